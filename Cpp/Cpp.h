@@ -76,6 +76,8 @@ struct Cpp_AccParams {
 	eAF flags;
 	int skip;
 	WCHAR resultProp;
+	STR resultProps; //properties to get for each found AO, like Cpp_AccGetProps. Then sResult is a pack of records (see "acc props.h").
+	int resultPropsLength;
 
 	Cpp_AccParams() noexcept { memset(this, 0, sizeof(*this)); }
 };
@@ -90,6 +92,9 @@ enum class eError
 	InvalidParameter = 0x1002, //invalid parameter, for example wildcard expression (or regular expression in it)
 	WindowClosed = 0x1003, //the specified window handle is invalid or the window was destroyed while injecting
 	WaitChromeDisabled = 0x1004, //need to wait while enabling Chrome AOs
+	Cancelled = 0x1005, //Cpp_AccFindAsync search cancelled with Cpp_AccFindAsyncCancel or Cpp_AccFindAsyncClose
+	Timeout = 0x1006, //Cpp_AccFindAsync search deadline expired
+	Pending = 0x1007, //Cpp_AccFindAsyncWait: still searching
 #ifdef Cpp_EXPORTS
 	Inject = 0x1100, //failed to inject this dll into the target process
 	WindowOfThisThread = 0x1101, //the specified window belongs to the caller thread
@@ -0,0 +1,183 @@
+//Asynchronous 'find AO'. Cpp_AccFindAsync starts Cpp_AccFind in a worker thread and returns a handle.
+//The caller can wait with timeout, read progress (count of visited AOs), cancel, and run several searches at the same time.
+//Cancellation and deadline are cooperative: the finder checks them between AOs. When in-proc, through memory shared with the target process (AccCancelShared).
+//The platform-neutral part (handle table, cancellation token) is in "acc async.h".
+
+#include "stdafx.h"
+#include "cpp.h"
+#include "acc.h"
+
+namespace outproc
+{
+void HwndTidCache_OnThreadDetach();
+}
+
+namespace
+{
+//Parameters and results of a Cpp_AccFindAsync search.
+class _AccFindJob : public AccAsyncJob
+{
+public:
+	//parameters
+	HWND w;
+	IStream* parentStream; //aParent marshaled for the worker thread (CoMarshalInterThreadInterfaceInStream), or null
+	Cpp_Acc parent; //parent elem and misc. acc is unmarshaled from parentStream.
+	std::wstring role, name, prop, resultProps; //copies of Cpp_AccParams strings, because the caller's strings are valid only while in Cpp_AccFindAsync
+	Cpp_AccParams ap; //its strings point to role, name, prop
+	AccCancelShared cancel;
+
+	//results
+	HRESULT hr;
+	IStream* resultStream; //found AO marshaled for the caller thread, or null
+	Cpp_Acc aResult; //elem and misc of the found AO. acc is unmarshaled from resultStream.
+	BSTR sResult; //resultProp, resultProps pack or error string
+
+	_AccFindJob() noexcept {
+		w = 0;
+		parentStream = null;
+		hr = (HRESULT)eError::Pending;
+		resultStream = null;
+		sResult = null;
+	}
+
+	~_AccFindJob() {
+		assert(!parentStream && !resultStream); //released by the worker or by Discard
+		SysFreeString(sResult);
+	}
+
+	//Copies ap and its strings.
+	void SetParams(const Cpp_AccParams& ap_) {
+		ap = ap_;
+		if(ap_.role) ap.role = role.assign(ap_.role, ap_.roleLength).c_str();
+		if(ap_.name) ap.name = name.assign(ap_.name, ap_.nameLength).c_str();
+		if(ap_.prop) ap.prop = prop.assign(ap_.prop, ap_.propLength).c_str();
+		if(ap_.resultProps) ap.resultProps = resultProps.assign(ap_.resultProps, ap_.resultPropsLength).c_str();
+	}
+
+	static void ReleaseStream(ref IStream*& stream) {
+		if(!stream) return;
+		CoReleaseMarshalData(stream);
+		stream->Release();
+		stream = null;
+	}
+
+	//Runs in the worker thread.
+	void Run() {
+		HRESULT hrCom = CoInitializeEx(0, COINIT_MULTITHREADED);
+
+		Cpp_Acc a, * aParent = null;
+		if(parentStream) {
+			a = parent;
+			HRESULT hrUnm = CoGetInterfaceAndReleaseStream(parentStream, IID_IAccessible, (void**)&a.acc);
+			parentStream = null; //released by CoGetInterfaceAndReleaseStream
+			if(hrUnm) hr = hrUnm; else aParent = &a;
+		}
+
+		if(!w == !aParent) hr = E_FAIL;
+		else {
+			Cpp_Acc r;
+			hr = outproc::AccFindEx(w, aParent, ap, null, out r, out sResult, &cancel);
+			if(hr == 0 && r.acc) {
+				aResult = r;
+				if(CoMarshalInterThreadInterfaceInStream(IID_IAccessible, r.acc, &resultStream)) { resultStream = null; hr = RPC_E_SERVER_CANTMARSHAL_DATA; }
+				r.acc->Release(); aResult.acc = null;
+			}
+		}
+		if(aParent) a.acc->Release();
+
+		if(!Publish()) ReleaseStream(ref resultStream); //closed while searching. Release now, while COM is initialized.
+
+		outproc::HwndTidCache_OnThreadDetach(); //release the cached agent AO now, not on DLL_THREAD_DETACH, when COM is uninitialized
+		if(hrCom == 0 || hrCom == S_FALSE) CoUninitialize();
+	}
+
+	//Called by Cpp_AccFindAsyncClose if the caller did not take the results.
+	void Discard() override {
+		ReleaseStream(ref resultStream);
+	}
+};
+
+AccAsyncJobs<_AccFindJob> s_accFindJobs;
+}
+
+namespace outproc
+{
+//Starts Cpp_AccFind in a worker thread and returns immediately.
+//Parameters w, aParent and ap are the same as with Cpp_AccFind. The 'also' callback is not supported; the search stops at the first found AO (can be used ap.skip and ap.resultProp).
+//timeoutMs - max search time. The search stops with eError::Timeout. If <= 0, no timeout.
+//handle - receives the search handle. Then call Cpp_AccFindAsyncWait to get results and Cpp_AccFindAsyncClose to free the handle.
+//Returns 0 or an error code.
+EXPORT HRESULT Cpp_AccFindAsync(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, int timeoutMs, out int& handle)
+{
+	handle = 0;
+	assert(!!w == !aParent);
+	if(!w == !aParent) return E_INVALIDARG;
+
+	auto job = std::make_shared<_AccFindJob>();
+	if(!job->cancel.Create()) return HRESULT_FROM_WIN32(GetLastError());
+	job->state = job->cancel.State();
+	job->state->SetTimeout(timeoutMs);
+	job->SetParams(ref ap);
+	job->w = w;
+	if(aParent) {
+		job->parent = *aParent;
+		job->parent.acc = null;
+		HRESULT hr = CoMarshalInterThreadInterfaceInStream(IID_IAccessible, aParent->acc, &job->parentStream);
+		if(hr) { job->parentStream = null; return hr; }
+	}
+
+	handle = s_accFindJobs.Start(job, [](_AccFindJob& j) { j.Run(); });
+	if(handle == 0) {
+		_AccFindJob::ReleaseStream(ref job->parentStream);
+		return E_OUTOFMEMORY;
+	}
+	return 0;
+}
+
+//Waits for results of Cpp_AccFindAsync.
+//waitMs - max time to wait. If 0, just checks. If < 0, infinite.
+//aResult, sResult - the same as with Cpp_AccFind. Can be retrieved once; later they are empty.
+//nodesVisited - receives the count of AOs visited so far. When in-proc, it is updated by the target process while searching.
+//Returns eError::Pending if still searching. Else returns the Cpp_AccFind result (0, eError::NotFound etc), or eError::Cancelled, eError::Timeout.
+//Returns E_HANDLE if the handle is invalid.
+EXPORT HRESULT Cpp_AccFindAsyncWait(int handle, int waitMs, out Cpp_Acc& aResult, out BSTR& sResult, out int& nodesVisited)
+{
+	aResult.Zero(); sResult = null;
+	nodesVisited = (int)s_accFindJobs.Progress(handle);
+	bool invalid;
+	auto job = s_accFindJobs.Wait(handle, waitMs, out invalid);
+	if(invalid) return E_HANDLE;
+	if(!job) return (HRESULT)eError::Pending;
+	nodesVisited = (int)job->state->visited.load();
+
+	HRESULT hr = job->hr;
+	if(job->resultStream) {
+		aResult = job->aResult;
+		HRESULT hrUnm = CoGetInterfaceAndReleaseStream(job->resultStream, IID_IAccessible, (void**)&aResult.acc);
+		job->resultStream = null;
+		if(hrUnm) { aResult.Zero(); hr = hrUnm; }
+	}
+	sResult = job->sResult; job->sResult = null;
+	return hr;
+}
+
+//Sets the cancellation flag of a Cpp_AccFindAsync search. It stops soon, when the finder visits the next AO.
+//Then Cpp_AccFindAsyncWait returns eError::Cancelled, unless already found.
+EXPORT bool Cpp_AccFindAsyncCancel(int handle)
+{
+	return s_accFindJobs.Cancel(handle);
+}
+
+//Frees the handle returned by Cpp_AccFindAsync. If still searching, cancels. Releases results not retrieved with Cpp_AccFindAsyncWait.
+EXPORT bool Cpp_AccFindAsyncClose(int handle)
+{
+	return s_accFindJobs.Close(handle);
+}
+
+//Closes all Cpp_AccFindAsync handles (like Cpp_AccFindAsyncClose) and waits until the search threads end.
+//Call before unloading this dll. Its static destructor cannot wait for the threads, because it runs under the loader lock; it only cancels them.
+EXPORT void Cpp_AccFindAsyncCloseAll()
+{
+	s_accFindJobs.CloseAll();
+}
+} //namespace outproc
@@ -0,0 +1,269 @@
+//Cancellation, deadline, progress and handle table for asynchronous 'find AO' (Cpp_AccFindAsync).
+//Platform-neutral: uses only the standard library. The Windows part is in "acc async.cpp".
+//It allows to test the scheduling/cancellation logic without COM, eg with a simulated slow AO tree.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//AccCancelToken::Visit result.
+enum class eAccCancel { None, Cancelled, Timeout };
+
+//Shared state of an asynchronous search: cancellation flag, deadline and progress.
+//POD-like, without pointers. Can be placed in memory shared with the target process, to control an in-proc search from this process.
+struct AccCancelState
+{
+	std::atomic<long> cancel; //!0 when cancelled by the caller
+	std::atomic<long> visited; //count of AOs visited by the finder
+	long long deadline; //AccCancelState::Now() time (ms) when the search must stop. 0 if no deadline.
+
+	AccCancelState() noexcept : cancel(0), visited(0), deadline(0) {}
+
+	//Sets deadline = now + ms. If ms <= 0, no deadline.
+	void SetTimeout(int ms) { deadline = ms > 0 ? Now() + ms : 0; }
+
+	//Monotonic time in milliseconds. Comparable between processes (steady clock is system-wide).
+	static long long Now() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static_assert(sizeof(std::atomic<long>) == sizeof(long), "AccCancelState must not contain locks");
+};
+
+//Checked by the finder between AOs.
+//Counts visited AOs and tells when to stop (cancelled or deadline).
+class AccCancelToken
+{
+	AccCancelState* _s;
+	eAccCancel _result;
+public:
+	AccCancelToken(AccCancelState* s) noexcept : _s(s), _result(eAccCancel::None) {}
+
+	//Call before visiting each AO. Returns true if the search must stop. Then Result() tells why.
+	bool Visit() {
+		if(_result != eAccCancel::None) return true;
+		_s->visited.fetch_add(1, std::memory_order_relaxed);
+		if(_s->cancel.load(std::memory_order_relaxed)) _result = eAccCancel::Cancelled;
+		else if(_s->deadline && AccCancelState::Now() >= _s->deadline) _result = eAccCancel::Timeout;
+		else return false;
+		return true;
+		//speed: Now() is fast compared with a single IAccessible call, even inproc. Don't need to check the time every n-th AO.
+	}
+
+	eAccCancel Result() const { return _result; }
+
+	long Visited() const { return _s->visited.load(std::memory_order_relaxed); }
+};
+
+//Base of jobs managed by AccAsyncJobs.
+//A derived class adds parameters and results.
+class AccAsyncJob
+{
+	template<class TJob> friend class AccAsyncJobs;
+	AccCancelState _localState;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	bool _done, _closed;
+	std::atomic<bool> _exited; //the worker thread function returned; joining the thread will not wait
+public:
+	//Cancellation/progress state used by the worker. By default points to a state in this object.
+	//Can be redirected to shared memory before AccAsyncJobs::Start.
+	AccCancelState* state;
+
+	AccAsyncJob() noexcept : _done(false), _closed(false), _exited(false) { state = &_localState; }
+	virtual ~AccAsyncJob() {}
+
+	//The worker calls this at the end, while its thread resources (eg COM) are still initialized. Marks the job done and wakes waiters.
+	//Returns false if the job has been closed. Then nobody will take the results, and the worker must free them.
+	bool Publish() {
+		bool closed;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_done = true;
+			closed = _closed;
+		}
+		_cv.notify_all();
+		return !closed;
+	}
+
+	bool IsDone() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _done;
+	}
+
+protected:
+	//Frees results that the caller did not take.
+	//Called by AccAsyncJobs::Close in the caller's thread if the job is done. Else the worker frees results when Publish returns false.
+	virtual void Discard() {}
+};
+
+//Table of asynchronous jobs identified by int handles.
+//Each job runs in its own thread. The caller can wait (with timeout), cancel, read progress and close.
+//A job is deleted when closed and its worker ended, whichever is last. Closing a running job cancels it.
+//The table owns the threads: a thread of a closed job is joined when the job is closed after it ended, else later, when the worker returns.
+//CloseAll closes all jobs and joins all threads. Call it before the table is destroyed; the destructor does not join (see ~AccAsyncJobs).
+template<class TJob>
+class AccAsyncJobs
+{
+	struct _Entry
+	{
+		std::shared_ptr<TJob> job;
+		std::thread thread;
+	};
+
+	std::mutex _mutex;
+	std::map<int, _Entry> _jobs;
+	std::vector<_Entry> _closing; //closed while running. Joined when the worker returns.
+	int _nextHandle = 1;
+
+	std::shared_ptr<TJob> _Get(int handle) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = _jobs.find(handle);
+		return it == _jobs.end() ? nullptr : it->second.job;
+	}
+
+	//Joins threads of closed jobs whose workers returned. Call while _mutex is locked.
+	void _JoinExited() {
+		for(size_t i = _closing.size(); i-- > 0; ) {
+			auto& e = _closing[i];
+			if(!static_cast<AccAsyncJob*>(e.job.get())->_exited.load()) continue;
+			if(e.thread.joinable()) e.thread.join();
+			_closing.erase(_closing.begin() + i);
+		}
+	}
+
+public:
+	using Worker = std::function<void(TJob& job)>;
+
+	AccAsyncJobs() = default;
+	AccAsyncJobs(const AccAsyncJobs&) = delete;
+	AccAsyncJobs& operator=(const AccAsyncJobs&) = delete;
+
+	//A static table is destroyed on DLL_PROCESS_DETACH, under the loader lock. Joining there would deadlock: an ending thread waits for the loader lock.
+	//Therefore cancels and detaches threads not joined by CloseAll. Each keeps its job alive until it returns.
+	~AccAsyncJobs() {
+		for(auto& x : _jobs) {
+			x.second.job->state->cancel.store(1);
+			if(x.second.thread.joinable()) x.second.thread.detach();
+		}
+		for(auto& e : _closing) {
+			e.job->state->cancel.store(1);
+			if(e.thread.joinable()) e.thread.detach();
+		}
+	}
+
+	//Adds the job and starts a thread that calls worker(*job).
+	//Returns the job handle (> 0), or 0 if failed to create thread.
+	int Start(std::shared_ptr<TJob> job, Worker worker) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_JoinExited();
+		int handle = _nextHandle++; if(_nextHandle <= 0) _nextHandle = 1;
+		auto& e = _jobs[handle];
+		e.job = job;
+		try {
+			e.thread = std::thread([job, worker]() {
+				worker(*job);
+				if(!job->IsDone()) job->Publish(); //normally the worker calls it
+				static_cast<AccAsyncJob*>(job.get())->_exited.store(true);
+			});
+		}
+		catch(...) {
+			_jobs.erase(handle);
+			return 0;
+		}
+		return handle;
+	}
+
+	//Waits until the job ends, max waitMs milliseconds (if < 0, infinite).
+	//Returns the job if ended, else null. Also null if the handle is invalid; then invalid is set to true.
+	std::shared_ptr<TJob> Wait(int handle, int waitMs, bool& invalid) {
+		auto job = _Get(handle);
+		invalid = job == nullptr;
+		if(invalid) return nullptr;
+		std::unique_lock<std::mutex> lock(job->_mutex);
+		if(waitMs < 0) job->_cv.wait(lock, [&job] { return job->_done; });
+		else if(!job->_cv.wait_for(lock, std::chrono::milliseconds(waitMs), [&job] { return job->_done; })) return nullptr;
+		return job;
+	}
+
+	//Sets the cancellation flag. The worker stops when it visits the next AO.
+	bool Cancel(int handle) {
+		auto job = _Get(handle);
+		if(!job) return false;
+		job->state->cancel.store(1);
+		return true;
+	}
+
+	//Returns the count of AOs visited so far, or -1 if the handle is invalid.
+	long Progress(int handle) {
+		auto job = _Get(handle);
+		return job ? job->state->visited.load(std::memory_order_relaxed) : -1;
+	}
+
+	//Removes the job from the table. If done, frees results that the caller did not take (AccAsyncJob::Discard). Else cancels.
+	//The job object is deleted now or when its worker ends.
+	bool Close(int handle) {
+		_Entry e;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto it = _jobs.find(handle);
+			if(it == _jobs.end()) return false;
+			e = std::move(it->second);
+			_jobs.erase(it);
+		}
+		auto job = e.job;
+		bool done;
+		{
+			std::lock_guard<std::mutex> lock(job->_mutex);
+			job->_closed = true;
+			done = job->_done;
+		}
+		if(done) {
+			static_cast<AccAsyncJob*>(job.get())->Discard();
+			//The worker has published; it returns soon, after releasing its thread resources.
+			if(e.thread.joinable()) e.thread.join();
+			std::lock_guard<std::mutex> lock(_mutex);
+			_JoinExited();
+		} else {
+			job->state->cancel.store(1);
+			std::lock_guard<std::mutex> lock(_mutex);
+			_closing.push_back(std::move(e));
+			_JoinExited();
+		}
+		return true;
+	}
+
+	//Closes all jobs (see Close), including cancelling those still running, and waits until all threads end.
+	//Call in a thread where the results can be freed, eg the thread that took the results, not in DllMain.
+	void CloseAll() {
+		std::vector<int> handles;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for(auto& x : _jobs) handles.push_back(x.first);
+		}
+		for(int h : handles) Close(h);
+		std::vector<_Entry> closing;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			closing = std::move(_closing);
+			_closing.clear();
+		}
+		for(auto& e : closing) if(e.thread.joinable()) e.thread.join();
+	}
+
+	//Returns the count of threads not joined yet: of jobs not closed, and of closed jobs whose workers did not return.
+	size_t ThreadCount() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_JoinExited();
+		size_t n = _closing.size();
+		for(auto& x : _jobs) if(x.second.thread.joinable()) n++;
+		return n;
+	}
+};
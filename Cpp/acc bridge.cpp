@@ -2,10 +2,11 @@
 #include "cpp.h"
 #include "acc.h"
 
-HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, eAF2 flags2, out BSTR& errStr);
+HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, eAF2 flags2, out BSTR& errStr, AccCancelToken* cancel = null);
 HRESULT AccFromPoint(POINT p, int flags, int specWnd, out Cpp_Acc& aResult);
 HRESULT AccNavigate(Cpp_Acc aFrom, STR navig, out Cpp_Acc& aResult);
 HRESULT AccGetProp(Cpp_Acc a, WCHAR what, out BSTR& sResult);
+void AccGetProps(Cpp_Acc a, STR props, int len, ref AccPropsWriter& w);
 
 namespace {
 
@@ -26,6 +27,11 @@ private:
 	eAF _flags;
 	int _skip;
 	WCHAR _resultProp;
+	_FlatStr _resultProps;
+	//Cpp_AccFindAsync cancellation. The in-proc finder opens AccCancelShared(_cancelPid, _cancelId). If fails, uses only _deadline.
+	DWORD _cancelPid;
+	long _cancelId;
+	long long _deadline;
 
 	LPWSTR _SetString(STR s, int len, LPWSTR dest, out _FlatStr& r) {
 		if(!s) {
@@ -44,7 +50,7 @@ private:
 	}
 public:
 	static int CalcMemSize(const Cpp_AccParams& ap) {
-		return sizeof(MarshalParams_AccFind) + (ap.roleLength + ap.nameLength + ap.propLength + 3) * 2;
+		return sizeof(MarshalParams_AccFind) + (ap.roleLength + ap.nameLength + ap.propLength + ap.resultPropsLength + 4) * 2;
 	}
 
 	void Marshal(HWND w, const Cpp_AccParams& ap, eAF2 flags2_) {
@@ -58,6 +64,14 @@ public:
 		_flags = ap.flags;
 		_skip = ap.skip;
 		_resultProp = ap.resultProp;
+		s = _SetString(ap.resultProps, ap.resultPropsLength, s, out _resultProps);
+		_cancelPid = 0; _cancelId = 0; _deadline = 0;
+	}
+
+	void MarshalCancel(AccCancelShared* cancel) {
+		_cancelPid = cancel->pid;
+		_cancelId = cancel->id;
+		_deadline = cancel->State()->deadline;
 	}
 
 	void Unmarshal(out Cpp_AccParams& ap) {
@@ -67,6 +81,15 @@ public:
 		ap.flags = _flags;
 		ap.skip = _skip;
 		ap.resultProp = _resultProp;
+		ap.resultProps = _GetString(_resultProps, out ap.resultPropsLength);
+	}
+
+	//If used MarshalCancel, opens the shared cancellation state and returns it. If fails to open, sets a local state with the same deadline.
+	AccCancelState* UnmarshalCancel(out AccCancelShared& shared, out AccCancelState& local) {
+		if(!_cancelId) return null;
+		if(shared.Open(_cancelPid, _cancelId)) return shared.State();
+		local.deadline = _deadline; //eg target process of lower UAC integrity level
+		return &local;
 	}
 };
 
@@ -339,6 +362,27 @@ bool WriteAccToStream(ref Smart<IStream>& stream, Cpp_Acc a, Cpp_Acc* aPrev = nu
 
 #pragma endregion
 
+//Copies stream data to a new BSTR.
+//If tail not null, appends tail data (tailSize bytes) and its size (4 bytes). The caller gets it with InProcCall::DetachResultTail.
+HRESULT _StreamToResult(IStream* stream, out BSTR& sResult, const void* tail = null, DWORD tailSize = 0)
+{
+	DWORD streamSize, readSize;
+	if(istream::GetPos(stream, out streamSize) && istream::ResetPos(stream)) {
+		DWORD extra = tail ? tailSize + 4 : 0;
+		sResult = SysAllocStringByteLen(null, streamSize + extra);
+		if(0 == stream->Read(sResult, streamSize, &readSize) && readSize == streamSize) {
+			if(tail) {
+				auto p = (LPBYTE)sResult + streamSize;
+				memcpy(p, tail, tailSize);
+				memcpy(p + tailSize, &tailSize, 4);
+			}
+			return 0;
+		}
+		SysFreeString(sResult); sResult = null;
+	}
+	return RPC_E_SERVER_CANTMARSHAL_DATA;
+}
+
 } //namespace
 
 namespace inproc
@@ -385,15 +429,20 @@ HRESULT AccFindOrGet(MarshalParams_Header* h, IAccessible* iacc, out BSTR& sResu
 	} else { //IPA_AccFind
 		Cpp_AccParams ap;
 		auto p = (MarshalParams_AccFind*)h; p->Unmarshal(out ap);
+		AccCancelShared cancelShared; AccCancelState cancelLocal;
+		AccCancelState* cancelState = p->UnmarshalCancel(out cancelShared, out cancelLocal);
+		AccCancelToken cancel(cancelState);
 		HWND w = (HWND)(LPARAM)p->hwnd;
 		eAF2 flags2 = p->flags2;
 		bool findAll = !!(flags2&eAF2::FindAll);
 		auto resultProp = ap.resultProp;
+		STR resultProps = ap.resultProps; int nResultProps = ap.resultPropsLength;
+		AccPropsPacker pack;
 		HRESULT hr = (HRESULT)eError::NotFound;
 		Cpp_Acc aParent(iacc, 0, h->miscFlags), aPrev;
 
 		HRESULT hr2 = AccFind(
-			[&hr, &stream, &aPrev, resultProp, findAll, skip = ap.skip, &sResult](Cpp_Acc a) mutable
+			[&hr, &stream, &aPrev, resultProp, resultProps, nResultProps, &pack, findAll, skip = ap.skip, &sResult](Cpp_Acc a) mutable
 		{
 			if(!findAll && skip-- > 0) return eAccFindCallbackResult::Continue;
 
@@ -408,6 +457,11 @@ HRESULT AccFindOrGet(MarshalParams_Header* h, IAccessible* iacc, out BSTR& sResu
 				if(!WriteAccToStream(ref stream, a, &aPrev)) {
 					if(!findAll) goto ge;
 					stream->Seek(istream::LI(pos), STREAM_SEEK_SET, null);
+				} else if(resultProps) { //get props now, while we have the AO. Else the caller would call Cpp_AccGetProps for each AO.
+					Cpp_Acc ax = a; if(!(ax.misc.flags&(eAccMiscFlags::UIA | eAccMiscFlags::Java))) ax.misc.flags |= eAccMiscFlags::InProc; //for 'o', 'i', '@'
+					auto w = pack.BeginRecord(nResultProps);
+					AccGetProps(ax, resultProps, nResultProps, ref w);
+					pack.EndRecord();
 				}
 			}
 
@@ -416,20 +470,15 @@ HRESULT AccFindOrGet(MarshalParams_Header* h, IAccessible* iacc, out BSTR& sResu
 		ge:
 			hr = RPC_E_SERVER_CANTMARSHAL_DATA;
 			return eAccFindCallbackResult::StopNotFound;
-		}, w, w ? null : &aParent, ref ap, flags2, out sResult);
+		}, w, w ? null : &aParent, ref ap, flags2, out sResult, cancelState ? &cancel : null);
 
 		if(hr2 && hr2 != (HRESULT)eError::NotFound) return hr2;
 		if(hr) return hr;
 		if(resultProp) return 0;
+		if(resultProps) return _StreamToResult(stream, out sResult, pack.Data(), (DWORD)pack.Length() * 2);
 	}
 
-	DWORD streamSize, readSize;
-	if(istream::GetPos(stream, out streamSize) && istream::ResetPos(stream)) {
-		sResult = SysAllocStringByteLen(null, streamSize);
-		if(0 == stream->Read(sResult, streamSize, &readSize) && readSize == streamSize) return 0;
-		SysFreeString(sResult); sResult = null;
-	}
-	return RPC_E_SERVER_CANTMARSHAL_DATA;
+	return _StreamToResult(stream, out sResult);
 }
 
 bool AccDisconnectWrappers() { return AccessibleMarshalWrapper::Disconnect(); }
@@ -444,7 +493,7 @@ namespace outproc
 //dontNeedAO - don't need AO. Only release marshal data if need.
 HRESULT InProcCall::ReadResultAcc(ref Cpp_Acc& a, bool dontNeedAO/* = false*/) {
 	if(!_stream) {
-		_resultSize = _br.ByteLength(); if(_resultSize == 0) return RPC_E_CLIENT_CANTUNMARSHAL_DATA;
+		_resultSize = _br.ByteLength() - _tailSize; if(_resultSize == 0) return RPC_E_CLIENT_CANTUNMARSHAL_DATA;
 		HGLOBAL hg = GlobalAlloc(GMEM_MOVEABLE, _resultSize); if(hg == 0) return RPC_E_CLIENT_CANTUNMARSHAL_DATA;
 		LPVOID mem = GlobalLock(hg); memcpy(mem, _br, _resultSize); GlobalUnlock(mem);
 		CreateStreamOnHGlobal(hg, true, &_stream);
@@ -560,8 +609,17 @@ g1:
 //sResult - error string or a property of the found AO.
 //	When this func returns eError::InvalidParameter, it is error string.
 //	When this func returns 0 and used ap.resultProp, it is the property (string, or binary struct); null if '-'.
+//	When used ap.resultProps, it is a pack of property records (see "acc props.h"): one for each AO passed to 'also' (in the same order), or for the found AO if 'also' is null.
+//		Then it can be not null even if this func returns eError::NotFound, because with 'also' all AOs could be rejected.
 //	Else null.
 EXPORT HRESULT Cpp_AccFind(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, Cpp_AccCallbackT also, out Cpp_Acc& aResult, out BSTR& sResult)
+{
+	return AccFindEx(w, aParent, ap, also, out aResult, out sResult);
+}
+
+//Cpp_AccFind implementation. Also used by Cpp_AccFindAsync.
+//cancel - if not null, the finder checks it between AOs and writes progress there. Then can return eError::Cancelled or eError::Timeout.
+HRESULT AccFindEx(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, Cpp_AccCallbackT also, out Cpp_Acc& aResult, out BSTR& sResult, AccCancelShared* cancel/* = null*/)
 {
 	//Perf.First();
 	aResult.Zero(); sResult = null;
@@ -571,6 +629,10 @@ EXPORT HRESULT Cpp_AccFind(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, Cp
 
 	assert(!!w == !aParent);
 	assert(!ap.resultProp || !findAll);
+	if(ap.resultProps && (ap.resultProp || !AccIsPropString(ap.resultProps, ap.resultPropsLength))) {
+		sResult = SysAllocString(ap.resultProp ? L"resultProp and resultProps cannot be used together." : L"Unknown property character in resultProps.");
+		return (HRESULT)eError::InvalidParameter;
+	}
 
 	if(useWnd) {
 		//If role has prefix "web:" and w is IE, need to find the web browser control at first, because it's in a different process than IE.
@@ -604,18 +666,22 @@ EXPORT HRESULT Cpp_AccFind(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, Cp
 		auto sizeofParams = MarshalParams_AccFind::CalcMemSize(ref ap);
 		auto p = (MarshalParams_AccFind*)c.AllocParams(aParent, InProcAction::IPA_AccFind, sizeofParams);
 		p->Marshal(useWnd ? w : 0, ref ap, flags2);
+		if(cancel) p->MarshalCancel(cancel);
 
 		if(R = c.Call()) {
 			if(R == (HRESULT)eError::InvalidParameter) sResult = c.DetachResultBSTR();
+		} else if(ap.resultProps && !(sResult = c.DetachResultTail())) {
+			R = RPC_E_CLIENT_CANTUNMARSHAL_DATA;
 		} else if(!findAll) {
 			if(!ap.resultProp) R = c.ReadResultAcc(ref aResult);
 			else if(ap.resultProp != '-') sResult = c.DetachResultBSTR();
 		} else {
 			Cpp_Acc a;
-			int skip = ap.skip;
+			int skip = ap.skip, nAlso = 0;
 			for(;;) {
 				R = c.ReadResultAcc(ref a);
 				if(R) break; //NotFound when end of stream
+				nAlso++;
 				if(!also(a)) continue; //must Release u.acc, preferably later
 				if(skip-- == 0) {
 					a.acc->AddRef();
@@ -625,15 +691,33 @@ EXPORT HRESULT Cpp_AccFind(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, Cp
 			}
 			//release the marshal data of remaining AO
 			for(auto k = R; k == 0; ) k = c.ReadResultAcc(ref a, true);
+
+			//The target process got props of all matching AO, but sResult must contain only records of AO passed to 'also', like when not in-proc.
+			if(sResult) {
+				UINT len = SysStringLen(sResult);
+				size_t k = nAlso ? AccPropsTruncatePack((AccPropChar*)sResult, len, ap.resultPropsLength, nAlso) : 0;
+				if(k < len) {
+					BSTR b = k ? SysAllocStringLen(sResult, (UINT)k) : null;
+					SysFreeString(sResult); sResult = b;
+				}
+			}
 		}
 		//Perf.Next();
 	} else {
 		flags2 |= eAF2::NotInProc;
 		bool found = false;
+		AccCancelToken cancelToken(cancel ? cancel->State() : null);
+		AccPropsPacker pack;
+		auto getProps = [&ap, &pack](Cpp_Acc a) {
+			auto w = pack.BeginRecord(ap.resultPropsLength);
+			AccGetProps(a, ap.resultProps, ap.resultPropsLength, ref w);
+			pack.EndRecord();
+		};
 		R = AccFind(
-			[&found, &aResult, &sResult, &ap, skip = ap.skip, also](Cpp_Acc a) mutable
+			[&found, &aResult, &sResult, &ap, &getProps, skip = ap.skip, also](Cpp_Acc a) mutable
 		{
 			if(also) {
+				if(ap.resultProps) getProps(a);
 				a.acc->AddRef(); //of proxy (fast)
 				if(!also(a)) return eAccFindCallbackResult::Continue;
 			}
@@ -644,14 +728,16 @@ EXPORT HRESULT Cpp_AccFind(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, Cp
 			if(ap.resultProp) {
 				if(ap.resultProp != '-') AccGetProp(a, ap.resultProp, out sResult);
 			} else {
+				if(ap.resultProps && !also) getProps(a);
 				aResult = a;
 				a.acc->AddRef();
 			}
 
 			return eAccFindCallbackResult::StopFound;
-		}, w, aParent, ref ap, flags2, out sResult);
+		}, w, aParent, ref ap, flags2, out sResult, cancel ? &cancelToken : null);
 
 		if(!R && !found) R = (HRESULT)eError::NotFound;
+		if(ap.resultProps && pack.Count() && (!R || R == (HRESULT)eError::NotFound)) sResult = SysAllocStringLen((STR)pack.Data(), (UINT)pack.Length());
 	}
 	//Perf.NW();
 
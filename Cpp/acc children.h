@@ -0,0 +1,257 @@
+//Adaptive child-fetch policy used by AccChildren.
+//Platform-neutral: uses only the standard library. Works with any IAccChildSource, therefore can be tuned offline with recorded traces.
+
+//How it works:
+//	Children are fetched in chunks. Each chunk continues after the children fetched before; they are not fetched again.
+//		AccChildren continues the enumeration instead of skipping to an index (with AccessibleChildren, iChildStart other than 0 does not always get all children).
+//	The first chunk size is learned per provider (eg window class + process): the typical child count, max 100.
+//	If the first chunk is full, calls GetCount, unless learned that it is slow or unreliable for this provider. Protects from huge containers (maxcc).
+//	More children are fetched only when the caller needs them (AccChildren::GetNext). Each next chunk is 4 times bigger, or all if the count is known.
+//	With exactIndex, fetches only up to that index. With reverse or index from end, needs all children.
+
+#pragma once
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+
+//Learned statistics of a provider of AOs, eg window class in a process.
+//Updated by AccChildFetcher. Not thread-safe; AccChildStatsTable::Get returns a per-thread copy that is merged back later.
+struct AccChildStats
+{
+	static const int c_nBuckets = 18;
+
+	long nEnum; //count of enumerated containers
+	long hist[c_nBuckets]; //histogram of child counts. [0] - 0 children, [i] - from 2^(i-1) to 2^i-1, [c_nBuckets-1] - more
+	long nCount; //count of GetCount calls
+	long nCountWrong; //count of GetCount results that did not match the fetched count
+	long long countTime; //total time of GetCount calls, microseconds
+	long long fetchTime; //total time of Fetch calls, microseconds
+	long long nFetched; //total count of fetched children
+	long nRefetch; //count of Fetch calls that fetched more children of the same container
+
+	AccChildStats() noexcept { memset(this, 0, sizeof(*this)); }
+
+	void AddChildCount(int n) {
+		int i = 0;
+		for(unsigned u = (unsigned)n; u && i < c_nBuckets - 1; u >>= 1) i++;
+		hist[i]++;
+		nEnum++;
+	}
+
+	//Returns the child count of 90% containers (bucket upper bound), min 1. If not enough data, returns 100.
+	int TypicalCount() const {
+		if(nEnum < 20) return 100;
+		long need = nEnum - nEnum / 10, sum = 0;
+		for(int i = 0; i < c_nBuckets; i++) {
+			sum += hist[i];
+			if(sum >= need) return i == 0 ? 1 : (1 << i) - 1;
+		}
+		return 1 << (c_nBuckets - 1);
+	}
+
+	//Returns true if GetCount is not slower than fetching 4 children. Unknown (true) if not enough data.
+	bool IsCountCheap() const {
+		if(nCount < 4 || nFetched < 100) return true;
+		return countTime / nCount <= fetchTime * 4 / nFetched;
+	}
+
+	//Returns false if GetCount often returns incorrect values, eg 0 or 1 (noticed in IE).
+	bool IsCountReliable() const {
+		return nCountWrong * 4 <= nCount;
+	}
+
+	void Add(const AccChildStats& x) {
+		nEnum += x.nEnum;
+		for(int i = 0; i < c_nBuckets; i++) hist[i] += x.hist[i];
+		nCount += x.nCount; nCountWrong += x.nCountWrong;
+		countTime += x.countTime; fetchTime += x.fetchTime;
+		nFetched += x.nFetched; nRefetch += x.nRefetch;
+	}
+};
+
+//Children of an AO for AccChildFetcher.
+class IAccChildSource
+{
+public:
+	//Appends children [from, n) to the fetched children [0, from). from is 0 the first time, then the count returned by the previous call.
+	//Returns the count of fetched children (< n if there are no more), or -1 if failed. If failed, children [0, from) remain.
+	virtual int Fetch(int from, int n) = 0;
+	//Returns the child count (get_accChildCount), or -1 if failed.
+	virtual int GetCount() = 0;
+};
+
+//Decides how many children to fetch and when. See comments at the top of this file.
+class AccChildFetcher
+{
+	IAccChildSource& _src;
+	AccChildStats& _stats;
+	int _maxcc;
+	int _fetched; //count of children now in the source
+	int _total; //child count, if known, else -1
+	bool _tooMany; //more than maxcc children
+	bool _learned; //_stats.AddChildCount called
+
+	static long long _Now() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int _Fetch(int n) {
+		int from = _fetched;
+		if(from > 0) _stats.nRefetch++;
+		auto t = _Now();
+		int r = _src.Fetch(from, n);
+		_stats.fetchTime += _Now() - t;
+		if(r < from) r = from; //failed
+		_stats.nFetched += r - from;
+		_fetched = r;
+		if(r < n) _total = r;
+		return r;
+	}
+
+	void _Learn() {
+		if(_learned || _total < 0) return;
+		_learned = true;
+		_stats.AddChildCount(_total);
+	}
+
+	int _GetCount() {
+		auto t = _Now();
+		int r = _src.GetCount();
+		_stats.countTime += _Now() - t;
+		_stats.nCount++;
+		return r;
+	}
+
+public:
+	AccChildFetcher(IAccChildSource& src, AccChildStats& stats, int maxcc) noexcept
+		: _src(src), _stats(stats), _maxcc(maxcc), _fetched(0), _total(-1), _tooMany(false), _learned(false) {}
+
+	//Fetches the first chunk.
+	//need - how many children the caller needs: -1 all, 0 unknown (eg searching; maybe will stop at the first child), else need children [0, need).
+	//minFetch - fetch at least this count of children, eg to see whether all children of a container with a known layout are fetched.
+	//Returns the count of fetched children. 0 if there are no children or more than maxcc.
+	int Begin(int need, int minFetch = 0) {
+		int n = need > 0 ? need : _stats.TypicalCount() + 1; //+1 to detect 'no more' without GetCount
+		if(need == 0 && n > 100) n = 100;
+		if(need >= 0 && n < minFetch) n = minFetch;
+		if(need < 0) {
+			if(_stats.IsCountCheap() && _stats.IsCountReliable()) {
+				int k = _GetCount();
+				if(k > _maxcc) return _SetTooMany();
+				if(k > 0) n = k + 1;
+			} else if(n < 100) n = 100;
+		}
+		if(n > _maxcc && _maxcc < INT_MAX) n = _maxcc + 1;
+
+		int r = _Fetch(n);
+		if(r == n && _total < 0) { //more children?
+			//Like before this class existed, check the count once. Protection from AO such as LibreOffice Calc TABLE that has 1073741824 children.
+			//	Don't if learned that GetCount is slow or unreliable with this provider. Then Ensure fetches with growing chunks.
+			if(_stats.nCount < 4 || (_stats.IsCountCheap() && _stats.IsCountReliable())) {
+				int k = _GetCount();
+				if(k >= 0 && k < r) _stats.nCountWrong++; //some objects return 0 or 1. Noticed in IE.
+				else if(k == r) _total = r;
+				else if(k > _maxcc) return _SetTooMany();
+				else if(k > r) _total = k;
+			}
+			if(r > _maxcc) return _SetTooMany();
+			if(need < 0) Ensure(INT_MAX - 1);
+		}
+		_Learn();
+		return Fetched();
+	}
+
+	//Ensures that child i is fetched, if exists. Fetches more children if need.
+	//Returns false if there is no child i (or more than maxcc children). Then Total() is known.
+	bool Ensure(int i) {
+		if(_tooMany || (_total >= 0 && i >= _total)) return false;
+		if(i < _fetched) return true;
+		int total0 = _total;
+		while(i >= _fetched && !_tooMany) {
+			int n;
+			if(_total >= 0) n = _total; //count known. Fetch all. Don't make many cross-process calls.
+			else {
+				long long k = (long long)_fetched * 4; if(k <= i) k = (long long)i + 1;
+				if(k > (long long)_maxcc + 1) k = (long long)_maxcc + 1;
+				n = (int)(k < INT_MAX ? k : INT_MAX);
+			}
+			int r = _Fetch(n);
+			if(r > _maxcc) _SetTooMany();
+			else if(r < n) break; //no more (_Fetch set _total)
+			else if(total0 >= 0 && r == total0) break; //all
+		}
+		_Learn();
+		return !_tooMany && i < _fetched;
+	}
+
+	//Count of children now in the source.
+	int Fetched() const { return _tooMany ? 0 : _fetched; }
+
+	//Child count, or -1 if still unknown.
+	int Total() const { return _tooMany ? 0 : _total; }
+
+	//true if all children are in the source.
+	bool IsAll() const { return _tooMany || (_total >= 0 && _fetched >= _total); }
+
+	bool IsTooMany() const { return _tooMany; }
+
+private:
+	int _SetTooMany() {
+		_tooMany = true;
+		if(!_learned) { _learned = true; _stats.AddChildCount(INT_MAX); }
+		return 0;
+	}
+};
+
+//Learned AccChildStats of all providers in this process.
+//Each thread gets a copy (Get), and merges the changes back when done (Merge). Then AccChildren does not need to lock.
+class AccChildStatsTable
+{
+	std::mutex _mutex;
+	std::map<std::wstring, AccChildStats> _map;
+public:
+	//Gets a snapshot of stats of a provider. key - eg window class name and process id.
+	AccChildStats Get(const std::wstring& key) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = _map.find(key);
+		return it == _map.end() ? AccChildStats() : it->second;
+	}
+
+	//Adds stats collected since Get. snapshot - the value returned by Get; current - the same after using.
+	void Merge(const std::wstring& key, const AccChildStats& snapshot, const AccChildStats& current) {
+		AccChildStats d = current;
+		d.nEnum -= snapshot.nEnum;
+		for(int i = 0; i < AccChildStats::c_nBuckets; i++) d.hist[i] -= snapshot.hist[i];
+		d.nCount -= snapshot.nCount; d.nCountWrong -= snapshot.nCountWrong;
+		d.countTime -= snapshot.countTime; d.fetchTime -= snapshot.fetchTime;
+		d.nFetched -= snapshot.nFetched; d.nRefetch -= snapshot.nRefetch;
+		std::lock_guard<std::mutex> lock(_mutex);
+		_map[key].Add(d);
+	}
+
+	//Formats all stats for diagnostics. One line per provider:
+	//key|containers|typical count|GetCount calls|wrong|count us|fetched|fetch us|refetches|histogram
+	std::wstring ToString() {
+		std::wstring s;
+		std::lock_guard<std::mutex> lock(_mutex);
+		for(auto& kv : _map) {
+			auto& x = kv.second;
+			s += kv.first;
+			s += L'|'; s += std::to_wstring(x.nEnum);
+			s += L'|'; s += std::to_wstring(x.TypicalCount());
+			s += L'|'; s += std::to_wstring(x.nCount);
+			s += L'|'; s += std::to_wstring(x.nCountWrong);
+			s += L'|'; s += std::to_wstring(x.countTime);
+			s += L'|'; s += std::to_wstring(x.nFetched);
+			s += L'|'; s += std::to_wstring(x.fetchTime);
+			s += L'|'; s += std::to_wstring(x.nRefetch);
+			s += L'|';
+			for(int i = 0; i < AccChildStats::c_nBuckets; i++) { if(i) s += L' '; s += std::to_wstring(x.hist[i]); }
+			s += L'\n';
+		}
+		return s;
+	}
+};
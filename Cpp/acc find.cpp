@@ -1,11 +1,45 @@
 #include "stdafx.h"
 #include "cpp.h"
 #include "acc.h"
+#include "acc async.h"
 
 #pragma comment(lib, "oleacc.lib")
 
 bool AccMatchHtmlAttributes(IAccessible* iacc, NameValue* prop, int count);
 
+//Learned child-fetch stats of AO providers in this process. Used by AccChildren. See "acc children.h".
+AccChildStatsTable s_accChildStats;
+
+//Gets AccChildStats of a provider from s_accChildStats and merges changes back when destroyed.
+//The provider key is window class name and process id. When searching in an AO, "<acc>" and process id, because getting its window may be slow.
+class AccChildStatsScope
+{
+	std::wstring _key;
+	AccChildStats _snapshot;
+public:
+	AccChildStats stats;
+
+	AccChildStatsScope(HWND w)
+	{
+		DWORD pid = 0;
+		if(w) {
+			Bstr cn;
+			if(wnd::ClassName(w, out cn)) _key.assign(cn, cn.Length());
+			GetWindowThreadProcessId(w, &pid);
+		} else {
+			_key = L"<acc>";
+			pid = GetCurrentProcessId(); //when inproc, it is the target process
+		}
+		_key += L':'; _key += std::to_wstring(pid);
+		stats = _snapshot = s_accChildStats.Get(_key);
+	}
+
+	~AccChildStatsScope()
+	{
+		s_accChildStats.Merge(_key, _snapshot, stats);
+	}
+};
+
 class AccFinder
 {
 	//A parsed path part, when the role parameter is path like "A/B[4]/C". 
@@ -41,6 +75,8 @@ class AccFinder
 	IAccessible** _findDOCUMENT; //used by _FindDocumentSimple, else null
 	BSTR* _errStr; //error string, when a parameter is invalid
 	HWND _wTL; //window in which currently searching
+	AccCancelToken* _cancel; //used by Cpp_AccFindAsync, else null
+	AccChildStats* _childStats; //learned child-fetch stats of the provider (window class). Passed to AccChildren.
 
 	bool _Error(STR es) {
 		if(_errStr) *_errStr = SysAllocString(es);
@@ -301,10 +337,13 @@ public:
 		return true;
 	}
 
-	HRESULT Find(HWND w, const Cpp_Acc* a, AccFindCallback* callback)
+	HRESULT Find(HWND w, const Cpp_Acc* a, AccFindCallback* callback, AccCancelToken* cancel = null)
 	{
 		assert(!!w == !a);
 		_callback = callback;
+		_cancel = cancel;
+		AccChildStatsScope childStats(w);
+		_childStats = &childStats.stats;
 
 		if(a) {
 			if(!!(_flags2 & eAF2::InWebPage)) return _ErrorHR(L"Don't use role prefix when searching in Acc.");
@@ -342,6 +381,12 @@ public:
 			_FindInWnd(w);
 		}
 
+		if(!_found && _cancel) {
+			switch(_cancel->Result()) {
+			case eAccCancel::Cancelled: return (HRESULT)eError::Cancelled;
+			case eAccCancel::Timeout: return (HRESULT)eError::Timeout;
+			}
+		}
 		return _found ? 0 : (HRESULT)eError::NotFound;
 	}
 
@@ -386,7 +431,7 @@ private:
 			if(_path[level].exactIndex) exactIndex = true;
 		}
 
-		AccChildren c(ref aParent, startIndex, exactIndex, !!(_flags & eAF::Reverse), _maxCC);
+		AccChildren c(ref aParent, startIndex, exactIndex, !!(_flags & eAF::Reverse), _maxCC, _childStats);
 		if(c.Count() == 0) {
 			if(_wTL) {
 				//Java?
@@ -406,6 +451,7 @@ private:
 		for(;;) {
 			AccDtorIfElem0 aChild;
 			if(!c.GetNext(out aChild)) break;
+			if(_cancel && _cancel->Visit()) return true; //cancelled or timeout
 
 			switch(_Match(ref aChild, level)) {
 			case _eMatchResult::Stop: return true;
@@ -761,11 +807,12 @@ public:
 	}
 };
 
-HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, eAF2 flags2, out BSTR& errStr)
+//cancel - used by Cpp_AccFindAsync. The finder calls cancel->Visit() for each AO and stops if it returns true; then returns eError::Cancelled or eError::Timeout.
+HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, eAF2 flags2, out BSTR& errStr, AccCancelToken* cancel/* = null*/)
 {
 	AccFinder f(&errStr);
 	if(!f.SetParams(ref ap, flags2)) return (HRESULT)eError::InvalidParameter;
-	return f.Find(w, aParent, &callback);
+	return f.Find(w, aParent, &callback, cancel);
 }
 
 HRESULT GetChromeDOCUMENT(HWND w, IAccessible* aCLIENT, out IAccessible** ar)
@@ -789,8 +836,38 @@ HRESULT AccEnableChrome2(MarshalParams_AccElem* p)
 }
 }
 
+namespace inproc
+{
+//Formats s_accChildStats. Called in the target process (IPA_AccChildStats) or in this process.
+HRESULT AccChildStatsToString(out BSTR& sResult)
+{
+	auto s = s_accChildStats.ToString();
+	sResult = SysAllocStringLen(s.c_str(), (UINT)s.size());
+	return 0;
+}
+}
+
 namespace outproc
 {
+//Gets learned child-fetch stats of AO providers, for diagnostics. See "acc children.h".
+//w - if not 0, gets stats collected in the process of w (in-proc searches). Else stats of this process (searches with flag NotInProc).
+//sResult - one line per provider: key|containers|typical count|GetCount calls|wrong|count us|fetched|fetch us|refetches|histogram.
+EXPORT HRESULT Cpp_AccChildStats(HWND w, out BSTR& sResult)
+{
+	sResult = null;
+	if(!w) return inproc::AccChildStatsToString(out sResult);
+
+	IAccessible* iAgent;
+	HRESULT hr = InjectDllAndGetAgent(w, out iAgent);
+	if(hr) return hr;
+
+	InProcCall c;
+	c.AllocParams(iAgent, InProcAction::IPA_AccChildStats, sizeof(MarshalParams_Header));
+	if(hr = c.Call()) return hr;
+	sResult = c.DetachResultBSTR();
+	return 0;
+}
+
 //Returns: 0 not Chrome, 1 Chrome was already enabled, 2 Chrome enabled now.
 int AccEnableChrome(HWND w, bool checkClassName)
 {
@@ -320,22 +320,26 @@ HRESULT AccGetProp(Cpp_Acc a, WCHAR prop, out BSTR& sResult)
 	return hr;
 }
 
-HRESULT AccGetProps(Cpp_Acc a, STR props, out BSTR& sResult)
+//Gets multiple properties and adds them to a props record (see "acc props.h").
+//props must contain only valid property characters (AccIsPropString).
+void AccGetProps(Cpp_Acc a, STR props, int len, ref AccPropsWriter& w)
 {
-	sResult = null;
-	str::StringBuilder s;
-	s.AppendChar(0, (int)str::Len(props) * 4); //reserve for offsets
-	for(int i = 0; *props; props++, i++) {
+	for(int i = 0; i < len; i++) {
 		Bstr b;
-		HRESULT hr = AccGetProp(a, *props, out b.m_str);
-		((int*)(LPWSTR)s)[i] = (int)s.Length(); //offset
-		if(hr) {
-			if(hr == (HRESULT)eError::InvalidParameter) return hr;
-			continue;
-		}
-		s.AppendBSTR(b);
+		if(0 == AccGetProp(a, props[i], out b.m_str) && b) w.Add(b.m_str, SysStringByteLen(b));
+		else w.AddEmpty();
 	}
-	sResult = s.ToBSTR();
+}
+
+HRESULT AccGetProps(Cpp_Acc a, STR props, out BSTR& sResult)
+{
+	sResult = null;
+	int len = (int)str::Len(props);
+	if(!AccIsPropString(props, len)) return (HRESULT)eError::InvalidParameter;
+	std::vector<AccPropChar> v;
+	AccPropsWriter w(v, len);
+	AccGetProps(a, props, len, ref w);
+	sResult = SysAllocStringLen((STR)v.data(), (UINT)v.size());
 	return 0;
 }
 
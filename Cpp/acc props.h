@@ -0,0 +1,182 @@
+//Packing of AO properties returned by Cpp_AccGetProps and by Cpp_AccFind with Cpp_AccParams.resultProps.
+//Platform-neutral: uses only the standard library. Data is in 16-bit units (WCHAR in Windows), therefore can be encoded and decoded anywhere, eg to test without COM.
+
+//Record format (the same as always returned by Cpp_AccGetProps):
+//	int offsets[nProps] - offset of each property value, in 16-bit units from the record start. A value ends where the next begins, the last at the record end.
+//	values - strings (without '\0'), or binary data ('s' state, 'r' rect, 'w' window) padded to 16-bit units. Empty if the property is empty or failed to get.
+//Pack format (Cpp_AccFind with resultProps):
+//	int count - count of records.
+//	For each record: int length (16-bit units), then the record.
+//ints are 32-bit, in 2 units, native byte order.
+
+#pragma once
+#include <cstring>
+#include <vector>
+
+using AccPropChar = char16_t;
+
+//Returns true if c is a property character supported by Cpp_AccGetProp, like 'n' for name.
+inline bool AccIsPropChar(int c) {
+	switch(c) {
+	case 'R': case 'n': case 'v': case 'd': case 'h': case 'a': case 'k': case 'u':
+	case 's': case 'r': case 'c': case 'w': case 'o': case 'i': case '@': return true;
+	}
+	return false;
+}
+
+//Returns true if all characters of props are property characters (AccIsPropChar).
+template<class TChar>
+bool AccIsPropString(const TChar* props, int len) {
+	for(int i = 0; i < len; i++) if(!AccIsPropChar(props[i])) return false;
+	return true;
+}
+
+//Appends a props record to a buffer.
+//Call Add or AddEmpty once for each property, in the props string order.
+class AccPropsWriter
+{
+	std::vector<AccPropChar>& _b;
+	size_t _start;
+	int _n, _i;
+
+	static void _SetInt(AccPropChar* p, int v) { memcpy(p, &v, 4); }
+public:
+	AccPropsWriter(std::vector<AccPropChar>& b, int nProps) : _b(b), _start(b.size()), _n(nProps), _i(0) {
+		_b.resize(_start + (size_t)nProps * 2);
+	}
+
+	//Adds a property value. bytes - data size; if odd, the value is padded with a 0 byte.
+	void Add(const void* data, size_t bytes) {
+		AddEmpty();
+		if(bytes == 0) return;
+		size_t k = _b.size(), n = (bytes + 1) / 2;
+		_b.resize(k + n);
+		_b[k + n - 1] = 0;
+		memcpy(&_b[k], data, bytes);
+	}
+
+	//Adds an empty value. Use when the property is empty or failed to get.
+	void AddEmpty() {
+		if(_i >= _n) return;
+		_SetInt(&_b[_start + (size_t)_i++ * 2], (int)(_b.size() - _start));
+	}
+
+	//Count of properties added so far.
+	int Added() const { return _i; }
+
+	//Record length so far, in 16-bit units.
+	size_t Length() const { return _b.size() - _start; }
+};
+
+//Builds a pack of props records, one for each found AO.
+class AccPropsPacker
+{
+	std::vector<AccPropChar> _b;
+	size_t _recordStart;
+	int _count;
+
+	static void _SetInt(AccPropChar* p, int v) { memcpy(p, &v, 4); }
+public:
+	AccPropsPacker() : _b(2), _recordStart(0), _count(0) {}
+
+	//Starts a record. Then add nProps values with the returned writer, and call EndRecord.
+	AccPropsWriter BeginRecord(int nProps) {
+		_recordStart = _b.size();
+		_b.resize(_recordStart + 2);
+		return AccPropsWriter(_b, nProps);
+	}
+
+	void EndRecord() {
+		_SetInt(&_b[_recordStart], (int)(_b.size() - _recordStart - 2));
+		_SetInt(&_b[0], ++_count);
+	}
+
+	//Removes the record started with BeginRecord.
+	void DiscardRecord() {
+		_b.resize(_recordStart);
+	}
+
+	int Count() const { return _count; }
+
+	const AccPropChar* Data() const { return _b.data(); }
+
+	//Pack length, in 16-bit units.
+	size_t Length() const { return _b.size(); }
+};
+
+//A decoded props record. Points to the pack or Cpp_AccGetProps result memory.
+struct AccPropsRecord
+{
+	const AccPropChar* p;
+	int length; //16-bit units
+	int nProps;
+
+	//Initializes from memory in record format. Returns false if the data is invalid.
+	bool Init(const AccPropChar* data, int len, int nProps_) {
+		p = data; length = len; nProps = nProps_;
+		if(len < 0 || nProps < 0 || (long long)nProps * 2 > len) return false;
+		for(int i = 0, prev = nProps * 2; i < nProps; i++) {
+			int k = _Offset(i);
+			if(k < prev || k > len) return false;
+			prev = k;
+		}
+		return true;
+	}
+
+	//Gets value of property i (index in the props string). len - 16-bit units. Returns false if empty.
+	bool Get(int i, const AccPropChar*& value, int& len) const {
+		int k = _Offset(i), e = i == nProps - 1 ? length : _Offset(i + 1);
+		value = p + k; len = e - k;
+		return len > 0;
+	}
+
+private:
+	int _Offset(int i) const { int r; memcpy(&r, p + (size_t)i * 2, 4); return r; }
+};
+
+//Decodes a pack created by AccPropsPacker.
+class AccPropsReader
+{
+	const AccPropChar* _p;
+	size_t _len, _pos;
+	int _nProps, _count, _i;
+
+	int _Int(size_t pos) const { int r; memcpy(&r, _p + pos, 4); return r; }
+public:
+	//data, len - the pack (len in 16-bit units). nProps - length of the props string used to create the pack.
+	AccPropsReader(const AccPropChar* data, size_t len, int nProps) : _p(data), _len(len), _pos(2), _nProps(nProps), _i(0) {
+		_count = (data && len >= 2) ? _Int(0) : 0;
+		if(_count < 0) _count = 0;
+	}
+
+	//Count of records.
+	int Count() const { return _count; }
+
+	//Gets the next record. Returns false if there are no more records or the data is invalid.
+	bool Next(AccPropsRecord& r) {
+		if(_i >= _count || _pos + 2 > _len) return false;
+		int n = _Int(_pos);
+		if(n < 0 || (size_t)n > _len - _pos - 2) return false;
+		if(!r.Init(_p + _pos + 2, n, _nProps)) return false;
+		_pos += 2 + (size_t)n; _i++;
+		return true;
+	}
+
+	//Count of records got with Next.
+	int Read() const { return _i; }
+
+	//Length of the pack part that contains the records got with Next, in 16-bit units.
+	size_t Position() const { return _pos; }
+};
+
+//Removes records after the first count records of a pack created by AccPropsPacker.
+//Returns the new pack length, in 16-bit units. The pack memory is not reallocated.
+inline size_t AccPropsTruncatePack(AccPropChar* pack, size_t len, int nProps, int count) {
+	AccPropsReader r(pack, len, nProps);
+	if(count >= r.Count()) return len;
+	AccPropsRecord x;
+	while(r.Read() < count && r.Next(x)) {}
+	int n = r.Read();
+	memcpy(pack, &n, 4);
+	return r.Position();
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include "stdafx.h"
 #include "internal.h"
+#include "acc children.h"
+#include "acc props.h"
 
 //IAccessible helper methods. All methods are static; use this class like a namespace.
 //Other helper methods are in AccRaw. This class contains methods that don't depend on AccRaw.
@@ -443,81 +445,130 @@ public:
 
 
 //Gets child AOs.
-class AccChildren
+//Fetches children lazily, in chunks, as decided by AccChildFetcher (see "acc children.h").
+class AccChildren : IAccChildSource
 {
 	IAccessible* _parent;
-	VARIANT* _v;
-	int _count, _i, _startAtIndex;
-	bool _exactIndex, _reverse;
+	VARIANT* _v; //fetched children
+	int _nv, _capacity; //count of fetched VARIANTs in _v, and _v capacity
+	Smart<IEnumVARIANT> _enum; //enumerates the children in chunks, if the parent has it
+	int _count, _i, _startAtIndex; //_count - count of children that can be used now. More can be fetched, unless _complete.
+	bool _exactIndex, _reverse, _complete;
 	eAccMiscFlags _miscFlags;
+	AccChildFetcher _f;
+
+	//Returns stats used when the caller does not specify a provider, eg when navigating.
+	static AccChildStats& _DefaultStats() {
+		static thread_local AccChildStats t_stats;
+		return t_stats;
+	}
+
+	void _Clear() {
+		while(_nv > 0) VariantClear(&_v[--_nv]); //info: it's OK to clear variants for which FromVARIANT was called because then vt is 0
+	}
+
+	//IAccChildSource
+	int Fetch(int from, int n) override
+	{
+		if(from == 0) {
+			_Clear();
+			_enum.Release();
+		}
+		if(n > _capacity) {
+			auto v = (VARIANT*)realloc(_v, n * sizeof(VARIANT));
+			if(v == null) return -1;
+			_v = v;
+			_capacity = n;
+		}
+		//Like AccessibleChildren, but the next chunk continues the enumeration. AccessibleChildren would Skip to iChildStart, which does not always get all children.
+		ULONG got = 0;
+		HRESULT hr;
+		if(from == 0 && 0 == _parent->QueryInterface(&_enum)) _enum->Reset();
+		if(_enum) hr = _enum->Next(n - from, _v + from, &got);
+		else { //AccessibleChildren uses get_accChild with each index
+			long k = 0;
+			hr = AccessibleChildren(_parent, from, n - from, _v + from, &k);
+			got = k;
+		}
+		if(hr < 0) { //rare
+			//PRINTHEX(hr);
+			//ao::PrintAcc(_parent);
+			return -1;
+		}
+		_nv = from + got;
+		return _nv;
+
+		//speed: AccessibleChildren same as IEnumVARIANT with array. IEnumVARIANT.Next(1, ...) much slower (if out-proc).
+	}
+
+	//IAccChildSource
+	int GetCount() override
+	{
+		long n = 0;
+		if(0 != _parent->get_accChildCount(&n)) return -1;
+		return n; //note: some objects return 0 or 1, ie < n, and hr is usually 0. Noticed this only in IE, when c_nStack<10.
+	}
+
+	//Returns true if child i exists. If need, fetches more children.
+	bool _Has(int i)
+	{
+		if(i < _count) return true;
+		if(_complete) return false;
+		bool R = _f.Ensure(i);
+		_count = _f.Fetched();
+		_complete = _f.IsAll();
+		return R;
+	}
 
 public:
-	AccChildren(const Cpp_Acc& parent, int startAtIndex = 0, bool exactIndex = false, bool reverse = false, int maxcc = 10000)
+	//stats - learned stats of the provider (window class etc), to decide how many children to fetch. If null, uses stats of this thread.
+	AccChildren(const Cpp_Acc& parent, int startAtIndex = 0, bool exactIndex = false, bool reverse = false, int maxcc = 10000, AccChildStats* stats = null)
+		: _f(*this, stats ? *stats : _DefaultStats(), maxcc)
 	{
 		_parent = parent.acc;
 		_miscFlags = parent.misc.flags&eAccMiscFlags::InheritMask;
 		_v = null;
-		_count = -1;
+		_nv = _capacity = 0;
 		_i = 0;
 		_exactIndex = exactIndex;
 		_reverse = reverse;
 		_startAtIndex = startAtIndex;
 
 		//note: don't call get_accChildCount here. With Firefox etc it makes almost 2 times slower (outproc). With others same speed.
-
-		const int c_nStack = 100; //info: fast even with 10 or 7, but 5 makes slower. Just slightly faster with 100. Not faster with 30 etc.
-		VARIANT v[c_nStack];
-		long n = 0;
-		int hr = AccessibleChildren(_parent, 0, c_nStack, v, &n);
-		if(hr < 0) { //rare
-			n = 0;
-			//PRINTHEX(hr);
-			//ao::PrintAcc(_parent);
+		//	AccChildFetcher calls it only when the first chunk is full (like the old code), or when need all children and learned that it is fast.
+
+		int need = 0; //unknown; fetch the typical count, more later if need
+		if(reverse || startAtIndex < 0) need = -1; //all
+		else if(startAtIndex > 0) need = startAtIndex; //eg "A/B[4]/C". With exactIndex don't need more.
+
+		//_RemoveInvisibleNonclient removes children of a WINDOW that has exactly 7 children, before indices are calculated.
+		//	Fetch at least 8, so that then all children are fetched now, like with the old code that fetched 100.
+		bool mayBeWindow = !(parent.misc.flags&(eAccMiscFlags::UIA | eAccMiscFlags::Java)) && (parent.misc.role == ROLE_SYSTEM_WINDOW || parent.misc.role == 0);
+		_count = _f.Begin(need, mayBeWindow ? 8 : 0);
+		_complete = _f.IsAll();
+		if(_complete && _count > 0 && mayBeWindow) {
+			_nv = _count = _RemoveInvisibleNonclient(_v, _count, parent.misc.role);
 		}
 
-		if(n == c_nStack) { //more children?
-			_parent->get_accChildCount(&n); //note: some objects return 0 or 1, ie < n, and hr is usually 0. Noticed this only in IE, when c_nStack<10.
-			if(n != c_nStack) { //yes, more children
-				for(int i = c_nStack; i > 0;) VariantClear(&v[--i]);
-				if(n > maxcc) { //protection from AO such as LibreOffice Calc TABLE that has 1073741824 children. Default 10000.
-					n = 0;
-				} else {
-					if(n < c_nStack) n = 1000; //get_accChildCount returned error or incorrect value
-					_v = (VARIANT*)malloc(n * sizeof(VARIANT));
-					hr = AccessibleChildren(_parent, 0, n, _v, &n); //note: iChildStart must be 0, else not always gets all children
-					if(hr < 0) { PRINTHEX(hr); n = 0; }
-				}
-			}
-		} else if(!(parent.misc.flags&(eAccMiscFlags::UIA | eAccMiscFlags::Java))) {
-			n = _RemoveInvisibleNonclient(v, n, parent.misc.role);
-		}
-
-		if(n > 0 && _v == null) {
-			int memSize = n * sizeof(VARIANT);
-			_v = (VARIANT*)malloc(memSize);
-			memcpy(_v, v, memSize);
-		}
-
-		_count = n;
+		int n = _count;
 		if(n > 0 && _startAtIndex != 0) {
 			if(_startAtIndex < 0) _startAtIndex = n + _startAtIndex; else _startAtIndex--; //if < 0, it is index from end
-			int i = _startAtIndex; if(i < 0) i = 0; else if(i >= n) i = n - 1;
+			int i = _startAtIndex; if(i < 0) i = 0; else if(!_Has(i)) i = _count - 1;
 			if(_exactIndex && i != _startAtIndex) _startAtIndex = -1; else _startAtIndex = i;
 		} else _startAtIndex = -1; //not used
 
-		//speed: AccessibleChildren same as IEnumVARIANT with array. IEnumVARIANT.Next(1, ...) much slower (if out-proc).
-
 		//50% AO have 0 children. 20% have 1 child. Few have > 7.
 	}
 
 	~AccChildren()
 	{
 		if(_v != null) {
-			while(_count > 0) VariantClear(&_v[--_count]); //info: it's OK to clear variants for which FromVARIANT was called because then vt is 0
+			_Clear();
 			free(_v); _v = null;
 		}
 	}
 
+	//Returns the count of children fetched so far. 0 if there are no children (or more than maxcc).
 	int Count() { return _count; }
 
 	bool GetNext(out AccRaw& a)
@@ -530,19 +581,19 @@ public:
 		} else {
 		g1:
 			if(_startAtIndex < 0) { //_startAtIndex is -1 if not used
-				if(_i >= _count) return false;
+				if(!_Has(_i)) return false; //if reverse, all children are already fetched
 				int i = _i++; if(_reverse) i = _count - i - 1;
 				if(0 != a.FromVARIANT(_parent, _v[i])) goto g1;
 			} else { //_startAtIndex is in _count range
 				int i = _startAtIndex + _i;
-				if(i < 0 || i >= _count) return false; //no more
+				if(i < 0 || !_Has(i)) return false; //no more
 				//calculate next i
 				if(_i >= 0) {
 					_i = -(_i + 1);
 					if(_startAtIndex + _i < 0) _i = -_i;
 				} else {
 					_i = -_i;
-					if(_startAtIndex + _i >= _count) _i = -(_i + 1);
+					if(!_Has(_startAtIndex + _i)) _i = -(_i + 1);
 				}
 				if(0 != a.FromVARIANT(_parent, _v[i])) goto g1;
 			}
@@ -100,6 +100,7 @@ namespace inproc
 {
 HRESULT AccFindOrGet(MarshalParams_Header* h, IAccessible* iacc, out BSTR& sResult);
 HRESULT AccEnableChrome2(MarshalParams_AccElem* p);
+HRESULT AccChildStatsToString(out BSTR& sResult);
 
 //Our hook of get_accHelpTopic.
 HRESULT STDMETHODCALLTYPE Hook_get_accHelpTopic(IAccessible* iacc, out BSTR& sResult, VARIANT vParams, long* pMagic)
@@ -138,6 +139,9 @@ HRESULT STDMETHODCALLTYPE Hook_get_accHelpTopic(IAccessible* iacc, out BSTR& sRe
 				case InProcAction::IPA_AccEnableChrome:
 					hr = AccEnableChrome2(p);
 					break;
+				case InProcAction::IPA_AccChildStats:
+					hr = AccChildStatsToString(out sResult);
+					break;
 				//case InProcAction::IPA_StartProcess:
 				//	Print(L"IPA_StartProcess");
 				//	break;
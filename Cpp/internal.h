@@ -2,6 +2,7 @@
 
 #pragma once
 #include "stdafx.h"
+#include "acc async.h"
 
 
 //Internal flags used by 'find AO' functions.
@@ -60,6 +61,7 @@ enum InProcAction : char {
 	IPA_AccGetWindow,
 	IPA_AccGetHtml,
 	IPA_AccEnableChrome,
+	IPA_AccChildStats,
 
 	//IPA_StartProcess = 100,
 };
@@ -95,9 +97,46 @@ struct MarshalParams_AccElem
 	long elem;
 };
 
+//Cancellation/progress state of Cpp_AccFindAsync, in memory shared with the target process.
+//Created by the caller (outproc). Opened by the in-proc finder, which checks it between AOs and writes progress.
+//Identified by the caller's process id and a job id.
+class AccCancelShared
+{
+	SharedMemory _sm;
+
+	static void _Name(DWORD pid, long id, out WCHAR(&name)[40]) {
+		swprintf(name, 40, L"AuCpp_AccCancel_%u_%i", pid, id);
+	}
+public:
+	DWORD pid;
+	long id;
+
+	AccCancelShared() noexcept { pid = 0; id = 0; }
+
+	bool Create() {
+		static long s_id;
+		pid = GetCurrentProcessId();
+		id = InterlockedIncrement(&s_id);
+		WCHAR name[40]; _Name(pid, id, out name);
+		if(!_sm.Create(name, sizeof(AccCancelState))) return false;
+		new(_sm.Mem()) AccCancelState();
+		return true;
+	}
+
+	bool Open(DWORD pid_, long id_) {
+		WCHAR name[40]; _Name(pid_, id_, out name);
+		if(!_sm.Open(name)) return false;
+		pid = pid_; id = id_;
+		return true;
+	}
+
+	AccCancelState* State() { return (AccCancelState*)_sm.Mem(); }
+};
+
 namespace outproc
 {
 HRESULT InjectDllAndGetAgent(HWND w, out IAccessible*& iaccAgent, out HWND* wAgent = null);
+HRESULT AccFindEx(HWND w, Cpp_Acc* aParent, const Cpp_AccParams& ap, Cpp_AccCallbackT also, out Cpp_Acc& aResult, out BSTR& sResult, AccCancelShared* cancel = null);
 
 //Calls the hooked get_accHelpTopic in the target process.
 //Packs some parameters, unpacks the returned data.
@@ -107,7 +146,10 @@ class InProcCall {
 	Bstr _br;
 	Smart<IStream> _stream;
 	DWORD _resultSize;
+	DWORD _tailSize; //size of data appended to results by the target process, eg packed props (IPA_AccFind with resultProps). ReadResultAcc ignores it.
 public:
+	InProcCall() noexcept : _resultSize(0), _tailSize(0) {}
+
 	//Allocates memory to pass parameters.
 	//Writes MarshalParams_Header fields. Then let the caller cast the return value to MarshalParams_AccFind* etc and write other fields.
 	MarshalParams_Header* AllocParams(Cpp_Acc* a, InProcAction action, size_t size) {
@@ -153,6 +195,17 @@ public:
 		return _br.Detach();
 	}
 
+	//Gets data appended to results with WriteResultTail in the target process, as a new BSTR. Call before ReadResultAcc.
+	//Returns null if there is no such data.
+	BSTR DetachResultTail() {
+		UINT size = _br.ByteLength(), n = 0;
+		if(size < 4 || _stream) return null;
+		memcpy(&n, (LPBYTE)_br.m_str + size - 4, 4);
+		if(n > size - 4) return null;
+		_tailSize = n + 4;
+		return SysAllocStringByteLen((LPCSTR)_br.m_str + size - _tailSize, n);
+	}
+
 	BSTR GetResultBSTR() {
 		return _br;
 	}
@@ -3,6 +3,8 @@
 
 #include "stdafx.h"
 #include "cpp.h"
+#include "acc props.h"
+#include "acc children.h"
 
 
 #if _DEBUG
@@ -283,6 +285,320 @@ EXPORT void Cpp_TestPCRE(STR s, STR p, DWORD flags)
 	Perf.NW();
 }
 
+//Tests AccAsyncJobs and AccCancelToken ("acc async.h") with a simulated slow AO tree, without COM.
+//Prints failed checks and the count of checks. A failed check of a timing may be a false alarm on a busy computer.
+EXPORT void Cpp_TestAccAsync()
+{
+	//A search in a tree of nodes, each taking 1 ms to visit, like a slow out-of-proc AO.
+	class _TreeJob : public AccAsyncJob
+	{
+	public:
+		int nodes = 0, target = -1; //target -1 - not found
+		int found = -1;
+		eAccCancel stopped = eAccCancel::None;
+		std::shared_ptr<std::atomic<int>> discarded = std::make_shared<std::atomic<int>>(0);
+
+		void Run() {
+			AccCancelToken token(state);
+			for(int i = 0; i < nodes; i++) {
+				if(token.Visit()) { stopped = token.Result(); break; }
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				if(i == target) { found = i; break; }
+			}
+			Publish();
+		}
+
+	protected:
+		void Discard() override { (*discarded)++; }
+	};
+
+	int nChecks = 0, nFailed = 0;
+	auto check = [&](bool ok, STR what) {
+		nChecks++;
+		if(!ok) { nFailed++; Printf(L"Cpp_TestAccAsync failed: %s", what); }
+	};
+	auto make = [](int nodes, int target) {
+		auto j = std::make_shared<_TreeJob>();
+		j->nodes = nodes; j->target = target;
+		return j;
+	};
+	auto run = [](_TreeJob& j) { j.Run(); };
+	auto waitThreads = [](AccAsyncJobs<_TreeJob>& t) {
+		for(int i = 0; i < 500 && t.ThreadCount(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		return t.ThreadCount();
+	};
+	bool invalid;
+
+	{ //found
+		AccAsyncJobs<_TreeJob> t;
+		int h = t.Start(make(100, 20), run);
+		check(h > 0, L"Start");
+		auto j = t.Wait(h, -1, invalid);
+		check(j && !invalid && j->found == 20 && j->stopped == eAccCancel::None, L"found");
+		check(t.Progress(h) == 21, L"visited count");
+		check(t.Close(h) && !t.Close(h), L"Close once");
+		check(*j->discarded == 1, L"Discard results not taken");
+		check(t.ThreadCount() == 0, L"thread joined when closed after done");
+		t.Wait(h, 0, invalid);
+		check(invalid && t.Progress(h) == -1 && !t.Cancel(h), L"closed handle invalid");
+	}
+	{ //pending, progress, cancel
+		AccAsyncJobs<_TreeJob> t;
+		int h = t.Start(make(100000, -1), run);
+		check(t.Wait(h, 0, invalid) == nullptr && !invalid, L"pending");
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		long p1 = t.Progress(h);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		check(t.Progress(h) > p1 && p1 > 0, L"progress");
+		check(t.Cancel(h), L"Cancel");
+		auto j = t.Wait(h, 5000, invalid);
+		check(j && j->stopped == eAccCancel::Cancelled && j->found < 0 && t.Progress(h) < 100000, L"cancelled");
+		t.Close(h);
+	}
+	{ //deadline
+		AccAsyncJobs<_TreeJob> t;
+		auto j = make(100000, -1);
+		j->state->SetTimeout(50);
+		auto t0 = AccCancelState::Now();
+		int h = t.Start(j, run);
+		check(t.Wait(h, 5000, invalid) == j && j->stopped == eAccCancel::Timeout, L"timeout");
+		check(AccCancelState::Now() - t0 < 1000, L"timeout time");
+		t.Close(h);
+	}
+	{ //close while running: cancelled, then the thread is joined and the job deleted
+		AccAsyncJobs<_TreeJob> t;
+		auto j = make(100000, -1);
+		std::weak_ptr<_TreeJob> w = j;
+		auto discarded = j->discarded;
+		int h = t.Start(j, run); j = nullptr;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		check(t.Close(h), L"Close running");
+		check(waitThreads(t) == 0, L"thread of closed job joined");
+		check(w.expired() && *discarded == 0, L"closed job deleted");
+	}
+	{ //several at the same time, and CloseAll cancels and joins
+		std::vector<std::weak_ptr<_TreeJob>> w;
+		std::vector<int> handles;
+		AccAsyncJobs<_TreeJob> t;
+		for(int i = 0; i < 8; i++) {
+			auto j = make(100000, i % 2 ? -1 : 10 + i);
+			w.push_back(j);
+			handles.push_back(t.Start(j, run));
+		}
+		for(int i = 0; i < 8; i += 2) {
+			auto j = t.Wait(handles[i], 5000, invalid);
+			check(j && j->found == 10 + i, L"concurrent found");
+		}
+		check(t.ThreadCount() == 8, L"threads owned");
+		t.Close(handles[1]);
+		t.CloseAll();
+		check(t.ThreadCount() == 0, L"CloseAll joined all");
+		for(auto& x : w) check(x.lock() == nullptr, L"CloseAll deleted all");
+		t.Wait(handles[2], 0, invalid);
+		check(invalid, L"CloseAll closed handles");
+	}
+	{ //the destructor does not wait: it cancels, and the detached worker deletes its job when it returns
+		std::weak_ptr<_TreeJob> w;
+		auto t0 = AccCancelState::Now();
+		{
+			AccAsyncJobs<_TreeJob> t;
+			auto j = make(100000, -1);
+			w = j;
+			t.Start(j, run);
+		}
+		check(AccCancelState::Now() - t0 < 1000, L"destructor does not wait");
+		for(int i = 0; i < 500 && !w.expired(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		check(w.expired(), L"detached worker cancelled");
+	}
+
+	Printf(L"Cpp_TestAccAsync: %i checks, %i failed", nChecks, nFailed);
+}
+
+//Tests the props record and pack format of Cpp_AccFind with resultProps ("acc props.h"): encodes with AccPropsPacker, decodes with AccPropsReader, truncates.
+//Prints failed checks and the count of checks.
+EXPORT void Cpp_TestAccProps()
+{
+	int nChecks = 0, nFailed = 0;
+	auto check = [&](bool ok, STR what) {
+		nChecks++;
+		if(!ok) { nFailed++; Printf(L"Cpp_TestAccProps failed: %s", what); }
+	};
+	auto equals = [](const AccPropsRecord& r, int i, const void* data, int bytes) {
+		const AccPropChar* v; int len;
+		bool ne = r.Get(i, v, len);
+		if(len != (bytes + 1) / 2 || ne != (bytes > 0)) return false;
+		if(bytes & 1 && ((const BYTE*)v)[bytes] != 0) return false; //padding
+		return bytes == 0 || 0 == memcmp(v, data, bytes);
+	};
+
+	//3 records of props "nsr": a string, binary with odd size, empty
+	const int nProps = 3;
+	const BYTE bin[] = { 1, 2, 3 };
+	AccPropsPacker pack;
+	for(int i = 0; i < 3; i++) {
+		auto w = pack.BeginRecord(nProps);
+		std::wstring name(i * 5, L'a' + i);
+		w.Add(name.c_str(), name.size() * 2);
+		w.Add(bin, i);
+		w.AddEmpty();
+		check(w.Added() == nProps, L"Added");
+		pack.EndRecord();
+	}
+	auto w = pack.BeginRecord(nProps); w.AddEmpty(); pack.DiscardRecord();
+	check(pack.Count() == 3, L"Count");
+
+	std::vector<AccPropChar> v(pack.Data(), pack.Data() + pack.Length());
+	AccPropsReader r(v.data(), v.size(), nProps);
+	AccPropsRecord x;
+	check(r.Count() == 3, L"read Count");
+	for(int i = 0; i < 3; i++) {
+		std::wstring name(i * 5, L'a' + i);
+		check(r.Next(x), L"Next");
+		check(equals(x, 0, name.c_str(), (int)name.size() * 2), L"string value");
+		check(equals(x, 1, bin, i), L"binary value");
+		check(equals(x, 2, null, 0), L"empty value");
+	}
+	check(!r.Next(x) && r.Position() == v.size(), L"end of pack");
+
+	//truncate, like Cpp_AccFind does in-proc when 'also' stops before the last found AO
+	auto v2 = v;
+	size_t len2 = AccPropsTruncatePack(v2.data(), v2.size(), nProps, 2);
+	AccPropsReader r2(v2.data(), len2, nProps);
+	check(r2.Count() == 2 && r2.Next(x) && r2.Next(x) && !r2.Next(x) && r2.Position() == len2, L"truncated to 2");
+	check(equals(x, 0, L"bbbbb", 10), L"last record after truncating");
+	check(AccPropsTruncatePack(v2.data(), len2, nProps, 5) == len2, L"truncate to more than Count");
+	check(AccPropsTruncatePack(v2.data(), len2, nProps, 0) == 2 && AccPropsReader(v2.data(), 2, nProps).Count() == 0, L"truncated to 0");
+
+	//invalid data
+	auto v3 = v;
+	v3[2] = 0x7fff; //record length too big
+	AccPropsReader r3(v3.data(), v3.size(), nProps);
+	check(!r3.Next(x), L"invalid record length");
+	v3 = v;
+	int off = 1000; memcpy(&v3[4], &off, 4); //offset of property 0 after the record end
+	AccPropsReader r4(v3.data(), v3.size(), nProps);
+	check(!r4.Next(x), L"invalid offset");
+	check(AccPropsReader(v.data(), 1, nProps).Count() == 0 && AccPropsReader(null, 0, nProps).Count() == 0, L"too short");
+
+	Printf(L"Cpp_TestAccProps: %i checks, %i failed", nChecks, nFailed);
+}
+
+//Tests AccChildFetcher ("acc children.h") with a simulated IAccChildSource, without COM.
+//Prints failed checks and the count of checks.
+EXPORT void Cpp_TestAccChildren()
+{
+	//Children 0 to count-1. Records the Fetch calls.
+	class _Source : public IAccChildSource
+	{
+	public:
+		int count = 0;
+		int reportedCount = -2; //GetCount returns this, or count if -2
+		int failAt = -1; //Fetch fails when it would fetch this child
+		std::vector<int> fetched; //the children in the source
+		std::vector<int> requests; //n of each Fetch call
+		int nAppended = 0, nGetCount = 0;
+		bool sequential = true; //each Fetch continued after the children in the source
+
+		int Fetch(int from, int n) override {
+			requests.push_back(n);
+			if(from != (int)fetched.size()) sequential = false;
+			if(failAt >= from && failAt < n) return -1;
+			for(int i = from; i < n && i < count; i++) { fetched.push_back(i); nAppended++; }
+			return (int)fetched.size();
+		}
+		int GetCount() override { nGetCount++; return reportedCount == -2 ? count : reportedCount; }
+	};
+
+	int nChecks = 0, nFailed = 0;
+	auto check = [&](bool ok, STR what) {
+		nChecks++;
+		if(!ok) { nFailed++; Printf(L"Cpp_TestAccChildren failed: %s", what); }
+	};
+	//Stats of a provider whose containers have 0 or 1 child, so the first chunk is 2 children
+	AccChildStats small;
+	for(int i = 0; i < 20; i++) small.AddChildCount(i % 2);
+	check(small.TypicalCount() == 1, L"TypicalCount");
+	auto inOrder = [](const _Source& s) {
+		for(int i = 0; i < (int)s.fetched.size(); i++) if(s.fetched[i] != i) return false;
+		return s.sequential && s.nAppended == (int)s.fetched.size();
+	};
+
+	{ //minimum first chunk: a WINDOW with 7 children is fetched whole, so that _RemoveInvisibleNonclient can see all 7
+		_Source s; s.count = 7;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 10000);
+		check(f.Begin(0, 8) == 7 && s.requests.size() == 1 && s.requests[0] == 8, L"minFetch");
+		check(f.IsAll() && f.Total() == 7 && s.nGetCount == 0, L"7 children all fetched");
+		check(!f.Ensure(7) && s.requests.size() == 1, L"no fetch after the end");
+	}
+	{ //minimum first chunk with an index: "A/B[4]/C"
+		_Source s; s.count = 7;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 10000);
+		check(f.Begin(4, 8) == 7 && s.requests[0] == 8 && f.IsAll(), L"minFetch with need");
+	}
+	{ //a WINDOW with more children: the first chunk is full, then GetCount gives the end
+		_Source s; s.count = 8;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 10000);
+		check(f.Begin(0, 8) == 8 && s.nGetCount == 1 && f.IsAll() && f.Total() == 8, L"first chunk full, count known");
+		check(!f.Ensure(8) && s.requests.size() == 1, L"no fetch after the known end");
+	}
+	{ //growth without a reliable count: each chunk 4 times bigger, continuing after the fetched children
+		_Source s; s.count = 1000; s.reportedCount = -1;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 10000);
+		check(f.Begin(0) == 2 && f.Total() < 0, L"first chunk of the learned size");
+		int n = 0;
+		while(f.Ensure(n)) n++;
+		check(n == 1000 && f.Total() == 1000 && f.IsAll(), L"all children by growing chunks");
+		const int grown[] = { 2, 8, 32, 128, 512, 2048 };
+		check(s.requests == std::vector<int>(std::begin(grown), std::end(grown)), L"chunk sizes");
+		check(inOrder(s), L"growth fetched each child once");
+		check(stats.nFetched - small.nFetched == 1000 && stats.nRefetch - small.nRefetch == 5, L"stats of growth");
+	}
+	{ //the count known after the first chunk: the rest in one Fetch
+		_Source s; s.count = 1000;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 10000);
+		check(f.Begin(0) == 2 && f.Total() == 1000, L"count after the first chunk");
+		check(f.Ensure(500) && f.Fetched() == 1000 && s.requests.size() == 2 && inOrder(s), L"rest in one Fetch");
+		check(f.Ensure(999) && !f.Ensure(1000) && s.requests.size() == 2, L"end of known count");
+	}
+	{ //the end of children when a chunk is not full
+		_Source s; s.count = 32; s.reportedCount = -1;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 10000);
+		f.Begin(0);
+		check(f.Ensure(31) && !f.IsAll(), L"last child in a full chunk");
+		check(!f.Ensure(32) && f.IsAll() && f.Total() == 32 && inOrder(s), L"end found by a chunk that is not full");
+	}
+	{ //all children, eg reverse
+		_Source s; s.count = 300;
+		AccChildStats stats;
+		AccChildFetcher f(s, stats, 10000);
+		check(f.Begin(-1) == 300 && f.IsAll() && s.requests.size() == 1 && s.requests[0] == 301, L"need all");
+	}
+	{ //more than maxcc
+		_Source s; s.count = 100000; s.reportedCount = -1;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 100);
+		f.Begin(0);
+		int n = 0;
+		while(f.Ensure(n)) n++;
+		check(f.IsTooMany() && f.Fetched() == 0 && n <= 101 && s.requests.back() == 101, L"maxcc");
+	}
+	{ //a failed Fetch keeps the children fetched before
+		_Source s; s.count = 100; s.reportedCount = -1; s.failAt = 50;
+		AccChildStats stats = small;
+		AccChildFetcher f(s, stats, 10000);
+		f.Begin(0);
+		check(f.Ensure(31) && !f.Ensure(32) && f.Fetched() == 32 && f.Total() == 32 && inOrder(s), L"failed Fetch");
+	}
+
+	Printf(L"Cpp_TestAccChildren: %i checks, %i failed", nChecks, nFailed);
+}
+
 
 //class TestTL {
 //public:
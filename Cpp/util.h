@@ -229,44 +229,43 @@ public:
 //	LPBYTE Alloc(HWND hWnd, DWORD nBytes, DWORD flags = 0);
 //};
 
-//currently not used.
-////can instead use CAtlFileMappingBase from atlfile.h, but this added before including ATL, and don't want to change now.
-//class SharedMemory
-//{
-//	HANDLE _hmapfile;
-//	LPBYTE _mem;
-//public:
-//	SharedMemory() { _hmapfile = 0; _mem = 0; }
-//	~SharedMemory() { Close(); }
-//
-//	bool Create(STR name, DWORD size)
-//	{
-//		Close();
-//		_hmapfile = CreateFileMappingW((HANDLE)(-1), SecurityAttributes::Common(), PAGE_READWRITE, 0, size, name);
-//		if(!_hmapfile) return false;
-//		_mem = (LPBYTE)MapViewOfFile(_hmapfile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
-//		return _mem != null;
-//	}
-//
-//	bool Open(STR name)
-//	{
-//		Close();
-//		_hmapfile = OpenFileMappingW(FILE_MAP_ALL_ACCESS, 0, name);
-//		if(!_hmapfile) return false;
-//		_mem = (LPBYTE)MapViewOfFile(_hmapfile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
-//		return _mem != null;
-//	}
-//
-//	void Close()
-//	{
-//		if(_mem) { UnmapViewOfFile(_mem); _mem = 0; }
-//		if(_hmapfile) { CloseHandle(_hmapfile); _hmapfile = 0; }
-//	}
-//
-//	LPBYTE Mem() { return _mem; }
-//
-//	bool Is0() { return _mem == null; }
-//};
+//can instead use CAtlFileMappingBase from atlfile.h, but this added before including ATL, and don't want to change now.
+class SharedMemory
+{
+	HANDLE _hmapfile;
+	LPBYTE _mem;
+public:
+	SharedMemory() { _hmapfile = 0; _mem = 0; }
+	~SharedMemory() { Close(); }
+
+	bool Create(STR name, DWORD size)
+	{
+		Close();
+		_hmapfile = CreateFileMappingW((HANDLE)(-1), SecurityAttributes::Common(), PAGE_READWRITE, 0, size, name);
+		if(!_hmapfile) return false;
+		_mem = (LPBYTE)MapViewOfFile(_hmapfile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		return _mem != null;
+	}
+
+	bool Open(STR name)
+	{
+		Close();
+		_hmapfile = OpenFileMappingW(FILE_MAP_ALL_ACCESS, 0, name);
+		if(!_hmapfile) return false;
+		_mem = (LPBYTE)MapViewOfFile(_hmapfile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		return _mem != null;
+	}
+
+	void Close()
+	{
+		if(_mem) { UnmapViewOfFile(_mem); _mem = 0; }
+		if(_hmapfile) { CloseHandle(_hmapfile); _hmapfile = 0; }
+	}
+
+	LPBYTE Mem() { return _mem; }
+
+	bool Is0() { return _mem == null; }
+};
 
 //currently not used.
 //template<class T>
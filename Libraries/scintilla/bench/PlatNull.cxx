@@ -0,0 +1,254 @@
+// Scintilla source code edit control
+/** @file PlatNull.cxx
+ ** Implementation of platform facilities with no windows, for running the core without a display.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include "Platform.h"
+
+#include "PlatNull.h"
+
+namespace Scintilla {
+
+Font::Font() noexcept : fid(nullptr) {
+}
+
+Font::~Font() {
+}
+
+void Font::Create(const FontParameters &fp) {
+	// Any value but nullptr so the font is seen as created; the size decides the measurements
+	fid = reinterpret_cast<FontID>(static_cast<intptr_t>(fp.size > 1 ? fp.size : 1));
+}
+
+void Font::Release() {
+	fid = nullptr;
+}
+
+Surface *Surface::Allocate(int) {
+	return new SurfaceNull();
+}
+
+Window::~Window() {
+}
+
+void Window::Destroy() {
+	wid = nullptr;
+}
+
+PRectangle Window::GetPosition() const {
+	return PRectangle();
+}
+
+void Window::SetPosition(PRectangle) {
+}
+
+void Window::SetPositionRelative(PRectangle, const Window *) {
+}
+
+PRectangle Window::GetClientPosition() const {
+	return PRectangle();
+}
+
+void Window::Show(bool) {
+}
+
+void Window::InvalidateAll() {
+}
+
+void Window::InvalidateRectangle(PRectangle) {
+}
+
+void Window::SetFont(Font &) {
+}
+
+void Window::SetCursor(Cursor curs) {
+	cursorLast = curs;
+}
+
+PRectangle Window::GetMonitorRect(Point) {
+	return PRectangle();
+}
+
+namespace {
+
+/// A list with no window that keeps the items so autocompletion can select among them.
+class ListBoxNull : public ListBox {
+	std::vector<std::string> items;
+	int selection = -1;
+	int visibleRows = 5;
+	IListBoxDelegate *delegate = nullptr;
+public:
+	void SetFont(Font &) override {
+	}
+	void Create(Window &, int, Point, int, bool, int) override {
+	}
+	void SetAverageCharWidth(int) override {
+	}
+	void SetVisibleRows(int rows) override {
+		visibleRows = rows;
+	}
+	int GetVisibleRows() const override {
+		return visibleRows;
+	}
+	PRectangle GetDesiredRect() override {
+		return PRectangle();
+	}
+	int CaretFromEdge() override {
+		return 0;
+	}
+	void Clear() override {
+		items.clear();
+		selection = -1;
+	}
+	void Append(char *s, int = -1) override {
+		items.push_back(s);
+	}
+	int Length() override {
+		return static_cast<int>(items.size());
+	}
+	void Select(int n) override {
+		selection = n;
+		if (delegate) {
+			ListBoxEvent event(ListBoxEvent::EventType::selectionChange);
+			delegate->ListNotify(&event);
+		}
+	}
+	int GetSelection() override {
+		return selection;
+	}
+	int Find(const char *prefix) override {
+		const size_t lenPrefix = strlen(prefix);
+		for (size_t i = 0; i < items.size(); i++) {
+			if (items[i].compare(0, lenPrefix, prefix) == 0)
+				return static_cast<int>(i);
+		}
+		return -1;
+	}
+	void GetValue(int n, char *value, int len) override {
+		if (len <= 0)
+			return;
+		value[0] = '\0';
+		if ((n >= 0) && (n < Length())) {
+			const std::string &item = items[n];
+			const size_t lenCopy = std::min(item.length(), static_cast<size_t>(len - 1));
+			memcpy(value, item.c_str(), lenCopy);
+			value[lenCopy] = '\0';
+		}
+	}
+	void RegisterImage(int, const char *) override {
+	}
+	void RegisterRGBAImage(int, int, int, const unsigned char *) override {
+	}
+	void ClearRegisteredImages() override {
+	}
+	void SetDelegate(IListBoxDelegate *lbDelegate) override {
+		delegate = lbDelegate;
+	}
+	void SetList(const char *list, char separator, char typesep) override {
+		Clear();
+		std::string item;
+		bool inType = false;
+		for (const char *s = list; *s; s++) {
+			if (*s == separator) {
+				items.push_back(item);
+				item.clear();
+				inType = false;
+			} else if (*s == typesep) {
+				inType = true;
+			} else if (!inType) {
+				item.push_back(*s);
+			}
+		}
+		items.push_back(item);
+	}
+};
+
+}
+
+ListBox::ListBox() noexcept {
+}
+
+ListBox::~ListBox() {
+}
+
+ListBox *ListBox::Allocate() {
+	return new ListBoxNull();
+}
+
+Menu::Menu() noexcept : mid(nullptr) {
+}
+
+void Menu::CreatePopUp() {
+}
+
+void Menu::Destroy() {
+	mid = nullptr;
+}
+
+void Menu::Show(Point, Window &) {
+}
+
+DynamicLibrary *DynamicLibrary::Load(const char *) {
+	// External lexers are not loaded without a platform
+	return nullptr;
+}
+
+ColourDesired Platform::Chrome() {
+	return ColourDesired(0xe0, 0xe0, 0xe0);
+}
+
+ColourDesired Platform::ChromeHighlight() {
+	return ColourDesired(0xff, 0xff, 0xff);
+}
+
+const char *Platform::DefaultFont() {
+	return "Verdana";
+}
+
+int Platform::DefaultFontSize() {
+	return 8;
+}
+
+unsigned int Platform::DoubleClickTime() {
+	return 500;
+}
+
+void Platform::DebugDisplay(const char *s) {
+	fputs(s, stderr);
+}
+
+void Platform::DebugPrintf(const char *, ...) {
+}
+
+static bool assertionPopUps = true;
+
+bool Platform::ShowAssertionPopUps(bool assertionPopUps_) {
+	const bool ret = assertionPopUps;
+	assertionPopUps = assertionPopUps_;
+	return ret;
+}
+
+void Platform::Assert(const char *c, const char *file, int line) {
+	char buffer[2000];
+	snprintf(buffer, sizeof(buffer), "Assertion [%s] failed at %s %d\n", c, file, line);
+	Platform::DebugDisplay(buffer);
+	// With no pop up to ask, a failed assertion stops as it would when the user chose Abort
+	if (assertionPopUps)
+		abort();
+}
+
+}
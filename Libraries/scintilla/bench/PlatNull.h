@@ -0,0 +1,115 @@
+// Scintilla source code edit control
+/** @file PlatNull.h
+ ** A surface with no window, for running the core without a display.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef PLATNULL_H
+#define PLATNULL_H
+
+namespace Scintilla {
+
+/**
+ * A surface that draws nothing and measures every byte of text as wide as the font size,
+ * so layout runs as on a display with a fixed pitch font.
+ */
+class SurfaceNull : public Surface {
+	static XYPOSITION Pitch(const Font &font_) noexcept {
+		const intptr_t size = reinterpret_cast<intptr_t>(font_.GetID());
+		return static_cast<XYPOSITION>(size > 0 ? size : 10);
+	}
+public:
+	void Init(WindowID) override {
+	}
+	void Init(SurfaceID, WindowID) override {
+	}
+	void InitPixMap(int, int, Surface *, WindowID) override {
+	}
+	void Release() override {
+	}
+	bool Initialised() override {
+		return true;
+	}
+	void PenColour(ColourDesired) override {
+	}
+	int LogPixelsY() override {
+		return 96;
+	}
+	int DeviceHeightFont(int points) override {
+		return points * 96 / 72;
+	}
+	void MoveTo(int, int) override {
+	}
+	void LineTo(int, int) override {
+	}
+	void Polygon(Point *, size_t, ColourDesired, ColourDesired) override {
+	}
+	void RectangleDraw(PRectangle, ColourDesired, ColourDesired) override {
+	}
+	void FillRectangle(PRectangle, ColourDesired) override {
+	}
+	void FillRectangle(PRectangle, Surface &) override {
+	}
+	void RoundedRectangle(PRectangle, ColourDesired, ColourDesired) override {
+	}
+	void AlphaRectangle(PRectangle, int, ColourDesired, int, ColourDesired, int, int) override {
+	}
+	void GradientRectangle(PRectangle, const std::vector<ColourStop> &, GradientOptions) override {
+	}
+	void DrawRGBAImage(PRectangle, int, int, const unsigned char *) override {
+	}
+	void Ellipse(PRectangle, ColourDesired, ColourDesired) override {
+	}
+	void Copy(PRectangle, Point, Surface &) override {
+	}
+	std::unique_ptr<IScreenLineLayout> Layout(const IScreenLine *) override {
+		return {};
+	}
+	void DrawTextNoClip(PRectangle, Font &, XYPOSITION, std::string_view, ColourDesired, ColourDesired) override {
+	}
+	void DrawTextClipped(PRectangle, Font &, XYPOSITION, std::string_view, ColourDesired, ColourDesired) override {
+	}
+	void DrawTextTransparent(PRectangle, Font &, XYPOSITION, std::string_view, ColourDesired) override {
+	}
+	void MeasureWidths(Font &font_, std::string_view text, XYPOSITION *positions) override {
+		const XYPOSITION pitch = Pitch(font_);
+		for (size_t i = 0; i < text.length(); i++) {
+			positions[i] = pitch * static_cast<XYPOSITION>(i + 1);
+		}
+	}
+	XYPOSITION WidthText(Font &font_, std::string_view text) override {
+		return Pitch(font_) * static_cast<XYPOSITION>(text.length());
+	}
+	XYPOSITION Ascent(Font &font_) override {
+		return Pitch(font_);
+	}
+	XYPOSITION Descent(Font &font_) override {
+		return Pitch(font_) / 4;
+	}
+	XYPOSITION InternalLeading(Font &) override {
+		return 0;
+	}
+	XYPOSITION Height(Font &font_) override {
+		return Ascent(font_) + Descent(font_);
+	}
+	XYPOSITION AverageCharWidth(Font &font_) override {
+		return Pitch(font_);
+	}
+	void SetClip(PRectangle) override {
+	}
+	void FlushCachedState() override {
+	}
+	void SetUnicodeMode(bool) override {
+	}
+	void SetDBCSMode(int) override {
+	}
+	void SetBidiR2L(bool) override {
+	}
+	void *get_hdc() override {
+		return nullptr;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,1656 @@
+// Scintilla source code edit control
+/** @file SciBench.cxx
+ ** Measures loading, editing, undo, searching and lexing of large documents with no window,
+ ** and converting text between UTF-8 and UTF-16.
+ ** Checks that conversions taking runs of ASCII 16 bytes at a time match conversions a byte at a time.
+ ** Checks that text with invalid UTF-8 got as UTF-16 a buffer at a time matches a conversion a character at a time,
+ ** and that the UTF-16 position map matches counting from the start after random edits.
+ ** Checks that styling in the background gives the same styles, fold levels and line states as styling at once.
+ ** Counts the text measured through the position cache when laying out lines on a surface with no window.
+ ** Checks that wrapping in the background breaks lines as wrapping at once, also when an edit invalidates the run.
+ ** Checks that styles held as runs, and held a byte each again after short runs, match the styles set.
+ ** Checks that filling many ranges of runs and removing many partitions at once match doing so one at a time.
+ ** Checks that range pointers into chunked text match the text edited and do not grow chunks beyond their limit.
+ ** Checks that undo and redo are unchanged by trimming the history to a memory limit, and measures
+ ** replacing all matches over 100 MB with the undo text that keeps.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+// Usage: SciBench [-mb megabytes] [-edits count] [file ...]
+// With no files, each bundled lexer gets a corpus made by repeating a sample of its language.
+// A file is lexed by the lexer of its extension, if any.
+// Conversions are also measured on corpora of ASCII, Latin, CJK and emoji text.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <forward_list>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <random>
+#include <fstream>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "LexerModule.h"
+#include "Catalogue.h"
+
+#include "CharacterCategory.h"
+#include "Position.h"
+#include "UniqueString.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "ContractionState.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "Indicator.h"
+#include "LineMarker.h"
+#include "Style.h"
+#include "ViewStyle.h"
+#include "Selection.h"
+#include "PositionCache.h"
+#include "EditModel.h"
+#include "MarginView.h"
+#include "EditView.h"
+#include "BackgroundWrapper.h"
+#include "ElapsedPeriod.h"
+#include "UniConversion.h"
+
+#include "PlatNull.h"
+
+using namespace Scintilla;
+
+namespace {
+
+struct Language {
+	const char *name;
+	int lexer;
+	const char *extensions;	// Space separated, with a space at each end
+	const char *keywords;	// Word list 0 of the lexer
+	const char *word;	// Found in the sample
+	const char *sample;
+};
+
+const Language languages[] = {
+	{ "cpp", SCLEX_CPP, " c cc cpp cxx h hpp hxx cs java js ",
+		"bool break case char class const continue default do double else enum for if int long namespace return static struct switch void while",
+		"return",
+R"sample(// Counts the words of a line; 单词 are separated by spaces.
+static int CountWords(const char *line, size_t length) {
+	int words = 0;
+	bool inWord = false;
+	for (size_t i = 0; i < length; i++) {
+		const bool space = (line[i] == ' ') || (line[i] == '\t');
+		if (!space && !inWord)
+			words++;
+		inWord = !space;
+	}
+	return words; /* 0 for an empty line */
+}
+#define WORDS_MAX 0x100
+)sample" },
+	{ "css", SCLEX_CSS, " css ",
+		"color background margin padding border font-size display width height",
+		"color",
+R"sample(/* Styles of the page — résumé */
+body { margin: 0; padding: 8px 16px; font-family: "Segoe UI", sans-serif; }
+.header > h1:hover { color: #336699; background: url(images/top.png) no-repeat; }
+@media screen and (max-width: 600px) {
+	.column { width: 100%; display: block !important; }
+}
+)sample" },
+	{ "html", SCLEX_HTML, " htm html xhtml ",
+		"a body div head html img li link meta p script span style table td title tr ul",
+		"class",
+R"sample(<!DOCTYPE html>
+<html lang="en">
+<head><meta charset="utf-8"><title>Benchmark — 測試</title></head>
+<body>
+<!-- A comment -->
+<div class="row" id="r1"><p>Some <b>bold</b> text &amp; an <a href="https://example.com/?q=1">anchor</a>.</p></div>
+<script>
+	for (var i = 0; i < 10; i++) { document.write("<li>" + i + "</li>"); }
+</script>
+</body>
+</html>
+)sample" },
+	{ "xml", SCLEX_XML, " xml xaml csproj vcxproj config ",
+		"",
+		"PropertyGroup",
+R"sample(<?xml version="1.0" encoding="utf-8"?>
+<Project Sdk="Microsoft.NET.Sdk">
+	<!-- Settings of the build -->
+	<PropertyGroup Condition="'$(Configuration)'=='Release'">
+		<Optimize>true</Optimize>
+		<Description><![CDATA[Text with <markup> & symbols — ü]]></Description>
+	</PropertyGroup>
+</Project>
+)sample" },
+	{ "json", SCLEX_JSON, " json ",
+		"false null true",
+		"items",
+R"sample({
+	"name": "benchmark",
+	"version": 3.25e2,
+	"enabled": true,
+	"tags": ["fast", "größer", null],
+	"nested": { "depth": 2, "items": [ { "id": 1 }, { "id": 2 } ] }
+},
+)sample" },
+	{ "markdown", SCLEX_MARKDOWN, " md markdown ",
+		"",
+		"link",
+R"sample(# Heading one
+Some *emphasis*, **strong** text and `inline code` — naïve.
+
+* A list item
+* Another with a [link](https://example.com)
+
+```
+code block
+```
+> A quote
+)sample" },
+	{ "powershell", SCLEX_POWERSHELL, " ps1 psm1 ",
+		"begin break catch continue else elseif end exit foreach function if param process return switch throw try until while",
+		"Length",
+R"sample(# Lists the files larger than a size — größe
+function Get-LargeFiles {
+	param([string]$Path = ".", [int]$MinSize = 1MB)
+	Get-ChildItem -Path $Path -Recurse | Where-Object { $_.Length -gt $MinSize } | ForEach-Object {
+		Write-Output "$($_.FullName) $($_.Length)"
+	}
+}
+<# block comment #>
+)sample" },
+	{ "python", SCLEX_PYTHON, " py pyw ",
+		"and as assert break class continue def del elif else except for from if import in is lambda not or pass return try while with yield",
+		"self",
+R"sample(# Counts the words of each line — ünïcode
+import sys
+
+class Counter(object):
+	def __init__(self, name):
+		self.name = name
+		self.counts = {}
+
+	def add(self, line):
+		for word in line.split():
+			self.counts[word] = self.counts.get(word, 0) + 1
+		return len(self.counts) > 0x10 and 'many' or "few"
+)sample" },
+	{ "sql", SCLEX_SQL, " sql ",
+		"select from where insert into values update set delete create table index join on group by order having and or not null",
+		"total",
+R"sample(-- Orders of the last month — ørder
+SELECT c.name, COUNT(o.id) AS orders, SUM(o.total) AS total
+FROM customers c
+	JOIN orders o ON o.customer_id = c.id
+WHERE o.created >= '2020-01-01' AND o.status <> 'cancelled'
+GROUP BY c.name
+HAVING SUM(o.total) > 100.50
+ORDER BY total DESC;
+)sample" },
+	{ "vb", SCLEX_VB, " vb bas vbs ",
+		"and as boolean byval dim do else end for function if integer loop next not or return string sub then while",
+		"words",
+R"sample(' Counts the words of a line — naïve
+Function CountWords(ByVal line As String) As Integer
+	Dim words As Integer = 0
+	Dim inWord As Boolean = False
+	For i As Integer = 1 To Len(line)
+		Dim c As String = Mid(line, i, 1)
+		If c <> " " And Not inWord Then words = words + 1
+		inWord = (c <> " ")
+	Next
+	Return words
+End Function
+)sample" },
+	{ "yaml", SCLEX_YAML, " yaml yml ",
+		"true false yes no null",
+		"true",
+R"sample(# Settings — été
+build:
+  configuration: Release
+  platforms: [x64, x86]
+  options:
+    optimize: true
+    warnings: 4
+    defines: "NDEBUG; SCI_LEXER"
+---
+)sample" },
+};
+
+struct Script {
+	const char *name;
+	const char *sample;
+};
+
+const Script scripts[] = {
+	{ "ASCII", "The quick brown fox jumps over the lazy dog; 0123456789 times.\n" },
+	{ "Latin", "Être à l'écoute, naïveté, façade, Größe, smörgåsbord, jalapeño, Dvořák, złoty.\n" },
+	{ "CJK", "敏捷的棕色狐狸跳过了懒狗。素早い茶色の狐がのろまな犬を飛び越える。빠른 갈색 여우.\n" },
+	{ "emoji", "😀😃😄😁 🦊🐶🐱 👍🏽 🎉✨ 🇯🇵🇫🇷 ok 🚀🌍\n" },
+};
+
+constexpr const char *searchRegex = "[A-Za-z_]+[0-9]+";
+
+const Language *LanguageOfFile(const std::string &path) {
+	const size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+		return nullptr;
+	std::string extension = " " + path.substr(dot + 1) + " ";
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char ch) noexcept {
+		return static_cast<char>(((ch >= 'A') && (ch <= 'Z')) ? ch - 'A' + 'a' : ch);
+	});
+	for (const Language &language : languages) {
+		if (strstr(language.extensions, extension.c_str()))
+			return &language;
+	}
+	return nullptr;
+}
+
+std::string Corpus(const char *sample, size_t size) {
+	const size_t lengthSample = strlen(sample);
+	std::string text;
+	text.reserve(size + lengthSample);
+	while (text.length() < size)
+		text.append(sample, lengthSample);
+	return text;
+}
+
+// A corpus repeats its sample so has few different words: starting each word of 4 or more letters
+// with random letters gives the many different runs of real text.
+std::string Varied(const std::string &text) {
+	std::mt19937 generator(1);
+	std::string varied(text);
+	const auto isLetter = [](char ch) noexcept {
+		return ((ch >= 'a') && (ch <= 'z')) || ((ch >= 'A') && (ch <= 'Z'));
+	};
+	size_t start = 0;
+	while (start < varied.length()) {
+		size_t end = start;
+		while ((end < varied.length()) && isLetter(varied[end]))
+			end++;
+		if (end - start >= 4) {
+			varied[start] = static_cast<char>('a' + generator() % 26);
+			varied[start + 1] = static_cast<char>('a' + generator() % 26);
+		}
+		start = end + 1;
+	}
+	return varied;
+}
+
+void Report(const char *what, double seconds, size_t bytes, const std::string &extra = std::string()) {
+	printf("  %-28s %10.2f ms", what, seconds * 1000.0);
+	if (bytes && (seconds > 0))
+		printf(" %10.1f MB/s", bytes / seconds / 1e6);
+	else
+		printf(" %16s", "");
+	printf("  %s\n", extra.c_str());
+}
+
+/// Holds a reference to a document, released when done.
+class DocumentHolder {
+public:
+	Document *pdoc;
+	explicit DocumentHolder(int options) : pdoc(new Document(options)) {
+		pdoc->AddRef();
+	}
+	DocumentHolder(const DocumentHolder &) = delete;
+	DocumentHolder(DocumentHolder &&) = delete;
+	DocumentHolder &operator=(const DocumentHolder &) = delete;
+	DocumentHolder &operator=(DocumentHolder &&) = delete;
+	~DocumentHolder() {
+		pdoc->Release();
+	}
+};
+
+// Text shown as by Sci_OpenMappedFile, in place or, as for a file that can not be mapped, read a step at a time
+class TextMapped : public IMappedText {
+	const std::string &text;
+	bool inPlace;
+public:
+	TextMapped(const std::string &text_, bool inPlace_) noexcept : text(text_), inPlace(inPlace_) {
+	}
+	const char *Data() const noexcept override {
+		return inPlace ? text.c_str() : nullptr;
+	}
+	Sci::Position Length() const noexcept override {
+		return text.length();
+	}
+	Sci::Position Read(Sci::Position position, char *buffer, Sci::Position length) noexcept override {
+		length = std::min<Sci::Position>(length, text.length() - position);
+		memcpy(buffer, text.c_str() + position, length);
+		return length;
+	}
+};
+
+void BenchMapped(const std::string &text, bool inPlace, const char *what) {
+	DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+	ElapsedPeriod ep;
+	holder.pdoc->SetMappedText(std::make_unique<TextMapped>(text, inPlace));
+	holder.pdoc->ExtendMapped();
+	const double durationFirst = ep.Duration();
+	while (holder.pdoc->ExtendMapped()) {
+	}
+	const double duration = durationFirst + ep.Duration();
+	std::string shown(holder.pdoc->Length(), '\0');
+	holder.pdoc->GetCharRange(&shown[0], 0, holder.pdoc->Length());
+	char first[40];
+	snprintf(first, sizeof(first), "first step %.2f ms", durationFirst * 1000);
+	Report(what, duration, text.length(), std::string(first) + ((shown == text) ? "" : ", differs"));
+}
+
+void BenchLoad(const std::string &text) {
+	{
+		DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+		ElapsedPeriod ep;
+		holder.pdoc->SetUndoCollection(false);
+		holder.pdoc->InsertString(0, text.c_str(), text.length());
+		holder.pdoc->SetUndoCollection(true);
+		Report("load", ep.Duration(), text.length(),
+			std::to_string(holder.pdoc->LinesTotal()) + " lines");
+	}
+	{
+		// As SCI_CREATELOADER, adding the text in pieces as when reading a file
+		constexpr size_t pieceSize = 0x100000;
+		DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+		ElapsedPeriod ep;
+		holder.pdoc->Allocate(text.length());
+		for (size_t start = 0; start < text.length(); start += pieceSize) {
+			holder.pdoc->AddData(text.c_str() + start, std::min(pieceSize, text.length() - start));
+		}
+		Report("load with loader", ep.Duration(), text.length());
+	}
+	{
+		DocumentHolder holder(SC_DOCUMENTOPTION_CHUNKED);
+		ElapsedPeriod ep;
+		holder.pdoc->SetUndoCollection(false);
+		holder.pdoc->InsertString(0, text.c_str(), text.length());
+		holder.pdoc->SetUndoCollection(true);
+		Report("load chunked", ep.Duration(), text.length());
+	}
+	BenchMapped(text, true, "load mapped");
+	BenchMapped(text, false, "load mapped in steps");
+}
+
+void BenchEdits(const std::string &text, int options, const char *what, int edits) {
+	DocumentHolder holder(options);
+	Document *pdoc = holder.pdoc;
+	pdoc->SetUndoCollection(false);
+	pdoc->InsertString(0, text.c_str(), text.length());
+	pdoc->SetUndoCollection(true);
+
+	// The same edits on each run so results can be compared
+	std::mt19937 generator(1);
+	const char *insertions[] = { "x", "id", "word ", "\r\n", "if (a) {", "ü", "0x1F" };
+	ElapsedPeriod ep;
+	for (int edit = 0; edit < edits; edit++) {
+		const Sci::Position length = pdoc->Length();
+		const Sci::Position position = generator() % (length + 1);
+		if ((generator() % 3 == 0) && (position < length)) {
+			const Sci::Position lengthDelete = std::min<Sci::Position>(1 + generator() % 8, length - position);
+			pdoc->DeleteChars(position, lengthDelete);
+		} else {
+			const char *insertion = insertions[generator() % std::size(insertions)];
+			pdoc->InsertString(position, insertion, strlen(insertion));
+		}
+	}
+	Report(what, ep.Duration(), 0, std::to_string(edits) + " edits");
+
+	int steps = 0;
+	ep.Duration(true);
+	while (pdoc->CanUndo()) {
+		pdoc->Undo();
+		steps++;
+	}
+	Report("undo all", ep.Duration(), 0, std::to_string(steps) + " steps");
+	ep.Duration(true);
+	while (pdoc->CanRedo()) {
+		pdoc->Redo();
+	}
+	Report("redo all", ep.Duration(), 0);
+}
+
+void BenchFind(Document *pdoc, const char *what, const char *search, int flags, bool backward = false) {
+	const Sci::Position length = pdoc->Length();
+	ElapsedPeriod ep;
+	int matches = 0;
+	Sci::Position position = backward ? length : 0;
+	try {
+		while (backward ? position > 0 : position <= length) {
+			Sci::Position lengthFound = strlen(search);
+			const Sci::Position found = backward ?
+				pdoc->FindText(position, 0, search, flags, &lengthFound) :
+				pdoc->FindText(position, length, search, flags, &lengthFound);
+			if (found < 0)
+				break;
+			matches++;
+			position = backward ? found : found + std::max<Sci::Position>(lengthFound, 1);
+		}
+		Report(what, ep.Duration(), length, std::to_string(matches) + " matches");
+	} catch (const std::exception &e) {
+		Report(what, ep.Duration(), 0, std::string("failed: ") + e.what());
+	}
+}
+
+void BenchSearch(const std::string &text, const char *word) {
+	DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+	Document *pdoc = holder.pdoc;
+	pdoc->SetUndoCollection(false);
+	pdoc->InsertString(0, text.c_str(), text.length());
+	pdoc->SetCaseFolder(new CaseFolderUnicode());
+	BenchFind(pdoc, "find", word, SCFIND_MATCHCASE);
+	BenchFind(pdoc, "find no case", word, 0);
+	BenchFind(pdoc, "find whole word", word, SCFIND_MATCHCASE | SCFIND_WHOLEWORD);
+	BenchFind(pdoc, "find regex", searchRegex, SCFIND_MATCHCASE | SCFIND_REGEXP);
+	BenchFind(pdoc, "find regex PCRE2", searchRegex, SCFIND_MATCHCASE | SCFIND_REGEXP | SCFIND_PCRE2);
+	BenchFind(pdoc, "find regex PCRE2 backward", searchRegex, SCFIND_MATCHCASE | SCFIND_REGEXP | SCFIND_PCRE2, true);
+	// std::regex is much slower so searches less text
+	if (text.length() <= 0x400000)
+		BenchFind(pdoc, "find regex C++11", searchRegex, SCFIND_MATCHCASE | SCFIND_REGEXP | SCFIND_CXX11REGEX);
+}
+
+ILexer4 *CreateLexer(const Language &language) {
+	const LexerModule *lm = Catalogue::Find(language.lexer);
+	if (!lm)
+		return nullptr;
+	ILexer4 *lexer = lm->Create();
+	if (*language.keywords)
+		lexer->WordListSet(0, language.keywords);
+	lexer->PropertySet("fold", "1");
+	lexer->PropertySet("fold.html", "1");
+	return lexer;
+}
+
+/// Gives a document a lexer as ScintillaBase does.
+class DocumentLexer : public LexInterface {
+public:
+	DocumentLexer(Document *pdoc_, const Language &language) : LexInterface(pdoc_) {
+		instance = CreateLexer(language);
+	}
+	DocumentLexer(const DocumentLexer &) = delete;
+	DocumentLexer(DocumentLexer &&) = delete;
+	DocumentLexer &operator=(const DocumentLexer &) = delete;
+	DocumentLexer &operator=(DocumentLexer &&) = delete;
+	~DocumentLexer() override {
+		if (instance)
+			instance->Release();
+	}
+};
+
+void BenchLex(const std::string &text, const Language &language) {
+	ILexer4 *lexer = CreateLexer(language);
+	if (!lexer) {
+		Report("lex", 0, 0, "no lexer");
+		return;
+	}
+	DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+	Document *pdoc = holder.pdoc;
+	pdoc->SetUndoCollection(false);
+	pdoc->InsertString(0, text.c_str(), text.length());
+	const Sci::Position length = pdoc->Length();
+	ElapsedPeriod ep;
+	lexer->Lex(0, length, 0, pdoc);
+	Report("lex", ep.Duration(), length);
+	ep.Duration(true);
+	lexer->Fold(0, length, 0, pdoc);
+	Report("fold", ep.Duration(), length);
+	lexer->Release();
+}
+
+// Describes the first style, fold level or line state of pdoc that differs from pdocExpected.
+std::string StylingDifference(Document *pdoc, Document *pdocExpected) {
+	if (pdoc->GetEndStyled() != pdocExpected->GetEndStyled())
+		return "styled to " + std::to_string(pdoc->GetEndStyled()) + " not " + std::to_string(pdocExpected->GetEndStyled());
+	for (Sci::Position position = 0; position < pdoc->Length(); position++) {
+		if (pdoc->StyleAt(position) != pdocExpected->StyleAt(position))
+			return "style differs at " + std::to_string(position);
+	}
+	for (Sci::Line line = 0; line < pdoc->LinesTotal(); line++) {
+		if (pdoc->GetLevel(line) != pdocExpected->GetLevel(line))
+			return "level differs on line " + std::to_string(line);
+		if (pdoc->GetLineState(line) != pdocExpected->GetLineState(line))
+			return "line state differs on line " + std::to_string(line);
+	}
+	return "same as at once";
+}
+
+// Styles all of the document in the background a step at a time, as idle styling does.
+// When edit is set, inserts it in the middle after the first step, which invalidates the run.
+void StyleInBackground(Document *pdoc, const char *edit) {
+	constexpr Sci::Position step = 0x100000;
+	for (int calls = 0; (calls < 100000) && (pdoc->GetEndStyled() < pdoc->Length()); calls++) {
+		if (!pdoc->StyleInBackground(std::min(pdoc->Length(), pdoc->GetEndStyled() + step)))
+			break;
+		if (edit && (calls == 0))
+			pdoc->InsertString(pdoc->Length() / 2, edit, strlen(edit));
+	}
+}
+
+void BenchBackground(const std::string &text, const Language &language, int options, const char *what) {
+	for (const char *edit : { static_cast<const char *>(nullptr), language.sample }) {
+		DocumentHolder holderExpected(options);
+		Document *pdocExpected = holderExpected.pdoc;
+		pdocExpected->SetLexInterface(new DocumentLexer(pdocExpected, language));
+		pdocExpected->InsertString(0, text.c_str(), text.length());
+		if (edit)
+			pdocExpected->InsertString(pdocExpected->Length() / 2, edit, strlen(edit));
+		pdocExpected->EnsureStyledTo(pdocExpected->Length());
+
+		DocumentHolder holder(options);
+		Document *pdoc = holder.pdoc;
+		pdoc->SetLexInterface(new DocumentLexer(pdoc, language));
+		pdoc->SetBackgroundStyling(true);
+		pdoc->InsertString(0, text.c_str(), text.length());
+		ElapsedPeriod ep;
+		StyleInBackground(pdoc, edit);
+		const double duration = ep.Duration();
+		Report(edit ? (std::string(what) + " edited").c_str() : what, duration, text.length(),
+			StylingDifference(pdoc, pdocExpected));
+	}
+}
+
+/// Counts the text measured, which the position cache should mostly avoid.
+class SurfaceCounting : public SurfaceNull {
+public:
+	size_t runs = 0;
+	size_t bytes = 0;
+	void MeasureWidths(Font &font_, std::string_view text, XYPOSITION *positions) override {
+		runs++;
+		bytes += text.length();
+		SurfaceNull::MeasureWidths(font_, text, positions);
+	}
+};
+
+// Measures the runs of each line of the lexed text through one position cache, as views of a document
+// laying out their lines, again on each pass as when lines are laid out again after scrolling.
+void BenchPositionCache(const std::string &text, const Language &language) {
+	DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+	Document *pdoc = holder.pdoc;
+	pdoc->SetLexInterface(new DocumentLexer(pdoc, language));
+	pdoc->SetUndoCollection(false);
+	pdoc->InsertString(0, text.c_str(), text.length());
+	pdoc->EnsureStyledTo(pdoc->Length());
+	const char *chars = pdoc->BufferPointer();
+
+	// Runs of one style as BreakFinder finds them, leaving out tabs and single spaces which EditView::LayoutLine
+	// does not measure
+	struct Run {
+		Sci::Position start;
+		unsigned int length;
+		unsigned int style;
+	};
+	std::vector<Run> runs;
+	unsigned int lengthLongest = 1;
+	for (Sci::Line line = 0; line < pdoc->LinesTotal(); line++) {
+		const Sci::Position end = pdoc->LineEnd(line);
+		Sci::Position position = pdoc->LineStart(line);
+		while (position < end) {
+			const int style = pdoc->StyleIndexAt(position);
+			Sci::Position endRun = position + 1;
+			if (chars[position] != '\t') {
+				while ((endRun < end) && (pdoc->StyleIndexAt(endRun) == style) && (chars[endRun] != '\t'))
+					endRun++;
+				const unsigned int length = static_cast<unsigned int>(endRun - position);
+				if ((length > 1) || (chars[position] != ' ')) {
+					runs.push_back({ position, length, static_cast<unsigned int>(style) });
+					lengthLongest = std::max(lengthLongest, length);
+				}
+			}
+			position = endRun;
+		}
+	}
+
+	constexpr int passes = 3;
+	std::vector<XYPOSITION> positions(lengthLongest);
+	std::vector<XYPOSITION> positionsExpected(lengthLongest);
+	for (const size_t views : { 1, 2 }) {
+		SurfaceCounting surface;
+		std::vector<ViewStyle> styles(views);
+		for (ViewStyle &vs : styles) {
+			vs.EnsureStyle(255);
+			vs.Refresh(surface, pdoc->tabInChars);
+		}
+		PositionCache posCache;
+		bool same = true;
+		ElapsedPeriod ep;
+		for (int pass = 0; pass < passes; pass++) {
+			for (const ViewStyle &vs : styles) {
+				for (const Run &run : runs) {
+					posCache.MeasureWidths(&surface, vs, run.style, chars + run.start, run.length, positions.data(), pdoc);
+					if (pass == 0) {
+						FontAlias font = vs.styles[run.style].font;
+						surface.SurfaceNull::MeasureWidths(font,
+							std::string_view(chars + run.start, run.length), positionsExpected.data());
+						same = same && std::equal(positions.begin(), positions.begin() + run.length, positionsExpected.begin());
+					}
+				}
+			}
+		}
+		const double duration = ep.Duration();
+		Sci_CacheStatistics stats {};
+		posCache.GetStatistics(&stats);
+		const std::string what = "position cache " + std::to_string(views) + (views == 1 ? " view" : " views");
+		char measured[200];
+		snprintf(measured, sizeof(measured), "%zu measurements for %zu runs, %.2f MB, %.1f%% hits, %d entries%s",
+			surface.runs, runs.size() * views * passes, surface.bytes / 1e6,
+			stats.lookups ? stats.hits * 100.0 / stats.lookups : 0.0, stats.size, same ? "" : ", widths differ");
+		Report(what.c_str(), duration, pdoc->Length() * views * passes, measured);
+	}
+}
+
+/// A view of a document with no window, for laying out its lines.
+class ModelNull : public EditModel {
+public:
+	explicit ModelNull(const Language &language) {
+		pdoc->SetDBCSCodePage(SC_CP_UTF8);
+		pdoc->SetLexInterface(new DocumentLexer(pdoc, language));
+		pdoc->SetUndoCollection(false);
+	}
+	Sci::Line TopLineOfMain() const override {
+		return 0;
+	}
+	Point GetVisibleOriginInMain() const override {
+		return Point();
+	}
+	Sci::Line LinesOnScreen() const override {
+		return 1;
+	}
+	Range GetHotSpotRange() const noexcept override {
+		return Range(Sci::invalidPosition);
+	}
+};
+
+// The number of lines each line of the model wraps to, laid out on this thread as Editor::WrapLines does.
+std::vector<int> WrapAtOnce(const ModelNull &model, Surface *surface, const ViewStyle &vs, int width) {
+	EditView view;
+	std::vector<int> lines;
+	for (Sci::Line line = 0; line < model.pdoc->LinesTotal(); line++) {
+		LineLayout ll(static_cast<int>(model.pdoc->LineStart(line + 1) - model.pdoc->LineStart(line)));
+		view.LayoutLine(model, line, surface, vs, &ll, width);
+		lines.push_back(ll.lines);
+	}
+	return lines;
+}
+
+// Wraps the lines of the model in the background a batch at a time as Editor::WrapInBackground does.
+// When edit is set, it is inserted at the first line not yet wrapped while a run is wrapping that line,
+// as typing does, and lineEdit is set to that line: the pieces of the run must then be dropped.
+// Returns what went wrong or an empty string.
+std::string WrapInBackground(ModelNull &model, const ViewStyle &vs, int width, const char *edit,
+	std::vector<int> &lines, Sci::Line &lineEdit) {
+	constexpr Sci::Line batchLines = 0x4000;
+	Document *pdoc = model.pdoc;
+	BackgroundWrapper wrapper;
+	lines.assign(pdoc->LinesTotal(), 0);
+	lineEdit = -1;
+	Sci::Line pending = 0;
+	Sci::Line endRun = 0;
+	for (int calls = 0; (calls < 100000) && (pending < pdoc->LinesTotal()); calls++) {
+		for (const WrappedPiece &piece : wrapper.TakePieces(10)) {
+			if (piece.lineStart > pending)
+				break;
+			const Sci::Line lineEndPiece = std::min(piece.lineStart + static_cast<Sci::Line>(piece.lines.size()),
+				pdoc->LinesTotal());
+			for (; pending < lineEndPiece; pending++) {
+				lines[pending] = piece.lines[pending - piece.lineStart];
+			}
+		}
+		if (edit && (lineEdit < 0) && (pending > 0) && (pending < endRun) && wrapper.Wrapping()) {
+			const Sci::Line linesBefore = pdoc->LinesTotal();
+			pdoc->InsertString(pdoc->LineStart(pending), edit, strlen(edit));
+			lines.insert(lines.begin() + pending, pdoc->LinesTotal() - linesBefore, 0);
+			wrapper.Invalidate(pending);
+			if (wrapper.Wrapping())
+				return "still wrapping after an edit";
+			if (!wrapper.TakePieces(0).empty())
+				return "pieces wrapped before an edit taken after it";
+			lineEdit = pending;
+		}
+		if ((pending < pdoc->LinesTotal()) && !wrapper.Wrapping()) {
+			endRun = std::min(pdoc->LinesTotal(), pending + batchLines);
+			pdoc->EnsureStyledTo(pdoc->LineStart(endRun));
+			if (!wrapper.Start(std::make_unique<WrapSnapshot>(model, vs, 0, pending, endRun, width),
+				std::unique_ptr<Surface>(Surface::Allocate(SC_TECHNOLOGY_DEFAULT)), nullptr))
+				return "no thread";
+		}
+	}
+	if (edit && (lineEdit < 0))
+		return "finished before the edit";
+	return std::string();
+}
+
+void BenchWrap(const std::string &text, const Language &language) {
+	SurfaceNull surface;
+	ViewStyle vs;
+	vs.EnsureStyle(255);
+	vs.wrapState = eWrapWord;
+	vs.Refresh(surface, 4);
+	const int width = static_cast<int>(vs.aveCharWidth * 40);
+	for (const char *edit : { static_cast<const char *>(nullptr), language.sample }) {
+		ModelNull model(language);
+		model.pdoc->InsertString(0, text.c_str(), text.length());
+		std::vector<int> lines;
+		Sci::Line lineEdit = -1;
+		ElapsedPeriod ep;
+		std::string result = WrapInBackground(model, vs, width, edit, lines, lineEdit);
+		const double duration = ep.Duration();
+
+		ModelNull modelExpected(language);
+		modelExpected.pdoc->InsertString(0, text.c_str(), text.length());
+		if (lineEdit >= 0)
+			modelExpected.pdoc->InsertString(modelExpected.pdoc->LineStart(lineEdit), edit, strlen(edit));
+		ep.Duration(true);
+		modelExpected.pdoc->EnsureStyledTo(modelExpected.pdoc->Length());
+		const std::vector<int> linesExpected = WrapAtOnce(modelExpected, &surface, vs, width);
+		if (!edit)
+			Report("wrap", ep.Duration(), text.length());
+
+		if (result.empty()) {
+			const auto differ = std::mismatch(lines.begin(), lines.end(), linesExpected.begin(), linesExpected.end());
+			result = ((differ.first == lines.end()) && (differ.second == linesExpected.end())) ? "same as at once" :
+				"differs on line " + std::to_string(differ.first - lines.begin());
+		}
+		Report(edit ? "background wrap edited" : "background wrap", duration, text.length(), result);
+	}
+}
+
+void BenchConversion(const std::string &text) {
+	const std::string_view sv(text);
+	ElapsedPeriod ep;
+	const bool valid = UTF8IsValid(sv);
+	Report("UTF8IsValid", ep.Duration(), text.length(), valid ? "valid" : "invalid");
+	ep.Duration(true);
+	const size_t lengthUTF16 = UTF16Length(sv);
+	Report("UTF16Length", ep.Duration(), text.length(), std::to_string(lengthUTF16) + " units");
+	std::wstring ws(lengthUTF16, 0);
+	ep.Duration(true);
+	UTF16FromUTF8(sv, &ws[0], lengthUTF16);
+	Report("UTF16FromUTF8", ep.Duration(), text.length());
+	const std::wstring_view wsv(ws);
+	ep.Duration(true);
+	const size_t lengthUTF8 = UTF8Length(wsv);
+	Report("UTF8Length", ep.Duration(), text.length());
+	std::string back(lengthUTF8, '\0');
+	ep.Duration(true);
+	UTF8FromUTF16(wsv, &back[0], lengthUTF8);
+	Report("UTF8FromUTF16", ep.Duration(), text.length(), (back == text) ? "" : "differs");
+
+	// Setting and getting a document's text as UTF-16 a buffer at a time
+	constexpr Sci::Position bufferLength = 0x10000;
+	DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+	Document *pdoc = holder.pdoc;
+	pdoc->SetUndoCollection(false);
+	ep.Duration(true);
+	Sci::Position position = 0;
+	for (size_t start = 0; start < ws.length();) {
+		const Sci::Position lengthPiece = std::min<Sci::Position>(0x100000, ws.length() - start);
+		const Sci::Position inserted = pdoc->InsertUTF16(position, ws.c_str() + start, lengthPiece);
+		if (inserted == 0)
+			break;
+		start += inserted;
+	}
+	Report("load UTF-16", ep.Duration(), text.length());
+	// With the gap in the middle
+	pdoc->InsertString(pdoc->LineStart(pdoc->LinesTotal() / 2), " ", 1);
+	std::vector<wchar_t> buffer(bufferLength);
+	ep.Duration(true);
+	position = 0;
+	size_t units = 0;
+	while (position < pdoc->Length()) {
+		units += pdoc->GetUTF16Range(position, pdoc->Length(), buffer.data(), bufferLength);
+	}
+	Report("get UTF-16", ep.Duration(), text.length(), std::to_string(units) + " units");
+	ep.Duration(true);
+	std::string copy(pdoc->Length(), '\0');
+	pdoc->GetCharRange(&copy[0], 0, pdoc->Length());
+	const std::wstring wsCopy = WStringFromUTF8(copy);
+	Report("get UTF-16 through copies", ep.Duration(), text.length(), std::to_string(wsCopy.length()) + " units");
+}
+
+std::string StylesDiffer(const CellBuffer &cb, const std::string &styles) {
+	std::string held(cb.Length(), '\0');
+	cb.GetStyleRange(reinterpret_cast<unsigned char *>(&held[0]), 0, cb.Length());
+	const auto differ = std::mismatch(held.begin(), held.end(), styles.begin(), styles.end());
+	if ((differ.first == held.end()) && (differ.second == styles.end()))
+		return std::string();
+	return "differs at " + std::to_string(differ.first - held.begin());
+}
+
+// Styles of a buffer of 16 MB or more are held as runs until the runs are too short, when they are
+// held a byte each again. Checks them against a string styled the same way through both stages.
+void BenchStyleRuns(bool chunked, const char *what) {
+	constexpr Sci::Position lengthText = 0x1000000;
+	std::mt19937 rng(36);
+	CellBuffer cb(true, true, chunked);
+	cb.SetUndoCollection(false);
+	std::string styles(lengthText, '\0');
+	bool startSequence = false;
+	ElapsedPeriod ep;
+	cb.InsertString(0, std::string(lengthText, 'x').c_str(), lengthText, startSequence);
+	const bool runsLoaded = cb.HasStyleRuns();
+	// Fills of at most maxFill bytes between insertions and deletions
+	auto edit = [&](Sci::Position maxFill) {
+		for (int i = 0; i < 2000; i++) {
+			const Sci::Position length = cb.Length();
+			const Sci::Position position = rng() % (length + 1);
+			const Sci::Position lengthChange = std::min<Sci::Position>(1 + rng() % maxFill, length - position);
+			const char value = static_cast<char>(rng() % 32);
+			switch (rng() % 4) {
+			case 0:
+				cb.InsertString(position, std::string(lengthChange + 1, 'y').c_str(), lengthChange + 1, startSequence);
+				styles.insert(position, lengthChange + 1, '\0');
+				break;
+			case 1:
+				if (lengthChange > 0) {
+					cb.DeleteChars(position, lengthChange, startSequence);
+					styles.erase(position, lengthChange);
+				}
+				break;
+			default:
+				cb.SetStyleFor(position, lengthChange, value);
+				styles.replace(position, lengthChange, lengthChange, value);
+				break;
+			}
+		}
+	};
+	edit(0x1000);
+	std::string result = StylesDiffer(cb, styles);
+	const bool runsEdited = cb.HasStyleRuns();
+	// A megabyte styled a byte at a time makes the runs too short
+	std::string alternate(0x100000, '\0');
+	for (size_t i = 0; i < alternate.length(); i++)
+		alternate[i] = static_cast<char>(1 + i % 2);
+	const Sci::Position positionAlternate = rng() % (cb.Length() - alternate.length());
+	Sci::Position firstChanged = 0;
+	Sci::Position lastChanged = 0;
+	cb.SetStyles(positionAlternate, alternate.c_str(), alternate.length(), firstChanged, lastChanged);
+	styles.replace(positionAlternate, alternate.length(), alternate);
+	const bool runsAlternate = cb.HasStyleRuns();
+	if (result.empty())
+		result = StylesDiffer(cb, styles);
+	edit(8);
+	if (result.empty())
+		result = StylesDiffer(cb, styles);
+	const double duration = ep.Duration();
+	if (!runsLoaded || !runsEdited)
+		result += " not held as runs";
+	else if (runsAlternate || cb.HasStyleRuns())
+		result += " not held a byte each after short runs";
+	Report(what, duration, lengthText, result.empty() ? "same as styled" : result);
+}
+
+// Conversions a byte or unit at a time, as they were before runs of ASCII were taken 16 at a time.
+
+size_t UTF8ValidLengthScalar(std::string_view svu8) noexcept {
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(svu8.data());
+	size_t i = 0;
+	while (i < svu8.length()) {
+		const int utf8Status = UTF8Classify(us + i, svu8.length() - i);
+		if (utf8Status & UTF8MaskInvalid)
+			break;
+		i += utf8Status & UTF8MaskWidth;
+	}
+	return i;
+}
+
+size_t UTF16LengthScalar(std::string_view svu8) noexcept {
+	size_t ulen = 0;
+	for (size_t i = 0; i < svu8.length();) {
+		const unsigned int byteCount = UTF8BytesOfLead[static_cast<unsigned char>(svu8[i])];
+		i += byteCount;
+		ulen += (i > svu8.length()) ? 1 : UTF16LengthFromUTF8ByteCount(byteCount);
+	}
+	return ulen;
+}
+
+size_t UTF16FromUTF8Scalar(std::string_view svu8, wchar_t *tbuf, size_t tlen) {
+	size_t ui = 0;
+	for (size_t i = 0; i < svu8.length();) {
+		const unsigned char *us = reinterpret_cast<const unsigned char *>(svu8.data()) + i;
+		const unsigned int byteCount = UTF8BytesOfLead[us[0]];
+		if (i + byteCount > svu8.length()) {
+			if (ui < tlen)
+				tbuf[ui++] = us[0];
+			break;
+		}
+		if (ui + UTF16LengthFromUTF8ByteCount(byteCount) > tlen)
+			throw std::runtime_error("UTF16FromUTF8Scalar: attempted write beyond end");
+		const unsigned int value = UnicodeFromUTF8(us);
+		if (byteCount == 4) {
+			tbuf[ui++] = static_cast<wchar_t>(((value - 0x10000) >> 10) + SURROGATE_LEAD_FIRST);
+			tbuf[ui++] = static_cast<wchar_t>((value & 0x3ff) + SURROGATE_TRAIL_FIRST);
+		} else {
+			tbuf[ui++] = static_cast<wchar_t>(value);
+		}
+		i += byteCount;
+	}
+	return ui;
+}
+
+size_t UTF8LengthScalar(std::wstring_view wsv) noexcept {
+	size_t len = 0;
+	for (size_t i = 0; i < wsv.length() && wsv[i]; i++) {
+		const unsigned int uch = wsv[i];
+		if (uch < 0x80) {
+			len++;
+		} else if (uch < 0x800) {
+			len += 2;
+		} else if ((uch >= SURROGATE_LEAD_FIRST) && (uch <= SURROGATE_TRAIL_LAST)) {
+			len += 4;
+			i++;
+		} else {
+			len += 3;
+		}
+	}
+	return len;
+}
+
+void UTF8FromUTF16Scalar(std::wstring_view wsv, char *putf, size_t len) {
+	size_t k = 0;
+	for (size_t i = 0; i < wsv.length() && wsv[i]; i++) {
+		const unsigned int uch = wsv[i];
+		if (uch < 0x80) {
+			putf[k++] = static_cast<char>(uch);
+		} else if (uch < 0x800) {
+			putf[k++] = static_cast<char>(0xC0 | (uch >> 6));
+			putf[k++] = static_cast<char>(0x80 | (uch & 0x3f));
+		} else if ((uch >= SURROGATE_LEAD_FIRST) && (uch <= SURROGATE_TRAIL_LAST)) {
+			i++;
+			const unsigned int xch = 0x10000 + ((uch & 0x3ff) << 10) + (wsv[i] & 0x3ff);
+			putf[k++] = static_cast<char>(0xF0 | (xch >> 18));
+			putf[k++] = static_cast<char>(0x80 | ((xch >> 12) & 0x3f));
+			putf[k++] = static_cast<char>(0x80 | ((xch >> 6) & 0x3f));
+			putf[k++] = static_cast<char>(0x80 | (xch & 0x3f));
+		} else {
+			putf[k++] = static_cast<char>(0xE0 | (uch >> 12));
+			putf[k++] = static_cast<char>(0x80 | ((uch >> 6) & 0x3f));
+			putf[k++] = static_cast<char>(0x80 | (uch & 0x3f));
+		}
+	}
+	if (k < len)
+		putf[k] = '\0';
+}
+
+// Number of units written or SIZE_MAX when the conversion throws for a buffer too short.
+template <typename Convert>
+size_t Converted(Convert convert) {
+	try {
+		return convert();
+	} catch (const std::runtime_error &) {
+		return SIZE_MAX;
+	}
+}
+
+// Name of the first conversion of UTF-8 that differs from the scalar version, or nullptr.
+// The text is followed by bytes that are not ASCII so reading past its end changes the result.
+const char *ConversionDiffers(std::string_view svu8) {
+	const size_t lengthValid = UTF8ValidLengthScalar(svu8);
+	if (UTF8ValidLength(svu8) != lengthValid)
+		return "UTF8ValidLength";
+	if (UTF8IsValid(svu8) != (lengthValid == svu8.length()))
+		return "UTF8IsValid";
+	const size_t lengthUTF16 = UTF16LengthScalar(svu8);
+	if (UTF16Length(svu8) != lengthUTF16)
+		return "UTF16Length";
+	// Long enough, and too short to end before or after the last block of ASCII
+	for (const size_t shorter : { 0, 1, 15, 16, 17 }) {
+		const size_t tlen = lengthUTF16 - std::min(shorter, lengthUTF16);
+		std::wstring ws(tlen + 16, L'\xFFFE');
+		std::wstring wsExpected(ws);
+		const size_t written = Converted([&]() { return UTF16FromUTF8(svu8, &ws[0], tlen); });
+		const size_t writtenExpected = Converted([&]() { return UTF16FromUTF8Scalar(svu8, &wsExpected[0], tlen); });
+		if ((written != writtenExpected) || (ws != wsExpected))
+			return "UTF16FromUTF8";
+	}
+	return nullptr;
+}
+
+// Name of the first conversion of UTF-16 that differs from the scalar version, or nullptr.
+const char *ConversionDiffers(std::wstring_view wsv) {
+	const size_t lengthUTF8 = UTF8LengthScalar(wsv);
+	if (UTF8Length(wsv) != lengthUTF8)
+		return "UTF8Length";
+	std::string s(lengthUTF8 + 16, '\x7F');
+	std::string sExpected(s);
+	UTF8FromUTF16(wsv, &s[0], lengthUTF8 + 1);
+	UTF8FromUTF16Scalar(wsv, &sExpected[0], lengthUTF8 + 1);
+	return (s == sExpected) ? nullptr : "UTF8FromUTF16";
+}
+
+// Compares the conversions that take runs of ASCII 16 at a time with those a byte at a time on short text:
+// every length up to 5 blocks with a byte or unit that is not ASCII at each position, then random text with
+// invalid UTF-8. Each text starts at a varying alignment.
+void BenchASCIIRuns() {
+	std::mt19937 rng(49);
+	size_t cases = 0;
+	size_t bytes = 0;
+	std::string result;
+	auto check = [&](const auto &text, size_t alignment, auto after) {
+		auto placed = text.substr(0, 0);
+		placed.append(alignment, text.empty() ? 'a' : text[0]);
+		placed.append(text);
+		placed.append(16, after);
+		const char *differs = ConversionDiffers(std::basic_string_view(placed.data() + alignment, text.length()));
+		cases++;
+		bytes += text.length() * sizeof(text[0]);
+		if (differs && result.empty())
+			result = std::string(differs) + " differs on case " + std::to_string(cases);
+	};
+	ElapsedPeriod ep;
+	constexpr size_t maxSwept = 80;
+	const unsigned char bytesNotASCII[] = { 0x80, 0xBF, 0xC3, 0xE2, 0xF0, 0xFF };
+	const wchar_t unitsNotASCII[] = { 0, 0x80, 0x141, 0x7FF, 0x800, 0xFF41 };
+	for (size_t length = 0; length <= maxSwept; length++) {
+		check(std::string(length, 'a'), length % 16, '\xFF');
+		check(std::wstring(length, L'a'), length % 16, L'\x100');
+		for (size_t position = 0; position < length; position++) {
+			for (const unsigned char b : bytesNotASCII) {
+				std::string text(length, 'a');
+				text[position] = b;
+				check(text, (length + position) % 16, '\xFF');
+			}
+			for (const wchar_t unit : unitsNotASCII) {
+				std::wstring text(length, L'a');
+				text[position] = unit;
+				check(text, (length + position) % 16, L'\x100');
+			}
+		}
+	}
+	for (int i = 0; i < 20000; i++) {
+		const size_t length = rng() % 200;
+		std::string text;
+		std::wstring wtext;
+		while (text.length() < length) {
+			const unsigned int kind = rng() % 20;
+			char utf8[UTF8MaxBytes + 1];
+			if (kind < 16) {
+				text.push_back(static_cast<char>(0x20 + rng() % 0x5F));
+				wtext.push_back(text.back());
+			} else if (kind == 16) {
+				// Invalid: a lone trail byte, a lead byte without its trail or a byte never in UTF-8
+				text.push_back(static_cast<char>(0x80 + rng() % 0x80));
+			} else {
+				const unsigned int ranges[] = { 0x80, 0x800, 0x10000, 0x110000 };
+				const unsigned int range = rng() % 3;
+				unsigned int value = ranges[range] + rng() % (ranges[range + 1] - ranges[range]);
+				if ((value >= SURROGATE_LEAD_FIRST) && (value <= SURROGATE_TRAIL_LAST))
+					value = 0xFFFD;
+				UTF8FromUTF32Character(value, utf8);
+				text.append(utf8);
+				wchar_t units[2];
+				wtext.append(units, UTF16FromUTF32Character(value, units));
+			}
+		}
+		check(text, rng() % 16, '\xFF');
+		check(wtext, rng() % 16, L'\x100');
+	}
+	Report("ASCII runs", ep.Duration(), bytes,
+		result.empty() ? "same as a byte at a time in " + std::to_string(cases) + " cases" : result);
+}
+
+// Random text of length bytes or a little more with runs of ASCII, characters of 2 to 4 bytes and, when
+// withInvalid, invalid UTF-8: lone trail bytes, bytes never in UTF-8, sequences missing their last byte,
+// overlong forms, surrogates and values over 0x10FFFF.
+std::string RandomUTF8(std::mt19937 &rng, size_t length, bool withInvalid = true) {
+	std::string text;
+	while (text.length() < length) {
+		const unsigned int kind = rng() % (withInvalid ? 12 : 8);
+		char utf8[UTF8MaxBytes + 1];
+		if (kind < 6) {
+			text.append(1 + rng() % 20, static_cast<char>(0x20 + rng() % 0x5F));
+		} else if (kind < 9) {
+			const unsigned int ranges[] = { 0x80, 0x800, 0x10000, 0x110000 };
+			const unsigned int range = rng() % 3;
+			unsigned int value = ranges[range] + rng() % (ranges[range + 1] - ranges[range]);
+			if ((value >= SURROGATE_LEAD_FIRST) && (value <= SURROGATE_TRAIL_LAST))
+				value = 0xFFFD;
+			UTF8FromUTF32Character(value, utf8);
+			if (kind == 8)
+				utf8[strlen(utf8) - 1] = '\0';
+			text.append(utf8);
+		} else if (kind == 9) {
+			text.push_back(static_cast<char>(0x80 + rng() % 0x80));
+		} else {
+			const char *invalid[] = { "\xC0\xAF", "\xE0\x80\xAF", "\xF0\x80\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80" };
+			text.append(invalid[rng() % std::size(invalid)]);
+		}
+	}
+	return text;
+}
+
+// UTF-16 of text with each byte of invalid UTF-8 as a code unit holding the byte, a character at a time.
+std::wstring UTF16OfCharacters(std::string_view text) {
+	std::wstring ws;
+	for (size_t i = 0; i < text.length();) {
+		const int utf8Status = UTF8Classify(reinterpret_cast<const unsigned char *>(text.data() + i), text.length() - i);
+		if (utf8Status & UTF8MaskInvalid) {
+			ws.push_back(static_cast<unsigned char>(text[i]));
+			i++;
+		} else {
+			const size_t width = utf8Status & UTF8MaskWidth;
+			wchar_t units[2];
+			ws.append(units, UTF16FromUTF8(text.substr(i, width), units, std::size(units)));
+			i += width;
+		}
+	}
+	return ws;
+}
+
+// Gets random text with invalid UTF-8 from documents with the gap at a random position, from a random start
+// to a random end a few code units at a time, so characters, valid or not, are divided by the gap, by the
+// end of the buffer and by the end of the range. Checks the result against a conversion a character at a time.
+void BenchUTF16Range() {
+	std::mt19937 rng(50);
+	size_t cases = 0;
+	size_t bytes = 0;
+	std::string result;
+	ElapsedPeriod ep;
+	for (int i = 0; (i < 2000) && result.empty(); i++) {
+		const std::string text = RandomUTF8(rng, rng() % 100);
+		DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+		Document *pdoc = holder.pdoc;
+		pdoc->SetUndoCollection(false);
+		pdoc->InsertString(0, text.c_str(), text.length());
+		const Sci::Position gap = rng() % (text.length() + 1);
+		pdoc->InsertString(gap, "a", 1);
+		pdoc->DeleteChars(gap, 1);
+		for (int range = 0; range < 10; range++) {
+			Sci::Position start = rng() % (text.length() + 1);
+			Sci::Position end = rng() % (text.length() + 1);
+			if (start > end)
+				std::swap(start, end);
+			const std::wstring expected = UTF16OfCharacters(std::string_view(text).substr(start, end - start));
+			std::wstring ws;
+			Sci::Position position = start;
+			while (position < end) {
+				// At least 2 code units so each character fits
+				wchar_t buffer[8];
+				const Sci::Position written = pdoc->GetUTF16Range(position, end, buffer, 2 + rng() % 7);
+				if (written == 0)
+					break;
+				ws.append(buffer, written);
+			}
+			cases++;
+			bytes += end - start;
+			if (((ws != expected) || (position != end)) && result.empty())
+				result = "differs on case " + std::to_string(cases);
+		}
+	}
+	Report("UTF-16 ranges", ep.Duration(), bytes,
+		result.empty() ? "same as a character at a time in " + std::to_string(cases) + " cases" : result);
+}
+
+// Edits random text in a document, either with invalid UTF-8 throughout or valid with a few invalid
+// insertions, and converts random positions, sorted and not, through the UTF-16 position map.
+// Checks them against counting the code units of the text from its start a character at a time.
+void BenchUTF16Positions(int options, const char *what) {
+	std::mt19937 rng(47);
+	size_t checks = 0;
+	size_t bytes = 0;
+	std::string result;
+	ElapsedPeriod ep;
+	for (const int oddsInvalid : { 1, 50 }) {
+		DocumentHolder holder(options);
+		Document *pdoc = holder.pdoc;
+		pdoc->SetUndoCollection(false);
+		std::string text = RandomUTF8(rng, 30000, oddsInvalid == 1);
+		pdoc->InsertString(0, text.c_str(), text.length());
+		for (int round = 0; (round < 1000) && result.empty(); round++) {
+			const size_t position = rng() % (text.length() + 1);
+			if ((rng() % 2) && (position < text.length())) {
+				// Mostly a few bytes so characters are cut, sometimes several blocks
+				const size_t lengthDelete = std::min<size_t>(text.length() - position,
+					(rng() % 4 == 0) ? rng() % 12000 : 1 + rng() % 8);
+				pdoc->DeleteChars(position, lengthDelete);
+				text.erase(position, lengthDelete);
+			} else {
+				const std::string insertion = RandomUTF8(rng, (rng() % 8 == 0) ? rng() % 15000 : 1 + rng() % 8,
+					rng() % oddsInvalid == 0);
+				pdoc->InsertString(position, insertion.c_str(), insertion.length());
+				text.insert(position, insertion);
+			}
+			if (round % 10)
+				continue;
+			// unitsBefore of a byte inside a character is the code units up to the end of the character;
+			// positionOfUnit of a code unit is the start of its character
+			std::vector<int> unitsBefore(text.length() + 1);
+			std::vector<int> positionOfUnit;
+			for (size_t i = 0; i < text.length();) {
+				const int utf8Status = UTF8Classify(reinterpret_cast<const unsigned char *>(text.data() + i), text.length() - i);
+				const size_t width = utf8Status & UTF8MaskWidth;
+				unitsBefore[i] = static_cast<int>(positionOfUnit.size());
+				positionOfUnit.insert(positionOfUnit.end(), (width == 4) ? 2 : 1, static_cast<int>(i));
+				for (size_t k = 1; k <= width; k++)
+					unitsBefore[i + k] = static_cast<int>(positionOfUnit.size());
+				i += width;
+			}
+			positionOfUnit.push_back(static_cast<int>(text.length()));
+			for (const bool sorted : { true, false }) {
+				std::vector<int> positions(300);
+				std::vector<int> units(300);
+				for (size_t k = 0; k < positions.size(); k++) {
+					positions[k] = rng() % (text.length() + 1);
+					units[k] = rng() % positionOfUnit.size();
+				}
+				if (sorted) {
+					std::sort(positions.begin(), positions.end());
+					std::sort(units.begin(), units.end());
+				}
+				std::vector<int> converted = positions;
+				pdoc->UTF16FromPositions(converted.data(), converted.size());
+				std::vector<int> convertedBack = units;
+				pdoc->PositionsFromUTF16(convertedBack.data(), convertedBack.size());
+				for (size_t k = 0; k < positions.size(); k++) {
+					if ((converted[k] != unitsBefore[positions[k]]) && result.empty())
+						result = "UTF-16 of " + std::to_string(positions[k]) + " differs in round " + std::to_string(round);
+					if ((convertedBack[k] != positionOfUnit[units[k]]) && result.empty())
+						result = "position of " + std::to_string(units[k]) + " differs in round " + std::to_string(round);
+				}
+				checks += positions.size() + units.size();
+			}
+			bytes += text.length();
+		}
+	}
+	Report(what, ep.Duration(), bytes,
+		result.empty() ? "same as counting from the start in " + std::to_string(checks) + " checks" : result);
+}
+
+// The runs of rs as pairs of start and value.
+std::vector<std::pair<Sci::Position, int>> Runs(const RunStyles<Sci::Position, int> &rs) {
+	std::vector<std::pair<Sci::Position, int>> runs;
+	for (Sci::Position position = 0; position < rs.Length(); position = rs.EndRun(position))
+		runs.emplace_back(position, rs.ValueAt(position));
+	return runs;
+}
+
+// The start of each partition then the partition of each position up to the end of the last partition.
+std::vector<Sci::Position> Layout(const Partitioning<Sci::Position> &partitioning) {
+	std::vector<Sci::Position> layout;
+	for (Sci::Position partition = 0; partition <= partitioning.Partitions(); partition++)
+		layout.push_back(partitioning.PositionFromPartition(partition));
+	const Sci::Position end = layout.back();
+	for (Sci::Position position = 0; position <= end; position++)
+		layout.push_back(partitioning.PartitionFromPosition(position));
+	return layout;
+}
+
+// Checks that filling many ranges in one pass gives the runs of filling them one at a time, reporting a
+// change that covers each value changed, and that removing partitions together leaves the positions of
+// removing them one at a time, with the step before, inside and after the removed partitions.
+void BenchBatchedRuns() {
+	std::mt19937 rng(46);
+	size_t cases = 0;
+	std::string result;
+	auto fail = [&](const char *what) {
+		if (result.empty())
+			result = std::string(what) + " differs on case " + std::to_string(cases);
+	};
+	ElapsedPeriod ep;
+	for (int i = 0; i < 2000; i++) {
+		RunStyles<Sci::Position, int> batched;
+		RunStyles<Sci::Position, int> single;
+		batched.InsertSpace(0, 1000);
+		single.InsertSpace(0, 1000);
+		// Fills, insertions and deletions leave runs of a few values and the step of the runs anywhere
+		for (int edit = 0; edit < 50; edit++) {
+			const Sci::Position position = rng() % batched.Length();
+			const Sci::Position length = 1 + rng() % std::min<Sci::Position>(40, batched.Length() - position);
+			const int value = rng() % 4;
+			switch (rng() % 3) {
+			case 0:
+				batched.FillRange(position, value, length);
+				single.FillRange(position, value, length);
+				break;
+			case 1:
+				batched.InsertSpace(position, length);
+				single.InsertSpace(position, length);
+				break;
+			default:
+				if (batched.Length() > 200) {
+					batched.DeleteRange(position, length);
+					single.DeleteRange(position, length);
+				}
+			}
+		}
+		// Sorted ranges, some adjacent
+		std::vector<Sci::Position> ranges;
+		for (Sci::Position position = rng() % 20; position < batched.Length();) {
+			const Sci::Position length = 1 + rng() % std::min<Sci::Position>(30, batched.Length() - position);
+			ranges.push_back(position);
+			ranges.push_back(length);
+			position += length + rng() % 30;
+		}
+		const int value = rng() % 4;
+		std::vector<int> before;
+		for (Sci::Position position = 0; position < batched.Length(); position++)
+			before.push_back(batched.ValueAt(position));
+		const FillResult<Sci::Position> fillResult = batched.FillRanges(ranges.data(), ranges.size() / 2, value);
+		for (size_t range = 0; range < ranges.size(); range += 2)
+			single.FillRange(ranges[range], value, ranges[range + 1]);
+		cases++;
+		try {
+			batched.Check();
+		} catch (const std::exception &) {
+			fail("FillRanges check");
+		}
+		if (Runs(batched) != Runs(single))
+			fail("FillRanges");
+		for (Sci::Position position = 0; position < batched.Length(); position++) {
+			if ((batched.ValueAt(position) != before[position]) && (!fillResult.changed ||
+				(position < fillResult.position) || (position >= fillResult.position + fillResult.fillLength)))
+				fail("FillRanges change");
+		}
+	}
+	for (int i = 0; i < 3000; i++) {
+		Partitioning<Sci::Position> batched(8);
+		Partitioning<Sci::Position> single(8);
+		const Sci::Position partitions = 2 + rng() % 40;
+		batched.InsertText(0, partitions * 10);
+		single.InsertText(0, partitions * 10);
+		for (Sci::Position partition = 1; partition < partitions; partition++) {
+			batched.InsertPartition(partition, partition * 10);
+			single.InsertPartition(partition, partition * 10);
+		}
+		const Sci::Position partition = 1 + rng() % (partitions - 1);
+		const Sci::Position count = 1 + rng() % (partitions - partition);
+		// The step before, inside or after the partitions removed
+		Sci::Position step = partition + count + rng() % (partitions - partition - count + 1);
+		const int where = rng() % 3;
+		if ((where == 0) || (step >= partitions))
+			step = rng() % partition;
+		else if (where == 1)
+			step = partition + rng() % count;
+		const Sci::Position delta = 1 + rng() % 20;
+		batched.InsertText(step, delta);
+		single.InsertText(step, delta);
+		batched.RemovePartitions(partition, count);
+		for (Sci::Position removal = 0; removal < count; removal++)
+			single.RemovePartition(partition);
+		cases++;
+		if (Layout(batched) != Layout(single))
+			fail("RemovePartitions");
+		// Inserting text again moves the step from where the removal left it
+		const Sci::Position partitionInsert = rng() % batched.Partitions();
+		batched.InsertText(partitionInsert, delta);
+		single.InsertText(partitionInsert, delta);
+		if (Layout(batched) != Layout(single))
+			fail("RemovePartitions then InsertText");
+	}
+	Report("batched runs", ep.Duration(), 0,
+		result.empty() ? "same as one at a time in " + std::to_string(cases) + " cases" : result);
+}
+
+// The length of the longest contiguous range of cb, which for a chunked buffer is its longest chunk.
+Sci::Position LongestRange(const CellBuffer &cb) {
+	Sci::Position longest = 0;
+	Sci::Position position = 0;
+	while (position < cb.Length()) {
+		Sci::Position start = 0;
+		Sci::Position length = 0;
+		cb.ContiguousRange(position, start, length);
+		longest = std::max(longest, length);
+		position = start + length;
+	}
+	return longest;
+}
+
+// Takes pointers to ranges of a chunked buffer between random edits, whose deletions also take the text
+// deleted for undo by a range pointer. Checks the ranges and the text against a string edited the same way
+// and that no chunk grows longer than a chunk may be, except for a long range until an edit in it.
+void BenchRangePointer() {
+	constexpr Sci::Position maxChunk = 0x10000;	// As in ChunkedVector
+	std::mt19937 rng(32);
+	CellBuffer cb(true, true, true);
+	std::string text = Varied(Corpus(languages[0].sample, 0x200000));
+	bool startSequence = false;
+	cb.InsertString(0, text.c_str(), text.length(), startSequence);
+	size_t ranges = 0;
+	Sci::Position longest = 0;
+	std::string result;
+	ElapsedPeriod ep;
+	for (int i = 0; (i < 20000) && result.empty(); i++) {
+		const Sci::Position position = rng() % (text.length() + 1);
+		const unsigned int kind = rng() % 3;
+		if (kind == 0) {
+			const char *insertions[] = { "x", "word ", "\r\n", "if (a) {" };
+			const char *insertion = insertions[rng() % std::size(insertions)];
+			cb.InsertString(position, insertion, strlen(insertion), startSequence);
+			text.insert(position, insertion);
+		} else {
+			// Mostly short, as taken by a search or a deletion, sometimes longer than a chunk
+			const Sci::Position lengthRange = std::min<Sci::Position>(text.length() - position,
+				(rng() % 100 == 0) ? maxChunk + rng() % (2 * maxChunk) : 1 + rng() % 1000);
+			if (lengthRange == 0)
+				continue;
+			const char *range = (kind == 1) ? cb.RangePointer(position, lengthRange) :
+				cb.DeleteChars(position, lengthRange, startSequence);
+			ranges++;
+			if (text.compare(position, lengthRange, range, lengthRange) != 0)
+				result = "range " + std::to_string(ranges) + " differs";
+			if (kind == 2) {
+				text.erase(position, lengthRange);
+			} else if (lengthRange > maxChunk) {
+				// An edit in a long range splits it
+				const Sci::Position positionDelete = position + rng() % lengthRange;
+				cb.DeleteChars(positionDelete, 1, startSequence);
+				text.erase(positionDelete, 1);
+			}
+		}
+		longest = std::max(longest, LongestRange(cb));
+	}
+	std::string all(cb.Length(), '\0');
+	cb.GetCharRange(&all[0], 0, cb.Length());
+	if (result.empty() && (all != text))
+		result = "text differs";
+	if (result.empty() && (longest > maxChunk))
+		result = "chunk of " + std::to_string(longest) + " bytes";
+	Report("range pointers chunked", ep.Duration(), 0, result.empty() ? "same as edited, " + std::to_string(ranges) +
+		" ranges, longest chunk " + std::to_string(longest) + " bytes" : result);
+}
+
+std::string DocumentText(const Document *pdoc) {
+	std::string text(pdoc->Length(), '\0');
+	pdoc->GetCharRange(&text[0], 0, pdoc->Length());
+	return text;
+}
+
+std::string Megabytes(size_t bytes) {
+	char mb[40];
+	snprintf(mb, sizeof(mb), "%.1f MB", bytes / 1e6);
+	return mb;
+}
+
+// Replaces each match as one user operation, as SCI_REPLACETARGET does in a loop, then undoes and redoes it.
+void BenchReplaceAll(const std::string &text, const char *search, const char *replacement) {
+	DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+	Document *pdoc = holder.pdoc;
+	pdoc->SetUndoCollection(false);
+	pdoc->InsertString(0, text.c_str(), text.length());
+	pdoc->SetUndoCollection(true);
+	const Sci::Position lengthReplacement = strlen(replacement);
+	ElapsedPeriod ep;
+	int matches = 0;
+	pdoc->BeginUndoAction();
+	for (Sci::Position position = 0;;) {
+		Sci::Position lengthFound = strlen(search);
+		const Sci::Position found = pdoc->FindText(position, pdoc->Length(), search, SCFIND_MATCHCASE, &lengthFound);
+		if (found < 0)
+			break;
+		pdoc->DeleteChars(found, lengthFound);
+		pdoc->InsertString(found, replacement, lengthReplacement);
+		position = found + lengthReplacement;
+		matches++;
+	}
+	pdoc->EndUndoAction();
+	Report("replace all", ep.Duration(), text.length(),
+		std::to_string(matches) + " matches, undo text " + Megabytes(pdoc->UndoMemory()));
+	const std::string replaced = DocumentText(pdoc);
+	ep.Duration(true);
+	pdoc->Undo();
+	const double durationUndo = ep.Duration();
+	Report("undo replace all", durationUndo, text.length(), (DocumentText(pdoc) == text) ? "" : "differs");
+	ep.Duration(true);
+	pdoc->Redo();
+	const double durationRedo = ep.Duration();
+	Report("redo replace all", durationRedo, text.length(), (DocumentText(pdoc) == replaced) ? "" : "differs");
+}
+
+// Edits with an undo memory limit far below the text of the edits so the history is trimmed many times,
+// and with tentative actions that outgrow the limit. Then checks that tentative undo returns to the text at
+// the tentative start, that each undo and redo reaches the text after the matching user operation, and that
+// undo stops, away from the save point, where the history was trimmed.
+void BenchUndoTrim() {
+	constexpr size_t undoLimit = 0x40000;
+	DocumentHolder holder(SC_DOCUMENTOPTION_DEFAULT);
+	Document *pdoc = holder.pdoc;
+	pdoc->SetUndoMemoryLimit(undoLimit);
+	std::mt19937 rng(35);
+	const std::hash<std::string> hasher;
+	// Hash of the text after each user operation
+	std::vector<size_t> texts(1, hasher(std::string()));
+	size_t undoMemory = 0;
+	auto change = [&]() {
+		const Sci::Position length = pdoc->Length();
+		const Sci::Position position = rng() % (length + 1);
+		if ((rng() % 2 == 0) && (position < length)) {
+			pdoc->DeleteChars(position, std::min<Sci::Position>(1 + rng() % 400, length - position));
+		} else {
+			const std::string insertion(1 + rng() % 400, static_cast<char>('a' + rng() % 26));
+			pdoc->InsertString(position, insertion.c_str(), insertion.length());
+		}
+	};
+	auto operate = [&](int operations) {
+		for (int operation = 0; operation < operations; operation++) {
+			pdoc->BeginUndoAction();
+			for (unsigned int changes = 1 + rng() % 4; changes > 0; changes--)
+				change();
+			pdoc->EndUndoAction();
+			texts.push_back(hasher(DocumentText(pdoc)));
+			undoMemory = std::max(undoMemory, pdoc->UndoMemory());
+		}
+	};
+	ElapsedPeriod ep;
+	std::string result;
+	operate(3000);
+	const size_t undoMemoryTrimmed = undoMemory;
+	pdoc->TentativeStart();
+	for (int i = 0; i < 3000; i++)
+		change();
+	const size_t undoMemoryTentative = pdoc->UndoMemory();
+	pdoc->TentativeUndo();
+	if (hasher(DocumentText(pdoc)) != texts.back())
+		result = "tentative undo differs";
+	operate(3000);
+	size_t steps = 0;
+	while (pdoc->CanUndo() && result.empty()) {
+		pdoc->Undo();
+		steps++;
+		if (hasher(DocumentText(pdoc)) != texts[texts.size() - 1 - steps])
+			result = "undo differs at step " + std::to_string(steps);
+	}
+	if (result.empty() && ((steps + 1 >= texts.size()) || pdoc->IsSavePoint()))
+		result = "not trimmed";
+	for (size_t step = steps; (step > 0) && pdoc->CanRedo() && result.empty(); step--) {
+		pdoc->Redo();
+		if (hasher(DocumentText(pdoc)) != texts[texts.size() - step])
+			result = "redo differs at step " + std::to_string(steps + 1 - step);
+	}
+	if (result.empty() && pdoc->CanRedo())
+		result = "redo beyond the last operation";
+	Report("undo trim", ep.Duration(), 0, result.empty() ?
+		"same as edited, " + std::to_string(steps) + " of " + std::to_string(texts.size() - 1) +
+		" operations kept, undo text at most " + Megabytes(undoMemoryTrimmed) + ", " +
+		Megabytes(undoMemoryTentative) + " when tentative" : result);
+}
+
+void BenchText(const std::string &title, const std::string &text, const Language *language, int edits, bool corpus) {
+	printf("%s: %.1f MB\n", title.c_str(), text.length() / 1e6);
+	BenchLoad(text);
+	BenchEdits(text, SC_DOCUMENTOPTION_DEFAULT, "random edits", edits);
+	BenchEdits(text, SC_DOCUMENTOPTION_CHUNKED, "random edits chunked", edits);
+	BenchSearch(text, language ? language->word : "return");
+	if (language) {
+		BenchLex(text, *language);
+		BenchBackground(text, *language, SC_DOCUMENTOPTION_DEFAULT, "background styling");
+		BenchBackground(text, *language, SC_DOCUMENTOPTION_CHUNKED, "background styling chunked");
+		BenchPositionCache(corpus ? Varied(text) : text, *language);
+		BenchWrap(text, *language);
+	}
+	BenchConversion(text);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	size_t megabytes = 8;
+	int edits = 20000;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-mb") == 0) && (i + 1 < argc)) {
+			megabytes = std::max(1, atoi(argv[++i]));
+		} else if ((strcmp(argv[i], "-edits") == 0) && (i + 1 < argc)) {
+			edits = std::max(0, atoi(argv[++i]));
+		} else {
+			files.push_back(argv[i]);
+		}
+	}
+	Platform::ShowAssertionPopUps(false);
+	if (files.empty()) {
+		for (const Language &language : languages) {
+			BenchText(language.name, Corpus(language.sample, megabytes * 1000000), &language, edits, true);
+		}
+		for (const Script &script : scripts) {
+			const std::string text = Corpus(script.sample, megabytes * 1000000);
+			printf("%s: %.1f MB\n", script.name, text.length() / 1e6);
+			BenchConversion(text);
+		}
+		printf("style runs: %.1f MB\n", 0x1000000 / 1e6);
+		BenchStyleRuns(false, "style runs");
+		BenchStyleRuns(true, "style runs chunked");
+		printf("short text\n");
+		BenchASCIIRuns();
+		BenchUTF16Range();
+		BenchUTF16Positions(SC_DOCUMENTOPTION_DEFAULT, "UTF-16 positions");
+		BenchUTF16Positions(SC_DOCUMENTOPTION_CHUNKED, "UTF-16 positions chunked");
+		BenchBatchedRuns();
+		BenchRangePointer();
+		BenchUndoTrim();
+		const std::string text = Corpus(languages[0].sample, 100000000);
+		printf("replace all: %.1f MB\n", text.length() / 1e6);
+		BenchReplaceAll(text, "words", "wordCount");
+	}
+	for (const std::string &file : files) {
+		std::ifstream ifs(file, std::ios::binary);
+		if (!ifs) {
+			fprintf(stderr, "Can not open %s\n", file.c_str());
+			return 1;
+		}
+		const std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		BenchText(file, text, LanguageOfFile(file), edits, false);
+	}
+	return 0;
+}
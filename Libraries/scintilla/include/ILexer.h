@@ -12,7 +12,7 @@
 
 namespace Scintilla {
 
-enum { dvRelease4=2 };
+enum { dvRelease4=2, dvContiguousRange=3 };
 
 class IDocument {
 public:
@@ -42,6 +42,13 @@ public:
 	virtual int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const = 0;
 };
 
+// Implemented by documents whose Version is dvContiguousRange or later.
+// Returns the text around position that is held in one piece, from *start for *length bytes.
+class IDocumentContiguous : public IDocument {
+public:
+	virtual const char * SCI_METHOD ContiguousRange(Sci_Position position, Sci_Position *start, Sci_Position *length) const = 0;
+};
+
 enum { lvRelease4=2 };
 
 class ILexer4 {
@@ -1150,6 +1150,41 @@ typedef int(__stdcall* Sci_AnnotationDrawCallback)(void* cbParam, Sci_Annotation
 #define SCI_SETANNOTATIONDRAWCALLBACK 9504
 #define SCI_ISXINMARGIN 9506
 #define SCI_DRAGDROP 9507
+#define SCFIND_PCRE2 0x01000000 //with SCFIND_REGEXP: use PCRE2 (Perl syntax)
+#define SC_MOD_CHANGEFOLDLINES 0x1000000 //with SC_MOD_CHANGEFOLD: Sci_SetFoldLevels changed the fold levels of lines from line; length is the number of lines
+#define SC_DOCUMENTOPTION_CHUNKED 0x400 //SCI_CREATEDOCUMENT: hold text in chunks, for large documents edited in many places
+#define SCI_SETUNDOMEMORYLIMIT 9508 //wParam: max bytes of undo text, 0 unlimited (default); the oldest undo actions are deleted
+#define SCI_GETUNDOMEMORYLIMIT 9509
+#define SCI_SETBACKGROUNDSTYLING 9510 //wParam: bool; idle styling (SCI_SETIDLESTYLING) runs the lexer on another thread, for the document
+#define SCI_GETBACKGROUNDSTYLING 9511
+#define SCI_GETPOSITIONCACHESTATISTICS 9512 //lParam: Sci_CacheStatistics*; the position cache is shared by the views of the document and grows when too small
+#define SCI_SETLAYOUTCACHEBUDGET 9513 //wParam: max bytes of line layouts with SC_CACHE_DOCUMENT, 0 unlimited (default); the least recently used are dropped
+#define SCI_GETLAYOUTCACHEBUDGET 9514
+#define SCI_GETLAYOUTCACHESTATISTICS 9515 //lParam: Sci_CacheStatistics*; size and used are line layouts held and those with positions
+#define SCI_SETBACKGROUNDWRAPPING 9516 //wParam: bool; idle wrapping lays out lines on another thread, for the view; lines near the caret and on screen are wrapped first
+#define SCI_GETBACKGROUNDWRAPPING 9517
+#define SCI_MARGINSTYLEPREVIOUS 9518 //wParam: line, lParam: style; the last line up to wParam with the text margin style, or -1
+#define SCI_MARGINSTYLELINES 9519 //wParam: style, lParam: int* receiving the lines with the text margin style, or null; returns their count
+#define SCI_SETBATCHMODIFIED 9520 //wParam: bool; SCN_MODIFIED of a user action, undo group or undo/redo are sent as one SCN_MODIFIEDBATCH when it ends, except SC_MOD_INSERTCHECK
+#define SCI_GETBATCHMODIFIED 9521
+#define SCN_MODIFIEDBATCH 2900 //lParam: Sci_ModificationRecord*, length: their count, in the order of the modifications; modificationType: their types combined
+#define SCI_INDICATORFILLRANGES 9522 //wParam: count, lParam: Sci_IndicatorRange*; fills the ranges with the current indicator and value in one pass, fastest when sorted by position; one SCN_MODIFIED
+#define SCI_INDICATORCLEARRANGES 9523 //wParam: count, lParam: Sci_IndicatorRange*; clears the current indicator in the ranges
+struct Sci_CacheStatistics
+{
+	int size, used; //entries
+	long long bytes;
+	long long lookups, hits, evictions;
+};
+struct Sci_ModificationRecord
+{
+	int modificationType;
+	Sci_Position position, length, linesAdded, line;
+};
+struct Sci_IndicatorRange
+{
+	Sci_Position position, length;
+};
 struct Sci_DragDropData
 {
 	int x, y;
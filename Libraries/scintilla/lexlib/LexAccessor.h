@@ -15,25 +15,46 @@ enum EncodingType { enc8bit, encUnicode, encDBCS };
 class LexAccessor {
 private:
 	IDocument *pAccess;
+	IDocumentContiguous *pAccessContiguous;
 	enum {extremePosition=0x7FFFFFFF};
 	/** @a bufferSize is a trade off between time taken to copy the characters
 	 * and retrieval overhead.
 	 * @a slopSize positions the buffer before the desired position
-	 * in case there is some backtracking. */
-	enum {bufferSize=4000, slopSize=bufferSize/8};
+	 * in case there is some backtracking.
+	 * @a styleBufferSize is larger as each batch of styles may notify the document's watchers. */
+	enum {bufferSize=4000, slopSize=bufferSize/8, styleBufferSize=0x4000};
 	char buf[bufferSize+1];
+	/** Characters from startPos to endPos: buf or, when the document has them in one piece,
+	 * the document's own text which is read in place. */
+	const char *text;
 	Sci_Position startPos;
 	Sci_Position endPos;
 	int codePage;
 	enum EncodingType encodingType;
 	Sci_Position lenDoc;
-	char styleBuf[bufferSize];
+	char styleBuf[styleBufferSize];
 	Sci_Position validLen;
 	Sci_PositionU startSeg;
 	Sci_Position startPosStyling;
 	int documentVersion;
 
 	void Fill(Sci_Position position) {
+		if (pAccessContiguous) {
+			Sci_Position start = 0;
+			Sci_Position length = 0;
+			const char *range = pAccessContiguous->ContiguousRange(position, &start, &length);
+			// Near the end of a piece, copying avoids going back and forth between pieces
+			const Sci_Position startSlop = (position > slopSize) ? position - slopSize : 0;
+			const Sci_Position endSlop = (position + slopSize < lenDoc) ? position + slopSize : lenDoc;
+			if (range && (start <= startSlop) && (start + length >= endSlop)) {
+				text = range;
+				startPos = start;
+				endPos = start + length;
+				return;
+			}
+		}
+
+		text = buf;
 		startPos = position - slopSize;
 		if (startPos + bufferSize > lenDoc)
 			startPos = lenDoc - bufferSize;
@@ -47,9 +68,19 @@ private:
 		buf[endPos-startPos] = '\0';
 	}
 
+	/** The document's text may move when its watchers are told of a change, so is found again after. */
+	void ReleaseText() {
+		if (text != buf) {
+			startPos = extremePosition;
+			endPos = 0;
+		}
+	}
+
 public:
 	explicit LexAccessor(IDocument *pAccess_) :
-		pAccess(pAccess_), startPos(extremePosition), endPos(0),
+		pAccess(pAccess_),
+		pAccessContiguous((pAccess_->Version() >= dvContiguousRange) ? static_cast<IDocumentContiguous *>(pAccess_) : nullptr),
+		text(buf), startPos(extremePosition), endPos(0),
 		codePage(pAccess->CodePage()),
 		encodingType(enc8bit),
 		lenDoc(pAccess->Length()),
@@ -75,7 +106,7 @@ public:
 		if (position < startPos || position >= endPos) {
 			Fill(position);
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	IDocument *MultiByteAccess() const {
 		return pAccess;
@@ -89,7 +120,7 @@ public:
 				return chDefault;
 			}
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	bool IsLeadByte(char ch) const {
 		return pAccess->IsDBCSLeadByte(ch);
@@ -128,13 +159,16 @@ public:
 			pAccess->SetStyles(validLen, styleBuf);
 			startPosStyling += validLen;
 			validLen = 0;
+			ReleaseText();
 		}
 	}
 	int GetLineState(Sci_Position line) const {
 		return pAccess->GetLineState(line);
 	}
 	int SetLineState(Sci_Position line, int state) {
-		return pAccess->SetLineState(line, state);
+		const int statePrevious = pAccess->SetLineState(line, state);
+		ReleaseText();
+		return statePrevious;
 	}
 	// Style setting
 	void StartAt(Sci_PositionU start) {
@@ -155,12 +189,13 @@ public:
 				return;
 			}
 
-			if (validLen + (pos - startSeg + 1) >= bufferSize)
+			if (validLen + (pos - startSeg + 1) >= styleBufferSize)
 				Flush();
 			const char attr = static_cast<char>(chAttr);
-			if (validLen + (pos - startSeg + 1) >= bufferSize) {
+			if (validLen + (pos - startSeg + 1) >= styleBufferSize) {
 				// Too big for buffer so send directly
 				pAccess->SetStyleFor(pos - startSeg + 1, attr);
+				ReleaseText();
 			} else {
 				for (Sci_PositionU i = startSeg; i <= pos; i++) {
 					assert((startPosStyling + validLen) < Length());
@@ -172,14 +207,17 @@ public:
 	}
 	void SetLevel(Sci_Position line, int level) {
 		pAccess->SetLevel(line, level);
+		ReleaseText();
 	}
 	void IndicatorFill(Sci_Position start, Sci_Position end, int indicator, int value) {
 		pAccess->DecorationSetCurrentIndicator(indicator);
 		pAccess->DecorationFillRange(start, value, end - start);
+		ReleaseText();
 	}
 
 	void ChangeLexerState(Sci_Position start, Sci_Position end) {
 		pAccess->ChangeLexerState(start, end);
+		ReleaseText();
 	}
 };
 
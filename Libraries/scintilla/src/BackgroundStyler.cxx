@@ -0,0 +1,611 @@
+// Scintilla source code edit control
+/** @file BackgroundStyler.cxx
+ ** Styles a snapshot of a document on another thread.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstring>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <system_error>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "ChunkedVector.h"
+#include "UniConversion.h"
+#include "DBCS.h"
+#include "LineScanner.h"
+#include "BackgroundStyler.h"
+
+using namespace Scintilla;
+
+namespace {
+
+// Text styled by the thread before it checks whether to stop and queues the changes
+constexpr Sci::Position pieceLength = 0x40000;
+
+constexpr Sci::Position NextTab(Sci::Position pos, Sci::Position tabSize) noexcept {
+	return ((pos / tabSize) + 1) * tabSize;
+}
+
+}
+
+DocumentSnapshot::DocumentSnapshot(std::unique_ptr<ChunkedVector<char>> text_, Sci::Position startText_,
+	const char *textFixed_, Sci::Position lengthText_,
+	std::unique_ptr<ChunkedVector<char>> styles, Sci::Position startStyles_, Sci::Position startStyling,
+	Sci::Position startLines_, Sci::Position endLines_, Sci::Line lineFirst_,
+	std::vector<int> &&lineStates_, std::vector<int> &&levels_,
+	int codePage_, bool utf8LineEnds_, int tabInChars_) :
+	text(std::move(text_)), startText(startText_), textFixed(textFixed_), lengthText(lengthText_),
+	stylesBefore(std::move(styles)), startStyles(startStyles_), startWritten(startStyling),
+	startLines(startLines_), endLines(endLines_), lineFirst(lineFirst_),
+	lineStates(std::move(lineStates_)), levels(std::move(levels_)),
+	codePage(codePage_), utf8LineEnds(utf8LineEnds_), tabInChars(tabInChars_),
+	endStyled(startStyling), startPiece(startStyling), indicator(0), missed(false),
+	chunkStart(0), chunkEnd(0), chunkData(nullptr) {
+}
+
+DocumentSnapshot::~DocumentSnapshot() {
+}
+
+unsigned char DocumentSnapshot::UCharAt(Sci::Position position) const noexcept {
+	if ((position < 0) || (position >= lengthText))
+		return 0;
+	if (textFixed)
+		return textFixed[position];
+	if ((position < startText) || (position >= EndText())) {
+		missed = true;
+		return 0;
+	}
+	if ((position < chunkStart) || (position >= chunkEnd)) {
+		Sci::Position lengthChunk = 0;
+		chunkData = text->ContiguousRange(position - startText, chunkStart, lengthChunk);
+		chunkStart += startText;
+		chunkEnd = chunkStart + lengthChunk;
+	}
+	return chunkData[position - chunkStart];
+}
+
+Sci::Position DocumentSnapshot::EndText() const noexcept {
+	return textFixed ? lengthText : startText + text->Length();
+}
+
+Sci::Line DocumentSnapshot::Lines() const noexcept {
+	return lineFirst + static_cast<Sci::Line>(lineStarts.size());
+}
+
+// Lines before those copied, or after them when they do not reach the end, are in the document but not here.
+bool DocumentSnapshot::LineMissing(Sci::Line line) const noexcept {
+	if ((line >= 0) && ((line < lineFirst) ||
+		((line >= lineFirst + static_cast<Sci::Line>(levels.size())) && (endLines < lengthText)))) {
+		missed = true;
+		return true;
+	}
+	return false;
+}
+
+// Makes the styles set by the lexer cover [position, end) and returns them from position.
+char *DocumentSnapshot::Written(Sci::Position position, Sci::Position end) {
+	if (position < startWritten) {
+		// The lexer went back before where it started
+		std::string before(startWritten - position, '\0');
+		const Sci::Position startKnown = std::max(position, startStyles);
+		if (startKnown > position)
+			missed = true;
+		stylesBefore->GetRange(&before[startKnown - position], startKnown - startStyles, startWritten - startKnown);
+		written.insert(0, before);
+		startWritten = position;
+	}
+	if (end - startWritten > static_cast<Sci::Position>(written.length()))
+		written.resize(end - startWritten);
+	startPiece = std::min(startPiece, position);
+	return &written[position - startWritten];
+}
+
+void DocumentSnapshot::FindLines() {
+	lineStarts.clear();
+	lineStarts.push_back(startLines);
+	unsigned char chBeforePrev = 0;
+	unsigned char chPrev = 0;
+	Sci::Position position = startLines;
+	while (position < endLines) {
+		const char *block = textFixed + position;
+		Sci::Position lengthBlock = endLines - position;
+		if (!textFixed) {
+			Sci::Position startChunk = 0;
+			Sci::Position lengthChunk = 0;
+			block = text->ContiguousRange(position - startText, startChunk, lengthChunk) + (position - startText - startChunk);
+			lengthBlock = std::min(lengthBlock, lengthChunk - (position - startText - startChunk));
+		}
+		const size_t found = lineStarts.size();
+		FindLineStarts(block, lengthBlock, chBeforePrev, chPrev, utf8LineEnds, lineStarts);
+		for (size_t i = found; i < lineStarts.size(); i++) {
+			lineStarts[i] += position;
+		}
+		position += lengthBlock;
+		chBeforePrev = (lengthBlock >= 2) ? block[lengthBlock - 2] : chPrev;
+		chPrev = block[lengthBlock - 1];
+		// A CR ending the block and an LF starting the next are one line end
+		if ((chPrev == '\r') && (position < endLines) && (UCharAt(position) == '\n') && (lineStarts.back() == position))
+			lineStarts.back()++;
+	}
+}
+
+Sci::Position DocumentSnapshot::EndStyled() const noexcept {
+	return endStyled;
+}
+
+bool DocumentSnapshot::Missed() const noexcept {
+	return missed;
+}
+
+StyledPiece DocumentSnapshot::TakePiece(Sci::Position start) {
+	StyledPiece taken = std::move(piece);
+	piece = StyledPiece();
+	taken.start = start;
+	taken.startStyles = std::min(start, startPiece);
+	const Sci::Position end = std::min(endStyled, startWritten + static_cast<Sci::Position>(written.length()));
+	if (end > taken.startStyles) {
+		taken.styles.assign(written, taken.startStyles - startWritten, end - taken.startStyles);
+	}
+	startPiece = endStyled;
+	return taken;
+}
+
+int SCI_METHOD DocumentSnapshot::Version() const {
+	return dvContiguousRange;
+}
+
+void SCI_METHOD DocumentSnapshot::SetErrorStatus(int status) {
+	piece.errorStatus = status;
+}
+
+Sci_Position SCI_METHOD DocumentSnapshot::Length() const {
+	return lengthText;
+}
+
+void SCI_METHOD DocumentSnapshot::GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+	if ((lengthRetrieve <= 0) || (position < 0) || ((position + lengthRetrieve) > lengthText))
+		return;
+	if (textFixed) {
+		memcpy(buffer, textFixed + position, lengthRetrieve);
+		return;
+	}
+	const Sci::Position startKnown = std::max(position, startText);
+	const Sci::Position endKnown = std::min(position + lengthRetrieve, EndText());
+	if ((startKnown > position) || (endKnown < position + lengthRetrieve)) {
+		missed = true;
+		memset(buffer, 0, lengthRetrieve);
+	}
+	if (endKnown > startKnown)
+		text->GetRange(buffer + (startKnown - position), startKnown - startText, endKnown - startKnown);
+}
+
+// Styles after where styling started are 0 until the lexer sets them.
+char SCI_METHOD DocumentSnapshot::StyleAt(Sci_Position position) const {
+	if (position >= startWritten) {
+		const Sci::Position index = position - startWritten;
+		return (index < static_cast<Sci::Position>(written.length())) ? written[index] : 0;
+	}
+	if (position < startStyles) {
+		if (position >= 0)
+			missed = true;
+		return 0;
+	}
+	return stylesBefore->ValueAt(position - startStyles);
+}
+
+Sci_Position SCI_METHOD DocumentSnapshot::LineFromPosition(Sci_Position position) const {
+	if (position < 0)
+		return 0;
+	if ((position < startLines) || ((position > endLines) && (endLines < lengthText)))
+		missed = true;
+	const Sci::Line line = std::upper_bound(lineStarts.begin(), lineStarts.end(), position) - lineStarts.begin() - 1;
+	return lineFirst + std::max<Sci::Line>(line, 0);
+}
+
+Sci_Position SCI_METHOD DocumentSnapshot::LineStart(Sci_Position line) const {
+	if (line < 0)
+		return 0;
+	else if (LineMissing(line))
+		return (line < lineFirst) ? startLines : endLines;
+	else if (line >= Lines())
+		return lengthText;
+	else
+		return lineStarts[line - lineFirst];
+}
+
+int SCI_METHOD DocumentSnapshot::GetLevel(Sci_Position line) const {
+	const Sci::Line index = line - lineFirst;
+	if (!LineMissing(line) && (index >= 0) && (index < static_cast<Sci::Line>(levels.size())))
+		return levels[index];
+	return SC_FOLDLEVELBASE;
+}
+
+int SCI_METHOD DocumentSnapshot::SetLevel(Sci_Position line, int level) {
+	int prev = 0;
+	const Sci::Line index = line - lineFirst;
+	if (!LineMissing(line) && (index >= 0) && (index < static_cast<Sci::Line>(levels.size()))) {
+		prev = levels[index];
+		levels[index] = level;
+		piece.levels.push_back({ static_cast<Sci::Line>(line), level });
+	}
+	return prev;
+}
+
+int SCI_METHOD DocumentSnapshot::GetLineState(Sci_Position line) const {
+	const Sci::Line index = line - lineFirst;
+	if (!LineMissing(line) && (index >= 0) && (index < static_cast<Sci::Line>(lineStates.size())))
+		return lineStates[index];
+	return 0;
+}
+
+int SCI_METHOD DocumentSnapshot::SetLineState(Sci_Position line, int state) {
+	if ((line < 0) || LineMissing(line))
+		return 0;
+	const Sci::Line index = line - lineFirst;
+	if (index >= static_cast<Sci::Line>(lineStates.size()))
+		lineStates.resize(index + 1);
+	const int statePrevious = lineStates[index];
+	lineStates[index] = state;
+	piece.lineStates.push_back({ static_cast<Sci::Line>(line), state });
+	return statePrevious;
+}
+
+void SCI_METHOD DocumentSnapshot::StartStyling(Sci_Position position) {
+	endStyled = position;
+}
+
+bool SCI_METHOD DocumentSnapshot::SetStyleFor(Sci_Position length, char style) {
+	const Sci::Position end = std::min(endStyled + length, lengthText);
+	if (end > endStyled) {
+		char *styles = Written(endStyled, end);
+		std::fill(styles, styles + (end - endStyled), style);
+	}
+	endStyled += length;
+	return true;
+}
+
+bool SCI_METHOD DocumentSnapshot::SetStyles(Sci_Position length, const char *styles) {
+	const Sci::Position end = std::min(endStyled + length, lengthText);
+	if (end > endStyled) {
+		memcpy(Written(endStyled, end), styles, end - endStyled);
+	}
+	endStyled += length;
+	return true;
+}
+
+void SCI_METHOD DocumentSnapshot::DecorationSetCurrentIndicator(int indicator_) {
+	indicator = indicator_;
+}
+
+void SCI_METHOD DocumentSnapshot::DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) {
+	piece.decorations.push_back({ indicator, position, value, fillLength });
+}
+
+void SCI_METHOD DocumentSnapshot::ChangeLexerState(Sci_Position start, Sci_Position end) {
+	piece.lexerStates.push_back({ start, end });
+}
+
+int SCI_METHOD DocumentSnapshot::CodePage() const {
+	return codePage;
+}
+
+bool SCI_METHOD DocumentSnapshot::IsDBCSLeadByte(char ch) const {
+	return DBCSIsLeadByte(codePage, ch);
+}
+
+// Only available when all of the text is here.
+const char *SCI_METHOD DocumentSnapshot::BufferPointer() {
+	if (textFixed)
+		return textFixed;
+	if ((startText > 0) || (EndText() < lengthText)) {
+		missed = true;
+		return nullptr;
+	}
+	chunkEnd = chunkStart;
+	return text->BufferPointer();
+}
+
+int SCI_METHOD DocumentSnapshot::GetLineIndentation(Sci_Position line) {
+	int indent = 0;
+	if ((line >= 0) && !LineMissing(line) && (line < Lines())) {
+		for (Sci::Position i = LineStart(line); i < lengthText; i++) {
+			const unsigned char ch = UCharAt(i);
+			if (ch == ' ')
+				indent++;
+			else if (ch == '\t')
+				indent = static_cast<int>(NextTab(indent, tabInChars));
+			else
+				return indent;
+		}
+	}
+	return indent;
+}
+
+// As Document::LineEnd
+Sci_Position SCI_METHOD DocumentSnapshot::LineEnd(Sci_Position line) const {
+	if (line >= Lines() - 1)
+		return LineStart(line + 1);
+	Sci::Position position = LineStart(line + 1);
+	if (SC_CP_UTF8 == codePage) {
+		const unsigned char bytes[] = {
+			UCharAt(position - 3),
+			UCharAt(position - 2),
+			UCharAt(position - 1),
+		};
+		if (UTF8IsSeparator(bytes))
+			return position - UTF8SeparatorLength;
+		if (UTF8IsNEL(bytes + 1))
+			return position - UTF8NELLength;
+	}
+	position--; // Back over CR or LF
+	// When line terminator is CR+LF, may need to go back one more
+	if ((position > LineStart(line)) && (UCharAt(position - 1) == '\r'))
+		position--;
+	return position;
+}
+
+// As Document::InGoodUTF8 where only start is needed
+bool DocumentSnapshot::InGoodUTF8(Sci::Position pos, Sci::Position &start) const noexcept {
+	Sci::Position trail = pos;
+	while ((trail > 0) && (pos - trail < UTF8MaxBytes) && UTF8IsTrailByte(UCharAt(trail - 1)))
+		trail--;
+	start = (trail > 0) ? trail - 1 : trail;
+	const unsigned char leadByte = UCharAt(start);
+	const int widthCharBytes = UTF8BytesOfLead[leadByte];
+	if ((widthCharBytes == 1) || (pos - start > widthCharBytes - 1))
+		return false;
+	unsigned char charBytes[UTF8MaxBytes] = { leadByte, 0, 0, 0 };
+	for (Sci::Position b = 1; b < widthCharBytes && ((start + b) < lengthText); b++)
+		charBytes[b] = UCharAt(start + b);
+	return (UTF8Classify(charBytes, widthCharBytes) & UTF8MaskInvalid) == 0;
+}
+
+// As Document::NextPosition
+Sci::Position DocumentSnapshot::NextPosition(Sci::Position pos, int moveDir) const noexcept {
+	const int increment = (moveDir > 0) ? 1 : -1;
+	if (pos + increment <= 0)
+		return 0;
+	if (pos + increment >= lengthText)
+		return lengthText;
+	if (!codePage)
+		return pos + increment;
+	if (SC_CP_UTF8 == codePage) {
+		if (increment == 1) {
+			const unsigned char leadByte = UCharAt(pos);
+			if (UTF8IsAscii(leadByte))
+				return pos + 1;
+			const int widthCharBytes = UTF8BytesOfLead[leadByte];
+			unsigned char charBytes[UTF8MaxBytes] = { leadByte, 0, 0, 0 };
+			for (int b = 1; b < widthCharBytes; b++)
+				charBytes[b] = UCharAt(pos + b);
+			const int utf8status = UTF8Classify(charBytes, widthCharBytes);
+			return pos + ((utf8status & UTF8MaskInvalid) ? 1 : (utf8status & UTF8MaskWidth));
+		}
+		pos--;
+		Sci::Position startUTF = pos;
+		if (UTF8IsTrailByte(UCharAt(pos)) && InGoodUTF8(pos, startUTF))
+			pos = startUTF;
+		return pos;
+	}
+	if (moveDir > 0)
+		return std::min(pos + (IsDBCSLeadByte(UCharAt(pos)) ? 2 : 1), lengthText);
+	// Anchor DBCS calculations at start of line because start of line can not be a DBCS trail byte.
+	const Sci::Position posStartLine = LineStart(LineFromPosition(pos));
+	if ((pos - 1) <= posStartLine)
+		return pos - 1;
+	if (IsDBCSLeadByte(UCharAt(pos - 1)))
+		return pos - 2;
+	Sci::Position posTemp = pos - 1;
+	while (posStartLine <= --posTemp && IsDBCSLeadByte(UCharAt(posTemp)))
+		;
+	return (pos - 1 - ((pos - posTemp) & 1));
+}
+
+Sci_Position SCI_METHOD DocumentSnapshot::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const {
+	Sci::Position pos = positionStart;
+	if (codePage) {
+		const int increment = (characterOffset > 0) ? 1 : -1;
+		while (characterOffset != 0) {
+			const Sci::Position posNext = NextPosition(pos, increment);
+			if (posNext == pos)
+				return INVALID_POSITION;
+			pos = posNext;
+			characterOffset -= increment;
+		}
+	} else {
+		pos = positionStart + characterOffset;
+		if ((pos < 0) || (pos > lengthText))
+			return INVALID_POSITION;
+	}
+	return pos;
+}
+
+// As Document::GetCharacterAndWidth
+int SCI_METHOD DocumentSnapshot::GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const {
+	int character;
+	int bytesInCharacter = 1;
+	const unsigned char leadByte = UCharAt(position);
+	if (SC_CP_UTF8 == codePage) {
+		if (UTF8IsAscii(leadByte)) {
+			character = leadByte;
+		} else {
+			const int widthCharBytes = UTF8BytesOfLead[leadByte];
+			unsigned char charBytes[UTF8MaxBytes] = { leadByte, 0, 0, 0 };
+			for (int b = 1; b < widthCharBytes; b++)
+				charBytes[b] = UCharAt(position + b);
+			const int utf8status = UTF8Classify(charBytes, widthCharBytes);
+			if (utf8status & UTF8MaskInvalid) {
+				// Report as singleton surrogate values which are invalid Unicode
+				character = 0xDC80 + leadByte;
+			} else {
+				bytesInCharacter = utf8status & UTF8MaskWidth;
+				character = UnicodeFromUTF8(charBytes);
+			}
+		}
+	} else if (codePage && IsDBCSLeadByte(leadByte)) {
+		bytesInCharacter = 2;
+		character = (leadByte << 8) | UCharAt(position + 1);
+	} else {
+		character = leadByte;
+	}
+	if (pWidth)
+		*pWidth = bytesInCharacter;
+	return character;
+}
+
+const char *SCI_METHOD DocumentSnapshot::ContiguousRange(Sci_Position position, Sci_Position *start, Sci_Position *length) const {
+	if (!textFixed) {
+		if ((position >= 0) && (position < lengthText) && ((position < startText) || (position >= EndText())))
+			missed = true;
+		ptrdiff_t startRange = 0;
+		ptrdiff_t lengthRange = 0;
+		const char *range = text->ContiguousRange(position - startText, startRange, lengthRange);
+		*start = startText + startRange;
+		*length = lengthRange;
+		return range;
+	}
+	if ((position < 0) || (position >= lengthText)) {
+		*start = position;
+		*length = 0;
+		return nullptr;
+	}
+	*start = 0;
+	*length = lengthText;
+	return textFixed;
+}
+
+BackgroundStyler::BackgroundStyler() noexcept :
+	lexer(nullptr), startRun(0), endRun(0), version(0), versionRun(0), finished(true), missed(false) {
+}
+
+BackgroundStyler::~BackgroundStyler() {
+	Stop();
+}
+
+void BackgroundStyler::Work() noexcept {
+	try {
+		snapshot->FindLines();
+		Sci::Position position = startRun;
+		while ((position < endRun) && (version.load() == versionRun)) {
+			const Sci::Position start = snapshot->LineStart(snapshot->LineFromPosition(position));
+			const Sci::Position end = std::min(endRun,
+				snapshot->LineStart(snapshot->LineFromPosition(std::min(start + pieceLength, endRun)) + 1));
+			// As LexInterface::Colourise
+			int styleStart = 0;
+			if (start > 0)
+				styleStart = snapshot->StyleAt(start - 1);
+			lexer->Lex(start, end - start, styleStart, snapshot.get());
+			lexer->Fold(start, end - start, styleStart, snapshot.get());
+			if (snapshot->Missed()) {
+				// What the lexer found may depend on what it could not read
+				std::lock_guard<std::mutex> guard(mutex);
+				missed = true;
+				break;
+			}
+			StyledPiece piece = snapshot->TakePiece(start);
+			piece.version = versionRun;
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				pieces.push_back(std::move(piece));
+			}
+			pieceReady.notify_one();
+			if (snapshot->EndStyled() <= start)
+				break;	// The lexer styled nothing
+			position = snapshot->EndStyled();
+		}
+	} catch (...) {
+		// Such as running out of memory: the document styles the rest on its own thread
+	}
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		finished = true;
+	}
+	pieceReady.notify_one();
+}
+
+bool BackgroundStyler::Start(ILexer4 *lexer_, std::unique_ptr<DocumentSnapshot> snapshot_, Sci::Position start, Sci::Position end) {
+	Stop();
+	lexer = lexer_;
+	snapshot = std::move(snapshot_);
+	startRun = start;
+	endRun = end;
+	versionRun = version.load();
+	finished = false;
+	try {
+		worker = std::thread(&BackgroundStyler::Work, this);
+	} catch (const std::system_error &) {
+		finished = true;
+		snapshot.reset();
+		return false;
+	}
+	return true;
+}
+
+bool BackgroundStyler::Styling() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return !finished && (version.load() == versionRun);
+}
+
+bool BackgroundStyler::Missed() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return missed;
+}
+
+bool BackgroundStyler::Current(const StyledPiece &piece) const noexcept {
+	return piece.version == version.load();
+}
+
+void BackgroundStyler::Invalidate(Sci::Position position) noexcept {
+	// Changes after the snapshot do not change the text styled, as when the document is styled up to its end
+	if (snapshot && (position <= snapshot->Length()))
+		version++;
+}
+
+void BackgroundStyler::Stop() noexcept {
+	version++;
+	if (worker.joinable()) {
+		try {
+			worker.join();
+		} catch (const std::system_error &) {
+			// Not joinable after all
+		}
+	}
+	snapshot.reset();
+	pieces.clear();
+	finished = true;
+}
+
+std::vector<StyledPiece> BackgroundStyler::TakePieces(int millisecondsWait) {
+	std::vector<StyledPiece> taken;
+	std::unique_lock<std::mutex> lock(mutex);
+	if (pieces.empty() && !finished && (millisecondsWait > 0)) {
+		pieceReady.wait_for(lock, std::chrono::milliseconds(millisecondsWait), [this]() noexcept {
+			return !pieces.empty() || finished;
+		});
+	}
+	for (StyledPiece &piece : pieces) {
+		if (Current(piece))
+			taken.push_back(std::move(piece));
+	}
+	pieces.clear();
+	return taken;
+}
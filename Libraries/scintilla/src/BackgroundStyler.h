@@ -0,0 +1,193 @@
+// Scintilla source code edit control
+/** @file BackgroundStyler.h
+ ** Styles a snapshot of a document on another thread.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef BACKGROUNDSTYLER_H
+#define BACKGROUNDSTYLER_H
+
+namespace Scintilla {
+
+/**
+ * The changes a lexer made when styling a snapshot from start: styles from startStyles, which is before
+ * start if the lexer went back, and line states, fold levels, indicators and lexer state changes
+ * in the order they were made.
+ * Merged into the document while the text styled is unchanged, as shown by version.
+ */
+struct StyledPiece {
+	struct LineValue {
+		Sci::Line line;
+		int value;
+	};
+	struct DecorationFill {
+		int indicator;
+		Sci::Position position;
+		int value;
+		Sci::Position fillLength;
+	};
+	struct Range {
+		Sci::Position start;
+		Sci::Position end;
+	};
+	int version = 0;
+	Sci::Position start = 0;
+	Sci::Position startStyles = 0;
+	std::string styles;
+	std::vector<LineValue> lineStates;
+	std::vector<LineValue> levels;
+	std::vector<DecorationFill> decorations;
+	std::vector<Range> lexerStates;
+	int errorStatus = 0;
+};
+
+/**
+ * The text, styles, line states and fold levels of a document at one time, read by a lexer on another thread.
+ * Only the lines around the text to be styled are copied: from startLines, a line start, to endLines, which is
+ * the end of the document or a line start.
+ * Chunked text is shared with the document and mapped text never changes so both are read in full,
+ * other text is copied for those lines.
+ * Styles are copied up to the position styling starts from and read as 0 after it until set.
+ * Reading a part of the document that was not copied marks the snapshot as missed, when what the lexer
+ * found can not be used.
+ * What the lexer sets is kept here and handed out as StyledPieces.
+ */
+class DocumentSnapshot : public IDocumentContiguous {
+	std::unique_ptr<ChunkedVector<char>> text;
+	Sci::Position startText;	// Position of the first byte of text
+	const char *textFixed;
+	Sci::Position lengthText;
+	std::unique_ptr<ChunkedVector<char>> stylesBefore;
+	Sci::Position startStyles;	// Position of the first style of stylesBefore
+	Sci::Position startWritten;
+	std::string written;	// Styles set by the lexer, from startWritten
+	Sci::Position startLines;
+	Sci::Position endLines;
+	Sci::Line lineFirst;	// The line starting at startLines
+	std::vector<Sci::Position> lineStarts;	// From lineFirst
+	std::vector<int> lineStates;	// From lineFirst
+	std::vector<int> levels;	// From lineFirst, one for each line copied
+	int codePage;
+	bool utf8LineEnds;
+	int tabInChars;
+	Sci::Position endStyled;
+	Sci::Position startPiece;	// First position styled since the last piece
+	int indicator;
+	StyledPiece piece;
+	mutable bool missed;
+	// The chunk of text last read, as the lexer mostly reads in order. Only the styling thread reads the text.
+	mutable Sci::Position chunkStart;
+	mutable Sci::Position chunkEnd;
+	mutable const char *chunkData;
+
+	unsigned char UCharAt(Sci::Position position) const noexcept;
+	Sci::Position EndText() const noexcept;
+	Sci::Line Lines() const noexcept;
+	bool LineMissing(Sci::Line line) const noexcept;
+	char *Written(Sci::Position position, Sci::Position end);
+	bool InGoodUTF8(Sci::Position pos, Sci::Position &start) const noexcept;
+	Sci::Position NextPosition(Sci::Position pos, int moveDir) const noexcept;
+public:
+	/// text holds the bytes from startText or, when it is null, textFixed holds all lengthText bytes.
+	/// styles holds the styles from startStyles_ to startStyling.
+	/// lineStates_ and levels_ are for the lines from startLines_ to endLines_.
+	DocumentSnapshot(std::unique_ptr<ChunkedVector<char>> text_, Sci::Position startText_,
+		const char *textFixed_, Sci::Position lengthText_,
+		std::unique_ptr<ChunkedVector<char>> styles, Sci::Position startStyles_, Sci::Position startStyling,
+		Sci::Position startLines_, Sci::Position endLines_, Sci::Line lineFirst_,
+		std::vector<int> &&lineStates_, std::vector<int> &&levels_,
+		int codePage_, bool utf8LineEnds_, int tabInChars_);
+	// Deleted so DocumentSnapshot objects can not be copied.
+	DocumentSnapshot(const DocumentSnapshot &) = delete;
+	DocumentSnapshot(DocumentSnapshot &&) = delete;
+	DocumentSnapshot &operator=(const DocumentSnapshot &) = delete;
+	DocumentSnapshot &operator=(DocumentSnapshot &&) = delete;
+	virtual ~DocumentSnapshot();
+
+	/// Finds the line starts, which is left to the styling thread as it reads all of the text.
+	void FindLines();
+	Sci::Position EndStyled() const noexcept;
+	/// True once the lexer has read a part of the document that was not copied.
+	bool Missed() const noexcept;
+	/// Returns the changes made since the last piece, with the styles from start.
+	StyledPiece TakePiece(Sci::Position start);
+
+	int SCI_METHOD Version() const override;
+	void SCI_METHOD SetErrorStatus(int status) override;
+	Sci_Position SCI_METHOD Length() const override;
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const override;
+	char SCI_METHOD StyleAt(Sci_Position position) const override;
+	Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const override;
+	Sci_Position SCI_METHOD LineStart(Sci_Position line) const override;
+	int SCI_METHOD GetLevel(Sci_Position line) const override;
+	int SCI_METHOD SetLevel(Sci_Position line, int level) override;
+	int SCI_METHOD GetLineState(Sci_Position line) const override;
+	int SCI_METHOD SetLineState(Sci_Position line, int state) override;
+	void SCI_METHOD StartStyling(Sci_Position position) override;
+	bool SCI_METHOD SetStyleFor(Sci_Position length, char style) override;
+	bool SCI_METHOD SetStyles(Sci_Position length, const char *styles) override;
+	void SCI_METHOD DecorationSetCurrentIndicator(int indicator_) override;
+	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
+	void SCI_METHOD ChangeLexerState(Sci_Position start, Sci_Position end) override;
+	int SCI_METHOD CodePage() const override;
+	bool SCI_METHOD IsDBCSLeadByte(char ch) const override;
+	const char *SCI_METHOD BufferPointer() override;
+	int SCI_METHOD GetLineIndentation(Sci_Position line) override;
+	Sci_Position SCI_METHOD LineEnd(Sci_Position line) const override;
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const override;
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const override;
+	const char * SCI_METHOD ContiguousRange(Sci_Position position, Sci_Position *start, Sci_Position *length) const override;
+};
+
+/**
+ * Runs a lexer over a DocumentSnapshot on a thread, a piece of about pieceLength at a time,
+ * queuing the changes found for each piece.
+ * The version is advanced when the text of the snapshot changes in the document, so the thread
+ * stops after its current piece and the queued pieces are dropped.
+ * The lexer is used by the thread until it stops, so it must not be used or changed until Stop is called.
+ */
+class BackgroundStyler {
+	ILexer4 *lexer;
+	std::unique_ptr<DocumentSnapshot> snapshot;
+	Sci::Position startRun;
+	Sci::Position endRun;
+	std::atomic<int> version;
+	int versionRun;
+	std::mutex mutex;
+	std::condition_variable pieceReady;
+	std::vector<StyledPiece> pieces;
+	bool finished;
+	bool missed;
+	std::thread worker;
+
+	void Work() noexcept;
+public:
+	BackgroundStyler() noexcept;
+	// Deleted so BackgroundStyler objects can not be copied.
+	BackgroundStyler(const BackgroundStyler &) = delete;
+	BackgroundStyler(BackgroundStyler &&) = delete;
+	BackgroundStyler &operator=(const BackgroundStyler &) = delete;
+	BackgroundStyler &operator=(BackgroundStyler &&) = delete;
+	~BackgroundStyler();
+
+	/// Starts styling snapshot from start, a line start, to end with lexer.
+	/// Returns false if no thread could be started.
+	bool Start(ILexer4 *lexer_, std::unique_ptr<DocumentSnapshot> snapshot_, Sci::Position start, Sci::Position end);
+	/// True while a thread is styling text that has not changed.
+	bool Styling();
+	/// True once a lexer has read outside its snapshot: the piece it was styling was dropped
+	/// and later snapshots should copy all of the document.
+	bool Missed();
+	bool Current(const StyledPiece &piece) const noexcept;
+	/// Called when the document changes at position: the snapshot is out of date if it includes position.
+	void Invalidate(Sci::Position position) noexcept;
+	/// Waits for the thread to stop and drops the pieces not yet taken.
+	void Stop() noexcept;
+	/// Removes the queued pieces, returning those still valid.
+	/// When none are queued, waits up to millisecondsWait for the thread to queue one.
+	std::vector<StyledPiece> TakePieces(int millisecondsWait);
+};
+
+}
+
+#endif
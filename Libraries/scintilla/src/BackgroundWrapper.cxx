@@ -0,0 +1,247 @@
+// Scintilla source code edit control
+/** @file BackgroundWrapper.cxx
+ ** Wraps a copy of lines of a document on another thread.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <forward_list>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <system_error>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "CharacterCategory.h"
+#include "Position.h"
+#include "UniqueString.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "ContractionState.h"
+#include "CellBuffer.h"
+#include "KeyMap.h"
+#include "Indicator.h"
+#include "LineMarker.h"
+#include "Style.h"
+#include "ViewStyle.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "UniConversion.h"
+#include "Selection.h"
+#include "PositionCache.h"
+#include "EditModel.h"
+#include "MarginView.h"
+#include "EditView.h"
+#include "BackgroundWrapper.h"
+
+using namespace Scintilla;
+
+namespace {
+
+constexpr Sci::Line pieceLines = 0x400;
+
+/**
+ * A document holding the lines of a WrapSnapshot, set up as the document they were copied from.
+ */
+class WrapModel : public EditModel {
+public:
+	explicit WrapModel(const WrapSnapshot &snapshot) {
+		pdoc->SetDBCSCodePage(snapshot.codePage);
+		pdoc->tabInChars = snapshot.tabInChars;
+		pdoc->indentInChars = snapshot.indentInChars;
+		pdoc->actualIndentInChars = snapshot.actualIndentInChars;
+		for (int cc = CharClassify::ccSpace; cc <= CharClassify::ccPunctuation; cc++) {
+			pdoc->SetCharClasses(reinterpret_cast<const unsigned char *>(snapshot.charsOfClass[cc].c_str()),
+				static_cast<CharClassify::cc>(cc));
+		}
+		pdoc->SetUndoCollection(false);
+		pdoc->InsertString(0, snapshot.text.c_str(), snapshot.text.length());
+		pdoc->StartStyling(0);
+		pdoc->SetStyles(snapshot.styles.length(), snapshot.styles.c_str());
+		reprs = snapshot.reprs;
+	}
+	Sci::Line TopLineOfMain() const override {
+		return 0;
+	}
+	Point GetVisibleOriginInMain() const override {
+		return Point();
+	}
+	Sci::Line LinesOnScreen() const override {
+		return 1;
+	}
+	Range GetHotSpotRange() const noexcept override {
+		return Range(Sci::invalidPosition);
+	}
+};
+
+}
+
+WrapSnapshot::WrapSnapshot(const EditModel &model, const ViewStyle &vs_, int tabWidthMinimumPixels_,
+	Sci::Line lineStart_, Sci::Line lineEnd, int width_) :
+	lineStart(lineStart_),
+	lines(lineEnd - lineStart_),
+	codePage(model.pdoc->dbcsCodePage),
+	tabInChars(model.pdoc->tabInChars),
+	indentInChars(model.pdoc->indentInChars),
+	actualIndentInChars(model.pdoc->actualIndentInChars),
+	reprs(model.reprs),
+	vs(vs_),
+	tabWidthMinimumPixels(tabWidthMinimumPixels_),
+	bidiR2L(model.BidirectionalR2L()),
+	width(width_) {
+	const Sci::Position start = model.pdoc->LineStart(lineStart);
+	const Sci::Position length = model.pdoc->LineStart(lineEnd) - start;
+	text.resize(length);
+	model.pdoc->GetCharRange(text.data(), start, length);
+	styles.resize(length);
+	model.pdoc->GetStyleRange(reinterpret_cast<unsigned char *>(styles.data()), start, length);
+	for (int cc = CharClassify::ccSpace; cc <= CharClassify::ccPunctuation; cc++) {
+		unsigned char chars[256]{};
+		const int count = model.pdoc->GetCharsOfClass(static_cast<CharClassify::cc>(cc), chars);
+		// NUL is last when in the class and ends the string
+		charsOfClass[cc].assign(reinterpret_cast<const char *>(chars), count);
+	}
+}
+
+WrapSnapshot::~WrapSnapshot() {
+}
+
+BackgroundWrapper::BackgroundWrapper() noexcept :
+	wid(nullptr), lineEndRun(0), version(0), versionRun(0), finished(true) {
+}
+
+BackgroundWrapper::~BackgroundWrapper() {
+	Stop();
+}
+
+void BackgroundWrapper::Work() noexcept {
+	try {
+		surface->Init(wid);
+		surface->SetUnicodeMode(SC_CP_UTF8 == snapshot->codePage);
+		surface->SetDBCSMode(snapshot->codePage);
+		surface->SetBidiR2L(snapshot->bidiR2L);
+		// Fonts of the copied styles are made for this thread
+		snapshot->vs.Refresh(*surface, snapshot->tabInChars);
+		WrapModel model(*snapshot);
+		EditView view;
+		view.tabWidthMinimumPixels = snapshot->tabWidthMinimumPixels;
+		Sci::Position lengthLineMax = 0;
+		for (Sci::Line line = 0; line < snapshot->lines; line++) {
+			lengthLineMax = std::max(lengthLineMax, model.pdoc->LineStart(line + 1) - model.pdoc->LineStart(line));
+		}
+		// One layout, long enough for every line, as LayoutLine limits a line to the layout only when it is longer
+		LineLayout ll(static_cast<int>(lengthLineMax));
+		Sci::Line line = 0;
+		while ((line < snapshot->lines) && (version.load() == versionRun)) {
+			WrappedPiece piece;
+			piece.version = versionRun;
+			piece.lineStart = snapshot->lineStart + line;
+			const Sci::Line lineEndPiece = std::min(snapshot->lines, line + pieceLines);
+			for (; (line < lineEndPiece) && (version.load() == versionRun); line++) {
+				ll.validity = LineLayout::llInvalid;
+				view.LayoutLine(model, line, surface.get(), snapshot->vs, &ll, snapshot->width);
+				piece.lines.push_back(ll.lines);
+			}
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				pieces.push_back(std::move(piece));
+			}
+			pieceReady.notify_one();
+		}
+	} catch (...) {
+		// Such as running out of memory: the view wraps the rest on its own thread
+	}
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		finished = true;
+	}
+	pieceReady.notify_one();
+}
+
+bool BackgroundWrapper::Start(std::unique_ptr<WrapSnapshot> snapshot_, std::unique_ptr<Surface> surface_, WindowID wid_) {
+	Stop();
+	snapshot = std::move(snapshot_);
+	surface = std::move(surface_);
+	wid = wid_;
+	lineEndRun = snapshot->lineStart + snapshot->lines;
+	versionRun = version.load();
+	finished = false;
+	try {
+		worker = std::thread(&BackgroundWrapper::Work, this);
+	} catch (const std::system_error &) {
+		finished = true;
+		snapshot.reset();
+		surface.reset();
+		return false;
+	}
+	return true;
+}
+
+bool BackgroundWrapper::Wrapping() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return !finished && (version.load() == versionRun);
+}
+
+bool BackgroundWrapper::Current(const WrappedPiece &piece) const noexcept {
+	return piece.version == version.load();
+}
+
+void BackgroundWrapper::Invalidate(Sci::Line line) noexcept {
+	// Lines after the snapshot do not change how its lines wrap
+	if (line < lineEndRun)
+		version++;
+}
+
+void BackgroundWrapper::Stop() noexcept {
+	version++;
+	if (worker.joinable()) {
+		try {
+			worker.join();
+		} catch (const std::system_error &) {
+			// Not joinable after all
+		}
+	}
+	// The surface lets go of the fonts of the snapshot before they are released
+	surface.reset();
+	snapshot.reset();
+	lineEndRun = 0;
+	pieces.clear();
+	finished = true;
+}
+
+std::vector<WrappedPiece> BackgroundWrapper::TakePieces(int millisecondsWait) {
+	std::vector<WrappedPiece> taken;
+	std::unique_lock<std::mutex> lock(mutex);
+	if (pieces.empty() && !finished && (millisecondsWait > 0)) {
+		pieceReady.wait_for(lock, std::chrono::milliseconds(millisecondsWait), [this]() noexcept {
+			return !pieces.empty() || finished;
+		});
+	}
+	for (WrappedPiece &piece : pieces) {
+		if (Current(piece))
+			taken.push_back(std::move(piece));
+	}
+	pieces.clear();
+	return taken;
+}
@@ -0,0 +1,95 @@
+// Scintilla source code edit control
+/** @file BackgroundWrapper.h
+ ** Wraps a copy of lines of a document on another thread.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef BACKGROUNDWRAPPER_H
+#define BACKGROUNDWRAPPER_H
+
+namespace Scintilla {
+
+/**
+ * Lines of a document with their styles and the settings of a view that decide how they wrap,
+ * copied so they can be laid out on another thread just as EditView::LayoutLine lays them out for the view.
+ */
+struct WrapSnapshot {
+	Sci::Line lineStart;
+	Sci::Line lines;
+	std::string text;	// The lines with their line ends
+	std::string styles;
+	int codePage;
+	int tabInChars;
+	int indentInChars;
+	int actualIndentInChars;
+	std::string charsOfClass[CharClassify::ccPunctuation + 1];
+	SpecialRepresentations reprs;
+	ViewStyle vs;
+	int tabWidthMinimumPixels;
+	bool bidiR2L;
+	int width;
+
+	WrapSnapshot(const EditModel &model, const ViewStyle &vs_, int tabWidthMinimumPixels_,
+		Sci::Line lineStart_, Sci::Line lineEnd, int width_);
+	// Deleted so WrapSnapshot objects can not be copied.
+	WrapSnapshot(const WrapSnapshot &) = delete;
+	WrapSnapshot(WrapSnapshot &&) = delete;
+	WrapSnapshot &operator=(const WrapSnapshot &) = delete;
+	WrapSnapshot &operator=(WrapSnapshot &&) = delete;
+	~WrapSnapshot();
+};
+
+/// The number of lines each line from lineStart wraps to.
+struct WrappedPiece {
+	int version = 0;
+	Sci::Line lineStart = 0;
+	std::vector<int> lines;
+};
+
+/**
+ * Lays out the lines of a WrapSnapshot on a thread with its own surface, fonts and position cache,
+ * queuing how many lines each wraps to for each piece of about pieceLines lines.
+ * The version is advanced when lines of the snapshot may wrap differently in the view, so the thread
+ * stops after its current line and the queued pieces are dropped.
+ */
+class BackgroundWrapper {
+	std::unique_ptr<WrapSnapshot> snapshot;
+	std::unique_ptr<Surface> surface;
+	WindowID wid;
+	Sci::Line lineEndRun;
+	std::atomic<int> version;
+	int versionRun;
+	std::mutex mutex;
+	std::condition_variable pieceReady;
+	std::vector<WrappedPiece> pieces;
+	bool finished;
+	std::thread worker;
+
+	void Work() noexcept;
+public:
+	BackgroundWrapper() noexcept;
+	// Deleted so BackgroundWrapper objects can not be copied.
+	BackgroundWrapper(const BackgroundWrapper &) = delete;
+	BackgroundWrapper(BackgroundWrapper &&) = delete;
+	BackgroundWrapper &operator=(const BackgroundWrapper &) = delete;
+	BackgroundWrapper &operator=(BackgroundWrapper &&) = delete;
+	~BackgroundWrapper();
+
+	/// Starts wrapping snapshot, measuring with surface_ which is initialised for wid_ on the thread.
+	/// Returns false if no thread could be started.
+	bool Start(std::unique_ptr<WrapSnapshot> snapshot_, std::unique_ptr<Surface> surface_, WindowID wid_);
+	/// True while a thread is wrapping lines that still wrap the same.
+	bool Wrapping();
+	bool Current(const WrappedPiece &piece) const noexcept;
+	/// Called when the lines from line may wrap differently: the snapshot is out of date if it includes line.
+	void Invalidate(Sci::Line line) noexcept;
+	/// Waits for the thread to stop and drops the pieces not yet taken.
+	void Stop() noexcept;
+	/// Removes the queued pieces, returning those still valid.
+	/// When none are queued, waits up to millisecondsWait for the thread to queue one.
+	std::vector<WrappedPiece> TakePieces(int millisecondsWait);
+};
+
+}
+
+#endif
@@ -25,8 +25,12 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "ChunkedVector.h"
+#include "RunStyles.h"
 #include "CellBuffer.h"
 #include "UniConversion.h"
+#include "LineScanner.h"
+#include "UTF16PositionMap.h"
 
 namespace Scintilla {
 
@@ -65,6 +69,7 @@ public:
 	virtual void SetPerLine(PerLine *pl) = 0;
 	virtual void InsertText(Sci::Line line, Sci::Position delta) = 0;
 	virtual void InsertLine(Sci::Line line, Sci::Position position, bool lineStart) = 0;
+	virtual void InsertLines(Sci::Line line, const Sci::Position *positions, size_t lines, bool lineStart) = 0;
 	virtual void SetLineStart(Sci::Line line, Sci::Position position) noexcept = 0;
 	virtual void RemoveLine(Sci::Line line) = 0;
 	virtual Sci::Line Lines() const noexcept = 0;
@@ -111,6 +116,15 @@ public:
 		}
 		return refCount == 1;
 	}
+	void InsertLines(Sci::Line line, Sci::Line lines) {
+		// Insert multiple lines with each temporarily 1 character wide.
+		// The line widths will be fixed up by later measuring code.
+		const POS lineAsPos = static_cast<POS>(line);
+		const POS lineStart = static_cast<POS>(starts.PositionFromPartition(lineAsPos - 1) + 1);
+		for (POS l = 0; l < static_cast<POS>(lines); l++) {
+			starts.InsertPartition(lineAsPos + l, lineStart + l);
+		}
+	}
 	bool Release() {
 		if (refCount == 1) {
 			starts.DeleteAll();
@@ -179,6 +193,25 @@ public:
 			perLine->InsertLine(line);
 		}
 	}
+	void InsertLines(Sci::Line line, const Sci::Position *positions, size_t lines, bool lineStart) override {
+		const POS lineAsPos = static_cast<POS>(line);
+		if constexpr (sizeof(Sci::Position) == sizeof(POS)) {
+			starts.InsertPartitions(lineAsPos, positions, lines);
+		} else {
+			starts.InsertPartitionsWithCast(lineAsPos, positions, lines);
+		}
+		if (startsUTF32.Active()) {
+			startsUTF32.InsertLines(line, lines);
+		}
+		if (startsUTF16.Active()) {
+			startsUTF16.InsertLines(line, lines);
+		}
+		if (perLine) {
+			if ((line > 0) && lineStart)
+				line--;
+			perLine->InsertLines(line, lines);
+		}
+	}
 	void SetLineStart(Sci::Line line, Sci::Position position) noexcept override {
 		starts.SetPartitionStartPosition(static_cast<POS>(line), static_cast<POS>(position));
 	}
@@ -270,33 +303,101 @@ public:
 	}
 };
 
-Action::Action() {
+Action::Action() noexcept {
 	at = startAction;
 	position = 0;
+	data = nullptr;
 	lenData = 0;
 	mayCoalesce = false;
 }
 
-Action::~Action() {
-}
-
-void Action::Create(actionType at_, Sci::Position position_, const char *data_, Sci::Position lenData_, bool mayCoalesce_) {
-	data = nullptr;
+void Action::Create(actionType at_, Sci::Position position_, const char *data_, Sci::Position lenData_, bool mayCoalesce_) noexcept {
 	position = position_;
 	at = at_;
-	if (lenData_) {
-		data = std::make_unique<char[]>(lenData_);
-		memcpy(&data[0], data_, lenData_);
-	}
+	data = lenData_ ? data_ : nullptr;
 	lenData = lenData_;
 	mayCoalesce = mayCoalesce_;
 }
 
-void Action::Clear() {
+void Action::Clear() noexcept {
 	data = nullptr;
 	lenData = 0;
 }
 
+namespace {
+
+// Most actions are small so are packed into blocks of this size. Larger text gets its own block.
+constexpr size_t undoBlockSize = 0x10000;
+
+}
+
+UndoLog::UndoLog() noexcept : memory(0) {
+}
+
+UndoLog::~UndoLog() {
+}
+
+const char *UndoLog::Append(const char *s, size_t length) {
+	if (blocks.empty() || (blocks.back().size - blocks.back().used < length)) {
+		const size_t size = std::max(length, undoBlockSize);
+		blocks.push_back({std::make_unique<char[]>(size), size, 0});
+		memory += size;
+	}
+	Block &block = blocks.back();
+	char *text = block.text.get() + block.used;
+	memcpy(text, s, length);
+	block.used += length;
+	return text;
+}
+
+bool UndoLog::Extend(const char *end, const char *s, size_t length) {
+	if (blocks.empty())
+		return false;
+	Block &block = blocks.back();
+	if ((block.used == 0) || (end != block.text.get() + block.used) || (block.size - block.used < length))
+		return false;
+	memcpy(block.text.get() + block.used, s, length);
+	block.used += length;
+	return true;
+}
+
+void UndoLog::TruncateAfter(const char *end) noexcept {
+	if (!end) {
+		Clear();
+		return;
+	}
+	// Usually end is in the last block
+	while (!blocks.empty()) {
+		Block &block = blocks.back();
+		// end follows some text so can not be at the start of its block
+		if (end > block.text.get() && end <= block.text.get() + block.used) {
+			block.used = end - block.text.get();
+			return;
+		}
+		memory -= block.size;
+		blocks.pop_back();
+	}
+}
+
+void UndoLog::DiscardBefore(const char *start) noexcept {
+	if (!start) {
+		Clear();
+		return;
+	}
+	size_t keep = 0;
+	while ((keep < blocks.size()) &&
+		!(start >= blocks[keep].text.get() && start < blocks[keep].text.get() + blocks[keep].used)) {
+		memory -= blocks[keep].size;
+		keep++;
+	}
+	blocks.erase(blocks.begin(), blocks.begin() + keep);
+}
+
+void UndoLog::Clear() noexcept {
+	blocks.clear();
+	memory = 0;
+}
+
 // The undo history stores a sequence of user operations that represent the user's view of the
 // commands executed on the text.
 // Each user operation contains a sequence of text insertion and text deletion actions.
@@ -323,6 +424,8 @@ UndoHistory::UndoHistory() {
 	undoSequenceDepth = 0;
 	savePoint = 0;
 	tentativePoint = -1;
+	memoryLimit = 0;
+	trimAt = 0;
 
 	actions[currentAction].Create(startAction);
 }
@@ -339,6 +442,52 @@ void UndoHistory::EnsureUndoRoom() {
 	}
 }
 
+// The end of the text of the actions before act
+const char *UndoHistory::LogEnd(int act) const noexcept {
+	while (act > 0) {
+		act--;
+		if (actions[act].lenData)
+			return actions[act].data + actions[act].lenData;
+	}
+	return nullptr;
+}
+
+// Forgets the oldest user operations until the text fits in 3/4 of the limit,
+// keeping the current user operation and any tentative actions.
+void UndoHistory::TrimHistory() {
+	int keepFrom = currentAction - 1;
+	while (keepFrom > 0 && actions[keepFrom].at != startAction)
+		keepFrom--;
+	if (tentativePoint >= 0)
+		keepFrom = std::min(keepFrom, tentativePoint);
+	const size_t target = memoryLimit / 4 * 3;
+	size_t freed = 0;
+	int cut = 0;
+	for (int act = 1; (act <= keepFrom) && (log.Memory() - std::min(freed, log.Memory()) > target); act++) {
+		freed += actions[act].lenData;
+		if (actions[act].at == startAction)
+			cut = act;
+	}
+	if (cut > 0) {
+		// actions[cut] becomes the initial start action
+		actions.erase(actions.begin(), actions.begin() + cut);
+		actions.resize(actions.size() + cut);
+		currentAction -= cut;
+		maxAction -= cut;
+		savePoint = (savePoint >= cut) ? savePoint - cut : -1;
+		if (tentativePoint >= 0)
+			tentativePoint -= cut;
+		const char *start = nullptr;
+		for (int act = 1; act <= maxAction && !start; act++) {
+			if (actions[act].lenData)
+				start = actions[act].data;
+		}
+		log.DiscardBefore(start);
+	}
+	// When the current user operation alone is over the limit, try again after it grows by a quarter
+	trimAt = std::max(memoryLimit, log.Memory() + memoryLimit / 4);
+}
+
 const char *UndoHistory::AppendAction(actionType at, Sci::Position position, const char *data, Sci::Position lengthData,
 	bool &startSequence, bool mayCoalesce) {
 	EnsureUndoRoom();
@@ -403,12 +552,33 @@ const char *UndoHistory::AppendAction(actionType at, Sci::Position position, con
 		currentAction++;
 	}
 	startSequence = oldCurrentAction != currentAction;
-	const int actionWithData = currentAction;
-	actions[currentAction].Create(at, position, data, lengthData, mayCoalesce);
-	currentAction++;
-	actions[currentAction].Create(startAction);
-	maxAction = currentAction;
-	return actions[actionWithData].data.get();
+	// Text of any redo actions being overwritten is dropped
+	const char *logEnd = LogEnd(currentAction);
+	log.TruncateAfter(logEnd);
+	const char *text = nullptr;
+	Action &actPrevious = actions[currentAction - 1];
+	// Not when a save or tentative point marks the current action as that must move past it.
+	// Not before a tentative point left after undo, so that actions reach it as they would unmerged.
+	if (!startSequence && (currentAction != savePoint) && (tentativePoint < currentAction) &&
+		(at == insertAction) && lengthData && (actPrevious.at == insertAction) &&
+		(position == actPrevious.position + actPrevious.lenData) &&
+		log.Extend(logEnd, data, lengthData)) {
+		// Typing: lengthen the previous insertion instead of adding an action
+		text = logEnd;
+		actPrevious.lenData += lengthData;
+		actPrevious.mayCoalesce = mayCoalesce;
+		maxAction = currentAction;
+	} else {
+		if (lengthData)
+			text = log.Append(data, lengthData);
+		actions[currentAction].Create(at, position, text, lengthData, mayCoalesce);
+		currentAction++;
+		actions[currentAction].Create(startAction);
+		maxAction = currentAction;
+	}
+	if (memoryLimit && log.Memory() > trimAt)
+		TrimHistory();
+	return text;
 }
 
 void UndoHistory::BeginUndoAction() {
@@ -438,6 +608,10 @@ void UndoHistory::EndUndoAction() {
 	}
 }
 
+int UndoHistory::UndoSequenceDepth() const noexcept {
+	return undoSequenceDepth;
+}
+
 void UndoHistory::DropUndoSequence() {
 	undoSequenceDepth = 0;
 }
@@ -450,6 +624,21 @@ void UndoHistory::DeleteUndoHistory() {
 	actions[currentAction].Create(startAction);
 	savePoint = 0;
 	tentativePoint = -1;
+	log.Clear();
+	trimAt = memoryLimit;
+}
+
+void UndoHistory::SetMemoryLimit(size_t limit) noexcept {
+	memoryLimit = limit;
+	trimAt = limit;
+}
+
+size_t UndoHistory::GetMemoryLimit() const noexcept {
+	return memoryLimit;
+}
+
+size_t UndoHistory::Memory() const noexcept {
+	return log.Memory();
 }
 
 void UndoHistory::SetSavePoint() {
@@ -530,12 +719,474 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
-CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
-	hasStyles(hasStyles_), largeDocument(largeDocument_) {
+namespace {
+
+// Documents at least this long hold their styles as runs.
+constexpr Sci::Position runStylesLength = 0x1000000;
+
+// Runs are kept only while they are this long on average, so take less than half the memory of dense storage.
+constexpr Sci::Position minAverageRun = 32;
+
+// Length filled before the average length of filled runs is checked
+constexpr Sci::Position minLengthFilled = 0x100000;
+
+}
+
+CellVector::CellVector(bool chunked_) :
+	storage(chunked_ ? Storage::chunked : Storage::split), dense(storage), runsRejected(false),
+	mapped(nullptr), length(0), runStart(0), runEnd(0), runValue(0), runData(nullptr), fills(0), lengthFilled(0) {
+	if (chunked_)
+		chunked = std::make_unique<ChunkedVector<char>>();
+}
+
+CellVector::~CellVector() {
+}
+
+void CellVector::SetMapped(std::unique_ptr<IMappedText> mappedText_) {
+	storage = Storage::mapped;
+	split.DeleteAll();
+	chunked.reset();
+	runs.reset();
+	mappedText = std::move(mappedText_);
+	mapped = mappedText->Data();
+	length = 0;
+	InvalidateRun();
+	if (!mapped) {
+		// Read a step at a time into chunks so a large file needs no contiguous allocation
+		storage = Storage::chunked;
+		dense = Storage::chunked;
+		chunked = std::make_unique<ChunkedVector<char>>();
+	}
+}
+
+void CellVector::SetPrefix() {
+	storage = Storage::prefix;
+	dense = Storage::split;
+	split.DeleteAll();
+	chunked.reset();
+	runs.reset();
+	length = 0;
+}
+
+void CellVector::UseRuns() {
+	if (storage == Storage::runs || storage == Storage::mapped || runsRejected)
+		return;
+	const Sci::Position lengthAll = Length();
+	const Sci::Position maxRuns = lengthAll / minAverageRun + 1;
+	auto runsNew = std::make_unique<RunStyles<Sci::Position, char>>();
+	runsNew->InsertSpace(0, lengthAll);
+	constexpr Sci::Position blockSize = 0x10000;
+	std::unique_ptr<char[]> block = std::make_unique<char[]>(blockSize);
+	Sci::Position runStart = 0;
+	char runValue = 0;
+	for (Sci::Position blockStart = 0; blockStart < lengthAll; blockStart += blockSize) {
+		const Sci::Position lengthBlock = std::min(blockSize, lengthAll - blockStart);
+		GetRange(block.get(), blockStart, lengthBlock);
+		for (Sci::Position i = 0; i < lengthBlock; i++) {
+			if (block[i] != runValue) {
+				if (runValue)
+					runsNew->FillRange(runStart, runValue, blockStart + i - runStart);
+				runStart = blockStart + i;
+				runValue = block[i];
+			}
+		}
+		if (runsNew->Runs() > maxRuns) {
+			runsRejected = true;
+			return;
+		}
+	}
+	if (runValue)
+		runsNew->FillRange(runStart, runValue, lengthAll - runStart);
+	runs = std::move(runsNew);
+	storage = Storage::runs;
+	split.DeleteAll();
+	chunked.reset();
+	length = 0;
+	fills = 0;
+	lengthFilled = 0;
+	InvalidateRun();
+}
+
+void CellVector::InvalidateRun() noexcept {
+	runStart = 0;
+	runEnd = 0;
+	runData = nullptr;
+}
+
+// The runs were too short: hold each value again
+void CellVector::RunsToDense() {
+	const Sci::Position lengthAll = runs->Length();
+	if (dense == Storage::chunked) {
+		chunked = std::make_unique<ChunkedVector<char>>();
+	} else {
+		split.DeleteAll();
+		// Room for a gap so the last insertion does not reallocate
+		split.ReAllocate(lengthAll + 1);
+	}
+	for (Sci::Position position = 0; position < lengthAll;) {
+		const Sci::Position end = runs->EndRun(position);
+		if (dense == Storage::chunked)
+			chunked->InsertValue(position, end - position, runs->ValueAt(position));
+		else
+			split.InsertValue(position, end - position, runs->ValueAt(position));
+		position = end;
+	}
+	runs.reset();
+	storage = dense;
+	runsRejected = true;
+	InvalidateRun();
+}
+
+// lengthFill is the length of a range filled with one value, or 0 for other changes.
+void CellVector::CheckRuns(Sci::Position lengthFill) {
+	if (lengthFill > 0) {
+		fills++;
+		lengthFilled += lengthFill;
+	}
+	if ((runs->Runs() > runs->Length() / minAverageRun + 1) ||
+		((lengthFilled >= minLengthFilled) && (fills > lengthFilled / minAverageRun)))
+		RunsToDense();
+}
+
+bool CellVector::IsChunked() const noexcept {
+	return storage == Storage::chunked;
+}
+
+bool CellVector::IsRuns() const noexcept {
+	return storage == Storage::runs;
+}
+
+bool CellVector::IsMapped() const noexcept {
+	return mappedText != nullptr;
+}
+
+const char *CellVector::MappedData() const noexcept {
+	return mapped;
+}
+
+Sci::Position CellVector::MappedLength() const noexcept {
+	return mappedText ? mappedText->Length() : 0;
+}
+
+Sci::Position CellVector::ReadMapped(Sci::Position position, char *buffer, Sci::Position readLength) noexcept {
+	return mappedText ? mappedText->Read(position, buffer, readLength) : 0;
+}
+
+char CellVector::ValueAt(Sci::Position position) const noexcept {
+	switch (storage) {
+	case Storage::chunked:
+		if (position >= runStart && position < runEnd)
+			return runData[position - runStart];
+		// Outside the text, the range is empty and there is no data
+		runData = chunked->ContiguousRange(position, runStart, runEnd);
+		runEnd += runStart;
+		return runData ? runData[position - runStart] : 0;
+	case Storage::mapped:
+		return (position >= 0 && position < length) ? mapped[position] : 0;
+	case Storage::runs:
+		if (position >= runStart && position < runEnd)
+			return runValue;
+		if (position < 0 || position >= runs->Length())
+			return 0;
+		runStart = runs->StartRun(position);
+		runEnd = runs->EndRun(position);
+		runValue = runs->ValueAt(position);
+		return runValue;
+	default:
+		// Prefix storage returns 0 after the elements held
+		return split.ValueAt(position);
+	}
+}
+
+void CellVector::SetValueAt(Sci::Position position, char v) {
+	switch (storage) {
+	case Storage::chunked:
+		InvalidateRun();
+		chunked->SetValueAt(position, v);
+		break;
+	case Storage::mapped:
+		break;
+	case Storage::prefix:
+		if (position < 0 || position >= length)
+			return;
+		if (position >= split.Length()) {
+			if (v == 0)
+				return;
+			split.EnsureLength(position + 1);
+		}
+		split.SetValueAt(position, v);
+		break;
+	case Storage::runs:
+		InvalidateRun();
+		runs->FillRange(position, v, 1);
+		CheckRuns(1);
+		break;
+	default:
+		split.SetValueAt(position, v);
+	}
+}
+
+bool CellVector::FillRange(Sci::Position &position, char v, Sci::Position &fillLength) {
+	if (storage == Storage::runs) {
+		InvalidateRun();
+		const FillResult<Sci::Position> result = runs->FillRange(position, v, fillLength);
+		CheckRuns(fillLength);
+		position = result.position;
+		fillLength = result.fillLength;
+		return result.changed;
+	}
+	Sci::Position firstChanged = -1;
+	Sci::Position lastChanged = -1;
+	for (Sci::Position i = position; i < position + fillLength; i++) {
+		if (ValueAt(i) != v) {
+			SetValueAt(i, v);
+			if (firstChanged < 0)
+				firstChanged = i;
+			lastChanged = i;
+		}
+	}
+	if (firstChanged < 0)
+		return false;
+	position = firstChanged;
+	fillLength = lastChanged + 1 - firstChanged;
+	return true;
+}
+
+Sci::Position CellVector::Length() const noexcept {
+	switch (storage) {
+	case Storage::chunked:
+		return chunked->Length();
+	case Storage::mapped:
+	case Storage::prefix:
+		return length;
+	case Storage::runs:
+		return runs->Length();
+	default:
+		return split.Length();
+	}
+}
+
+void CellVector::InsertValue(Sci::Position position, Sci::Position insertLength, char v) {
+	switch (storage) {
+	case Storage::chunked:
+		InvalidateRun();
+		chunked->InsertValue(position, insertLength, v);
+		break;
+	case Storage::mapped:
+		break;
+	case Storage::prefix:
+		if (position < 0 || position > length || insertLength <= 0)
+			return;
+		if (position < split.Length() || v != 0) {
+			split.EnsureLength(position);
+			split.InsertValue(position, insertLength, v);
+		}
+		length += insertLength;
+		break;
+	case Storage::runs:
+		if (insertLength <= 0)
+			return;
+		// Inserted space is filled with v as in dense storage
+		InvalidateRun();
+		runs->InsertSpace(position, insertLength);
+		runs->FillRange(position, v, insertLength);
+		CheckRuns(0);
+		break;
+	default:
+		split.InsertValue(position, insertLength, v);
+	}
+}
+
+void CellVector::InsertFromArray(Sci::Position positionToInsert, const char s[], Sci::Position positionFrom, Sci::Position insertLength) {
+	switch (storage) {
+	case Storage::chunked:
+		InvalidateRun();
+		chunked->InsertFromArray(positionToInsert, s, positionFrom, insertLength);
+		break;
+	case Storage::mapped:
+		// Mapped text is read-only so the only insertion is of the following mapped text at the end
+		PLATFORM_ASSERT(positionToInsert == length && s + positionFrom == mapped + length);
+		if (positionToInsert == length && s + positionFrom == mapped + length)
+			length = std::min(length + insertLength, MappedLength());
+		break;
+	case Storage::runs:
+		InvalidateRun();
+		runs->InsertSpace(positionToInsert, insertLength);
+		for (Sci::Position i = 0; i < insertLength;) {
+			Sci::Position end = i + 1;
+			while (end < insertLength && s[positionFrom + end] == s[positionFrom + i])
+				end++;
+			runs->FillRange(positionToInsert + i, s[positionFrom + i], end - i);
+			i = end;
+		}
+		CheckRuns(0);
+		break;
+	default:
+		split.InsertFromArray(positionToInsert, s, positionFrom, insertLength);
+	}
+}
+
+void CellVector::DeleteRange(Sci::Position position, Sci::Position deleteLength) {
+	switch (storage) {
+	case Storage::chunked:
+		InvalidateRun();
+		chunked->DeleteRange(position, deleteLength);
+		break;
+	case Storage::mapped:
+		break;
+	case Storage::prefix:
+		if (position < 0 || position + deleteLength > length || deleteLength <= 0)
+			return;
+		if (position < split.Length())
+			split.DeleteRange(position, std::min(deleteLength, split.Length() - position));
+		length -= deleteLength;
+		break;
+	case Storage::runs:
+		InvalidateRun();
+		runs->DeleteRange(position, deleteLength);
+		break;
+	default:
+		split.DeleteRange(position, deleteLength);
+	}
+}
+
+void CellVector::GetRange(char *buffer, Sci::Position position, Sci::Position retrieveLength) const noexcept {
+	switch (storage) {
+	case Storage::chunked:
+		chunked->GetRange(buffer, position, retrieveLength);
+		break;
+	case Storage::mapped:
+		std::copy(mapped + position, mapped + position + retrieveLength, buffer);
+		break;
+	case Storage::prefix: {
+			const Sci::Position lengthHeld = std::clamp<Sci::Position>(split.Length() - position, 0, retrieveLength);
+			split.GetRange(buffer, position, lengthHeld);
+			std::fill(buffer + lengthHeld, buffer + retrieveLength, '\0');
+		}
+		break;
+	case Storage::runs:
+		for (Sci::Position i = 0; i < retrieveLength;) {
+			const Sci::Position end = std::min(runs->EndRun(position + i) - position, retrieveLength);
+			std::fill(buffer + i, buffer + end, runs->ValueAt(position + i));
+			i = end;
+		}
+		break;
+	default:
+		split.GetRange(buffer, position, retrieveLength);
+	}
+}
+
+// Mapped text is terminated by 0 only when it does not end at the end of a memory page.
+// Runs are only used for styles which are not accessed through pointers.
+const char *CellVector::BufferPointer() {
+	switch (storage) {
+	case Storage::runs:
+		return nullptr;
+	case Storage::chunked:
+		InvalidateRun();
+		return chunked->BufferPointer();
+	case Storage::mapped:
+		return mapped;
+	case Storage::prefix:
+		split.EnsureLength(length);
+		return split.BufferPointer();
+	default:
+		return split.BufferPointer();
+	}
+}
+
+const char *CellVector::RangePointer(Sci::Position position, Sci::Position rangeLength) {
+	switch (storage) {
+	case Storage::runs:
+		return nullptr;
+	case Storage::chunked:
+		InvalidateRun();
+		return chunked->RangePointer(position, rangeLength);
+	case Storage::mapped:
+		return mapped + position;
+	case Storage::prefix:
+		split.EnsureLength(position + rangeLength);
+		return split.RangePointer(position, rangeLength);
+	default:
+		return split.RangePointer(position, rangeLength);
+	}
+}
+
+Sci::Position CellVector::GapPosition() const noexcept {
+	switch (storage) {
+	case Storage::chunked:
+		return chunked->GapPosition();
+	case Storage::mapped:
+		return length;
+	case Storage::runs:
+		return runs->Length();
+	default:
+		return split.GapPosition();
+	}
+}
+
+const char *CellVector::ContiguousRange(Sci::Position position, Sci::Position &start, Sci::Position &length_) const noexcept {
+	switch (storage) {
+	case Storage::chunked:
+		return chunked->ContiguousRange(position, start, length_);
+	case Storage::mapped:
+		if (position < 0 || position >= length) {
+			start = position;
+			length_ = 0;
+			return nullptr;
+		}
+		start = 0;
+		length_ = length;
+		return mapped;
+	case Storage::runs:
+		start = position;
+		length_ = 0;
+		return nullptr;
+	default:
+		return split.ContiguousRange(position, start, length_);
+	}
+}
+
+void CellVector::ReAllocate(Sci::Position newSize) {
+	switch (storage) {
+	case Storage::chunked:
+		chunked->ReAllocate(newSize);
+		break;
+	case Storage::split:
+		split.ReAllocate(newSize);
+		break;
+	default:
+		// Mapped text needs no allocation, prefix storage grows as styled and runs as values change
+		break;
+	}
+}
+
+std::unique_ptr<ChunkedVector<char>> CellVector::Snapshot(Sci::Position &start, Sci::Position end) const {
+	if (storage == Storage::chunked) {
+		start = 0;
+		return chunked->Snapshot();
+	}
+	std::unique_ptr<ChunkedVector<char>> copy = std::make_unique<ChunkedVector<char>>();
+	end = std::min(end, Length());
+	start = std::clamp<Sci::Position>(start, 0, end);
+	constexpr Sci::Position blockSize = 0x10000;
+	std::unique_ptr<char[]> block = std::make_unique<char[]>(blockSize);
+	for (Sci::Position position = start; position < end; position += blockSize) {
+		const Sci::Position lengthBlock = std::min(blockSize, end - position);
+		GetRange(block.get(), position, lengthBlock);
+		copy->InsertFromArray(position - start, block.get(), 0, lengthBlock);
+	}
+	return copy;
+}
+
+CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_, bool chunked_) :
+	hasStyles(hasStyles_), largeDocument(largeDocument_), substance(chunked_), style(chunked_) {
 	readOnly = false;
 	utf8Substance = false;
 	utf8LineEnds = 0;
 	collectingUndo = true;
+	mappedReadStart = 0;
+	mappedReadEnded = false;
 	if (largeDocument)
 		plv = std::make_unique<LineVector<Sci::Position>>();
 	else
@@ -566,6 +1217,21 @@ void CellBuffer::GetCharRange(char *buffer, Sci::Position position, Sci::Positio
 	substance.GetRange(buffer, position, lengthRetrieve);
 }
 
+std::unique_ptr<ChunkedVector<char>> CellBuffer::TextSnapshot(Sci::Position &start, Sci::Position end) const {
+	return substance.Snapshot(start, end);
+}
+
+std::unique_ptr<ChunkedVector<char>> CellBuffer::StyleSnapshot(Sci::Position &start, Sci::Position end) const {
+	if (!hasStyles) {
+		std::unique_ptr<ChunkedVector<char>> none = std::make_unique<ChunkedVector<char>>();
+		end = std::min(end, Length());
+		start = std::clamp<Sci::Position>(start, 0, end);
+		none->InsertValue(0, end - start, 0);
+		return none;
+	}
+	return style.Snapshot(start, end);
+}
+
 char CellBuffer::StyleAt(Sci::Position position) const noexcept {
 	return hasStyles ? style.ValueAt(position) : 0;
 }
@@ -599,6 +1265,143 @@ Sci::Position CellBuffer::GapPosition() const {
 	return substance.GapPosition();
 }
 
+// Read-only access to the text without moving the gap, for searching.
+// The pointer is valid until the next modification.
+const char *CellBuffer::ContiguousRange(Sci::Position position, Sci::Position &start, Sci::Position &length) const noexcept {
+	return substance.ContiguousRange(position, start, length);
+}
+
+namespace {
+
+// Converts the start of s, up to length bytes, to UTF-16 at buffer + written, which has room for length code units.
+// Each byte of invalid UTF-8 is 1 code unit holding the byte, as the UTF-16 line index counts it.
+// Unless atEnd, stops before a character that the bytes after s may complete.
+// Returns the number of bytes converted and adds the code units to written.
+Sci::Position UTF16FromUTF8Characters(const char *s, Sci::Position length, bool atEnd, wchar_t *buffer, Sci::Position &written) {
+	Sci::Position converted = 0;
+	while (converted < length) {
+		const std::string_view sv(s + converted, length - converted);
+		const size_t lengthValid = UTF8ValidLength(sv);
+		if (lengthValid > 0) {
+			written += UTF16FromUTF8(sv.substr(0, lengthValid), buffer + written, lengthValid);
+			converted += lengthValid;
+			continue;
+		}
+		const unsigned char lead = sv.front();
+		if (!atEnd && (UTF8BytesOfLead[lead] > sv.length()))
+			break;
+		buffer[written++] = lead;
+		converted++;
+	}
+	return converted;
+}
+
+}
+
+Sci::Position CellBuffer::GetUTF16Range(Sci::Position &position, Sci::Position end, wchar_t *buffer, Sci::Position bufferLength) const {
+	end = std::clamp<Sci::Position>(end, 0, Length());
+	position = std::clamp<Sci::Position>(position, 0, end);
+	Sci::Position written = 0;
+	while ((position < end) && (written < bufferLength)) {
+		// Each byte converts to at most one code unit so converting no more bytes than there is room for can not overflow
+		Sci::Position startRange = 0;
+		Sci::Position lengthRange = 0;
+		const char *range = ContiguousRange(position, startRange, lengthRange);
+		Sci::Position lengthConvert = 0;
+		if (range && (lengthRange > 0)) {
+			range += position - startRange;
+			const Sci::Position endRange = std::min(startRange + lengthRange, end);
+			const Sci::Position lengthWant = std::min(endRange - position, bufferLength - written);
+			lengthConvert = UTF16FromUTF8Characters(range, lengthWant, position + lengthWant == end, buffer, written);
+			position += lengthConvert;
+		}
+		if (lengthConvert == 0) {
+			// A character divided between ranges or by the room left, or that needs 2 code units when only 1 is left.
+			// Its bytes up to end decide whether it is valid, so an invalid sequence is not cut short.
+			char bytes[UTF8MaxBytes];
+			const Sci::Position lengthBytes = std::min<Sci::Position>(UTF8MaxBytes, end - position);
+			GetCharRange(bytes, position, lengthBytes);
+			const int utf8Status = UTF8Classify(reinterpret_cast<const unsigned char *>(bytes), lengthBytes);
+			const Sci::Position lengthCharacter = (utf8Status & UTF8MaskInvalid) ? 1 : (utf8Status & UTF8MaskWidth);
+			const Sci::Position units = UTF16LengthFromUTF8ByteCount(static_cast<unsigned int>(lengthCharacter));
+			if (written + units > bufferLength)
+				break;
+			if (utf8Status & UTF8MaskInvalid)
+				buffer[written++] = static_cast<unsigned char>(bytes[0]);
+			else
+				written += UTF16FromUTF8(std::string_view(bytes, lengthCharacter), buffer + written, units);
+			position += lengthCharacter;
+		}
+	}
+	return written;
+}
+
+bool CellBuffer::SetMappedText(std::unique_ptr<IMappedText> mappedText) {
+	if (Length() != 0)
+		return false;
+	substance.SetMapped(std::move(mappedText));
+	if (hasStyles)
+		style.SetPrefix();
+	readOnly = true;
+	collectingUndo = false;
+	uh.DeleteUndoHistory();
+	return true;
+}
+
+Sci::Position CellBuffer::MappedPending() const noexcept {
+	if (mappedReadEnded)
+		return mappedReadStart + static_cast<Sci::Position>(mappedRead.length()) - Length();
+	return substance.MappedLength() - Length();
+}
+
+// The mapped text after the end of the buffer. Text without Data() is read into mappedRead, at least
+// maxLength + 1 bytes of it when there are more, so a step can look at the byte after its end.
+const char *CellBuffer::MappedText(Sci::Position maxLength) {
+	const Sci::Position position = Length();
+	const char *data = substance.MappedData();
+	if (data)
+		return data + position;
+	mappedRead.erase(0, position - mappedReadStart);
+	mappedReadStart = position;
+	const Sci::Position have = static_cast<Sci::Position>(mappedRead.length());
+	const Sci::Position want = std::min(MappedPending(), maxLength + 1);
+	if (have < want) {
+		mappedRead.resize(want);
+		const Sci::Position lengthRead = substance.ReadMapped(position + have, &mappedRead[have], want - have);
+		mappedRead.resize(have + lengthRead);
+		// The file could not be read to its end so the document ends where reading stopped
+		if (lengthRead < want - have)
+			mappedReadEnded = true;
+	}
+	return mappedRead.data();
+}
+
+Sci::Position CellBuffer::MappedStep(Sci::Position maxLength) {
+	const char *text = MappedText(maxLength);
+	const Sci::Position pending = MappedPending();
+	if (pending <= maxLength)
+		return pending;
+	// End after the last '\n' so that CR LF pairs and lines are not split between steps
+	for (Sci::Position step = maxLength; step > 0; step--) {
+		if (text[step - 1] == '\n')
+			return step;
+	}
+	// A very long line: end at a UTF-8 character start, if any
+	Sci::Position step = maxLength;
+	while (step > maxLength - UTF8MaxBytes && UTF8IsTrailByte(static_cast<unsigned char>(text[step])))
+		step--;
+	return step;
+}
+
+// The char* returned is to the mapped text or to the text read, valid until the next step
+const char *CellBuffer::AppendMapped(Sci::Position appendLength) {
+	const Sci::Position position = Length();
+	const char *text = MappedText(appendLength);
+	appendLength = std::min(appendLength, MappedPending());
+	BasicInsertString(position, text, appendLength);
+	return text;
+}
+
 // The char* returned is to an allocation owned by the undo history
 const char *CellBuffer::InsertString(Sci::Position position, const char *s, Sci::Position insertLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
@@ -632,16 +1435,33 @@ bool CellBuffer::SetStyleFor(Sci::Position position, Sci::Position lengthStyle,
 	if (!hasStyles) {
 		return false;
 	}
-	bool changed = false;
 	PLATFORM_ASSERT(lengthStyle == 0 ||
 		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
-	while (lengthStyle--) {
-		const char curVal = style.ValueAt(position);
-		if (curVal != styleValue) {
-			style.SetValueAt(position, styleValue);
+	return style.FillRange(position, styleValue, lengthStyle);
+}
+
+// Each run of one style is set at once, which is much faster than setting each position for run storage.
+bool CellBuffer::SetStyles(Sci::Position position, const char *styles, Sci::Position lengthStyles,
+	Sci::Position &firstChanged, Sci::Position &lastChanged) {
+	if (!hasStyles) {
+		return false;
+	}
+	PLATFORM_ASSERT(lengthStyles == 0 ||
+		(lengthStyles > 0 && lengthStyles + position <= style.Length()));
+	bool changed = false;
+	for (Sci::Position i = 0; i < lengthStyles;) {
+		Sci::Position end = i + 1;
+		while (end < lengthStyles && styles[end] == styles[i])
+			end++;
+		Sci::Position positionFill = position + i;
+		Sci::Position lengthFill = end - i;
+		if (style.FillRange(positionFill, styles[i], lengthFill)) {
+			if (!changed)
+				firstChanged = positionFill;
 			changed = true;
+			lastChanged = positionFill + lengthFill - 1;
 		}
-		position++;
+		i = end;
 	}
 	return changed;
 }
@@ -731,6 +1551,22 @@ void CellBuffer::ReleaseLineCharacterIndex(int lineCharacterIndex) {
 	plv->ReleaseLineCharacterIndex(lineCharacterIndex);
 }
 
+const UTF16PositionMap &CellBuffer::UTF16Map() {
+	if (!utf16Map) {
+		utf16Map = std::make_unique<UTF16PositionMap>();
+		utf16Map->Init(*this);
+	}
+	return *utf16Map;
+}
+
+void CellBuffer::UTF16FromPositions(int *positions, size_t count) {
+	UTF16Map().UTF16FromPositions(*this, positions, count);
+}
+
+void CellBuffer::PositionsFromUTF16(int *positions, size_t count) {
+	UTF16Map().PositionsFromUTF16(*this, positions, count);
+}
+
 Sci::Line CellBuffer::Lines() const noexcept {
 	return plv->Lines();
 }
@@ -761,13 +1597,30 @@ bool CellBuffer::IsReadOnly() const {
 }
 
 void CellBuffer::SetReadOnly(bool set) {
-	readOnly = set;
+	// Mapped text can not be modified
+	readOnly = set || substance.IsMapped();
 }
 
 bool CellBuffer::IsLarge() const {
 	return largeDocument;
 }
 
+bool CellBuffer::IsChunked() const {
+	return substance.IsChunked();
+}
+
+bool CellBuffer::HasStyleRuns() const noexcept {
+	return style.IsRuns();
+}
+
+bool CellBuffer::IsMapped() const {
+	return substance.IsMapped();
+}
+
+bool CellBuffer::IsMappedInPlace() const noexcept {
+	return substance.MappedData() != nullptr;
+}
+
 bool CellBuffer::HasStyles() const {
 	return hasStyles;
 }
@@ -947,7 +1800,12 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 	}
 
 	substance.InsertFromArray(position, s, 0, insertLength);
+	if (utf16Map)
+		utf16Map->InsertText(*this, position, insertLength);
 	if (hasStyles) {
+		// Large documents hold styles as runs, before inserting so a large load does not allocate dense styles
+		if (style.Length() + insertLength >= runStylesLength)
+			style.UseRuns();
 		style.InsertValue(position, insertLength, 0);
 	}
 
@@ -964,33 +1822,25 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 	if (breakingUTF8LineEnd) {
 		RemoveLine(lineInsert);
 	}
-	unsigned char ch = ' ';
-	for (Sci::Position i = 0; i < insertLength; i++) {
-		ch = s[i];
-		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
-			simpleInsertion = false;
-		} else if (ch == '\n') {
-			if (chPrev == '\r') {
-				// Patch up what was end of line
-				plv->SetLineStart(lineInsert - 1, (position + i) + 1);
-			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-			}
-			simpleInsertion = false;
-		} else if (utf8LineEnds) {
-			const unsigned char back3[3] = {chBeforePrev, chPrev, ch};
-			if (UTF8IsSeparator(back3) || UTF8IsNEL(back3+1)) {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-				simpleInsertion = false;
-			}
+	if (s[0] == '\n' && chPrev == '\r') {
+		// Patch up what was end of line
+		plv->SetLineStart(lineInsert - 1, position + 1);
+		simpleInsertion = false;
+	}
+	// Find the line ends first then insert all the lines at once
+	std::vector<Sci::Position> lineStarts;
+	FindLineStarts(s, insertLength, chBeforePrev, chPrev, utf8LineEnds != 0, lineStarts);
+	if (!lineStarts.empty()) {
+		for (Sci::Position &lineStart : lineStarts) {
+			lineStart += position;
 		}
-		chBeforePrev = chPrev;
-		chPrev = ch;
+		plv->InsertLines(lineInsert, lineStarts.data(), lineStarts.size(), atLineStart);
+		lineInsert += lineStarts.size();
+		simpleInsertion = false;
 	}
+	const unsigned char ch = s[insertLength - 1];
+	chBeforePrev = (insertLength >= 2) ? s[insertLength - 2] : chPrev;
+	chPrev = ch;
 	// Joining two lines where last insertion is cr and following substance starts with lf
 	if (chAfter == '\n') {
 		if (ch == '\r') {
@@ -1120,6 +1970,8 @@ void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLe
 		}
 	}
 	substance.DeleteRange(position, deleteLength);
+	if (utf16Map)
+		utf16Map->DeleteText(*this, position, deleteLength);
 	if (lineRecalculateStart >= 0) {
 		RecalculateIndexLineStarts(lineRecalculateStart, lineRecalculateStart);
 	}
@@ -1146,6 +1998,10 @@ void CellBuffer::EndUndoAction() {
 	uh.EndUndoAction();
 }
 
+int CellBuffer::UndoSequenceDepth() const noexcept {
+	return uh.UndoSequenceDepth();
+}
+
 void CellBuffer::AddUndoAction(Sci::Position token, bool mayCoalesce) {
 	bool startSequence;
 	uh.AppendAction(containerAction, token, nullptr, 0, startSequence, mayCoalesce);
@@ -1155,6 +2011,18 @@ void CellBuffer::DeleteUndoHistory() {
 	uh.DeleteUndoHistory();
 }
 
+void CellBuffer::SetUndoMemoryLimit(size_t limit) noexcept {
+	uh.SetMemoryLimit(limit);
+}
+
+size_t CellBuffer::GetUndoMemoryLimit() const noexcept {
+	return uh.GetMemoryLimit();
+}
+
+size_t CellBuffer::UndoMemory() const noexcept {
+	return uh.Memory();
+}
+
 bool CellBuffer::CanUndo() const {
 	return uh.CanUndo();
 }
@@ -1176,7 +2044,7 @@ void CellBuffer::PerformUndoStep() {
 		}
 		BasicDeleteChars(actionStep.position, actionStep.lenData);
 	} else if (actionStep.at == removeAction) {
-		BasicInsertString(actionStep.position, actionStep.data.get(), actionStep.lenData);
+		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
 	}
 	uh.CompletedUndoStep();
 }
@@ -1196,7 +2064,7 @@ const Action &CellBuffer::GetRedoStep() const {
 void CellBuffer::PerformRedoStep() {
 	const Action &actionStep = uh.GetRedoStep();
 	if (actionStep.at == insertAction) {
-		BasicInsertString(actionStep.position, actionStep.data.get(), actionStep.lenData);
+		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
 	} else if (actionStep.at == removeAction) {
 		BasicDeleteChars(actionStep.position, actionStep.lenData);
 	}
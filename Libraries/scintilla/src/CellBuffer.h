@@ -16,6 +16,7 @@ public:
 	virtual ~PerLine() {}
 	virtual void Init()=0;
 	virtual void InsertLine(Sci::Line line)=0;
+	virtual void InsertLines(Sci::Line line, Sci::Line lines)=0;
 	virtual void RemoveLine(Sci::Line line)=0;
 };
 
@@ -24,6 +25,8 @@ public:
  */
 class ILineVector;
 
+class UTF16PositionMap;
+
 enum actionType { insertAction, removeAction, startAction, containerAction };
 
 /**
@@ -32,21 +35,50 @@ enum actionType { insertAction, removeAction, startAction, containerAction };
 class Action {
 public:
 	actionType at;
+	bool mayCoalesce;
 	Sci::Position position;
-	std::unique_ptr<char[]> data;
+	const char *data;	// Owned by the UndoLog of the UndoHistory
 	Sci::Position lenData;
-	bool mayCoalesce;
 
-	Action();
-	// Deleted so Action objects can not be copied.
-	Action(const Action &other) = delete;
-	Action &operator=(const Action &other) = delete;
-	Action &operator=(const Action &&other) = delete;
-	// Move constructor allows vector to be resized without reallocating.
-	Action(Action &&other) noexcept = default;
-	~Action();
-	void Create(actionType at_, Sci::Position position_=0, const char *data_=nullptr, Sci::Position lenData_=0, bool mayCoalesce_=true);
-	void Clear();
+	Action() noexcept;
+	void Create(actionType at_, Sci::Position position_=0, const char *data_=nullptr, Sci::Position lenData_=0, bool mayCoalesce_=true) noexcept;
+	void Clear() noexcept;
+};
+
+/**
+ * Holds the text of undo actions in order in a few large blocks, instead of an allocation
+ * for each action. Text is only added at the end and removed from either end.
+ */
+class UndoLog {
+	struct Block {
+		std::unique_ptr<char[]> text;
+		size_t size;
+		size_t used;
+	};
+	std::vector<Block> blocks;
+	size_t memory;
+
+public:
+	UndoLog() noexcept;
+	// Deleted so UndoLog objects can not be copied.
+	UndoLog(const UndoLog &) = delete;
+	UndoLog(UndoLog &&) = delete;
+	void operator=(const UndoLog &) = delete;
+	void operator=(UndoLog &&) = delete;
+	~UndoLog();
+
+	/// Copies s to the end of the log, returning the copy which stays at that address.
+	const char *Append(const char *s, size_t length);
+	/// If end is the end of the log and there is room, appends s contiguously and returns true.
+	bool Extend(const char *end, const char *s, size_t length);
+	/// Discards the text after end, which is in the log or nullptr to discard everything.
+	void TruncateAfter(const char *end) noexcept;
+	/// Frees the blocks before the one containing start, which is in the log or nullptr.
+	void DiscardBefore(const char *start) noexcept;
+	void Clear() noexcept;
+	size_t Memory() const noexcept {
+		return memory;
+	}
 };
 
 /**
@@ -59,8 +91,13 @@ class UndoHistory {
 	int undoSequenceDepth;
 	int savePoint;
 	int tentativePoint;
+	UndoLog log;
+	size_t memoryLimit;
+	size_t trimAt;
 
 	void EnsureUndoRoom();
+	const char *LogEnd(int act) const noexcept;
+	void TrimHistory();
 
 public:
 	UndoHistory();
@@ -75,9 +112,17 @@ public:
 
 	void BeginUndoAction();
 	void EndUndoAction();
+	int UndoSequenceDepth() const noexcept;
 	void DropUndoSequence();
 	void DeleteUndoHistory();
 
+	/// When the text of the history grows past the limit, the oldest user operations are
+	/// forgotten. 0 is no limit.
+	void SetMemoryLimit(size_t limit) noexcept;
+	size_t GetMemoryLimit() const noexcept;
+	/// Memory held for the text of the history.
+	size_t Memory() const noexcept;
+
 	/// The save point is a marker in the undo stack where the container has stated that
 	/// the buffer was saved. Undo and redo can move over the save point.
 	void SetSavePoint();
@@ -101,6 +146,98 @@ public:
 	void CompletedRedoStep();
 };
 
+template <typename T> class ChunkedVector;
+template <typename DISTANCE, typename STYLE> class RunStyles;
+
+/**
+ * Read-only text shown by a document, such as a file mapped in memory.
+ * Must not change while the document exists.
+ * Text that can not be mapped, such as a file too big for the address space, has no Data()
+ * and is read a step at a time into the document.
+ */
+class IMappedText {
+public:
+	virtual ~IMappedText() {}
+	virtual const char *Data() const noexcept = 0;
+	virtual Sci::Position Length() const noexcept = 0;
+	/// Reads up to length bytes from position into buffer. Returns the number of bytes read.
+	virtual Sci::Position Read(Sci::Position position, char *buffer, Sci::Position length) noexcept = 0;
+};
+
+/**
+ * Array of characters or styles for CellBuffer held in a SplitVector or, for documents
+ * created with SC_DOCUMENTOPTION_CHUNKED, in a ChunkedVector.
+ * For documents showing mapped text, characters are read from the IMappedText, and styles are
+ * held only up to the last styled position as the values after it are 0.
+ * Has the subset of the SplitVector interface used by CellBuffer.
+ */
+class CellVector {
+	enum class Storage { split, chunked, mapped, prefix, runs };
+	Storage storage;
+	Storage dense;	// Storage to return to when runs are too short: split or chunked
+	bool runsRejected;
+	SplitVector<char> split;
+	std::unique_ptr<ChunkedVector<char>> chunked;
+	std::unique_ptr<IMappedText> mappedText;
+	const char *mapped;
+	Sci::Position length;	// Used by mapped and prefix storage
+	std::unique_ptr<RunStyles<Sci::Position, char>> runs;
+	// The run, or for chunked storage the chunk, last read, as values are mostly read in order.
+	// Kept here rather than in the ChunkedVector so reading a snapshot of it on another thread writes nothing shared.
+	mutable Sci::Position runStart;
+	mutable Sci::Position runEnd;
+	mutable char runValue;
+	mutable const char *runData;
+	// Filled ranges and their lengths, to see early if styles are in short runs
+	Sci::Position fills;
+	Sci::Position lengthFilled;
+
+	void InvalidateRun() noexcept;
+	void RunsToDense();
+	void CheckRuns(Sci::Position lengthFill);
+public:
+	explicit CellVector(bool chunked_);
+	// Deleted so CellVector objects can not be copied.
+	CellVector(const CellVector &) = delete;
+	CellVector(CellVector &&) = delete;
+	void operator=(const CellVector &) = delete;
+	void operator=(CellVector &&) = delete;
+	~CellVector();
+
+	/// Show mappedText_. Length is initially 0 and increases by inserting the mapped text at the end.
+	/// Text without Data() is held in chunks as inserted.
+	void SetMapped(std::unique_ptr<IMappedText> mappedText_);
+	/// Hold values only up to the last one set.
+	void SetPrefix();
+	/// Hold values as runs of the same value, which is smaller when runs are long as for styles.
+	/// Returns to dense storage for good if the runs turn out short.
+	void UseRuns();
+	bool IsChunked() const noexcept;
+	bool IsRuns() const noexcept;
+	bool IsMapped() const noexcept;
+	const char *MappedData() const noexcept;
+	Sci::Position MappedLength() const noexcept;
+	Sci::Position ReadMapped(Sci::Position position, char *buffer, Sci::Position readLength) noexcept;
+
+	char ValueAt(Sci::Position position) const noexcept;
+	void SetValueAt(Sci::Position position, char v);
+	/// Returns true if some values changed with position and fillLength trimmed to the values changed.
+	bool FillRange(Sci::Position &position, char v, Sci::Position &fillLength);
+	Sci::Position Length() const noexcept;
+	void InsertValue(Sci::Position position, Sci::Position insertLength, char v);
+	void InsertFromArray(Sci::Position positionToInsert, const char s[], Sci::Position positionFrom, Sci::Position insertLength);
+	void DeleteRange(Sci::Position position, Sci::Position deleteLength);
+	void GetRange(char *buffer, Sci::Position position, Sci::Position retrieveLength) const noexcept;
+	const char *BufferPointer();
+	const char *RangePointer(Sci::Position position, Sci::Position rangeLength);
+	Sci::Position GapPosition() const noexcept;
+	const char *ContiguousRange(Sci::Position position, Sci::Position &start, Sci::Position &length) const noexcept;
+	void ReAllocate(Sci::Position newSize);
+	/// A copy of the values from start to end, which may be read on another thread.
+	/// Chunked storage shares all of its chunks instead of copying them and sets start to 0.
+	std::unique_ptr<ChunkedVector<char>> Snapshot(Sci::Position &start, Sci::Position end) const;
+};
+
 /**
  * Holder for an expandable array of characters that supports undo and line markers.
  * Based on article "Data Structures in a Bit-Mapped Text Editor"
@@ -110,8 +247,8 @@ class CellBuffer {
 private:
 	bool hasStyles;
 	bool largeDocument;
-	SplitVector<char> substance;
-	SplitVector<char> style;
+	CellVector substance;
+	CellVector style;
 	bool readOnly;
 	bool utf8Substance;
 	int utf8LineEnds;
@@ -120,6 +257,11 @@ private:
 	UndoHistory uh;
 
 	std::unique_ptr<ILineVector> plv;
+	std::unique_ptr<UTF16PositionMap> utf16Map;	// Allocated when first used
+	// Mapped text without Data() read for the next steps, from mappedReadStart
+	std::string mappedRead;
+	Sci::Position mappedReadStart;
+	bool mappedReadEnded;
 
 	bool UTF8LineEndOverlaps(Sci::Position position) const;
 	bool UTF8IsCharacterBoundary(Sci::Position position) const;
@@ -129,10 +271,12 @@ private:
 	/// Actions without undo
 	void BasicInsertString(Sci::Position position, const char *s, Sci::Position insertLength);
 	void BasicDeleteChars(Sci::Position position, Sci::Position deleteLength);
+	const UTF16PositionMap &UTF16Map();
+	const char *MappedText(Sci::Position maxLength);
 
 public:
 
-	CellBuffer(bool hasStyles_, bool largeDocument_);
+	CellBuffer(bool hasStyles_, bool largeDocument_, bool chunked_);
 	// Deleted so CellBuffer objects can not be copied.
 	CellBuffer(const CellBuffer &) = delete;
 	CellBuffer(CellBuffer &&) = delete;
@@ -149,6 +293,17 @@ public:
 	const char *BufferPointer();
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength);
 	Sci::Position GapPosition() const;
+	const char *ContiguousRange(Sci::Position position, Sci::Position &start, Sci::Position &length) const noexcept;
+	/// Converts the UTF-8 text from position up to end into UTF-16 in buffer, as many whole characters as fit
+	/// in bufferLength code units, reading each contiguous range of the text in place.
+	/// Advances position past the text converted and returns the number of code units written,
+	/// so a range may be retrieved a buffer at a time. Text converts the same however it is divided:
+	/// each byte of invalid UTF-8 is 1 code unit holding the byte, as the UTF-16 line index counts it.
+	Sci::Position GetUTF16Range(Sci::Position &position, Sci::Position end, wchar_t *buffer, Sci::Position bufferLength) const;
+	/// Copies of the text and of the styles from start to end, which may be read on another thread.
+	/// start is set to the position the copy starts at, which is 0 when all is shared.
+	std::unique_ptr<ChunkedVector<char>> TextSnapshot(Sci::Position &start, Sci::Position end) const;
+	std::unique_ptr<ChunkedVector<char>> StyleSnapshot(Sci::Position &start, Sci::Position end) const;
 
 	Sci::Position Length() const noexcept;
 	void Allocate(Sci::Position newSize);
@@ -165,20 +320,39 @@ public:
 	Sci::Position IndexLineStart(Sci::Line line, int lineCharacterIndex) const noexcept;
 	Sci::Line LineFromPosition(Sci::Position pos) const noexcept;
 	Sci::Line LineFromPositionIndex(Sci::Position pos, int lineCharacterIndex) const noexcept;
+	/// Convert count positions in place between bytes and UTF-16 code units.
+	void UTF16FromPositions(int *positions, size_t count);
+	void PositionsFromUTF16(int *positions, size_t count);
 	void InsertLine(Sci::Line line, Sci::Position position, bool lineStart);
 	void RemoveLine(Sci::Line line);
+	/// Makes an empty buffer show mappedText read-only. Returns false if not empty.
+	bool SetMappedText(std::unique_ptr<IMappedText> mappedText);
+	/// Length of mapped text not yet appended to the buffer.
+	Sci::Position MappedPending() const noexcept;
+	/// Length of the next part of mapped text to append: up to maxLength, ending at a line end when possible.
+	Sci::Position MappedStep(Sci::Position maxLength);
+	/// Appends the next appendLength bytes of mapped text, without undo.
+	const char *AppendMapped(Sci::Position appendLength);
 	const char *InsertString(Sci::Position position, const char *s, Sci::Position insertLength, bool &startSequence);
 
 	/// Setting styles for positions outside the range of the buffer is safe and has no effect.
 	/// @return true if the style of a character is changed.
 	bool SetStyleAt(Sci::Position position, char styleValue);
 	bool SetStyleFor(Sci::Position position, Sci::Position lengthStyle, char styleValue);
+	bool SetStyles(Sci::Position position, const char *styles, Sci::Position lengthStyles,
+		Sci::Position &firstChanged, Sci::Position &lastChanged);
 
 	const char *DeleteChars(Sci::Position position, Sci::Position deleteLength, bool &startSequence);
 
 	bool IsReadOnly() const;
 	void SetReadOnly(bool set);
 	bool IsLarge() const;
+	bool IsChunked() const;
+	/// Styles held as runs of one value rather than a byte each.
+	bool HasStyleRuns() const noexcept;
+	bool IsMapped() const;
+	/// Mapped text that is read where it is, so does not change.
+	bool IsMappedInPlace() const noexcept;
 	bool HasStyles() const;
 
 	/// The save point is a marker in the undo stack where the container has stated that
@@ -195,8 +369,12 @@ public:
 	bool IsCollectingUndo() const;
 	void BeginUndoAction();
 	void EndUndoAction();
+	int UndoSequenceDepth() const noexcept;
 	void AddUndoAction(Sci::Position token, bool mayCoalesce);
 	void DeleteUndoHistory();
+	void SetUndoMemoryLimit(size_t limit) noexcept;
+	size_t GetUndoMemoryLimit() const noexcept;
+	size_t UndoMemory() const noexcept;
 
 	/// To perform an undo, StartUndo is called to retrieve the number of steps, then UndoStep is
 	/// called that many times. Similarly for redo.
@@ -0,0 +1,375 @@
+// Scintilla source code edit control
+/** @file ChunkedVector.h
+ ** Array held as a sequence of chunks so that insertions and deletions
+ ** anywhere in large arrays are fast.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef CHUNKEDVECTOR_H
+#define CHUNKEDVECTOR_H
+
+namespace Scintilla {
+
+/**
+ * Holds elements in chunks of up to maxChunk elements, with the chunk start positions in a Partitioning.
+ * An insertion or deletion moves only elements of the chunks it touches, so edits scattered over
+ * a large array do not move the text between them as a SplitVector moves its gap.
+ * Chunks are reference counted: a Snapshot shares them and a chunk is copied before it is modified.
+ * Const methods change nothing, so a Snapshot may be read from several threads at once.
+ * A range longer than maxChunk asked for by RangePointer is held in one chunk until an edit in it splits it.
+ * Has the subset of the SplitVector interface used by CellBuffer.
+ */
+template <typename T>
+class ChunkedVector {
+	using Chunk = std::vector<T>;
+	static constexpr ptrdiff_t maxChunk = 0x10000;
+	// Chunks are made half full when split so that following insertions do not split them again at once.
+	static constexpr ptrdiff_t fillChunk = maxChunk / 2;
+
+	// Never empty: an empty ChunkedVector has one empty chunk.
+	SplitVector<std::shared_ptr<Chunk>> chunks;
+	Partitioning<ptrdiff_t> starts;
+	ptrdiff_t lengthBody;
+	T empty;	/// Returned as the result of out-of-bounds access.
+
+	void Init() {
+		chunks.DeleteAll();
+		chunks.Insert(0, std::make_shared<Chunk>());
+		starts.DeleteAll();
+		lengthBody = 0;
+	}
+
+	ptrdiff_t ChunkLength(ptrdiff_t chunk) const noexcept {
+		return chunks.ValueAt(chunk)->size();
+	}
+
+	/// Return a chunk for modification, copying it first if it is shared with a snapshot.
+	Chunk &Writable(ptrdiff_t chunk) {
+		std::shared_ptr<Chunk> &p = chunks[chunk];
+		if (p.use_count() > 1)
+			p = std::make_shared<Chunk>(*p);
+		return *p;
+	}
+
+	/// Append the elements of the following chunk to chunk and remove the following chunk.
+	void MergeNext(ptrdiff_t chunk) {
+		const Chunk &next = *chunks.ValueAt(chunk + 1);
+		Chunk &c = Writable(chunk);
+		c.insert(c.end(), next.begin(), next.end());
+		chunks.Delete(chunk + 1);
+		starts.RemovePartition(chunk + 1);
+	}
+
+	/// Split a chunk longer than maxChunk into pieces of about fillChunk elements.
+	void SplitLong(ptrdiff_t chunk) {
+		const std::shared_ptr<Chunk> old = chunks.ValueAt(chunk);
+		const ptrdiff_t total = old->size();
+		if (total <= maxChunk) {
+			return;
+		}
+		const ptrdiff_t chunkStart = starts.PositionFromPartition(chunk);
+		const ptrdiff_t pieces = (total + fillChunk - 1) / fillChunk;
+		ptrdiff_t done = 0;
+		for (ptrdiff_t piece = 0; piece < pieces; piece++) {
+			const ptrdiff_t lengthPiece = total / pieces + ((piece < total % pieces) ? 1 : 0);
+			auto pc = std::make_shared<Chunk>(old->begin() + done, old->begin() + done + lengthPiece);
+			if (piece == 0) {
+				chunks[chunk] = std::move(pc);
+			} else {
+				chunks.Insert(chunk + piece, std::move(pc));
+				starts.InsertPartition(chunk + piece, chunkStart + done);
+			}
+			done += lengthPiece;
+		}
+	}
+
+	/// Merge chunks around position that have become small after deletions.
+	void MergeSmall(ptrdiff_t position) {
+		ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		if (chunk > 0 && ChunkLength(chunk - 1) + ChunkLength(chunk) <= fillChunk) {
+			chunk--;
+			MergeNext(chunk);
+		}
+		if (chunk + 1 < chunks.Length() && ChunkLength(chunk) + ChunkLength(chunk + 1) <= fillChunk) {
+			MergeNext(chunk);
+		}
+	}
+
+	/// Insert insertLength elements at position, calling fill(destination, index, count)
+	/// to set count elements starting from index within the inserted elements.
+	template <typename Fill>
+	void InsertFilled(ptrdiff_t position, ptrdiff_t insertLength, Fill fill) {
+		PLATFORM_ASSERT((position >= 0) && (position <= lengthBody));
+		if ((insertLength <= 0) || (position < 0) || (position > lengthBody)) {
+			return;
+		}
+		const ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		const ptrdiff_t chunkStart = starts.PositionFromPartition(chunk);
+		const ptrdiff_t offset = position - chunkStart;
+		Chunk &c = Writable(chunk);
+		const ptrdiff_t lengthChunk = c.size();
+		if (lengthChunk + insertLength <= maxChunk) {
+			c.insert(c.begin() + offset, insertLength, T());
+			fill(c.data() + offset, 0, insertLength);
+			starts.InsertText(chunk, insertLength);
+		} else {
+			// Replace the chunk with pieces of about fillChunk elements holding
+			// the start of the chunk, the inserted elements, then the rest of the chunk.
+			const Chunk old = std::move(c);
+			const ptrdiff_t total = lengthChunk + insertLength;
+			const ptrdiff_t pieces = (total + fillChunk - 1) / fillChunk;
+			ptrdiff_t done = 0;
+			starts.InsertText(chunk, insertLength);
+			for (ptrdiff_t piece = 0; piece < pieces; piece++) {
+				const ptrdiff_t lengthPiece = total / pieces + ((piece < total % pieces) ? 1 : 0);
+				auto pc = std::make_shared<Chunk>(lengthPiece);
+				for (ptrdiff_t i = 0; i < lengthPiece;) {
+					const ptrdiff_t index = done + i;
+					T *destination = pc->data() + i;
+					ptrdiff_t count = 0;
+					if (index < offset) {
+						count = std::min(lengthPiece - i, offset - index);
+						std::copy(old.data() + index, old.data() + index + count, destination);
+					} else if (index < offset + insertLength) {
+						count = std::min(lengthPiece - i, offset + insertLength - index);
+						fill(destination, index - offset, count);
+					} else {
+						count = lengthPiece - i;
+						const ptrdiff_t from = index - insertLength;
+						std::copy(old.data() + from, old.data() + from + count, destination);
+					}
+					i += count;
+				}
+				if (piece == 0) {
+					chunks[chunk] = std::move(pc);
+				} else {
+					chunks.Insert(chunk + piece, std::move(pc));
+					starts.InsertPartition(chunk + piece, chunkStart + done);
+				}
+				done += lengthPiece;
+			}
+		}
+		lengthBody += insertLength;
+	}
+
+public:
+	ChunkedVector() : starts(8), lengthBody(0), empty() {
+		chunks.Insert(0, std::make_shared<Chunk>());
+	}
+	// Deleted so ChunkedVector objects can not be copied: use Snapshot.
+	ChunkedVector(const ChunkedVector &) = delete;
+	ChunkedVector(ChunkedVector &&) = delete;
+	void operator=(const ChunkedVector &) = delete;
+	void operator=(ChunkedVector &&) = delete;
+	~ChunkedVector() {
+	}
+
+	/// Retrieve the element at a particular position.
+	/// Retrieving positions outside the range of the buffer returns empty or 0.
+	/// Each call searches for the chunk: a reader of many elements in order keeps the chunk from ContiguousRange.
+	const T &ValueAt(ptrdiff_t position) const noexcept {
+		if ((position < 0) || (position >= lengthBody)) {
+			return empty;
+		}
+		const ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		return (*chunks.ValueAt(chunk))[position - starts.PositionFromPartition(chunk)];
+	}
+
+	void SetValueAt(ptrdiff_t position, T v) {
+		if ((position < 0) || (position >= lengthBody)) {
+			return;
+		}
+		const ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		Writable(chunk)[position - starts.PositionFromPartition(chunk)] = std::move(v);
+	}
+
+	/// Retrieve the length of the buffer.
+	ptrdiff_t Length() const noexcept {
+		return lengthBody;
+	}
+
+	/// Insert a number of elements into the buffer setting their value.
+	void InsertValue(ptrdiff_t position, ptrdiff_t insertLength, T v) {
+		InsertFilled(position, insertLength, [&v](T *destination, ptrdiff_t, ptrdiff_t count) {
+			std::fill(destination, destination + count, v);
+		});
+	}
+
+	/// Insert text into the buffer from an array.
+	void InsertFromArray(ptrdiff_t positionToInsert, const T s[], ptrdiff_t positionFrom, ptrdiff_t insertLength) {
+		InsertFilled(positionToInsert, insertLength, [s, positionFrom](T *destination, ptrdiff_t index, ptrdiff_t count) {
+			std::copy(s + positionFrom + index, s + positionFrom + index + count, destination);
+		});
+	}
+
+	/// Delete a range from the buffer.
+	/// Deleting positions outside the current range fails.
+	void DeleteRange(ptrdiff_t position, ptrdiff_t deleteLength) {
+		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= lengthBody));
+		if ((position < 0) || ((position + deleteLength) > lengthBody)) {
+			return;
+		}
+		if ((position == 0) && (deleteLength == lengthBody)) {
+			// Full deallocation returns storage and is faster
+			Init();
+			return;
+		}
+		if (deleteLength <= 0) {
+			return;
+		}
+		ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		ptrdiff_t remaining = deleteLength;
+		while (remaining > 0) {
+			const ptrdiff_t offset = position - starts.PositionFromPartition(chunk);
+			const ptrdiff_t lengthChunk = ChunkLength(chunk);
+			const ptrdiff_t count = std::min(remaining, lengthChunk - offset);
+			starts.InsertText(chunk, -count);
+			if (count == lengthChunk) {
+				// Whole chunk: remove it, not copying it if shared.
+				// Its start and the next chunk's start are now equal so either may be removed.
+				chunks.Delete(chunk);
+				starts.RemovePartition((chunk + 1 < starts.Partitions()) ? chunk + 1 : chunk);
+			} else {
+				Chunk &c = Writable(chunk);
+				c.erase(c.begin() + offset, c.begin() + offset + count);
+				chunk++;
+			}
+			remaining -= count;
+		}
+		lengthBody -= deleteLength;
+		// Chunks joined beyond maxChunk by RangePointer around the deletion, the later first
+		const ptrdiff_t chunkAfter = starts.PartitionFromPosition(position);
+		SplitLong(chunkAfter);
+		if ((position > 0) && (chunkAfter > 0) && (starts.PositionFromPartition(chunkAfter) == position)) {
+			SplitLong(chunkAfter - 1);
+		}
+		MergeSmall(position);
+	}
+
+	/// Delete all the buffer contents.
+	void DeleteAll() {
+		Init();
+	}
+
+	/// Retrieve a range of elements into an array
+	void GetRange(T *buffer, ptrdiff_t position, ptrdiff_t retrieveLength) const noexcept {
+		if (retrieveLength <= 0) {
+			return;
+		}
+		ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		ptrdiff_t offset = position - starts.PositionFromPartition(chunk);
+		while (retrieveLength > 0) {
+			const Chunk &c = *chunks.ValueAt(chunk);
+			const ptrdiff_t count = std::min(retrieveLength, static_cast<ptrdiff_t>(c.size()) - offset);
+			std::copy(c.data() + offset, c.data() + offset + count, buffer);
+			buffer += count;
+			retrieveLength -= count;
+			offset = 0;
+			chunk++;
+		}
+	}
+
+	/// Merge all the chunks into one and return a pointer to the first element.
+	/// Also ensures there is an empty element beyond logical end in case its
+	/// passed to a function expecting a NUL terminated string.
+	/// Following insertions split the buffer into chunks again.
+	T *BufferPointer() {
+		RangePointer(0, lengthBody);
+		Chunk &c = Writable(0);
+		c.push_back(T());
+		c.pop_back();
+		return c.data();
+	}
+
+	/// Return a pointer to a range of elements. When the range extends over more than one chunk, the chunks
+	/// covering it are replaced by one chunk or, when that would be longer than maxChunk, by pieces divided
+	/// at the start or end of the range, so only a range longer than maxChunk makes a chunk that long.
+	T *RangePointer(ptrdiff_t position, ptrdiff_t rangeLength) {
+		const ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		const ptrdiff_t chunkStart = starts.PositionFromPartition(chunk);
+		const ptrdiff_t end = std::min(position + rangeLength, lengthBody);
+		if (end <= chunkStart + ChunkLength(chunk)) {
+			return chunks[chunk]->data() + (position - chunkStart);
+		}
+		const ptrdiff_t last = starts.PartitionFromPosition(end - 1);
+		const ptrdiff_t lastEnd = starts.PositionFromPartition(last + 1);
+		std::vector<ptrdiff_t> bounds { chunkStart };
+		if (lastEnd - chunkStart > maxChunk) {
+			if (end - chunkStart <= maxChunk) {
+				bounds.push_back(end);
+			} else if (lastEnd - position <= maxChunk) {
+				bounds.push_back(position);
+			} else {
+				if (position > chunkStart)
+					bounds.push_back(position);
+				if (end < lastEnd)
+					bounds.push_back(end);
+			}
+		}
+		bounds.push_back(lastEnd);
+		std::vector<std::shared_ptr<Chunk>> pieces;
+		for (size_t piece = 0; piece + 1 < bounds.size(); piece++) {
+			pieces.push_back(std::make_shared<Chunk>(bounds[piece + 1] - bounds[piece]));
+			GetRange(pieces.back()->data(), bounds[piece], bounds[piece + 1] - bounds[piece]);
+		}
+		chunks.DeleteRange(chunk + 1, last - chunk);
+		starts.RemovePartitions(chunk + 1, last - chunk);
+		T *data = nullptr;
+		for (size_t piece = 0; piece < pieces.size(); piece++) {
+			if ((position >= bounds[piece]) && (position < bounds[piece + 1]))
+				data = pieces[piece]->data() + (position - bounds[piece]);
+			if (piece == 0) {
+				chunks[chunk] = std::move(pieces[piece]);
+			} else {
+				chunks.Insert(chunk + piece, std::move(pieces[piece]));
+				starts.InsertPartition(chunk + piece, bounds[piece]);
+			}
+		}
+		return data;
+	}
+
+	/// There is no gap: returns the length so that callers treat all positions as before the gap.
+	ptrdiff_t GapPosition() const noexcept {
+		return lengthBody;
+	}
+
+	/// Return a pointer to the chunk that contains position, without rearranging the buffer.
+	/// start and length are set to the position and length of the chunk.
+	/// Returns nullptr when position is outside the buffer.
+	const T *ContiguousRange(ptrdiff_t position, ptrdiff_t &start, ptrdiff_t &length) const noexcept {
+		if ((position < 0) || (position >= lengthBody)) {
+			start = position;
+			length = 0;
+			return nullptr;
+		}
+		const ptrdiff_t chunk = starts.PartitionFromPosition(position);
+		const Chunk &c = *chunks.ValueAt(chunk);
+		start = starts.PositionFromPartition(chunk);
+		length = c.size();
+		return c.data();
+	}
+
+	/// Storage is allocated per chunk as needed so only checks the argument.
+	void ReAllocate(ptrdiff_t newSize) {
+		if (newSize < 0)
+			throw std::runtime_error("ChunkedVector::ReAllocate: negative size.");
+	}
+
+	/// Return a copy that shares chunks with this buffer. Either may then be modified without
+	/// affecting the other, copying only the chunks that are modified.
+	std::unique_ptr<ChunkedVector<T>> Snapshot() const {
+		std::unique_ptr<ChunkedVector<T>> copy = std::make_unique<ChunkedVector<T>>();
+		copy->chunks[0] = chunks.ValueAt(0);
+		copy->starts.InsertText(0, lengthBody);
+		for (ptrdiff_t chunk = 1; chunk < chunks.Length(); chunk++) {
+			copy->chunks.Insert(chunk, chunks.ValueAt(chunk));
+			copy->starts.InsertPartition(chunk, starts.PositionFromPartition(chunk));
+		}
+		copy->lengthBody = lengthBody;
+		return copy;
+	}
+};
+
+}
+
+#endif
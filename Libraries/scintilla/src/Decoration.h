@@ -37,6 +37,8 @@ public:
 
 	// Returns with changed=true if some values may have changed
 	virtual FillResult<Sci::Position> FillRange(Sci::Position position, int value, Sci::Position fillLength) = 0;
+	// ranges holds count pairs of position and length, sorted by position, not overlapping nor empty
+	virtual FillResult<Sci::Position> FillRanges(const Sci::Position *ranges, size_t count, int value) = 0;
 	virtual void InsertSpace(Sci::Position position, Sci::Position insertLength) = 0;
 	virtual void DeleteRange(Sci::Position position, Sci::Position deleteLength) = 0;
 	virtual void DeleteLexerDecorations() = 0;
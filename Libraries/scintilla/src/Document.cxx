@@ -20,6 +20,10 @@
 #include <algorithm>
 #include <memory>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #ifndef NO_CXX11_REGEX
 #include <regex>
@@ -36,6 +40,7 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "ChunkedVector.h"
 #include "RunStyles.h"
 #include "CellBuffer.h"
 #include "PerLine.h"
@@ -43,17 +48,35 @@
 #include "Decoration.h"
 #include "CaseFolder.h"
 #include "Document.h"
+#include "BackgroundStyler.h"
+#include "SearchFilter.h"
 #include "RESearch.h"
+#ifndef NO_PCRE2_REGEX
+#include "Pcre2Search.h"
+#endif
 #include "UniConversion.h"
 #include "ElapsedPeriod.h"
 
 using namespace Scintilla;
 
+namespace {
+
+// Idle styling waits this long for styles from the other thread rather than returning at once
+constexpr int backgroundWait = 10;
+// A snapshot for styling in the background copies from this many lines before where styling starts
+// to this many bytes after where it ends, as lexers look a little back and ahead
+constexpr Sci::Line snapshotLinesBefore = 1000;
+constexpr Sci::Position snapshotBytesAfter = 0x10000;
+
+}
+
 void LexInterface::Colourise(Sci::Position start, Sci::Position end) {
 	if(pdoc && instance && !performingStyle) {
 		// Protect against reentrance, which may occur, for example, when
 		// fold points are discovered while performing styling and the folding
 		// code looks for child lines which may trigger styling.
+		// The lexer must not be used by another thread at the same time.
+		pdoc->StopBackgroundStyling();
 		performingStyle = true;
 
 		const Sci::Position lengthDoc = pdoc->Length();
@@ -107,7 +130,8 @@ double ActionDuration::Duration() const noexcept {
 }
 
 Document::Document(int options) :
-	cb((options& SC_DOCUMENTOPTION_STYLES_NONE) == 0, (options& SC_DOCUMENTOPTION_TEXT_LARGE) != 0),
+	cb((options& SC_DOCUMENTOPTION_STYLES_NONE) == 0, (options& SC_DOCUMENTOPTION_TEXT_LARGE) != 0,
+		(options& SC_DOCUMENTOPTION_CHUNKED) != 0),
 	durationStyleOneLine(0.00001, 0.000001, 0.0001) {
 	refCount = 0;
 #ifdef _WIN32
@@ -178,6 +202,13 @@ void Document::InsertLine(Sci::Line line) {
 	}
 }
 
+void Document::InsertLines(Sci::Line line, Sci::Line lines) {
+	for(const std::unique_ptr<PerLine>& pl : perLineData) {
+		if(pl)
+			pl->InsertLines(line, lines);
+	}
+}
+
 void Document::RemoveLine(Sci::Line line) {
 	for(const std::unique_ptr<PerLine>& pl : perLineData) {
 		if(pl)
@@ -294,7 +325,7 @@ void Document::TentativeUndo() {
 						modFlags |= SC_MULTILINEUNDOREDO;
 				}
 				NotifyModified(DocModification(modFlags, action.position, action.lenData,
-					linesAdded, action.data.get()));
+					linesAdded, action.data));
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -404,6 +435,28 @@ Sci_Position SCI_METHOD Document::LineEnd(Sci_Position line) const {
 	}
 }
 
+bool Document::SetUndoCollection(bool collectUndo) {
+	const bool inGroup = InUndoGroup();
+	const bool collecting = cb.SetUndoCollection(collectUndo);
+	// Any undo group is dropped, which ends it as EndUndoAction does
+	if(inGroup) {
+		for(const WatcherWithUserData& watcher : watchers) {
+			watcher.watcher->NotifyGroupCompleted(this, watcher.userData);
+		}
+	}
+	return collecting;
+}
+
+void Document::EndUndoAction() {
+	cb.EndUndoAction();
+	if(!InUndoGroup()) {
+		// Tell the watchers the outermost undo group has ended.
+		for(const WatcherWithUserData& watcher : watchers) {
+			watcher.watcher->NotifyGroupCompleted(this, watcher.userData);
+		}
+	}
+}
+
 void SCI_METHOD Document::SetErrorStatus(int status) {
 	// Tell the watchers an error has occurred.
 	for(const WatcherWithUserData& watcher : watchers) {
@@ -466,12 +519,14 @@ int SCI_METHOD Document::SetLevel(Sci_Position line, int level) {
 }
 
 bool SCI_METHOD Document::Sci_SetFoldLevels(int line, int lineTo, int len, int* a) {
-	bool R = false;
 	//code like in LexCPP.cxx function Fold().
 	auto levels = Levels();
 	int levelCurrent = line == 0 ? SC_FOLDLEVELBASE : levels->GetLevel((Sci::Line)line - 1) >> 16;
 	int levelNext = levelCurrent;
 	int nLines = (int)LinesTotal();
+	//The levels are set without notifications. Then one notification tells the lines from the first to the last changed one.
+	Sci::Line lineFirstChanged = -1, lineLastChanged = -1;
+	std::vector<int> levelsPrev;
 	for(int i = 0; line < lineTo; line++) {
 		int eol = (int)this->LineStart((Sci::Line)line + 1);
 		if(a != nullptr) for(; i < len && (a[i] & 0x7fffffff) < eol; i++) levelNext += (a[i] & 0x80000000) ? -1 : 1;
@@ -482,13 +537,24 @@ bool SCI_METHOD Document::Sci_SetFoldLevels(int line, int lineTo, int len, int*
 		auto prevLevel = levels->GetLevel(line);
 		if(lev != prevLevel) {
 			//Platform::DebugPrintf("0x%x  0x%x", (int)prevLevel, (int)lev);
-			if(prevLevel <= SC_FOLDLEVELBASE)levels->SetLevel(line, lev, nLines); //first folding. Slightly faster, but does not show hidden lines when header unset, etc.
-			else SetLevel(line, lev);
-			R = true;
+			levels->SetLevel(line, lev, nLines);
+			if(lineFirstChanged < 0) lineFirstChanged = line;
+			lineLastChanged = line;
 		}
+		if(lineFirstChanged >= 0) levelsPrev.push_back(prevLevel);
 		levelCurrent = levelNext;
 	}
-	return R;
+	if(lineFirstChanged < 0) return false;
+
+	levelsPrev.resize(lineLastChanged - lineFirstChanged + 1);
+	DocModification mh(SC_MOD_CHANGEFOLD | SC_MOD_CHANGEMARKER | SC_MOD_CHANGEFOLDLINES,
+		LineStart(lineFirstChanged), 0, 0, nullptr, lineFirstChanged);
+	mh.foldLevelNow = levels->GetLevel(lineFirstChanged);
+	mh.foldLevelPrev = levelsPrev.front();
+	mh.foldLines = levelsPrev.size();
+	mh.foldLevelsPrev = levelsPrev.data();
+	NotifyModified(mh);
+	return true;
 }
 
 int SCI_METHOD Document::GetLevel(Sci_Position line) const {
@@ -990,6 +1056,15 @@ int SCI_METHOD Document::GetCharacterAndWidth(Sci_Position position, Sci_Positio
 	return character;
 }
 
+const char* SCI_METHOD Document::ContiguousRange(Sci_Position position, Sci_Position* start, Sci_Position* length) const {
+	Sci::Position startRange = 0;
+	Sci::Position lengthRange = 0;
+	const char* text = cb.ContiguousRange(position, startRange, lengthRange);
+	*start = startRange;
+	*length = lengthRange;
+	return text;
+}
+
 int SCI_METHOD Document::CodePage() const {
 	return dbcsCodePage;
 }
@@ -1176,6 +1251,8 @@ EncodingFamily Document::CodePageFamily() const noexcept {
 void Document::ModifiedAt(Sci::Position pos) noexcept {
 	if(endStyled > pos)
 		endStyled = pos;
+	if(background)
+		background->Invalidate(pos);
 }
 
 void Document::CheckReadOnly() {
@@ -1278,6 +1355,40 @@ Sci::Position Document::InsertString(Sci::Position position, const char* s, Sci:
 	return insertLength;
 }
 
+bool Document::SetMappedText(std::unique_ptr<IMappedText> mappedText) {
+	return cb.SetMappedText(std::move(mappedText));
+}
+
+// Scanning this much text for line ends takes some milliseconds, so steps are done in idle time.
+constexpr Sci::Position mappedStep = 0x1000000;
+
+bool Document::ExtendMapped() {
+	if(enteredModification != 0) {
+		return cb.MappedPending() > 0;
+	}
+	const Sci::Position appendLength = cb.MappedStep(mappedStep);
+	if(appendLength <= 0) {
+		return false;
+	}
+	enteredModification++;
+	const Sci::Position position = Length();
+	NotifyModified(
+		DocModification(
+			SC_MOD_BEFOREINSERT | SC_PERFORMED_USER,
+			position, appendLength,
+			0, nullptr));
+	const Sci::Line prevLinesTotal = LinesTotal();
+	const char* text = cb.AppendMapped(appendLength);
+	ModifiedAt(position);
+	NotifyModified(
+		DocModification(
+			SC_MOD_INSERTTEXT | SC_PERFORMED_USER,
+			position, appendLength,
+			LinesTotal() - prevLinesTotal, text));
+	enteredModification--;
+	return cb.MappedPending() > 0;
+}
+
 void Document::ChangeInsertion(const char* s, Sci::Position length) {
 	insertionSet = true;
 	insertion.assign(s, length);
@@ -1374,7 +1485,7 @@ Sci::Position Document::Undo() {
 						modFlags |= SC_MULTILINEUNDOREDO;
 				}
 				NotifyModified(DocModification(modFlags, action.position, action.lenData,
-					linesAdded, action.data.get()));
+					linesAdded, action.data));
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -1434,7 +1545,7 @@ Sci::Position Document::Redo() {
 				}
 				NotifyModified(
 					DocModification(modFlags, action.position, action.lenData,
-						linesAdded, action.data.get()));
+						linesAdded, action.data));
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -1681,6 +1792,7 @@ void Document::ConvertLineEnds(int eolModeSet) {
 
 int Document::Options() const {
 	return (IsLarge() ? SC_DOCUMENTOPTION_TEXT_LARGE : 0) |
+		(cb.IsChunked() ? SC_DOCUMENTOPTION_CHUNKED : 0) |
 		(cb.HasStyles() ? 0 : SC_DOCUMENTOPTION_STYLES_NONE);
 }
 
@@ -1994,13 +2106,162 @@ Document::CharacterExtracted Document::ExtractCharacter(Sci::Position position)
 	}
 }
 
+namespace {
+
+/**
+ * Calls matchAt for each position in [minCandidate, maxCandidate] that passes filter, in search order,
+ * until it returns true. Scans the text before and after the gap directly, without moving the gap.
+ * Returns the matching position or -1.
+ */
+template<typename MatchAt>
+Sci::Position ScanCandidates(const Document *pdoc, const SearchFilter &filter, bool forward,
+	Sci::Position minCandidate, Sci::Position maxCandidate, MatchAt matchAt) {
+	while(minCandidate <= maxCandidate) {
+		const Sci::Position pos = forward ? minCandidate : maxCandidate;
+		Sci::Position startRange = 0;
+		Sci::Position lengthRange = 0;
+		const char *range = pdoc->ContiguousRange(pos, startRange, lengthRange);
+		if(!range)
+			break;
+		const Sci::Position endRange = startRange + lengthRange;
+		if(forward) {
+			const Sci::Position end = std::min(endRange, maxCandidate + 1);
+			const Sci::Position index = filter.Forward(range + (pos - startRange), end - pos, endRange - pos);
+			if(index < 0) {
+				minCandidate = end;
+			} else {
+				if(matchAt(pos + index))
+					return pos + index;
+				minCandidate = pos + index + 1;
+			}
+		} else {
+			const Sci::Position start = std::max(startRange, minCandidate);
+			const Sci::Position index = filter.Backward(range + (start - startRange), pos - start + 1, endRange - start);
+			if(index < 0) {
+				maxCandidate = start - 1;
+			} else {
+				if(matchAt(start + index))
+					return start + index;
+				maxCandidate = start + index - 1;
+			}
+		}
+	}
+	return -1;
+}
+
+/**
+ * Computes the set of bytes that may start a document character whose folded form starts with the
+ * folded byte ch. Single bytes are folded with pcf. With UTF-8, lead bytes are all included
+ * as multi-byte characters may fold to anything, such as KELVIN SIGN to 'k'.
+ * Returns false if the set can not be represented by SearchFilter::ByteSet.
+ */
+bool FoldedByteSet(CaseFolder *pcf, char ch, bool utf8, SearchFilter::ByteSet &set) {
+	int count = 0;
+	unsigned char bytes[2] = { 0xC0, 0xC0 };
+	for(int b = 0; b < (utf8 ? 0xC0 : 0x100); b++) {
+		const char mixed = static_cast<char>(b);
+		char folded[8] = "";
+		if(pcf->Fold(folded, sizeof(folded), &mixed, 1) != 1 || folded[0] != ch)
+			continue;
+		if((utf8 && UTF8IsTrailByte(static_cast<unsigned char>(b))) || count >= 2)
+			return false;	// Isolated trail byte or too many bytes
+		bytes[count++] = static_cast<unsigned char>(b);
+	}
+	if(count == 1)
+		bytes[1] = bytes[0];
+	set = SearchFilter::ByteSet(bytes[0], bytes[1], utf8);
+	return count > 0 || utf8;
+}
+
+// Searches shorter than this range use the character loops without a filter.
+constexpr Sci::Position minRangeFilter = 256;
+
+// Reports a verified match to sink. Returns true if the search ends at this match.
+inline bool EndsSearch(FindAllSink *sink, Sci::Position position, Sci::Position length) {
+	return !sink || !sink->Match(position, length);
+}
+
+}
+
 /**
  * Find text in document, supporting both forward and backward
  * searches (just pass minPos > maxPos to do a backward search)
  * Has not been tested with backwards DBCS searches yet.
+ * Large ranges are first scanned with a SearchFilter directly in the buffer, and only the
+ * candidate positions are checked character by character like with small ranges.
  */
 Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, const char* search,
 	int flags, Sci::Position* length) {
+	return FindText(minPos, maxPos, search, flags, length, nullptr);
+}
+
+/**
+ * Find all matches of literal or regular expression text in [minPos, maxPos), in one pass.
+ * Matches do not overlap. Each match is passed to sink, until sink returns false or maxMatches
+ * (if > 0) matches are found. Literal text is searched with a single FindText that reports all
+ * matches instead of returning the first, so the setup is done once.
+ * @return The number of matches.
+ */
+Sci::Position Document::FindAll(Sci::Position minPos, Sci::Position maxPos, const char* search, Sci::Position lengthSearch,
+	int flags, Sci::Position maxMatches, FindAllSink& sink) {
+	if(minPos > maxPos)
+		std::swap(minPos, maxPos);
+	// Matches must be inside the range, so don't let FindText extend it over a partial character
+	minPos = MovePositionOutsideChar(ClampPositionIntoDocument(minPos), 1, false);
+	maxPos = MovePositionOutsideChar(ClampPositionIntoDocument(maxPos), -1, false);
+	if(lengthSearch <= 0 || minPos > maxPos)
+		return 0;
+
+	class Counter : public FindAllSink {
+		FindAllSink& sink;
+		Sci::Position maxMatches;
+		Sci::Position endLast = 0;
+	public:
+		Sci::Position count = 0;
+		bool stopped = false;
+		Counter(FindAllSink& sink_, Sci::Position maxMatches_) noexcept : sink(sink_), maxMatches(maxMatches_) {
+		}
+		bool Match(Sci::Position position, Sci::Position length) override {
+			if(count > 0 && position < endLast)
+				return true;	// Overlaps the previous match
+			endLast = position + length;
+			count++;
+			stopped = !sink.Match(position, length) || (maxMatches > 0 && count >= maxMatches);
+			return !stopped;
+		}
+	};
+	Counter counter(sink, maxMatches);
+
+	if(flags & SCFIND_REGEXP) {
+		Sci::Position pos = minPos;
+		while(pos <= maxPos && !counter.stopped) {
+			Sci::Position lengthFound = lengthSearch;
+			const Sci::Position posFound = FindText(pos, maxPos, search, flags, &lengthFound, nullptr);
+			if(posFound < 0 || posFound + lengthFound > maxPos)
+				break;
+			counter.Match(posFound, lengthFound);
+			if(lengthFound > 0) {
+				pos = posFound + lengthFound;
+			} else {
+				// Empty match: continue from the next character
+				if(posFound >= maxPos)
+					break;
+				pos = NextPosition(posFound, 1);
+			}
+		}
+	} else {
+		Sci::Position lengthFound = lengthSearch;
+		FindText(minPos, maxPos, search, flags, &lengthFound, &counter);
+	}
+	return counter.count;
+}
+
+/**
+ * FindText that reports each match to sink (if not null), and continues searching
+ * while sink returns true.
+ */
+Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, const char* search,
+	int flags, Sci::Position* length, FindAllSink* sink) {
 	if(*length <= 0)
 		return minPos;
 	const bool caseSensitive = (flags & SCFIND_MATCHCASE) != 0;
@@ -2030,16 +2291,40 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			// Back all of a character
 			pos = NextPosition(pos, increment);
 		}
+		const bool filter = (limitPos - std::min(startPos, endPos)) >= minRangeFilter;
 		if(caseSensitive) {
 			const Sci::Position endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
 			const char charStartSearch = search[0];
+			// A match can only start inside a character when the search starts with a trail byte
+			if(filter && (!dbcsCodePage || (SC_CP_UTF8 == dbcsCodePage && !UTF8IsTrailByte(search[0])))) {
+				const SearchFilter::ByteSet second = (lengthFind > 1) ? SearchFilter::ByteSet(search[1]) : SearchFilter::ByteSet();
+				const SearchFilter sf(SearchFilter::ByteSet(charStartSearch), second);
+				return ScanCandidates(this, sf, forward,
+					forward ? startPos : endPos, forward ? endSearch - 1 : limitPos - lengthFind,
+					[&](Sci::Position posMatch) {
+					Sci::Position startRange = 0;
+					Sci::Position lengthRange = 0;
+					const char *range = ContiguousRange(posMatch, startRange, lengthRange);
+					bool found = true;
+					if(posMatch + lengthFind <= startRange + lengthRange) {
+						found = 0 == memcmp(range + (posMatch - startRange), search, lengthFind);
+					} else {
+						for(int indexSearch = 1; (indexSearch < lengthFind) && found; indexSearch++) {
+							found = CharAt(posMatch + indexSearch) == search[indexSearch];
+						}
+					}
+					return found && MatchesWordOptions(word, wordStart, posMatch, lengthFind) &&
+						EndsSearch(sink, posMatch, lengthFind);
+				});
+			}
 			while(forward ? (pos < endSearch) : (pos >= endSearch)) {
 				if(CharAt(pos) == charStartSearch) {
 					bool found = (pos + lengthFind) <= limitPos;
 					for(int indexSearch = 1; (indexSearch < lengthFind) && found; indexSearch++) {
 						found = CharAt(pos + indexSearch) == search[indexSearch];
 					}
-					if(found && MatchesWordOptions(word, wordStart, pos, lengthFind)) {
+					if(found && MatchesWordOptions(word, wordStart, pos, lengthFind) &&
+						EndsSearch(sink, pos, lengthFind)) {
 						return pos;
 					}
 				}
@@ -2053,9 +2338,10 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 				pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
 			char bytes[UTF8MaxBytes + 1] = "";
 			char folded[UTF8MaxBytes * maxFoldingExpansion + 1] = "";
-			while(forward ? (pos < endPos) : (pos >= endPos)) {
-				int widthFirstCharacter = 0;
-				Sci::Position posIndexDocument = pos;
+			// Checks whether the folded text at posMatch matches; then sets *length.
+			auto matchAt = [&](Sci::Position posMatch, int& widthFirstCharacter) {
+				widthFirstCharacter = 0;
+				Sci::Position posIndexDocument = posMatch;
 				size_t indexSearch = 0;
 				bool characterMatches = true;
 				for(;;) {
@@ -2086,11 +2372,30 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 						break;
 				}
 				if(characterMatches && (indexSearch == lenSearch)) {
-					if(MatchesWordOptions(word, wordStart, pos, posIndexDocument - pos)) {
-						*length = posIndexDocument - pos;
-						return pos;
+					if(MatchesWordOptions(word, wordStart, posMatch, posIndexDocument - posMatch) &&
+						EndsSearch(sink, posMatch, posIndexDocument - posMatch)) {
+						*length = posIndexDocument - posMatch;
+						return true;
 					}
 				}
+				return false;
+			};
+			SearchFilter::ByteSet first;
+			if(filter && lenSearch > 0 && FoldedByteSet(pcf.get(), searchThing[0], true, first)) {
+				SearchFilter::ByteSet second;
+				if(lenSearch < 2 || !FoldedByteSet(pcf.get(), searchThing[1], true, second))
+					second = SearchFilter::ByteSet();
+				int widthFirstCharacter = 0;
+				return ScanCandidates(this, SearchFilter(first, second), forward,
+					forward ? pos : endPos, forward ? endPos - 1 : pos,
+					[&](Sci::Position posMatch) {
+					return matchAt(posMatch, widthFirstCharacter);
+				});
+			}
+			while(forward ? (pos < endPos) : (pos >= endPos)) {
+				int widthFirstCharacter = 0;
+				if(matchAt(pos, widthFirstCharacter))
+					return pos;
 				if(forward) {
 					pos += widthFirstCharacter;
 				} else {
@@ -2127,7 +2432,8 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 					indexSearch += lenFlat;
 				}
 				if(characterMatches && (indexSearch == lenSearch)) {
-					if(MatchesWordOptions(word, wordStart, pos, indexDocument)) {
+					if(MatchesWordOptions(word, wordStart, pos, indexDocument) &&
+						EndsSearch(sink, pos, indexDocument)) {
 						*length = indexDocument;
 						return pos;
 					}
@@ -2139,15 +2445,27 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			const Sci::Position endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
 			std::vector<char> searchThing(lengthFind + 1);
 			pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
-			while(forward ? (pos < endSearch) : (pos >= endSearch)) {
-				bool found = (pos + lengthFind) <= limitPos;
+			auto matchAt = [&](Sci::Position posMatch) {
+				bool found = (posMatch + lengthFind) <= limitPos;
 				for(int indexSearch = 0; (indexSearch < lengthFind) && found; indexSearch++) {
-					const char ch = CharAt(pos + indexSearch);
+					const char ch = CharAt(posMatch + indexSearch);
 					char folded[2];
 					pcf->Fold(folded, sizeof(folded), &ch, 1);
 					found = folded[0] == searchThing[indexSearch];
 				}
-				if(found && MatchesWordOptions(word, wordStart, pos, lengthFind)) {
+				return found && MatchesWordOptions(word, wordStart, posMatch, lengthFind) &&
+					EndsSearch(sink, posMatch, lengthFind);
+			};
+			SearchFilter::ByteSet first;
+			if(filter && FoldedByteSet(pcf.get(), searchThing[0], false, first)) {
+				SearchFilter::ByteSet second;
+				if(lengthFind < 2 || !FoldedByteSet(pcf.get(), searchThing[1], false, second))
+					second = SearchFilter::ByteSet();
+				return ScanCandidates(this, SearchFilter(first, second), forward,
+					forward ? startPos : endPos, forward ? endSearch - 1 : limitPos - lengthFind, matchAt);
+			}
+			while(forward ? (pos < endSearch) : (pos >= endSearch)) {
+				if(matchAt(pos)) {
 					return pos;
 				}
 				if(!NextCharacter(pos, increment))
@@ -2178,6 +2496,61 @@ void Document::ReleaseLineCharacterIndex(int lineCharacterIndex) {
 	return cb.ReleaseLineCharacterIndex(lineCharacterIndex);
 }
 
+//Au
+void Document::UTF16FromPositions(int *positions, size_t count) {
+	cb.UTF16FromPositions(positions, count);
+}
+
+//Au
+void Document::PositionsFromUTF16(int *positions, size_t count) {
+	cb.PositionsFromUTF16(positions, count);
+}
+
+//Au
+//Gets the text from position up to end as UTF-16, a buffer at a time. See CellBuffer::GetUTF16Range.
+Sci::Position Document::GetUTF16Range(Sci::Position &position, Sci::Position end, wchar_t *buffer, Sci::Position bufferLength) const {
+	return cb.GetUTF16Range(position, end, buffer, bufferLength);
+}
+
+//Au
+//Inserts length code units of UTF-16 text at position and advances position past the inserted text.
+//The text is converted and inserted a piece at a time, so no UTF-8 copy of all the text is made.
+//A lead surrogate that ends the text is not inserted, so that it can be passed again with the rest of the text.
+//Returns the number of code units inserted. All pieces are one undo action.
+Sci::Position Document::InsertUTF16(Sci::Position &position, const wchar_t *s, Sci::Position length) {
+	constexpr Sci::Position lengthPiece = 0x10000;
+	UndoGroup ug(this, length > lengthPiece);
+	std::string piece;
+	Sci::Position converted = 0;
+	while(converted < length) {
+		Sci::Position end = std::min(converted + lengthPiece, length);
+		if(UTF16CharLength(s[end - 1]) == 2) {
+			// Not dividing a surrogate pair
+			if(end < length) end++;
+			else end--;
+		}
+		// UTF8FromUTF16 stops at NUL, so NUL characters are inserted alone
+		const Sci::Position endText = std::find(s + converted, s + end, L'\0') - s;
+		Sci::Position units = endText - converted;
+		if(units > 0) {
+			const std::wstring_view wsv(s + converted, units);
+			piece.resize(UTF8Length(wsv));
+			UTF8FromUTF16(wsv, &piece[0], piece.length());
+		} else if(endText < end) {
+			piece.assign(1, '\0');
+			units = 1;
+		} else {
+			break;
+		}
+		const Sci::Position inserted = InsertString(position, piece.c_str(), piece.length());
+		if(inserted <= 0)
+			break;
+		position += inserted;
+		converted += units;
+	}
+	return converted;
+}
+
 Sci::Line Document::LinesTotal() const noexcept {
 	return cb.Lines();
 }
@@ -2228,19 +2601,10 @@ bool SCI_METHOD Document::SetStyles(Sci_Position length, const char* styles) {
 		return false;
 	} else {
 		enteredStyling++;
-		bool didChange = false;
 		Sci::Position startMod = 0;
 		Sci::Position endMod = 0;
-		for(int iPos = 0; iPos < length; iPos++, endStyled++) {
-			PLATFORM_ASSERT(endStyled < Length());
-			if(cb.SetStyleAt(endStyled, styles[iPos])) {
-				if(!didChange) {
-					startMod = endStyled;
-				}
-				didChange = true;
-				endMod = endStyled;
-			}
-		}
+		const bool didChange = cb.SetStyles(endStyled, styles, length, startMod, endMod);
+		endStyled += length;
 		if(didChange) {
 			const DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
 				startMod, endMod - startMod + 1);
@@ -2255,9 +2619,13 @@ void Document::EnsureStyledTo(Sci::Position pos) {
 	if((enteredStyling == 0) && (pos > GetEndStyled())) {
 		IncrementStyleClock();
 		if(pli && !pli->UseContainerLexing()) {
-			const Sci::Line lineEndStyled = SciLineFromPosition(GetEndStyled());
-			const Sci::Position endStyledTo = LineStart(lineEndStyled);
-			pli->Colourise(endStyledTo, pos);
+			// Styles found on another thread may already reach pos
+			MergeBackgroundStyling(0);
+			if(pos > GetEndStyled()) {
+				const Sci::Line lineEndStyled = SciLineFromPosition(GetEndStyled());
+				const Sci::Position endStyledTo = LineStart(lineEndStyled);
+				pli->Colourise(endStyledTo, pos);
+			}
 		} else {
 			// Ask the watchers to style, and stop as soon as one responds.
 			for(std::vector<WatcherWithUserData>::iterator it = watchers.begin();
@@ -2276,6 +2644,109 @@ void Document::StyleToAdjustingLineDuration(Sci::Position pos) {
 	durationStyleOneLine.AddSample(lineLast - lineFirst, epStyling.Duration());
 }
 
+void Document::SetBackgroundStyling(bool on) {
+	if(!on) {
+		background.reset();
+	} else if(!background) {
+		background = std::make_unique<BackgroundStyler>();
+	}
+}
+
+// Copies the lines around the text styled from startStyling to endStyling, or all lines when whole.
+std::unique_ptr<DocumentSnapshot> Document::Snapshot(Sci::Position startStyling, Sci::Position endStyling, bool whole) {
+	const Sci::Line lineFirst = whole ? 0 : std::max<Sci::Line>(SciLineFromPosition(startStyling) - snapshotLinesBefore, 0);
+	const Sci::Line lineLast = whole ? LinesTotal() : SciLineFromPosition(std::min(endStyling + snapshotBytesAfter, Length())) + 1;
+	const Sci::Position startLines = LineStart(lineFirst);
+	const Sci::Position endLines = LineStart(lineLast);
+	const Sci::Line linesCopied = SciLineFromPosition(endLines) + 1 - lineFirst;
+	std::vector<int> lineStates(std::clamp<Sci::Line>(GetMaxLineState() - lineFirst, 0, linesCopied));
+	for(size_t index = 0; index < lineStates.size(); index++) {
+		lineStates[index] = GetLineState(lineFirst + index);
+	}
+	std::vector<int> levels(linesCopied);
+	for(size_t index = 0; index < levels.size(); index++) {
+		levels[index] = GetLevel(lineFirst + index);
+	}
+	// Mapped text does not change so is read where it is
+	std::unique_ptr<ChunkedVector<char>> text;
+	Sci::Position startText = startLines;
+	const char *textFixed = nullptr;
+	if(cb.IsMappedInPlace())
+		textFixed = cb.BufferPointer();
+	else
+		text = cb.TextSnapshot(startText, endLines);
+	Sci::Position startStyles = startLines;
+	std::unique_ptr<ChunkedVector<char>> styles = cb.StyleSnapshot(startStyles, startStyling);
+	return std::make_unique<DocumentSnapshot>(std::move(text), startText, textFixed, Length(),
+		std::move(styles), startStyles, startStyling, startLines, endLines, lineFirst,
+		std::move(lineStates), std::move(levels),
+		dbcsCodePage, (GetLineEndTypesActive() & SC_LINE_END_TYPE_UNICODE) != 0, tabInChars);
+}
+
+bool Document::StyleInBackground(Sci::Position pos) {
+	if(!background || !pli || pli->UseContainerLexing() || (enteredStyling != 0))
+		return false;
+	MergeBackgroundStyling(0);
+	if(pos <= GetEndStyled())
+		return true;
+	if(!background->Styling()) {
+		const Sci::Position start = LineStart(SciLineFromPosition(GetEndStyled()));
+		if(!background->Start(pli->Instance(), Snapshot(start, pos, background->Missed()), start, pos))
+			return false;
+	}
+	// Waiting a little for the other thread avoids calling this again at once
+	MergeBackgroundStyling(backgroundWait);
+	return true;
+}
+
+// Applies the pieces styled on the other thread, in order, while they continue from where styling ended.
+void Document::MergeBackgroundStyling(int millisecondsWait) {
+	if(!background || (enteredStyling != 0))
+		return;
+	const std::vector<StyledPiece> pieces = background->TakePieces(millisecondsWait);
+	for(const StyledPiece& piece : pieces) {
+		// Watchers may have changed the document while the previous piece was merged
+		if(!background || !background->Current(piece))
+			return;
+		if(piece.start != LineStart(SciLineFromPosition(GetEndStyled()))) {
+			background->Stop();
+			return;
+		}
+		IncrementStyleClock();
+		enteredStyling++;
+		for(const StyledPiece::LineValue& lineState : piece.lineStates) {
+			SetLineState(lineState.line, lineState.value);
+		}
+		const Sci::Position lengthStyles = piece.styles.length();
+		Sci::Position startMod = 0;
+		Sci::Position endMod = 0;
+		if(cb.SetStyles(piece.startStyles, piece.styles.data(), lengthStyles, startMod, endMod)) {
+			const DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
+				startMod, endMod - startMod + 1);
+			NotifyModified(mh);
+		}
+		endStyled = piece.startStyles + lengthStyles;
+		for(const StyledPiece::LineValue& level : piece.levels) {
+			SetLevel(level.line, level.value);
+		}
+		for(const StyledPiece::DecorationFill& fill : piece.decorations) {
+			DecorationSetCurrentIndicator(fill.indicator);
+			DecorationFillRange(fill.position, fill.value, fill.fillLength);
+		}
+		for(const StyledPiece::Range& range : piece.lexerStates) {
+			ChangeLexerState(range.start, range.end);
+		}
+		if(piece.errorStatus)
+			SetErrorStatus(piece.errorStatus);
+		enteredStyling--;
+	}
+}
+
+void Document::StopBackgroundStyling() noexcept {
+	if(background)
+		background->Stop();
+}
+
 void Document::LexerChanged() {
 	// Tell the watchers the lexer has changed.
 	for(const WatcherWithUserData& watcher : watchers) {
@@ -2288,6 +2759,7 @@ LexInterface* Document::GetLexInterface() const {
 }
 
 void Document::SetLexInterface(LexInterface* pLexInterface) {
+	StopBackgroundStyling();
 	pli.reset(pLexInterface);
 }
 
@@ -2326,11 +2798,49 @@ Sci::Line Document::MarginStyledTextNext(Sci::Line line, int style) {
 	if(line < 0) return 0;
 	const LineAnnotation* pla = Margins();
 	auto lt = LinesTotal();
+	if(style > 0) {
+		//lines with styles other than 0 are indexed
+		line = pla->StyleNext(line, style);
+		return line < lt ? line : -1;
+	}
 	for(; line < lt; line++) if(pla->Style(line) == style) return line;
 	return -1;
 	//info: this is 10 times faster than repeatedly calling SCI_MARGINGETSTYLE
 }
 
+//Au: new function
+Sci::Line Document::MarginStyledTextPrevious(Sci::Line line, int style) {
+	const LineAnnotation* pla = Margins();
+	line = std::min(line, LinesTotal() - 1);
+	if(style > 0) return pla->StylePrevious(line, style);
+	for(; line >= 0; line--) if(pla->Style(line) == style) return line;
+	return -1;
+}
+
+//Au: new function
+Sci::Line Document::MarginStyledLines(int style, int* lines) {
+	const LineAnnotation* pla = Margins();
+	auto lt = LinesTotal();
+	Sci::Line count = 0;
+	if(style > 0) {
+		const Sci::Line styled = pla->StyledLinesCount(style);
+		for(Sci::Line i = 0; i < styled; i++) {
+			const Sci::Line line = pla->StyledLine(style, i);
+			if(line >= lt) break;
+			if(lines) lines[count] = static_cast<int>(line);
+			count++;
+		}
+	} else {
+		for(Sci::Line line = 0; line < lt; line++) {
+			if(pla->Style(line) == style) {
+				if(lines) lines[count] = static_cast<int>(line);
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
 void Document::MarginSetText(Sci::Line line, const char* text) {
 	Margins()->SetText(line, text);
 	const DocModification mh(SC_MOD_CHANGEMARGIN, LineStart(line),
@@ -2419,6 +2929,48 @@ void SCI_METHOD Document::DecorationFillRange(Sci_Position position, int value,
 	}
 }
 
+//Au. Fills many ranges in one pass over the runs of the current indicator and notifies once.
+//	Ranges are clipped to the document; when not sorted by position or when overlapping they are sorted and joined.
+void Document::DecorationFillRanges(const Sci_IndicatorRange *ranges, size_t count, int value) {
+	const Sci::Position length = Length();
+	std::vector<Sci::Position> fills;
+	fills.reserve(2 * count);
+	bool sorted = true;
+	for(size_t i = 0; i < count; i++) {
+		const Sci::Position start = std::clamp<Sci::Position>(ranges[i].position, 0, length);
+		const Sci::Position end = std::clamp<Sci::Position>(ranges[i].position + ranges[i].length, start, length);
+		if(end > start) {
+			if(!fills.empty() && (start < fills[fills.size() - 2] + fills.back()))
+				sorted = false;
+			fills.push_back(start);
+			fills.push_back(end - start);
+		}
+	}
+	if(!sorted) {
+		std::vector<std::pair<Sci::Position, Sci::Position>> spans;
+		for(size_t i = 0; i < fills.size(); i += 2) {
+			spans.emplace_back(fills[i], fills[i] + fills[i + 1]);
+		}
+		std::sort(spans.begin(), spans.end());
+		fills.clear();
+		for(const std::pair<Sci::Position, Sci::Position> &span : spans) {
+			if(!fills.empty() && (span.first <= fills[fills.size() - 2] + fills.back())) {
+				const Sci::Position start = fills[fills.size() - 2];
+				fills.back() = std::max(fills.back(), span.second - start);
+			} else {
+				fills.push_back(span.first);
+				fills.push_back(span.second - span.first);
+			}
+		}
+	}
+	const FillResult<Sci::Position> fr = decorations->FillRanges(fills.data(), fills.size() / 2, value);
+	if(fr.changed) {
+		const DocModification mh(SC_MOD_CHANGEINDICATOR | SC_PERFORMED_USER,
+			fr.position, fr.fillLength);
+		NotifyModified(mh);
+	}
+}
+
 bool Document::AddWatcher(DocWatcher* watcher, void* userData) {
 	const WatcherWithUserData wwud(watcher, userData);
 	std::vector<WatcherWithUserData>::iterator it =
@@ -2689,6 +3241,9 @@ public:
 private:
 	RESearch search;
 	std::string substituted;
+#ifndef NO_PCRE2_REGEX
+	std::unique_ptr<Pcre2Search> pcre2;
+#endif
 };
 
 namespace {
@@ -3145,6 +3700,14 @@ Sci::Position BuiltinRegex::FindText(Document* doc, Sci::Position minPos, Sci::P
 	bool caseSensitive, bool, bool, int flags,
 	Sci::Position* length) {
 
+#ifndef NO_PCRE2_REGEX
+	if(flags & SCFIND_PCRE2) {
+		if(!pcre2)
+			pcre2 = std::make_unique<Pcre2Search>();
+		return pcre2->FindText(doc, minPos, maxPos, s, caseSensitive, length, search);
+	}
+#endif
+
 #ifndef NO_CXX11_REGEX
 	if(flags & SCFIND_CXX11REGEX) {
 		return Cxx11RegexFindText(doc, minPos, maxPos, s,
@@ -17,6 +17,10 @@ class LineMarkers;
 class LineLevels;
 class LineState;
 class LineAnnotation;
+class DocumentSnapshot;
+class BackgroundStyler;
+class PositionCache;
+class LineLayoutCache;
 
 enum EncodingFamily { efEightBit, efUnicode, efDBCS };
 
@@ -102,6 +106,18 @@ public:
 /// Factory function for RegexSearchBase
 extern RegexSearchBase *CreateRegexSearch(CharClassify *charClassTable);
 
+/**
+ * Receives the matches found by Document::FindAll.
+ */
+class FindAllSink {
+public:
+	virtual ~FindAllSink() {}
+
+	/// Called for each match in document order.
+	///@return false to stop searching
+	virtual bool Match(Sci::Position position, Sci::Position length) = 0;
+};
+
 struct StyledText {
 	size_t length;
 	const char *text;
@@ -183,6 +199,9 @@ public:
 	bool UseContainerLexing() const noexcept {
 		return instance == nullptr;
 	}
+	ILexer4 *Instance() const noexcept {
+		return instance;
+	}
 };
 
 struct RegexError : public std::runtime_error {
@@ -211,7 +230,7 @@ public:
 
 /**
  */
-class Document : PerLine, public IDocument, public ILoader {
+class Document : PerLine, public IDocumentContiguous, public ILoader {
 
 public:
 	/** Used to pair watcher pointer with user data. */
@@ -255,6 +274,8 @@ private:
 	bool matchesValid;
 	std::unique_ptr<RegexSearchBase> regex;
 	std::unique_ptr<LexInterface> pli;
+	// After pli so that it stops using the lexer before the lexer is released
+	std::unique_ptr<BackgroundStyler> background;
 
 public:
 
@@ -284,6 +305,11 @@ public:
 
 	std::unique_ptr<IDecorationList> decorations;
 
+	/// The widths of text measured by the views of this document, which they share while any is alive.
+	std::weak_ptr<PositionCache> positionCacheShared;
+	/// The line layout caches of views of this document, each shared by the views laid out alike.
+	std::vector<std::weak_ptr<LineLayoutCache>> layoutCachesShared;
+
 	Document(int options);
 	// Deleted so Document objects can not be copied.
 	Document(const Document &) = delete;
@@ -298,6 +324,7 @@ public:
 	// From PerLine
 	void Init() override;
 	void InsertLine(Sci::Line line) override;
+	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
 
 	int LineEndTypesSupported() const;
@@ -307,7 +334,7 @@ public:
 	int GetLineEndTypesActive() const { return cb.GetLineEndTypes(); }
 
 	int SCI_METHOD Version() const override {
-		return dvRelease4;
+		return dvContiguousRange;
 	}
 
 	void SCI_METHOD SetErrorStatus(int status) override;
@@ -343,18 +370,27 @@ public:
 	Sci::Position InsertString(Sci::Position position, const char *s, Sci::Position insertLength);
 	void ChangeInsertion(const char *s, Sci::Position length);
 	int SCI_METHOD AddData(const char *data, Sci_Position length) override;
+	/// Shows a read-only file mapped in memory. The document must be empty.
+	/// Text is added in steps by ExtendMapped so that the start of a large file can be shown quickly.
+	bool SetMappedText(std::unique_ptr<IMappedText> mappedText);
+	bool IsMapped() const { return cb.IsMapped(); }
+	/// Appends the next part of the mapped text, ending at a line end when possible.
+	/// Returns true if there is more to append.
+	bool ExtendMapped();
 	void * SCI_METHOD ConvertToDocument() override;
 	Sci::Position Undo();
 	Sci::Position Redo();
 	bool CanUndo() const { return cb.CanUndo(); }
 	bool CanRedo() const { return cb.CanRedo(); }
 	void DeleteUndoHistory() { cb.DeleteUndoHistory(); }
-	bool SetUndoCollection(bool collectUndo) {
-		return cb.SetUndoCollection(collectUndo);
-	}
+	bool SetUndoCollection(bool collectUndo);
 	bool IsCollectingUndo() const { return cb.IsCollectingUndo(); }
+	void SetUndoMemoryLimit(size_t limit) noexcept { cb.SetUndoMemoryLimit(limit); }
+	size_t GetUndoMemoryLimit() const noexcept { return cb.GetUndoMemoryLimit(); }
+	size_t UndoMemory() const noexcept { return cb.UndoMemory(); }
 	void BeginUndoAction() { cb.BeginUndoAction(); }
-	void EndUndoAction() { cb.EndUndoAction(); }
+	void EndUndoAction();
+	bool InUndoGroup() const noexcept { return cb.UndoSequenceDepth() > 0; }
 	void AddUndoAction(Sci::Position token, bool mayCoalesce) { cb.AddUndoAction(token, mayCoalesce); }
 	void SetSavePoint();
 	bool IsSavePoint() const { return cb.IsSavePoint(); }
@@ -367,6 +403,10 @@ public:
 	const char * SCI_METHOD BufferPointer() override { return cb.BufferPointer(); }
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) { return cb.RangePointer(position, rangeLength); }
 	Sci::Position GapPosition() const { return cb.GapPosition(); }
+	const char *ContiguousRange(Sci::Position position, Sci::Position &start, Sci::Position &length) const noexcept {
+		return cb.ContiguousRange(position, start, length);
+	}
+	const char * SCI_METHOD ContiguousRange(Sci_Position position, Sci_Position *start, Sci_Position *length) const override;
 
 	int SCI_METHOD GetLineIndentation(Sci_Position line) override;
 	Sci::Position SetLineIndentation(Sci::Line line, Sci::Position indent);
@@ -437,10 +477,16 @@ public:
 	bool HasCaseFolder() const noexcept;
 	void SetCaseFolder(CaseFolder *pcf_);
 	Sci::Position FindText(Sci::Position minPos, Sci::Position maxPos, const char *search, int flags, Sci::Position *length);
+	Sci::Position FindAll(Sci::Position minPos, Sci::Position maxPos, const char *search, Sci::Position lengthSearch,
+		int flags, Sci::Position maxMatches, FindAllSink &sink);
 	const char *SubstituteByPosition(const char *text, Sci::Position *length);
 	int LineCharacterIndex() const;
 	void AllocateLineCharacterIndex(int lineCharacterIndex);
 	void ReleaseLineCharacterIndex(int lineCharacterIndex);
+	void UTF16FromPositions(int *positions, size_t count); //Au
+	void PositionsFromUTF16(int *positions, size_t count); //Au
+	Sci::Position GetUTF16Range(Sci::Position &position, Sci::Position end, wchar_t *buffer, Sci::Position bufferLength) const; //Au
+	Sci::Position InsertUTF16(Sci::Position &position, const wchar_t *s, Sci::Position length); //Au
 	Sci::Line LinesTotal() const noexcept;
 
 	void SetDefaultCharClasses(bool includeWordClass);
@@ -454,11 +500,20 @@ public:
 	Sci::Position GetEndStyled() const noexcept { return endStyled; }
 	void EnsureStyledTo(Sci::Position pos);
 	void StyleToAdjustingLineDuration(Sci::Position pos);
+	/// Lexing on another thread, of a snapshot taken from startStyling, with the results merged into the document.
+	void SetBackgroundStyling(bool on);
+	bool BackgroundStyling() const noexcept { return background != nullptr; }
+	std::unique_ptr<DocumentSnapshot> Snapshot(Sci::Position startStyling, Sci::Position endStyling, bool whole);
+	/// Returns false if the lexer can not be run on another thread so styling should be done on this thread.
+	bool StyleInBackground(Sci::Position pos);
+	void MergeBackgroundStyling(int millisecondsWait);
+	void StopBackgroundStyling() noexcept;
 	void LexerChanged();
 	int GetStyleClock() const noexcept { return styleClock; }
 	void IncrementStyleClock() noexcept;
 	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) override;
 	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
+	void DecorationFillRanges(const Sci_IndicatorRange *ranges, size_t count, int value); //Au
 	LexInterface *GetLexInterface() const;
 	void SetLexInterface(LexInterface *pLexInterface);
 
@@ -471,6 +526,8 @@ public:
 	void MarginSetStyle(Sci::Line line, int style);
 	void MarginSetStyles(Sci::Line line, const unsigned char *styles);
 	Sci::Line MarginStyledTextNext(Sci::Line line, int style); //Au: new function
+	Sci::Line MarginStyledTextPrevious(Sci::Line line, int style); //Au: new function
+	Sci::Line MarginStyledLines(int style, int *lines); //Au: new function
 	void MarginSetText(Sci::Line line, const char *text);
 	void MarginClearAll();
 
@@ -497,6 +554,8 @@ public:
 	Sci::Position BraceMatch(Sci::Position position, Sci::Position maxReStyle);
 
 private:
+	Sci::Position FindText(Sci::Position minPos, Sci::Position maxPos, const char *search, int flags, Sci::Position *length,
+		FindAllSink *sink);
 	void NotifyModifyAttempt();
 	void NotifySavePoint(bool atSavePoint);
 	void NotifyModified(DocModification mh);
@@ -545,6 +604,8 @@ public:
 	int foldLevelPrev;
 	Sci::Line annotationLinesAdded;
 	Sci::Position token;
+	Sci::Line foldLines;	/**< With SC_MOD_CHANGEFOLDLINES, the lines from line with fold levels set. */
+	const int *foldLevelsPrev;	/**< With SC_MOD_CHANGEFOLDLINES, the levels of those lines before. */
 
 	DocModification(int modificationType_, Sci::Position position_=0, Sci::Position length_=0,
 		Sci::Line linesAdded_=0, const char *text_=nullptr, Sci::Line line_=0) noexcept :
@@ -557,19 +618,23 @@ public:
 		foldLevelNow(0),
 		foldLevelPrev(0),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		foldLines(0),
+		foldLevelsPrev(nullptr) {}
 
 	DocModification(int modificationType_, const Action &act, Sci::Line linesAdded_=0) noexcept :
 		modificationType(modificationType_),
 		position(act.position),
 		length(act.lenData),
 		linesAdded(linesAdded_),
-		text(act.data.get()),
+		text(act.data),
 		line(0),
 		foldLevelNow(0),
 		foldLevelPrev(0),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		foldLines(0),
+		foldLevelsPrev(nullptr) {}
 };
 
 /**
@@ -587,6 +652,7 @@ public:
 	virtual void NotifyStyleNeeded(Document *doc, void *userData, Sci::Position endPos) = 0;
 	virtual void NotifyLexerChanged(Document *doc, void *userData) = 0;
 	virtual void NotifyErrorOccurred(Document *doc, void *userData, int status) = 0;
+	virtual void NotifyGroupCompleted(Document *doc, void *userData) = 0;	//Au
 };
 
 }
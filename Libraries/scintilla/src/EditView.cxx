@@ -183,8 +183,9 @@ EditView::EditView() {
 	additionalCaretsBlink = true;
 	additionalCaretsVisible = true;
 	imeCaretBlockOverride = false;
-	llc.SetLevel(LineLayoutCache::llcCaret);
-	posCache.SetSize(0x400);
+	llc = std::make_shared<LineLayoutCache>();
+	llc->SetLevel(LineLayoutCache::llcCaret);
+	posCache = std::make_shared<PositionCache>();
 	tabArrowHeight = 4;
 	customDrawTabArrow = nullptr;
 	customDrawWrapMarker = nullptr;
@@ -255,6 +256,112 @@ void EditView::LinesAddedOrRemoved(Sci::Line lineOfPos, Sci::Line linesAdded) {
 	}
 }
 
+// Views of a document share its position cache, which is created with the size set for this view.
+void EditView::SharePositionCache(Document *pdoc) {
+	std::shared_ptr<PositionCache> shared = pdoc->positionCacheShared.lock();
+	if (!shared) {
+		shared = std::make_shared<PositionCache>();
+		shared->SetSize(posCache->GetSize());
+		pdoc->positionCacheShared = shared;
+	}
+	posCache = shared;
+}
+
+// The settings that layouts depend on, so views with equal keys may use each other's layouts.
+// The wrap width is not included as a layout is rewrapped to another width without measuring it again.
+// Empty when layouts are not shared: only caches of the whole document are, and tab stops are set per view.
+std::string EditView::LayoutKey(const EditModel &model, const ViewStyle &vs) const {
+	std::string key;
+	if (ldTabstops || (llc->GetLevel() != LineLayoutCache::llcDocument)) {
+		return key;
+	}
+	auto addValue = [&key](int value) {
+		key.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	};
+	for (const Style &style : vs.styles) {
+		key.append(style.fontName ? style.fontName : "");
+		key.push_back('\0');
+		addValue(style.weight);
+		addValue(style.italic);
+		addValue(style.size);
+		addValue(style.characterSet);
+		addValue(style.extraFontFlag);
+		addValue(style.caseForce);
+		addValue(style.visible);
+	}
+	// Fonts of equal specifications measure differently on screens of other resolutions
+	addValue(vs.lineHeight);
+	addValue(static_cast<int>(vs.aveCharWidth * 64));
+	addValue(static_cast<int>(vs.spaceWidth * 64));
+	addValue(vs.technology);
+	addValue(vs.zoomLevel);
+	addValue(vs.extraFontFlag);
+	addValue(vs.controlCharSymbol);
+	addValue(vs.viewEOL);
+	addValue(vs.edgeState);
+	addValue(vs.theEdge.column);
+	addValue(vs.wrapState);
+	addValue(vs.wrapVisualFlags);
+	addValue(vs.wrapVisualStartIndent);
+	addValue(vs.wrapIndentMode);
+	addValue(tabWidthMinimumPixels);
+	addValue(static_cast<int>(model.bidirectional));
+	addValue(llc->GetLevel());
+	const size_t budget = llc->GetBudget();
+	key.append(reinterpret_cast<const char *>(&budget), sizeof(budget));
+	key.append(model.reprs.Key());
+	return key;
+}
+
+// Gives this view a layout cache of its own before a change to how it lays out lines.
+void EditView::DetachLayoutCache() {
+	if (llc.use_count() > 1) {
+		std::shared_ptr<LineLayoutCache> own = std::make_shared<LineLayoutCache>();
+		own->SetLevel(llc->GetLevel());
+		own->SetBudget(llc->GetBudget());
+		llc = own;
+	} else {
+		llc->SetKey(std::string());
+	}
+}
+
+// Gives this view an empty layout cache that no document lists, as when it shows another document.
+void EditView::NewLayoutCache() {
+	std::shared_ptr<LineLayoutCache> own = std::make_shared<LineLayoutCache>();
+	own->SetLevel(llc->GetLevel());
+	own->SetBudget(llc->GetBudget());
+	llc = own;
+}
+
+// Views of a document laid out alike share a layout cache, so lines shown in each are only laid out once.
+void EditView::ShareLayoutCache(const EditModel &model, const ViewStyle &vs) {
+	const std::string key = LayoutKey(model, vs);
+	if (key == llc->GetKey()) {
+		return;
+	}
+	DetachLayoutCache();
+	if (key.empty()) {
+		return;
+	}
+	std::vector<std::weak_ptr<LineLayoutCache>> &shared = model.pdoc->layoutCachesShared;
+	shared.erase(std::remove_if(shared.begin(), shared.end(), [](const std::weak_ptr<LineLayoutCache> &cache) noexcept {
+		return cache.expired();
+	}), shared.end());
+	for (const std::weak_ptr<LineLayoutCache> &cache : shared) {
+		std::shared_ptr<LineLayoutCache> other = cache.lock();
+		if (other && (other != llc) && (other->GetKey() == key)) {
+			llc = other;
+			return;
+		}
+	}
+	llc->SetKey(key);
+	if (std::none_of(shared.begin(), shared.end(), [this](const std::weak_ptr<LineLayoutCache> &cache) {
+		return cache.lock() == llc;
+	})) {
+		shared.push_back(llc);
+	}
+}
+
 void EditView::DropGraphics(bool freeObjects) {
 	if (freeObjects) {
 		pixmapLine.reset();
@@ -338,7 +445,7 @@ LineLayout *EditView::RetrieveLineLayout(Sci::Line lineNumber, const EditModel &
 	const Sci::Position posLineEnd = model.pdoc->LineStart(lineNumber + 1);
 	PLATFORM_ASSERT(posLineEnd >= posLineStart);
 	const Sci::Line lineCaret = model.pdoc->SciLineFromPosition(model.sel.MainCaret());
-	return llc.Retrieve(lineNumber, lineCaret,
+	return llc->Retrieve(lineNumber, lineCaret,
 		static_cast<int>(posLineEnd - posLineStart), model.pdoc->GetStyleClock(),
 		model.LinesOnScreen() + 1, model.pdoc->LinesTotal());
 }
@@ -473,7 +580,7 @@ void EditView::LayoutLine(const EditModel &model, Sci::Line line, Surface *surfa
 					} else {
 						if (representationWidth <= 0.0) {
 							XYPOSITION positionsRepr[256];	// Should expand when needed
-							posCache.MeasureWidths(surface, vstyle, STYLE_CONTROLCHAR, ts.representation->stringRep.c_str(),
+							posCache->MeasureWidths(surface, vstyle, STYLE_CONTROLCHAR, ts.representation->stringRep.c_str(),
 								static_cast<unsigned int>(ts.representation->stringRep.length()), positionsRepr, model.pdoc);
 							representationWidth = positionsRepr[ts.representation->stringRep.length() - 1] + vstyle.ctrlCharPadding;
 						}
@@ -485,7 +592,7 @@ void EditView::LayoutLine(const EditModel &model, Sci::Line line, Surface *surfa
 						// Over half the segments are single characters and of these about half are space characters.
 						ll->positions[ts.start + 1] = vstyle.styles[ll->styles[ts.start]].spaceWidth;
 					} else {
-						posCache.MeasureWidths(surface, vstyle, ll->styles[ts.start], &ll->chars[ts.start],
+						posCache->MeasureWidths(surface, vstyle, ll->styles[ts.start], &ll->chars[ts.start],
 							ts.length, &ll->positions[ts.start + 1], model.pdoc);
 					}
 				}
@@ -640,7 +747,7 @@ Point EditView::LocationFromPosition(Surface *surface, const EditModel &model, S
 		posLineStart = model.pdoc->LineStart(lineDoc);
 	}
 	const Sci::Line lineVisible = model.pcs->DisplayFromDoc(lineDoc);
-	AutoLineLayout ll(llc, RetrieveLineLayout(lineDoc, model));
+	AutoLineLayout ll(*llc, RetrieveLineLayout(lineDoc, model));
 	if (surface && ll) {
 		LayoutLine(model, lineDoc, surface, vs, ll, model.wrapWidth);
 		const int posInLine = static_cast<int>(pos.Position() - posLineStart);
@@ -680,7 +787,7 @@ Range EditView::RangeDisplayLine(Surface *surface, const EditModel &model, Sci::
 	}
 	const Sci::Line lineDoc = model.pcs->DocFromDisplay(lineVisible);
 	const Sci::Position positionLineStart = model.pdoc->LineStart(lineDoc);
-	AutoLineLayout ll(llc, RetrieveLineLayout(lineDoc, model));
+	AutoLineLayout ll(*llc, RetrieveLineLayout(lineDoc, model));
 	if (surface && ll) {
 		LayoutLine(model, lineDoc, surface, vs, ll, model.wrapWidth);
 		const Sci::Line lineStartSet = model.pcs->DisplayFromDoc(lineDoc);
@@ -711,7 +818,7 @@ SelectionPosition EditView::SPositionFromLocation(Surface *surface, const EditMo
 		return SelectionPosition(canReturnInvalid ? INVALID_POSITION :
 			model.pdoc->Length());
 	const Sci::Position posLineStart = model.pdoc->LineStart(lineDoc);
-	AutoLineLayout ll(llc, RetrieveLineLayout(lineDoc, model));
+	AutoLineLayout ll(*llc, RetrieveLineLayout(lineDoc, model));
 	if (surface && ll) {
 		LayoutLine(model, lineDoc, surface, vs, ll, model.wrapWidth);
 		const Sci::Line lineStartSet = model.pcs->DisplayFromDoc(lineDoc);
@@ -762,7 +869,7 @@ SelectionPosition EditView::SPositionFromLocation(Surface *surface, const EditMo
 * This method is used for rectangular selections and does not work on wrapped lines.
 */
 SelectionPosition EditView::SPositionFromLineX(Surface *surface, const EditModel &model, Sci::Line lineDoc, int x, const ViewStyle &vs) {
-	AutoLineLayout ll(llc, RetrieveLineLayout(lineDoc, model));
+	AutoLineLayout ll(*llc, RetrieveLineLayout(lineDoc, model));
 	if (surface && ll) {
 		const Sci::Position posLineStart = model.pdoc->LineStart(lineDoc);
 		LayoutLine(model, lineDoc, surface, vs, ll, model.wrapWidth);
@@ -783,7 +890,7 @@ SelectionPosition EditView::SPositionFromLineX(Surface *surface, const EditModel
 Sci::Line EditView::DisplayFromPosition(Surface *surface, const EditModel &model, Sci::Position pos, const ViewStyle &vs) {
 	const Sci::Line lineDoc = model.pdoc->SciLineFromPosition(pos);
 	Sci::Line lineDisplay = model.pcs->DisplayFromDoc(lineDoc);
-	AutoLineLayout ll(llc, RetrieveLineLayout(lineDoc, model));
+	AutoLineLayout ll(*llc, RetrieveLineLayout(lineDoc, model));
 	if (surface && ll) {
 		LayoutLine(model, lineDoc, surface, vs, ll, model.wrapWidth);
 		const Sci::Position posLineStart = model.pdoc->LineStart(lineDoc);
@@ -800,7 +907,7 @@ Sci::Line EditView::DisplayFromPosition(Surface *surface, const EditModel &model
 
 Sci::Position EditView::StartEndDisplayLine(Surface *surface, const EditModel &model, Sci::Position pos, bool start, const ViewStyle &vs) {
 	const Sci::Line line = model.pdoc->SciLineFromPosition(pos);
-	AutoLineLayout ll(llc, RetrieveLineLayout(line, model));
+	AutoLineLayout ll(*llc, RetrieveLineLayout(line, model));
 	Sci::Position posRet = INVALID_POSITION;
 	if (surface && ll) {
 		const Sci::Position posLineStart = model.pdoc->LineStart(line);
@@ -2198,7 +2305,7 @@ void EditView::PaintText(Surface *surfaceWindow, const EditModel &model, PRectan
 			(vsDraw.braceBadLightIndicatorSet && (model.bracesMatchStyle == STYLE_BRACEBAD)));
 
 		Sci::Line lineDocPrevious = -1;	// Used to avoid laying out one document line multiple times
-		AutoLineLayout ll(llc, nullptr);
+		AutoLineLayout ll(*llc, nullptr);
 		std::vector<DrawPhase> phases;
 		if ((phasesDraw == phasesMultiple) && !bufferedDraw) {
 			for (DrawPhase phase = drawBack; phase <= drawCarets; phase = static_cast<DrawPhase>(phase * 2)) {
@@ -2385,8 +2492,11 @@ static ColourDesired InvertedLight(ColourDesired orig) noexcept {
 
 Sci::Position EditView::FormatRange(bool draw, const Sci_RangeToFormat *pfr, Surface *surface, Surface *surfaceMeasure,
 	const EditModel &model, const ViewStyle &vs) {
-	// Can't use measurements cached for screen
-	posCache.Clear();
+	// Can't use measurements cached for screen, so measure with a cache of its own
+	// leaving the one shared with the other views of the document as it is
+	const std::shared_ptr<PositionCache> posCacheScreen = posCache;
+	posCache = std::make_shared<PositionCache>();
+	posCache->SetSize(posCacheScreen->GetSize());
 
 	ViewStyle vsPrint(vs);
 	vsPrint.technology = SC_TECHNOLOGY_DEFAULT;
@@ -2561,8 +2671,8 @@ Sci::Position EditView::FormatRange(bool draw, const Sci_RangeToFormat *pfr, Sur
 		++lineDoc;
 	}
 
-	// Clear cache so measurements are not used for screen
-	posCache.Clear();
+	// Drop the cache so measurements are not used for screen
+	posCache = posCacheScreen;
 
 	return nPrintPos;
 }
@@ -78,8 +78,8 @@ public:
 	std::unique_ptr<Surface> pixmapIndentGuide;
 	std::unique_ptr<Surface> pixmapIndentGuideHighlight;
 
-	LineLayoutCache llc;
-	PositionCache posCache;
+	std::shared_ptr<LineLayoutCache> llc;
+	std::shared_ptr<PositionCache> posCache;
 
 	int tabArrowHeight; // draw arrow heads this many pixels above/below line midpoint
 	/** Some platforms, notably PLAT_CURSES, do not support Scintilla's native
@@ -107,6 +107,11 @@ public:
 	bool AddTabstop(Sci::Line line, int x);
 	int GetNextTabstop(Sci::Line line, int x) const;
 	void LinesAddedOrRemoved(Sci::Line lineOfPos, Sci::Line linesAdded);
+	void SharePositionCache(Document *pdoc);
+	std::string LayoutKey(const EditModel &model, const ViewStyle &vs) const;
+	void DetachLayoutCache();
+	void NewLayoutCache();
+	void ShareLayoutCache(const EditModel &model, const ViewStyle &vs);
 
 	void DropGraphics(bool freeObjects);
 	void AllocateGraphics(const ViewStyle &vsDraw);
@@ -21,7 +21,11 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include "Platform.h"
 
@@ -56,11 +60,17 @@
 #include "EditView.h"
 #include "Editor.h"
 #include "ElapsedPeriod.h"
+#include "BackgroundWrapper.h"
 
 using namespace Scintilla;
 
 namespace {
 
+// Lines wrapped on another thread are copied a batch at a time
+constexpr Sci::Line wrapBatchLines = 0x10000;
+constexpr Sci::Position wrapBatchLength = 0x100000;
+constexpr int backgroundWrapWait = 10;
+
 /*
 	return whether this modification represents an operation that
 	may reasonably be deferred (not done now OR [possibly] at all)
@@ -185,11 +195,14 @@ Editor::Editor() : durationWrapOneLine(0.00001, 0.000001, 0.0001) {
 	willRedrawAll = false;
 	idleStyling = SC_IDLESTYLING_NONE;
 	needIdleStyling = false;
+	backgroundWrapping = false;
 
 	modEventMask = SC_MODEVENTMASKALL;
 	commandEvents = true;
+	batchModified = false;
 
 	pdoc->AddWatcher(this, 0);
+	view.SharePositionCache(pdoc);
 
 	recordingMacro = false;
 	foldAutomatic = 0;
@@ -278,8 +291,8 @@ void Editor::InvalidateStyleData() {
 	vs.technology = technology;
 	DropGraphics(false);
 	AllocateGraphics();
-	view.llc.Invalidate(LineLayout::llInvalid);
-	view.posCache.Clear();
+	view.DetachLayoutCache(); //Au: until RefreshStyleData shares layouts made with the new settings
+	view.llc->Invalidate(LineLayout::llInvalid);
 }
 
 void Editor::InvalidateStyleRedraw() {
@@ -295,6 +308,7 @@ void Editor::RefreshStyleData() {
 		if(surface) {
 			vs.Refresh(*surface, pdoc->tabInChars);
 		}
+		view.ShareLayoutCache(*this, vs); //Au
 		SetScrollBars();
 		SetRectangularRange();
 	}
@@ -850,7 +864,7 @@ void Editor::MovedCaret(SelectionPosition newPos, SelectionPosition previousPos,
 	if(ensureVisible) {
 		// In case in need of wrapping to ensure DisplayFromDoc works.
 		if(currentLine >= wrapPending.start) {
-			if(WrapLines(WrapScope::wsAll)) {
+			if(WrapLines(backgroundWrapping ? WrapScope::wsNear : WrapScope::wsAll, currentLine)) {
 				Redraw();
 			}
 		}
@@ -1474,8 +1488,13 @@ bool Editor::Wrapping() const noexcept {
 
 void Editor::NeedWrapping(Sci::Line docLineStart, Sci::Line docLineEnd) {
 //Platform::DebugPrintf("\nNeedWrapping: %0d..%0d\n", docLineStart, docLineEnd);
-	if(wrapPending.AddRange(docLineStart, docLineEnd)) {
-		view.llc.Invalidate(LineLayout::llPositions);
+	if(wrapPending.AddRange(docLineStart, docLineEnd) && (view.llc.use_count() == 1)) {
+		//Au: a layout made at another width is rewrapped when laid out, and views sharing a cache have
+		// the same wrap settings, so only a cache of this view alone drops its wrapping here
+		view.llc->Invalidate(LineLayout::llPositions);
+	}
+	if(backgroundWrapper) {
+		backgroundWrapper->Invalidate(docLineStart);
 	}
 	// Wrap lines during idle.
 	if(Wrapping() && wrapPending.NeedsWrap()) {
@@ -1484,7 +1503,7 @@ void Editor::NeedWrapping(Sci::Line docLineStart, Sci::Line docLineEnd) {
 }
 
 bool Editor::WrapOneLine(Surface* surface, Sci::Line lineToWrap) {
-	AutoLineLayout ll(view.llc, view.RetrieveLineLayout(lineToWrap, *this));
+	AutoLineLayout ll(*view.llc, view.RetrieveLineLayout(lineToWrap, *this));
 	int linesWrapped = 1;
 	if(ll) {
 		view.LayoutLine(*this, lineToWrap, surface, vs, ll, wrapWidth);
@@ -1498,8 +1517,9 @@ bool Editor::WrapOneLine(Surface* surface, Sci::Line lineToWrap) {
 // wsAll: wrap all lines which need wrapping in this single call
 // wsVisible: wrap currently visible lines
 // wsIdle: wrap one page + 100 lines
+// wsNear: wrap the lines within a page of lineNear
 // Return true if wrapping occurred.
-bool Editor::WrapLines(WrapScope ws) {
+bool Editor::WrapLines(WrapScope ws, Sci::Line lineNear) {
 	Sci::Line goodTopLine = topLine;
 	bool wrapOccurred = false;
 	if(!Wrapping()) {
@@ -1541,6 +1561,13 @@ bool Editor::WrapLines(WrapScope ws) {
 				// Currently visible text does not need wrapping
 				return false;
 			}
+		} else if(ws == WrapScope::wsNear) {
+			// The lines that may be shown when lineNear is scrolled into view
+			lineToWrap = std::clamp(lineNear - LinesOnScreen(), wrapPending.start, pdoc->LinesTotal());
+			lineToWrapEnd = lineNear + LinesOnScreen() + 1;
+			if((lineToWrap > wrapPending.end) || (lineToWrapEnd < wrapPending.start)) {
+				return false;
+			}
 		} else if(ws == WrapScope::wsIdle) {
 			// Try to keep time taken by wrapping reasonable so interaction remains smooth.
 			const double secondsAllowed = 0.01;
@@ -1597,6 +1624,69 @@ bool Editor::WrapLines(WrapScope ws) {
 	return wrapOccurred;
 }
 
+// Wrap the lines needing wrapping a batch at a time on another thread, setting the heights
+// of the lines wrapped so far.
+// Return false when the lines are to be wrapped on this thread instead.
+bool Editor::WrapInBackground() {
+	// Custom tab stops and Unicode line ends are not copied for the thread
+	if(!backgroundWrapping || !wMain.GetID() || view.ldTabstops ||
+		(pdoc->GetLineEndTypesActive() != SC_LINE_END_TYPE_DEFAULT)) {
+		return false;
+	}
+	if(!backgroundWrapper) {
+		backgroundWrapper = std::make_unique<BackgroundWrapper>();
+	}
+	wrapPending.start = std::min(wrapPending.start, pdoc->LinesTotal());
+	const Sci::Line lineDocTop = pcs->DocFromDisplay(topLine);
+	const Sci::Line subLineTop = topLine - pcs->DisplayFromDoc(lineDocTop);
+	bool wrapOccurred = false;
+	const std::vector<WrappedPiece> pieces = backgroundWrapper->TakePieces(backgroundWrapWait);
+	for(const WrappedPiece& piece : pieces) {
+		if(piece.lineStart > wrapPending.start)
+			break;
+		// Lines before wrapPending.start may have been wrapped here while the thread wrapped them
+		const Sci::Line lineEndPiece = std::min(piece.lineStart + static_cast<Sci::Line>(piece.lines.size()),
+			pdoc->LinesTotal());
+		for(Sci::Line line = wrapPending.start; line < lineEndPiece; line++) {
+			if(pcs->SetHeight(line, piece.lines[line - piece.lineStart] +
+				(vs.annotationVisible ? pdoc->AnnotationLines(line) : 0))) {
+				wrapOccurred = true;
+			}
+			wrapPending.Wrapped(line);
+		}
+	}
+
+	const Sci::Line lineEndNeedWrap = std::min(wrapPending.end, pdoc->LinesTotal());
+	if(wrapPending.start >= lineEndNeedWrap) {
+		wrapPending.Reset();
+	} else if(!backgroundWrapper->Wrapping()) {
+		const Sci::Line lineStart = wrapPending.start;
+		const Sci::Position positionEndBatch = pdoc->LineStart(lineStart) + wrapBatchLength;
+		Sci::Line lineEnd = std::min(lineEndNeedWrap, lineStart + wrapBatchLines);
+		lineEnd = std::clamp(pdoc->SciLineFromPosition(positionEndBatch), lineStart + 1, lineEnd);
+		// As WrapLines, lines are styled before they are wrapped
+		pdoc->EnsureStyledTo(pdoc->LineStart(lineEnd));
+		PRectangle rcTextArea = GetClientRectangle();
+		rcTextArea.left = static_cast<XYPOSITION>(vs.textStart);
+		rcTextArea.right -= vs.rightMarginWidth;
+		wrapWidth = static_cast<int>(rcTextArea.Width());
+		RefreshStyleData();
+		if(!backgroundWrapper->Start(
+			std::make_unique<WrapSnapshot>(*this, vs, view.tabWidthMinimumPixels, lineStart, lineEnd, wrapWidth),
+			std::unique_ptr<Surface>(Surface::Allocate(technology)), wMain.GetID())) {
+			return wrapOccurred;
+		}
+	}
+
+	if(wrapOccurred) {
+		SetScrollBars();
+		SetTopLine(std::clamp<Sci::Line>(pcs->DisplayFromDoc(lineDocTop) + std::min(
+			subLineTop, static_cast<Sci::Line>(pcs->GetHeight(lineDocTop) - 1)), 0, MaxScrollPos()));
+		SetVerticalScrollPos();
+	}
+	return true;
+}
+
 void Editor::LinesJoin() {
 	if(!RangeContainsProtected(targetStart, targetEnd)) {
 		UndoGroup ug(pdoc);
@@ -1639,7 +1729,7 @@ void Editor::LinesSplit(int pixelWidth) {
 		UndoGroup ug(pdoc);
 		for(Sci::Line line = lineStart; line <= lineEnd; line++) {
 			AutoSurface surface(this);
-			AutoLineLayout ll(view.llc, view.RetrieveLineLayout(line, *this));
+			AutoLineLayout ll(*view.llc, view.RetrieveLineLayout(line, *this));
 			if(surface && ll) {
 				const Sci::Position posLineStart = pdoc->LineStart(line);
 				view.LayoutLine(*this, line, surface, vs, ll, pixelWidth);
@@ -2341,6 +2431,27 @@ void Editor::NotifyErrorOccurred(Document*, void*, int status) {
 	errorStatus = status;
 }
 
+void Editor::NotifyGroupCompleted(Document*, void*) {
+	NotifyModifiedBatch();
+}
+
+//Au: sends the SCN_MODIFIED collected with batchModified as one SCN_MODIFIEDBATCH, in the order they occurred.
+void Editor::NotifyModifiedBatch() {
+	if(modifiedBatch.empty())
+		return;
+	// The container may modify the document when notified, starting another batch
+	std::vector<Sci_ModificationRecord> batch;
+	batch.swap(modifiedBatch);
+	SCNotification scn = {};
+	scn.nmhdr.code = SCN_MODIFIEDBATCH;
+	for(const Sci_ModificationRecord& record : batch) {
+		scn.modificationType |= record.modificationType;
+	}
+	scn.length = batch.size();
+	scn.lParam = reinterpret_cast<sptr_t>(batch.data());
+	NotifyParent(scn);
+}
+
 void Editor::NotifyChar(int ch) {
 	SCNotification scn = {};
 	scn.nmhdr.code = SCN_CHARADDED;
@@ -2517,8 +2628,8 @@ void Editor::NotifySavePoint(Document*, void*, bool atSavePoint) {
 
 void Editor::CheckModificationForWrap(DocModification mh) {
 	if(mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) {
-		view.llc.Invalidate(LineLayout::llCheckTextAndStyle);
 		const Sci::Line lineDoc = pdoc->SciLineFromPosition(mh.position);
+		view.llc->LinesChanged(lineDoc, mh.linesAdded, pdoc->LinesTotal());
 		const Sci::Line lines = std::max(static_cast<Sci::Line>(0), mh.linesAdded);
 		if(Wrapping()) {
 			NeedWrapping(lineDoc, lineDoc + lines + 1);
@@ -2596,7 +2707,8 @@ void Editor::NotifyModified(Document*, DocModification mh, void*) {
 			}
 		}
 		if(mh.modificationType & SC_MOD_CHANGESTYLE) {
-			view.llc.Invalidate(LineLayout::llCheckTextAndStyle);
+			view.llc->Invalidate(LineLayout::llCheckTextAndStyle,
+				pdoc->SciLineFromPosition(mh.position), pdoc->SciLineFromPosition(mh.position + mh.length));
 		}
 	} else {
 		// Move selection and brace highlights
@@ -2694,7 +2806,10 @@ void Editor::NotifyModified(Document*, DocModification mh, void*) {
 		}
 	}
 	if((mh.modificationType & SC_MOD_CHANGEFOLD) && (foldAutomatic & SC_AUTOMATICFOLD_CHANGE)) {
-		FoldChanged(mh.line, mh.foldLevelNow, mh.foldLevelPrev);
+		if(mh.modificationType & SC_MOD_CHANGEFOLDLINES)
+			FoldChangedLines(mh.line, mh.foldLines, mh.foldLevelsPrev);
+		else
+			FoldChanged(mh.line, mh.foldLevelNow, mh.foldLevelPrev);
 	}
 
 	// NOW pay the piper WRT "deferred" visual updates
@@ -2724,7 +2839,19 @@ void Editor::NotifyModified(Document*, DocModification mh, void*) {
 		scn.foldLevelPrev = mh.foldLevelPrev;
 		scn.token = static_cast<int>(mh.token);
 		scn.annotationLinesAdded = mh.annotationLinesAdded;
-		NotifyParent(scn);
+		if(mh.modificationType & SC_MOD_CHANGEFOLDLINES) scn.length = mh.foldLines; //Au
+		if(batchModified && !(mh.modificationType & SC_MOD_INSERTCHECK)) {
+			modifiedBatch.push_back({scn.modificationType, scn.position, scn.length, scn.linesAdded, scn.line});
+			// Sent when the modification is complete, unless it is part of a group or of an undo or redo of several steps
+			const bool partial = (mh.modificationType & (SC_MOD_BEFOREINSERT | SC_MOD_BEFOREDELETE)) ||
+				((mh.modificationType & (SC_PERFORMED_UNDO | SC_PERFORMED_REDO)) && !(mh.modificationType & SC_LASTSTEPINUNDOREDO));
+			if(!partial && !pdoc->InUndoGroup())
+				NotifyModifiedBatch();
+		} else {
+			// The insertion check is answered now, after the modifications before it
+			NotifyModifiedBatch();
+			NotifyParent(scn);
+		}
 	}
 }
 
@@ -4968,11 +5095,15 @@ void Editor::ButtonUpWithModifiers(Point pt, unsigned int curTime, int modifiers
 bool Editor::Idle() {
 	NotifyUpdateUI();
 
+	// Show more of a mapped file. Before wrapping and styling so they can include it.
+	const bool needMapping = pdoc->IsMapped() && pdoc->ExtendMapped();
+
 	bool needWrap = Wrapping() && wrapPending.NeedsWrap();
 
 	if(needWrap) {
 		// Wrap lines during idle.
-		WrapLines(WrapScope::wsIdle);
+		if(!WrapInBackground())
+			WrapLines(WrapScope::wsIdle);
 		// No more wrapping
 		needWrap = wrapPending.NeedsWrap();
 	} else if(needIdleStyling) {
@@ -4984,7 +5115,7 @@ bool Editor::Idle() {
 	// false will stop calling this idle function until SetIdle() is
 	// called again.
 
-	const bool idleDone = !needWrap && !needIdleStyling; // && thatDone && theOtherThingDone...
+	const bool idleDone = !needMapping && !needWrap && !needIdleStyling; // && thatDone && theOtherThingDone...
 
 	return !idleDone;
 }
@@ -5129,8 +5260,10 @@ void Editor::IdleStyling() {
 	const Sci::Position posAfterArea = PositionAfterArea(GetClientRectangle());
 	const Sci::Position endGoal = (idleStyling >= SC_IDLESTYLING_AFTERVISIBLE) ?
 		pdoc->Length() : posAfterArea;
-	const Sci::Position posAfterMax = PositionAfterMaxStyling(endGoal, false);
-	pdoc->StyleToAdjustingLineDuration(posAfterMax);
+	if(!pdoc->StyleInBackground(endGoal)) {
+		const Sci::Position posAfterMax = PositionAfterMaxStyling(endGoal, false);
+		pdoc->StyleToAdjustingLineDuration(posAfterMax);
+	}
 	if(pdoc->GetEndStyled() >= endGoal) {
 		needIdleStyling = false;
 	}
@@ -5218,7 +5351,7 @@ void Editor::SetAnnotationHeights(Sci::Line start, Sci::Line end) {
 			int linesWrapped = 1;
 			if(Wrapping()) {
 				AutoSurface surface(this);
-				AutoLineLayout ll(view.llc, view.RetrieveLineLayout(line, *this));
+				AutoLineLayout ll(*view.llc, view.RetrieveLineLayout(line, *this));
 				if(surface && ll) {
 					view.LayoutLine(*this, line, surface, vs, ll, wrapWidth);
 					linesWrapped = ll->lines;
@@ -5235,6 +5368,7 @@ void Editor::SetAnnotationHeights(Sci::Line start, Sci::Line end) {
 
 void Editor::SetDocPointer(Document* document) {
 	//Platform::DebugPrintf("** %x setdoc to %x\n", pdoc, document);
+	NotifyModifiedBatch();
 	pdoc->RemoveWatcher(this, 0);
 	pdoc->Release();
 	if(!document) {
@@ -5244,6 +5378,7 @@ void Editor::SetDocPointer(Document* document) {
 	}
 	pdoc->AddRef();
 	pcs = ContractionStateCreate(pdoc->IsLarge());
+	view.NewLayoutCache(); //Au: a cache the view owned alone would otherwise stay listed by the previous document
 
 	// Ensure all positions within document
 	sel.Clear();
@@ -5261,7 +5396,6 @@ void Editor::SetDocPointer(Document* document) {
 	pcs->Clear();
 	pcs->InsertLines(0, pdoc->LinesTotal() - 1);
 	SetAnnotationHeights(0, pdoc->LinesTotal());
-	view.llc.Deallocate();
 	NeedWrapping();
 
 	hotspot = Range(Sci::invalidPosition);
@@ -5270,8 +5404,13 @@ void Editor::SetDocPointer(Document* document) {
 	view.ClearAllTabstops();
 
 	pdoc->AddWatcher(this, 0);
+	view.SharePositionCache(pdoc);
+	view.ShareLayoutCache(*this, vs); //Au
 	SetScrollBars();
 	Redraw();
+	if(pdoc->IsMapped()) {
+		SetIdle(true);
+	}
 }
 
 void Editor::SetAnnotationVisible(int visible) {
@@ -5404,7 +5543,7 @@ void Editor::EnsureLineVisible(Sci::Line lineDoc, bool enforcePolicy) {
 
 	// In case in need of wrapping to ensure DisplayFromDoc works.
 	if(lineDoc >= wrapPending.start) {
-		if(WrapLines(WrapScope::wsAll)) {
+		if(WrapLines(backgroundWrapping ? WrapScope::wsNear : WrapScope::wsAll, lineDoc)) {
 			Redraw();
 		}
 	}
@@ -5543,6 +5682,20 @@ void Editor::FoldChanged(Sci::Line line, int levelNow, int levelPrev) {
 	}
 }
 
+//Au: FoldChanged for the lines whose fold levels were set together, with levelsPrev their levels before.
+void Editor::FoldChangedLines(Sci::Line line, Sci::Line lines, const int* levelsPrev) {
+	// FoldChanged only expands or shows lines, so does nothing when none are contracted or hidden
+	const Sci::Line lineContracted = pcs->ContractedNext(line);
+	if(!pcs->HiddenLines() && ((lineContracted < 0) || (lineContracted >= line + lines)))
+		return;
+	for(Sci::Line i = 0; i < lines; i++) {
+		const int levelNow = pdoc->GetLevel(line + i);
+		// Lines getting their first fold level are not checked, as when they were set one at a time
+		if((levelNow != levelsPrev[i]) && (levelsPrev[i] > SC_FOLDLEVELBASE))
+			FoldChanged(line + i, levelNow, levelsPrev[i]);
+	}
+}
+
 void Editor::NeedShown(Sci::Position pos, Sci::Position len) {
 	if(foldAutomatic & SC_AUTOMATICFOLD_SHOW) {
 		const Sci::Line lineStart = pdoc->SciLineFromPosition(pos);
@@ -5604,7 +5757,7 @@ int Editor::CodePage() const noexcept {
 
 Sci::Line Editor::WrapCount(Sci::Line line) {
 	AutoSurface surface(this);
-	AutoLineLayout ll(view.llc, view.RetrieveLineLayout(line, *this));
+	AutoLineLayout ll(*view.llc, view.RetrieveLineLayout(line, *this));
 
 	if(surface && ll) {
 		view.LayoutLine(*this, line, surface, vs, ll, wrapWidth);
@@ -6211,6 +6364,13 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETUNDOCOLLECTION:
 		return pdoc->IsCollectingUndo();
 
+	case SCI_SETUNDOMEMORYLIMIT: //Au: forget the oldest undo history when its text uses more memory
+		pdoc->SetUndoMemoryLimit(static_cast<size_t>(wParam));
+		return 0;
+
+	case SCI_GETUNDOMEMORYLIMIT:
+		return static_cast<sptr_t>(pdoc->GetUndoMemoryLimit());
+
 	case SCI_BEGINUNDOACTION:
 		pdoc->BeginUndoAction();
 		return 0;
@@ -6540,6 +6700,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		return pdoc->tabInChars;
 
 	case SCI_CLEARTABSTOPS:
+		view.DetachLayoutCache(); //Au: tab stops are set per view so its layouts are not shared
 		if(view.ClearTabstops(static_cast<Sci::Line>(wParam))) {
 			const DocModification mh(SC_MOD_CHANGETABSTOPS, 0, 0, 0, nullptr, static_cast<Sci::Line>(wParam));
 			NotifyModified(pdoc, mh, nullptr);
@@ -6547,6 +6708,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		break;
 
 	case SCI_ADDTABSTOP:
+		view.DetachLayoutCache(); //Au
 		if(view.AddTabstop(static_cast<Sci::Line>(wParam), static_cast<int>(lParam))) {
 			const DocModification mh(SC_MOD_CHANGETABSTOPS, 0, 0, 0, nullptr, static_cast<Sci::Line>(wParam));
 			NotifyModified(pdoc, mh, nullptr);
@@ -6624,6 +6786,22 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETIDLESTYLING:
 		return idleStyling;
 
+	case SCI_SETBACKGROUNDSTYLING: //Au: idle styling runs the lexer on another thread
+		pdoc->SetBackgroundStyling(wParam != 0);
+		break;
+
+	case SCI_GETBACKGROUNDSTYLING:
+		return pdoc->BackgroundStyling();
+
+	case SCI_SETBACKGROUNDWRAPPING: //Au: idle wrapping lays out lines on another thread, for the view
+		backgroundWrapping = wParam != 0;
+		if(!backgroundWrapping)
+			backgroundWrapper.reset();
+		break;
+
+	case SCI_GETBACKGROUNDWRAPPING:
+		return backgroundWrapping;
+
 	case SCI_SETWRAPMODE:
 		if(vs.SetWrapState(static_cast<int>(wParam))) {
 			xOffset = 0;
@@ -6676,18 +6854,41 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		return vs.wrapIndentMode;
 
 	case SCI_SETLAYOUTCACHE:
-		view.llc.SetLevel(static_cast<int>(wParam));
+		if(static_cast<int>(wParam) != view.llc->GetLevel()) {
+			view.DetachLayoutCache(); //Au: other views of the document keep the level of the cache they share
+		}
+		view.llc->SetLevel(static_cast<int>(wParam));
+		view.ShareLayoutCache(*this, vs); //Au
 		break;
 
 	case SCI_GETLAYOUTCACHE:
-		return view.llc.GetLevel();
+		return view.llc->GetLevel();
+
+	case SCI_SETLAYOUTCACHEBUDGET: //Au: with SC_CACHE_DOCUMENT, holds the layouts of the lines used last in wParam bytes
+		if(static_cast<size_t>(wParam) != view.llc->GetBudget()) {
+			view.DetachLayoutCache();
+		}
+		view.llc->SetBudget(static_cast<size_t>(wParam));
+		view.ShareLayoutCache(*this, vs);
+		break;
+
+	case SCI_GETLAYOUTCACHEBUDGET: //Au
+		return view.llc->GetBudget();
+
+	case SCI_GETLAYOUTCACHESTATISTICS: //Au
+		view.llc->GetStatistics(reinterpret_cast<Sci_CacheStatistics *>(lParam));
+		break;
 
 	case SCI_SETPOSITIONCACHE:
-		view.posCache.SetSize(wParam);
+		view.posCache->SetSize(wParam);
 		break;
 
 	case SCI_GETPOSITIONCACHE:
-		return view.posCache.GetSize();
+		return view.posCache->GetSize();
+
+	case SCI_GETPOSITIONCACHESTATISTICS: //Au: the position cache is shared by the views of the document
+		view.posCache->GetStatistics(reinterpret_cast<Sci_CacheStatistics *>(lParam));
+		break;
 
 	case SCI_SETSCROLLWIDTH:
 		PLATFORM_ASSERT(wParam > 0);
@@ -7465,6 +7666,15 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 			lParam);
 		break;
 
+	case SCI_INDICATORFILLRANGES: //Au
+		pdoc->DecorationFillRanges(reinterpret_cast<const Sci_IndicatorRange *>(lParam), wParam,
+			pdoc->decorations->GetCurrentValue());
+		break;
+
+	case SCI_INDICATORCLEARRANGES: //Au
+		pdoc->DecorationFillRanges(reinterpret_cast<const Sci_IndicatorRange *>(lParam), wParam, 0);
+		break;
+
 	case SCI_INDICATORALLONFOR:
 		return pdoc->decorations->AllOnFor(static_cast<Sci::Position>(wParam));
 
@@ -7711,6 +7921,15 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETCOMMANDEVENTS:
 		return commandEvents;
 
+	case SCI_SETBATCHMODIFIED: //Au
+		batchModified = wParam != 0;
+		if(!batchModified)
+			NotifyModifiedBatch();
+		break;
+
+	case SCI_GETBATCHMODIFIED:
+		return batchModified;
+
 	case SCI_CONVERTEOLS:
 		pdoc->ConvertLineEnds(static_cast<int>(wParam));
 		SetSelection(sel.MainCaret(), sel.MainAnchor());	// Ensure selection inside document
@@ -7837,6 +8056,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 
 	case SCI_SETREPRESENTATION:
 		reprs.SetRepresentation(ConstCharPtrFromUPtr(wParam), ConstCharPtrFromSPtr(lParam));
+		InvalidateStyleRedraw(); //Au: layouts depend on representations and may be shared with views that have others
 		break;
 
 	case SCI_GETREPRESENTATION: {
@@ -7850,6 +8070,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 
 	case SCI_CLEARREPRESENTATION:
 		reprs.ClearRepresentation(ConstCharPtrFromUPtr(wParam));
+		InvalidateStyleRedraw(); //Au
 		break;
 
 	case SCI_STARTRECORD:
@@ -7975,6 +8196,12 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_MARGINSTYLENEXT: //Au: fast find next line that has certain style in text margin
 		return pdoc->MarginStyledTextNext((Sci::Line)wParam, (int)lParam);
 
+	case SCI_MARGINSTYLEPREVIOUS: //Au
+		return pdoc->MarginStyledTextPrevious((Sci::Line)wParam, (int)lParam);
+
+	case SCI_MARGINSTYLELINES: //Au
+		return pdoc->MarginStyledLines((int)wParam, reinterpret_cast<int*>(lParam));
+
 	case SCI_MARGINSETSTYLES:
 		pdoc->MarginSetStyles(static_cast<Sci::Line>(wParam), ConstUCharPtrFromSPtr(lParam));
 		break;
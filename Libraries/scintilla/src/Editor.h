@@ -10,6 +10,8 @@
 
 namespace Scintilla {
 
+class BackgroundWrapper;
+
 /**
  */
 class Timer {
@@ -230,6 +232,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	int modEventMask;
 	bool commandEvents;
+	bool batchModified;	//Au: SCN_MODIFIED of a user action or undo group are sent together
+	std::vector<Sci_ModificationRecord> modifiedBatch;
 
 	SelectionText drag;
 
@@ -251,6 +255,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	// Wrapping support
 	WrapPending wrapPending;
 	ActionDuration durationWrapOneLine;
+	bool backgroundWrapping;
+	std::unique_ptr<BackgroundWrapper> backgroundWrapper;
 
 	bool convertPastes;
 
@@ -371,8 +377,9 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	bool Wrapping() const noexcept;
 	void NeedWrapping(Sci::Line docLineStart=0, Sci::Line docLineEnd=WrapPending::lineLarge);
 	bool WrapOneLine(Surface *surface, Sci::Line lineToWrap);
-	enum class WrapScope {wsAll, wsVisible, wsIdle};
-	bool WrapLines(WrapScope ws);
+	enum class WrapScope {wsAll, wsVisible, wsIdle, wsNear};
+	bool WrapLines(WrapScope ws, Sci::Line lineNear=0);
+	bool WrapInBackground();
 	void LinesJoin();
 	void LinesSplit(int pixelWidth);
 
@@ -445,6 +452,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void NotifyStyleNeeded(Document *doc, void *userData, Sci::Position endStyleNeeded) override;
 	void NotifyLexerChanged(Document *doc, void *userData) override;
 	void NotifyErrorOccurred(Document *doc, void *userData, int status) override;
+	void NotifyGroupCompleted(Document *doc, void *userData) override;
+	void NotifyModifiedBatch();
 	void NotifyMacroRecord(unsigned int iMessage, uptr_t wParam, sptr_t lParam);
 
 	void ContainerNeedsUpdate(int flags) noexcept;
@@ -546,6 +555,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	Sci::Line ContractedFoldNext(Sci::Line lineStart) const;
 	void EnsureLineVisible(Sci::Line lineDoc, bool enforcePolicy);
 	void FoldChanged(Sci::Line line, int levelNow, int levelPrev);
+	void FoldChangedLines(Sci::Line line, Sci::Line lines, const int *levelsPrev);
 	void NeedShown(Sci::Position pos, Sci::Position len);
 	void FoldAll(int action);
 
@@ -0,0 +1,173 @@
+// Scintilla source code edit control
+/** @file LineScanner.cxx
+ ** Finds the line ends in inserted text, 16 bytes at a time and in parallel for large text.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define LINESCANNER_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#include "Position.h"
+#include "UniConversion.h"
+#include "LineScanner.h"
+
+using namespace Scintilla;
+
+namespace {
+
+// Text is divided between threads only when each can scan at least this much.
+constexpr Sci::Position minSegment = 0x400000;
+constexpr Sci::Position maxSegments = 16;
+
+#ifdef LINESCANNER_SSE2
+
+constexpr Sci::Position blockSize = 16;
+
+inline int LowestBit(unsigned int mask) noexcept {
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+#endif
+
+class Scanner {
+	const unsigned char *us;
+	Sci::Position length;
+	unsigned char chBeforePrev;
+	unsigned char chPrev;
+	bool utf8LineEnds;
+
+	unsigned char At(Sci::Position i) const noexcept {
+		return (i >= 0) ? us[i] : ((i == -1) ? chPrev : chBeforePrev);
+	}
+
+	// Only called for bytes that may end a line: CR, LF and the last bytes of Unicode line ends.
+	bool LineEndsAt(Sci::Position i) const noexcept {
+		const unsigned char ch = us[i];
+		if (ch == '\n')
+			return (i > 0) || (chPrev != '\r');
+		if (ch == '\r')
+			return (i + 1 >= length) || (us[i + 1] != '\n');
+		if (utf8LineEnds) {
+			const unsigned char back3[3] = {At(i - 2), At(i - 1), ch};
+			return UTF8IsSeparator(back3) || UTF8IsNEL(back3 + 1);
+		}
+		return false;
+	}
+
+public:
+	Scanner(const char *s, Sci::Position length_, unsigned char chBeforePrev_, unsigned char chPrev_,
+		bool utf8LineEnds_) noexcept :
+		us(reinterpret_cast<const unsigned char *>(s)), length(length_),
+		chBeforePrev(chBeforePrev_), chPrev(chPrev_), utf8LineEnds(utf8LineEnds_) {
+	}
+
+	void Scan(Sci::Position start, Sci::Position end, std::vector<Sci::Position> &lineStarts) const {
+		Sci::Position i = start;
+#ifdef LINESCANNER_SSE2
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i lf = _mm_set1_epi8('\n');
+		// Last bytes of U+2028, U+2029 and NEL
+		const __m128i ls = _mm_set1_epi8(static_cast<char>(0xA8));
+		const __m128i ps = _mm_set1_epi8(static_cast<char>(0xA9));
+		const __m128i nel = _mm_set1_epi8(static_cast<char>(0x85));
+		for (; i + blockSize <= end; i += blockSize) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(us + i));
+			__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf));
+			if (utf8LineEnds) {
+				m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, ls),
+					_mm_or_si128(_mm_cmpeq_epi8(v, ps), _mm_cmpeq_epi8(v, nel))));
+			}
+			unsigned int mask = _mm_movemask_epi8(m);
+			while (mask) {
+				const Sci::Position candidate = i + LowestBit(mask);
+				if (LineEndsAt(candidate))
+					lineStarts.push_back(candidate + 1);
+				mask &= mask - 1;
+			}
+		}
+#endif
+		for (; i < end; i++) {
+			if (LineEndsAt(i))
+				lineStarts.push_back(i + 1);
+		}
+	}
+};
+
+}
+
+void Scintilla::FindLineStarts(const char *s, Sci::Position length, unsigned char chBeforePrev, unsigned char chPrev,
+	bool utf8LineEnds, std::vector<Sci::Position> &lineStarts) {
+	const Scanner scanner(s, length, chBeforePrev, chPrev, utf8LineEnds);
+	const Sci::Position segments = std::min<Sci::Position>({length / minSegment,
+		static_cast<Sci::Position>(std::thread::hardware_concurrency()), maxSegments});
+	if (segments <= 1) {
+		scanner.Scan(0, length, lineStarts);
+		return;
+	}
+
+	// Segments after the first are scanned by other threads. A segment that fails,
+	// as a thread could not be started or memory ran out, is scanned again by this thread.
+	const Sci::Position lengthSegment = length / segments;
+	std::vector<std::vector<Sci::Position>> found(segments);
+	std::vector<char> scanned(segments);
+	auto scanSegment = [&](Sci::Position segment) {
+		const Sci::Position start = segment * lengthSegment;
+		const Sci::Position end = (segment == segments - 1) ? length : start + lengthSegment;
+		found[segment].clear();
+		scanner.Scan(start, end, found[segment]);
+		scanned[segment] = true;
+	};
+	std::vector<std::thread> threads;
+	try {
+		for (Sci::Position segment = 1; segment < segments; segment++) {
+			threads.emplace_back([&scanSegment, segment]() noexcept {
+				try {
+					scanSegment(segment);
+				} catch (...) {
+					// Left for this thread
+				}
+			});
+		}
+	} catch (...) {
+		// Fewer threads
+	}
+	try {
+		scanSegment(0);
+	} catch (...) {
+		for (std::thread &t : threads)
+			t.join();
+		throw;
+	}
+	for (std::thread &t : threads)
+		t.join();
+
+	size_t total = lineStarts.size();
+	for (Sci::Position segment = 0; segment < segments; segment++) {
+		if (!scanned[segment])
+			scanSegment(segment);
+		total += found[segment].size();
+	}
+	lineStarts.reserve(total);
+	for (const std::vector<Sci::Position> &segmentStarts : found) {
+		lineStarts.insert(lineStarts.end(), segmentStarts.begin(), segmentStarts.end());
+	}
+}
@@ -0,0 +1,24 @@
+// Scintilla source code edit control
+/** @file LineScanner.h
+ ** Finds the line ends in inserted text, 16 bytes at a time and in parallel for large text.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef LINESCANNER_H
+#define LINESCANNER_H
+
+namespace Scintilla {
+
+/**
+ * Appends to lineStarts the offset after each line end in s[0, length), in order, as CellBuffer
+ * inserts lines: after CR, LF and, with utf8LineEnds, the Unicode line ends.
+ * A CR followed by LF is one line end after the LF.
+ * chBeforePrev and chPrev are the 2 bytes before s, used to detect line ends that start before s.
+ * An LF at s[0] after a CR is not included as it ends a line that already exists.
+ */
+void FindLineStarts(const char *s, Sci::Position length, unsigned char chBeforePrev, unsigned char chPrev,
+	bool utf8LineEnds, std::vector<Sci::Position> &lineStarts);
+
+}
+
+#endif
@@ -118,6 +118,28 @@ public:
 		stepPartition++;
 	}
 
+	void InsertPartitions(T partition, const T *positions, size_t length) {
+		// positions are actual positions. Applying the step up to partition leaves the new
+		// partitions at or before stepPartition, where values are stored without stepLength.
+		if (stepPartition < partition) {
+			ApplyStep(partition);
+		}
+		body->InsertFromArray(partition, positions, 0, length);
+		stepPartition += static_cast<T>(length);
+	}
+
+	void InsertPartitionsWithCast(T partition, const ptrdiff_t *positions, size_t length) {
+		// Used for 64-bit builds when T is 32-bits. Step handling is as in InsertPartitions.
+		if (stepPartition < partition) {
+			ApplyStep(partition);
+		}
+		T *pInsertion = body->InsertEmpty(partition, length);
+		for (size_t i = 0; i < length; i++) {
+			pInsertion[i] = static_cast<T>(positions[i]);
+		}
+		stepPartition += static_cast<T>(length);
+	}
+
 	void SetPartitionStartPosition(T partition, T pos) noexcept {
 		ApplyStep(partition+1);
 		if ((partition < 0) || (partition > body->Length())) {
@@ -158,6 +180,16 @@ public:
 		body->Delete(partition);
 	}
 
+	void RemovePartitions(T partition, T count) {
+		// Like count calls to RemovePartition(partition): the step is applied up to the last
+		// removed partition, so the partitions after them still need stepLength after moving down.
+		if (partition + count - 1 > stepPartition) {
+			ApplyStep(partition + count - 1);
+		}
+		stepPartition -= count;
+		body->DeleteRange(partition, count);
+	}
+
 	T PositionFromPartition(T partition) const noexcept {
 		PLATFORM_ASSERT(partition >= 0);
 		PLATFORM_ASSERT(partition < body->Length());
@@ -0,0 +1,328 @@
+// Scintilla source code edit control
+/** @file Pcre2Search.cxx
+ ** Regular expression search with PCRE2.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <forward_list>
+#include <algorithm>
+#include <memory>
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#define PCRE2_STATIC
+#include "pcre2.h"
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "CharacterSet.h"
+#include "CharacterCategory.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "RESearch.h"
+#include "UniConversion.h"
+#include "Pcre2Search.h"
+
+using namespace Scintilla;
+
+namespace {
+
+// The first window of a forward search. Each next window is twice as big, up to maxWindow,
+// so finding a match near the start does not inspect (and validate as UTF-8) the whole range.
+constexpr Sci::Position minWindow = 0x100;
+constexpr Sci::Position maxWindow = 0x400000;
+// A window ends at the gap, unless that would make it smaller than this.
+constexpr Sci::Position minWindowSide = 0x40;
+// Count of compiled patterns kept.
+constexpr size_t maxCompiled = 8;
+
+// Line ends as PCRE2_NEWLINE_ANYCRLF sees them. Faster than Document::IsLineStartPosition for each window.
+bool IsLineStart(const Document *doc, Sci::Position position) noexcept {
+	if (position <= 0)
+		return true;
+	const char chPrev = doc->CharAt(position - 1);
+	return chPrev == '\n' || (chPrev == '\r' && doc->CharAt(position) != '\n');
+}
+
+bool IsLineEnd(const Document *doc, Sci::Position position) noexcept {
+	if (position >= doc->Length())
+		return true;
+	const char ch = doc->CharAt(position);
+	return ch == '\r' || (ch == '\n' && (position == 0 || doc->CharAt(position - 1) != '\r'));
+}
+
+inline bool IsUTFError(int rc) noexcept {
+	return rc <= PCRE2_ERROR_UTF8_ERR1 && rc >= PCRE2_ERROR_UTF8_ERR21;
+}
+
+}
+
+/**
+ * A cached pattern.
+ */
+struct Pcre2Search::Compiled {
+	std::string pattern;
+	bool caseSensitive = true;
+	bool utf = false;
+	pcre2_code *code = nullptr;
+	pcre2_match_data *matchData = nullptr;
+	// Bytes before a match start that the pattern may inspect: lookbehinds and 1 character for \b and ^.
+	Sci::Position lookBehind = 0;
+
+	Compiled() noexcept = default;
+	Compiled(const Compiled &) = delete;
+	Compiled &operator=(const Compiled &) = delete;
+	~Compiled() {
+		pcre2_match_data_free(matchData);
+		pcre2_code_free(code);
+	}
+
+	void Create(std::string_view pattern_, bool caseSensitive_, bool utf_) {
+		pattern = pattern_;
+		caseSensitive = caseSensitive_;
+		utf = utf_;
+		pcre2_compile_context *compileContext = pcre2_compile_context_create(nullptr);
+		pcre2_set_newline(compileContext, PCRE2_NEWLINE_ANYCRLF);
+		uint32_t options = PCRE2_MULTILINE | PCRE2_ALT_CIRCUMFLEX;
+		if (!caseSensitive)
+			options |= PCRE2_CASELESS;
+		if (utf)
+			options |= PCRE2_UTF;
+		int errorCode = 0;
+		PCRE2_SIZE errorOffset = 0;
+		code = pcre2_compile(reinterpret_cast<PCRE2_SPTR>(pattern.data()), pattern.length(),
+			options, &errorCode, &errorOffset, compileContext);
+		pcre2_compile_context_free(compileContext);
+		if (!code)
+			throw RegexError();
+		matchData = pcre2_match_data_create_from_pattern(code, nullptr);
+		uint32_t maxLookBehind = 0;
+		pcre2_pattern_info(code, PCRE2_INFO_MAXLOOKBEHIND, &maxLookBehind);
+		lookBehind = (static_cast<Sci::Position>(maxLookBehind) + 1) * (utf ? UTF8MaxBytes : 2);
+	}
+};
+
+Pcre2Search::Pcre2Search() = default;
+
+Pcre2Search::~Pcre2Search() = default;
+
+Pcre2Search::Compiled &Pcre2Search::Compile(const char *s, Sci::Position lengthPattern, bool caseSensitive, bool utf) {
+	const std::string_view pattern(s, lengthPattern);
+	for (auto it = cache.begin(); it != cache.end(); ++it) {
+		Compiled &re = **it;
+		if (re.pattern == pattern && re.caseSensitive == caseSensitive && re.utf == utf) {
+			// Most recently used first
+			std::rotate(cache.begin(), it, it + 1);
+			return *cache.front();
+		}
+	}
+	std::unique_ptr<Compiled> re = std::make_unique<Compiled>();
+	re->Create(pattern, caseSensitive, utf);
+	if (cache.size() >= maxCompiled)
+		cache.pop_back();
+	cache.insert(cache.begin(), std::move(re));
+	return *cache.front();
+}
+
+/**
+ * Matches re at positions from start, in text that ends at end.
+ * With partial, reports a match that may continue after end as PCRE2_ERROR_PARTIAL.
+ * Invalid UTF-8 is a boundary that matches do not cross: end is reduced to the first invalid
+ * character after start, and the pattern does not look behind the last one before start.
+ * Sets base to the document position of subject offset 0.
+ * Returns the pcre2_match result.
+ */
+int Pcre2Search::Execute(Document *doc, Compiled &re, Sci::Position start, Sci::Position &end, bool partial,
+	Sci::Position &base) {
+	base = doc->MovePositionOutsideChar(std::max<Sci::Position>(start - re.lookBehind, 0), -1, false);
+	for (;;) {
+		Sci::Position startRange = 0;
+		Sci::Position lengthRange = 0;
+		const char *text = doc->ContiguousRange(base, startRange, lengthRange);
+		if (text && end <= startRange + lengthRange) {
+			text += base - startRange;
+		} else {
+			// Crosses the gap or empty at the end of the document
+			text = doc->RangePointer(base, end - base);
+			if (!text)
+				text = "";
+		}
+		uint32_t options = 0;
+		if (!IsLineStart(doc, base))
+			options |= PCRE2_NOTBOL;
+		if (partial)
+			options |= PCRE2_PARTIAL_HARD;
+		if (!IsLineEnd(doc, end))
+			options |= PCRE2_NOTEOL;
+		const int rc = pcre2_match(re.code, reinterpret_cast<PCRE2_SPTR>(text), end - base, start - base,
+			options, re.matchData, nullptr, nullptr);
+		if (rc == PCRE2_ERROR_BADUTFOFFSET) {
+			// start is inside an invalid character
+			end = start;
+			return PCRE2_ERROR_NOMATCH;
+		}
+		if (!IsUTFError(rc))
+			return rc;
+		const Sci::Position invalid = base + pcre2_get_startchar(re.matchData);
+		if (invalid < start) {
+			base = doc->NextPosition(invalid, 1);
+		} else if (invalid > start) {
+			end = invalid;
+			partial = false;
+		} else {
+			end = start;
+			return PCRE2_ERROR_NOMATCH;
+		}
+	}
+}
+
+/**
+ * Forward searches match across lines in one pass over windows of the range.
+ * Backward searches find the match that starts last, in windows from the end of the range;
+ * matches can span lines in both directions.
+ */
+Sci::Position Pcre2Search::FindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
+	bool caseSensitive, Sci::Position *length, RESearch &search) {
+	const bool utf = SC_CP_UTF8 == doc->dbcsCodePage;
+	Compiled &re = Compile(s, *length, caseSensitive, utf);
+	const bool forward = minPos <= maxPos;
+	// Range endpoints should not be inside DBCS characters or between a CR and LF
+	const Sci::Position rangeStart = doc->MovePositionOutsideChar(std::min(minPos, maxPos), 1, true);
+	const Sci::Position rangeEnd = doc->MovePositionOutsideChar(std::max(minPos, maxPos), 1, true);
+	const bool checkCharacterStart = doc->dbcsCodePage && !utf;
+	const PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(re.matchData);
+
+	Sci::Position base = 0;
+	Sci::Position posMatch = -1;
+	Sci::Position endMatch = -1;
+	// Copies the groups of the last match to search
+	auto setMatch = [&](int rc) {
+		search.Clear();
+		const int groups = std::min<int>(rc, RESearch::MAXTAG);
+		for (int co = 0; co < groups; co++) {
+			if (ovector[co * 2] != PCRE2_UNSET) {
+				search.bopat[co] = base + ovector[co * 2];
+				search.eopat[co] = base + ovector[co * 2 + 1];
+			}
+		}
+		posMatch = search.bopat[0];
+		endMatch = search.eopat[0];
+	};
+
+	if (forward) {
+		Sci::Position pos = rangeStart;	// No match starts before pos
+		Sci::Position window = minWindow;
+		bool partial = false;
+		while (pos <= rangeEnd) {
+			Sci::Position end = rangeEnd;
+			if (rangeEnd - pos > window) {
+				// End at a line end, so that $ and \b at the end of the window match like in the whole range
+				const Sci::Position posWindow = pos + window;
+				end = doc->LineEnd(doc->SciLineFromPosition(posWindow));
+				if (end - posWindow > window)
+					end = doc->MovePositionOutsideChar(posWindow, 1, true);	// Very long line
+				Sci::Position startRange = 0;
+				Sci::Position lengthRange = 0;
+				if (!partial && doc->ContiguousRange(pos, startRange, lengthRange)) {
+					const Sci::Position endSide = doc->LineEnd(doc->SciLineFromPosition(startRange + lengthRange) - 1);
+					if (endSide < end && endSide - pos >= minWindowSide)
+						end = endSide;
+				}
+				end = std::min(end, rangeEnd);
+			}
+			const int rc = Execute(doc, re, pos, end, end < rangeEnd, base);
+			if (rc >= 0) {
+				const Sci::Position posFound = base + ovector[0];
+				if (checkCharacterStart && doc->MovePositionOutsideChar(posFound, -1, false) != posFound) {
+					pos = posFound + 1;	// Inside a DBCS character
+					continue;
+				}
+				setMatch(rc);
+				break;
+			} else if (rc == PCRE2_ERROR_PARTIAL) {
+				// A match may start here and continue after end, so match again with more text
+				pos = std::max(pos, base + static_cast<Sci::Position>(ovector[0]));
+				window *= 2;
+				partial = true;
+			} else if (rc == PCRE2_ERROR_NOMATCH && pos < rangeEnd) {
+				// Execute sets end = pos at invalid UTF-8, then skip it
+				pos = (end > pos) ? end : doc->NextPosition(pos, 1);
+				window = std::min(window * 2, maxWindow);
+				partial = false;
+			} else {
+				break;
+			}
+		}
+	} else {
+		// Windows grow backward from the end of the range. A window is searched for match starts,
+		// and a match may continue after the window, up to the end of the range.
+		Sci::Position limit = rangeEnd;	// Starts at or after limit were inspected in previous windows
+		Sci::Position window = minWindow;
+		while (posMatch < 0 && limit > rangeStart) {
+			Sci::Position start = rangeStart;
+			if (limit - rangeStart > window) {
+				// Start at a line end, so that the window before this one ends at a line end, like forward windows
+				const Sci::Position posWindow = limit - window;
+				const Sci::Line linePrevious = doc->SciLineFromPosition(posWindow) - 1;
+				start = (linePrevious >= 0) ? doc->LineEnd(linePrevious) : 0;
+				if (posWindow - start > window)
+					start = doc->MovePositionOutsideChar(posWindow, -1, true);	// Very long line
+				start = std::max(start, rangeStart);
+			}
+			Sci::Position pos = start;
+			bool whole = limit == rangeEnd;
+			while (pos < limit) {
+				Sci::Position end = whole ? rangeEnd : limit;
+				const int rc = Execute(doc, re, pos, end, end < rangeEnd, base);
+				if (rc == PCRE2_ERROR_PARTIAL) {
+					// A match may start here and continue after the window
+					pos = std::max(pos, base + static_cast<Sci::Position>(ovector[0]));
+					whole = true;
+					continue;
+				}
+				if (rc < 0) {
+					if (rc != PCRE2_ERROR_NOMATCH || end >= limit)
+						break;
+					// Stopped at invalid UTF-8
+					pos = (end > pos) ? end : doc->NextPosition(pos, 1);
+					continue;
+				}
+				// An empty match at the end of the range is skipped, so that finding previous again moves back
+				const Sci::Position posFound = base + ovector[0];
+				if (posFound >= limit)
+					break;
+				if (!checkCharacterStart || doc->MovePositionOutsideChar(posFound, -1, false) == posFound)
+					setMatch(rc);
+				pos = doc->NextPosition(posFound, 1);
+				whole = limit == rangeEnd;
+			}
+			limit = start;
+			window = std::min(window * 2, maxWindow);
+		}
+	}
+
+	if (posMatch < 0)
+		return -1;
+	*length = endMatch - posMatch;
+	return posMatch;
+}
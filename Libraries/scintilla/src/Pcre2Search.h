@@ -0,0 +1,44 @@
+// Scintilla source code edit control
+/** @file Pcre2Search.h
+ ** Regular expression search with PCRE2.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef PCRE2SEARCH_H
+#define PCRE2SEARCH_H
+
+namespace Scintilla {
+
+/**
+ * Searches a document with PCRE2 in 8-bit mode, UTF-8 in UTF-8 documents.
+ * The text is matched directly in the buffer, in windows that grow while nothing is found,
+ * so the gap is moved only when a match may cross it.
+ * Compiled patterns are cached, so repeated searches (find next, find all) compile once.
+ * Patterns are matched by the PCRE2 interpreter: the bundled PCRE2 is built without JIT support.
+ */
+class Pcre2Search {
+public:
+	Pcre2Search();
+	// Deleted so Pcre2Search objects can not be copied.
+	Pcre2Search(const Pcre2Search &) = delete;
+	Pcre2Search(Pcre2Search &&) = delete;
+	Pcre2Search &operator=(const Pcre2Search &) = delete;
+	Pcre2Search &operator=(Pcre2Search &&) = delete;
+	~Pcre2Search();
+
+	/// Like RegexSearchBase::FindText. Sets search.bopat and search.eopat for SubstituteByPosition.
+	/// Throws RegexError if the pattern is invalid.
+	Sci::Position FindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
+		bool caseSensitive, Sci::Position *length, RESearch &search);
+
+private:
+	struct Compiled;
+	std::vector<std::unique_ptr<Compiled>> cache;
+
+	Compiled &Compile(const char *s, Sci::Position lengthPattern, bool caseSensitive, bool utf);
+	int Execute(Document *doc, Compiled &re, Sci::Position start, Sci::Position &end, bool partial, Sci::Position &base);
+};
+
+}
+
+#endif
@@ -6,10 +6,12 @@
 // The License.txt file describes the conditions under which this software may be distributed.
 
 #include <cstddef>
+#include <cstdint>
 #include <cassert>
 #include <cstring>
 
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <forward_list>
@@ -94,6 +96,12 @@ void LineMarkers::InsertLine(Sci::Line line) {
 	}
 }
 
+void LineMarkers::InsertLines(Sci::Line line, Sci::Line lines) {
+	if (markers.Length()) {
+		markers.InsertEmpty(line, lines);
+	}
+}
+
 void LineMarkers::RemoveLine(Sci::Line line) {
 	// Retain the markers from the deleted line by oring them into the previous line
 	if (markers.Length()) {
@@ -204,6 +212,13 @@ void LineLevels::InsertLine(Sci::Line line) {
 	}
 }
 
+void LineLevels::InsertLines(Sci::Line line, Sci::Line lines) {
+	if (levels.Length()) {
+		const int level = (line < levels.Length()) ? levels[line] : SC_FOLDLEVELBASE;
+		levels.InsertValue(line, lines, level);
+	}
+}
+
 void LineLevels::RemoveLine(Sci::Line line) {
 	if (levels.Length()) {
 		// Move up following lines but merge header flag from this line
@@ -262,6 +277,14 @@ void LineState::InsertLine(Sci::Line line) {
 	}
 }
 
+void LineState::InsertLines(Sci::Line line, Sci::Line lines) {
+	if (lineStates.Length()) {
+		lineStates.EnsureLength(line);
+		const int val = (line < lineStates.Length()) ? lineStates[line] : 0;
+		lineStates.InsertValue(line, lines, val);
+	}
+}
+
 void LineState::RemoveLine(Sci::Line line) {
 	if (lineStates.Length() > line) {
 		lineStates.Delete(line);
@@ -311,6 +334,69 @@ struct AnnotationHeader {
 	int length;
 };
 
+namespace {
+
+// The end of the last partition of StyledLines, after any line
+constexpr Sci::Line endStyledLines = PTRDIFF_MAX / 2;
+
+}
+
+StyledLines::StyledLines() : starts(8) {
+	starts.SetPartitionStartPosition(1, endStyledLines);
+}
+
+StyledLines::~StyledLines() {
+}
+
+// The number of lines held before line, which is the partition starting at or before line
+Sci::Line StyledLines::Before(Sci::Line line) const noexcept {
+	return starts.PartitionFromPosition(line);
+}
+
+Sci::Line StyledLines::Count() const noexcept {
+	return starts.Partitions() - 1;
+}
+
+Sci::Line StyledLines::At(Sci::Line index) const noexcept {
+	return starts.PositionFromPartition(index + 1) - 1;
+}
+
+bool StyledLines::Contains(Sci::Line line) const noexcept {
+	const Sci::Line index = Before(line + 1);
+	return (index > 0) && (At(index - 1) == line);
+}
+
+void StyledLines::Add(Sci::Line line) {
+	if (!Contains(line)) {
+		starts.InsertPartition(Before(line) + 1, line + 1);
+	}
+}
+
+void StyledLines::Remove(Sci::Line line) {
+	if (Contains(line)) {
+		starts.RemovePartition(Before(line) + 1);
+	}
+}
+
+void StyledLines::InsertLines(Sci::Line line, Sci::Line lines) {
+	starts.InsertText(Before(line), lines);
+}
+
+void StyledLines::DeleteLine(Sci::Line line) {
+	Remove(line);
+	starts.InsertText(Before(line), -1);
+}
+
+Sci::Line StyledLines::Next(Sci::Line line) const noexcept {
+	const Sci::Line index = Before(line);
+	return (index < Count()) ? At(index) : -1;
+}
+
+Sci::Line StyledLines::Previous(Sci::Line line) const noexcept {
+	const Sci::Line index = Before(line + 1);
+	return (index > 0) ? At(index - 1) : -1;
+}
+
 LineAnnotation::~LineAnnotation() {
 	ClearAll();
 }
@@ -323,6 +409,21 @@ void LineAnnotation::InsertLine(Sci::Line line) {
 	if (annotations.Length()) {
 		annotations.EnsureLength(line);
 		annotations.Insert(line, std::unique_ptr<char []>());
+		for (const std::unique_ptr<StyledLines> &sl : styledLines) {
+			if (sl)
+				sl->InsertLines(line, 1);
+		}
+	}
+}
+
+void LineAnnotation::InsertLines(Sci::Line line, Sci::Line lines) {
+	if (annotations.Length()) {
+		annotations.EnsureLength(line);
+		annotations.InsertEmpty(line, lines);
+		for (const std::unique_ptr<StyledLines> &sl : styledLines) {
+			if (sl)
+				sl->InsertLines(line, lines);
+		}
 	}
 }
 
@@ -330,6 +431,27 @@ void LineAnnotation::RemoveLine(Sci::Line line) {
 	if (annotations.Length() && (line > 0) && (line <= annotations.Length())) {
 		annotations[line-1].reset();
 		annotations.Delete(line-1);
+		for (const std::unique_ptr<StyledLines> &sl : styledLines) {
+			if (sl)
+				sl->DeleteLine(line-1);
+		}
+	}
+}
+
+void LineAnnotation::Restyled(Sci::Line line, int styleBefore, int style) {
+	if (styleBefore == style)
+		return;
+	if ((styleBefore > 0) && (styleBefore < static_cast<int>(styledLines.size())) && styledLines[styleBefore]) {
+		styledLines[styleBefore]->Remove(line);
+	}
+	if (style > 0) {
+		if (style >= static_cast<int>(styledLines.size())) {
+			styledLines.resize(style + 1);
+		}
+		if (!styledLines[style]) {
+			styledLines[style] = std::make_unique<StyledLines>();
+		}
+		styledLines[style]->Add(line);
 	}
 }
 
@@ -380,6 +502,7 @@ void LineAnnotation::SetText(Sci::Line line, const char *text) {
 		memcpy(pa+sizeof(AnnotationHeader), text, pah->length);
 	} else {
 		if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line]) {
+			Restyled(line, Style(line), 0);
 			annotations[line].reset();
 		}
 	}
@@ -387,18 +510,22 @@ void LineAnnotation::SetText(Sci::Line line, const char *text) {
 
 void LineAnnotation::ClearAll() {
 	annotations.DeleteAll();
+	styledLines.clear();
 }
 
 void LineAnnotation::SetStyle(Sci::Line line, int style) {
+	const int styleBefore = Style(line);
 	annotations.EnsureLength(line+1);
 	if (!annotations[line]) {
 		annotations[line] = AllocateAnnotation(0, style);
 	}
 	reinterpret_cast<AnnotationHeader *>(annotations[line].get())->style = static_cast<short>(style);
+	Restyled(line, styleBefore, Style(line));
 }
 
 void LineAnnotation::SetStyles(Sci::Line line, const unsigned char *styles) {
 	if (line >= 0) {
+		Restyled(line, Style(line), IndividualStyles);
 		annotations.EnsureLength(line+1);
 		if (!annotations[line]) {
 			annotations[line] = AllocateAnnotation(0, IndividualStyles);
@@ -433,6 +560,31 @@ int LineAnnotation::Lines(Sci::Line line) const {
 		return 0;
 }
 
+Sci::Line LineAnnotation::StyleNext(Sci::Line line, int style) const {
+	if ((style > 0) && (style < static_cast<int>(styledLines.size())) && styledLines[style])
+		return styledLines[style]->Next(line);
+	else
+		return -1;
+}
+
+Sci::Line LineAnnotation::StylePrevious(Sci::Line line, int style) const {
+	if ((style > 0) && (style < static_cast<int>(styledLines.size())) && styledLines[style])
+		return styledLines[style]->Previous(line);
+	else
+		return -1;
+}
+
+Sci::Line LineAnnotation::StyledLinesCount(int style) const noexcept {
+	if ((style > 0) && (style < static_cast<int>(styledLines.size())) && styledLines[style])
+		return styledLines[style]->Count();
+	else
+		return 0;
+}
+
+Sci::Line LineAnnotation::StyledLine(int style, Sci::Line index) const noexcept {
+	return styledLines[style]->At(index);
+}
+
 LineTabstops::~LineTabstops() {
 	tabstops.DeleteAll();
 }
@@ -448,6 +600,13 @@ void LineTabstops::InsertLine(Sci::Line line) {
 	}
 }
 
+void LineTabstops::InsertLines(Sci::Line line, Sci::Line lines) {
+	if (tabstops.Length()) {
+		tabstops.EnsureLength(line);
+		tabstops.InsertEmpty(line, lines);
+	}
+}
+
 void LineTabstops::RemoveLine(Sci::Line line) {
 	if (tabstops.Length() > line) {
 		tabstops[line].reset();
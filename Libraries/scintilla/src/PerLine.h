@@ -58,6 +58,7 @@ public:
 	~LineMarkers() override;
 	void Init() override;
 	void InsertLine(Sci::Line line) override;
+	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
 
 	int MarkValue(Sci::Line line) noexcept;
@@ -82,6 +83,7 @@ public:
 	~LineLevels() override;
 	void Init() override;
 	void InsertLine(Sci::Line line) override;
+	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
 
 	void ExpandLevels(Sci::Line sizeNew=-1);
@@ -103,6 +105,7 @@ public:
 	~LineState() override;
 	void Init() override;
 	void InsertLine(Sci::Line line) override;
+	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
 
 	int SetLineState(Sci::Line line, int state);
@@ -110,8 +113,41 @@ public:
 	Sci::Line GetMaxLineState() const;
 };
 
+/**
+ * The lines that have one style, in order.
+ * Each line is held as the start of a partition at line + 1, so the lines after an inserted or
+ * deleted line are moved with the step of the Partitioning and found with a binary search.
+ */
+class StyledLines {
+	Partitioning<Sci::Line> starts;
+	Sci::Line Before(Sci::Line line) const noexcept;
+public:
+	StyledLines();
+	// Deleted so StyledLines objects can not be copied.
+	StyledLines(const StyledLines &) = delete;
+	StyledLines(StyledLines &&) = delete;
+	void operator=(const StyledLines &) = delete;
+	void operator=(StyledLines &&) = delete;
+	~StyledLines();
+
+	Sci::Line Count() const noexcept;
+	Sci::Line At(Sci::Line index) const noexcept;
+	bool Contains(Sci::Line line) const noexcept;
+	void Add(Sci::Line line);
+	void Remove(Sci::Line line);
+	void InsertLines(Sci::Line line, Sci::Line lines);
+	void DeleteLine(Sci::Line line);
+	/// The first line from line, or -1 when none.
+	Sci::Line Next(Sci::Line line) const noexcept;
+	/// The last line up to line, or -1 when none.
+	Sci::Line Previous(Sci::Line line) const noexcept;
+};
+
 class LineAnnotation : public PerLine {
 	SplitVector<std::unique_ptr<char []>> annotations;
+	// Indexed by style, for the lines with styles other than 0
+	std::vector<std::unique_ptr<StyledLines>> styledLines;
+	void Restyled(Sci::Line line, int styleBefore, int style);
 public:
 	LineAnnotation() {
 	}
@@ -123,6 +159,7 @@ public:
 	~LineAnnotation() override;
 	void Init() override;
 	void InsertLine(Sci::Line line) override;
+	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
 
 	bool MultipleStyles(Sci::Line line) const;
@@ -135,6 +172,10 @@ public:
 	void SetStyles(Sci::Line line, const unsigned char *styles);
 	int Length(Sci::Line line) const;
 	int Lines(Sci::Line line) const;
+	Sci::Line StyleNext(Sci::Line line, int style) const;
+	Sci::Line StylePrevious(Sci::Line line, int style) const;
+	Sci::Line StyledLinesCount(int style) const noexcept;
+	Sci::Line StyledLine(int style, Sci::Line index) const noexcept;
 };
 
 typedef std::vector<int> TabstopList;
@@ -152,6 +193,7 @@ public:
 	~LineTabstops() override;
 	void Init() override;
 	void InsertLine(Sci::Line line) override;
+	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
 
 	bool ClearTabstops(Sci::Line line);
@@ -291,6 +291,21 @@ int LineLayout::EndLineStyle() const {
 	return styles[numCharsBeforeEOL > 0 ? numCharsBeforeEOL-1 : 0];
 }
 
+size_t LineLayout::MemoryUsed() const noexcept {
+	size_t bytes = sizeof(LineLayout);
+	if (chars) {
+		bytes += (maxLineLength + 1) * 2 + (maxLineLength + 2) * sizeof(XYPOSITION);
+	}
+	if (lineStarts) {
+		bytes += lenLineStarts * sizeof(int);
+	}
+	if (bidiData) {
+		bytes += sizeof(BidiData) + bidiData->stylesFonts.capacity() * sizeof(FontAlias) +
+			bidiData->widthReprs.capacity() * sizeof(XYPOSITION);
+	}
+	return bytes;
+}
+
 ScreenLine::ScreenLine(
 	const LineLayout *ll_,
 	int subLine,
@@ -354,7 +369,8 @@ XYPOSITION ScreenLine::TabPositionAfter(XYPOSITION xPosition) const {
 
 LineLayoutCache::LineLayoutCache() :
 	level(0),
-	allInvalidated(false), styleClock(-1), useCount(0) {
+	allInvalidated(false), styleClock(-1), useCount(0),
+	budget(0), useClock(0), bytesHeld(0), linesInDoc(-1), lookups(0), hits(0), evictions(0) {
 	Allocate(0);
 }
 
@@ -368,15 +384,15 @@ void LineLayoutCache::Allocate(size_t length_) {
 	cache.resize(length_);
 }
 
-void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc) {
+void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc_) {
 	PLATFORM_ASSERT(useCount == 0);
 	size_t lengthForLevel = 0;
 	if (level == llcCaret) {
 		lengthForLevel = 1;
 	} else if (level == llcPage) {
 		lengthForLevel = linesOnScreen + 1;
-	} else if (level == llcDocument) {
-		lengthForLevel = linesInDoc;
+	} else if ((level == llcDocument) && !Budgeted()) {
+		lengthForLevel = linesInDoc_;
 	}
 	if (lengthForLevel > cache.size()) {
 		Deallocate();
@@ -392,24 +408,126 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 	PLATFORM_ASSERT(cache.size() == lengthForLevel);
 }
 
+bool LineLayoutCache::Budgeted() const noexcept {
+	return (level == llcDocument) && (budget > 0);
+}
+
+LineLayout *LineLayoutCache::RetrieveHeld(Sci::Line lineNumber, int maxChars) {
+	std::map<Sci::Line, Held>::iterator it = held.find(lineNumber);
+	if (it != held.end()) {
+		recent.erase(it->second.lastUse);
+		if (it->second.ll->maxLineLength < maxChars) {
+			bytesHeld -= it->second.bytes;
+			held.erase(it);
+			it = held.end();
+		} else if (it->second.ll->validity != LineLayout::llInvalid) {
+			hits++;
+		}
+	}
+	if (it == held.end()) {
+		it = held.emplace(lineNumber, Held{ std::make_unique<LineLayout>(maxChars), 0, 0 }).first;
+		it->second.ll->lineNumber = lineNumber;
+		it->second.ll->inCache = true;
+	}
+	it->second.lastUse = ++useClock;
+	recent.emplace_hint(recent.end(), useClock, it->second.ll.get());
+	return it->second.ll.get();
+}
+
+void LineLayoutCache::Evict() noexcept {
+	// The layout used last is kept even when it is larger than the budget
+	while ((bytesHeld > budget) && (recent.size() > 1)) {
+		const std::map<unsigned long long, LineLayout *>::iterator oldest = recent.begin();
+		const std::map<Sci::Line, Held>::iterator it = held.find(oldest->second->lineNumber);
+		bytesHeld -= it->second.bytes;
+		held.erase(it);
+		recent.erase(oldest);
+		evictions++;
+	}
+}
+
 void LineLayoutCache::Deallocate() noexcept {
 	PLATFORM_ASSERT(useCount == 0);
 	cache.clear();
+	held.clear();
+	recent.clear();
+	bytesHeld = 0;
+	linesInDoc = -1;
 }
 
 void LineLayoutCache::Invalidate(LineLayout::validLevel validity_) {
-	if (!cache.empty() && !allInvalidated) {
+	if ((!cache.empty() || !held.empty()) && !allInvalidated) {
 		for (const std::unique_ptr<LineLayout> &ll : cache) {
 			if (ll) {
 				ll->Invalidate(validity_);
 			}
 		}
+		for (const std::pair<const Sci::Line, Held> &lineHeld : held) {
+			lineHeld.second.ll->Invalidate(validity_);
+		}
 		if (validity_ == LineLayout::llInvalid) {
 			allInvalidated = true;
 		}
 	}
 }
 
+void LineLayoutCache::Invalidate(LineLayout::validLevel validity_, Sci::Line lineFirst, Sci::Line lineLast) {
+	if (level == llcDocument) {
+		// Layouts are at the index of their line
+		const Sci::Line lineEnd = std::min(lineLast + 1, static_cast<Sci::Line>(cache.size()));
+		for (Sci::Line line = std::max(lineFirst, static_cast<Sci::Line>(0)); line < lineEnd; line++) {
+			if (cache[line]) {
+				cache[line]->Invalidate(validity_);
+			}
+		}
+	} else {
+		for (const std::unique_ptr<LineLayout> &ll : cache) {
+			if (ll && (ll->lineNumber >= lineFirst) && (ll->lineNumber <= lineLast)) {
+				ll->Invalidate(validity_);
+			}
+		}
+	}
+	for (std::map<Sci::Line, Held>::iterator it = held.lower_bound(lineFirst);
+		(it != held.end()) && (it->first <= lineLast); ++it) {
+		it->second.ll->Invalidate(validity_);
+	}
+}
+
+void LineLayoutCache::LinesChanged(Sci::Line line, Sci::Line linesAdded, Sci::Line linesInDoc_) {
+	if ((linesAdded != 0) && (linesInDoc == linesInDoc_)) {
+		// Already renumbered for another view sharing this cache
+		return;
+	}
+	linesInDoc = linesInDoc_;
+	if (!Budgeted()) {
+		// Layouts stay at the index of the line they were made for so may now hold other lines
+		Invalidate(LineLayout::llCheckTextAndStyle);
+		return;
+	}
+	Invalidate(LineLayout::llCheckTextAndStyle, line, line);
+	if (linesAdded < 0) {
+		// The deleted lines were joined onto line
+		std::map<Sci::Line, Held>::iterator it = held.upper_bound(line);
+		while ((it != held.end()) && (it->first <= line - linesAdded)) {
+			bytesHeld -= it->second.bytes;
+			recent.erase(it->second.lastUse);
+			it = held.erase(it);
+		}
+	}
+	if (linesAdded != 0) {
+		// Renumbering keeps the order so the layouts after line are put back at the end
+		std::vector<std::map<Sci::Line, Held>::node_type> after;
+		for (std::map<Sci::Line, Held>::iterator it = held.upper_bound(line); it != held.end();) {
+			after.push_back(held.extract(it++));
+		}
+		for (std::map<Sci::Line, Held>::node_type &node : after) {
+			node.key() += linesAdded;
+			node.mapped().ll->lineNumber = node.key();
+			held.insert(held.end(), std::move(node));
+		}
+	}
+}
+
 void LineLayoutCache::SetLevel(int level_) noexcept {
 	allInvalidated = false;
 	if ((level_ != -1) && (level != level_)) {
@@ -418,9 +536,65 @@ void LineLayoutCache::SetLevel(int level_) noexcept {
 	}
 }
 
+void LineLayoutCache::SetBudget(size_t budget_) noexcept {
+	allInvalidated = false;
+	if (budget != budget_) {
+		const bool budgetedBefore = Budgeted();
+		budget = budget_;
+		if (Budgeted() != budgetedBefore) {
+			Deallocate();
+		} else if (useCount == 0) {
+			Evict();
+		}
+	}
+}
+
+void LineLayoutCache::SetKey(const std::string &key_) {
+	key = key_;
+}
+
+void LineLayoutCache::GetStatistics(Sci_CacheStatistics *stats) const noexcept {
+	int size = 0;
+	int used = 0;
+	long long bytes = cache.capacity() * sizeof(std::unique_ptr<LineLayout>);
+	for (const std::unique_ptr<LineLayout> &ll : cache) {
+		if (ll) {
+			size++;
+			if (ll->validity >= LineLayout::llPositions) {
+				used++;
+			}
+			bytes += ll->MemoryUsed();
+		}
+	}
+	for (const std::pair<const Sci::Line, Held> &lineHeld : held) {
+		size++;
+		if (lineHeld.second.ll->validity >= LineLayout::llPositions) {
+			used++;
+		}
+	}
+	stats->size = size;
+	stats->used = used;
+	stats->bytes = bytes + bytesHeld;
+	stats->lookups = lookups;
+	stats->hits = hits;
+	stats->evictions = evictions;
+}
+
 LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
-                                      Sci::Line linesOnScreen, Sci::Line linesInDoc) {
-	AllocateForLevel(linesOnScreen, linesInDoc);
+                                      Sci::Line linesOnScreen, Sci::Line linesInDoc_) {
+	AllocateForLevel(linesOnScreen, linesInDoc_);
+	if (linesInDoc < 0) {
+		// Later changes are counted by LinesChanged
+		linesInDoc = linesInDoc_;
+	}
+	lookups++;
+	if (Budgeted()) {
+		// Styling invalidates the layouts of the lines it changes so the style clock is not needed
+		PLATFORM_ASSERT(useCount == 0);
+		allInvalidated = false;
+		useCount++;
+		return RetrieveHeld(lineNumber, maxChars);
+	}
 	if (styleClock != styleClock_) {
 		Invalidate(LineLayout::llCheckTextAndStyle);
 		styleClock = styleClock_;
@@ -446,6 +620,8 @@ LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret,
 				if ((cache[pos]->lineNumber != lineNumber) ||
 				        (cache[pos]->maxLineLength < maxChars)) {
 					cache[pos].reset();
+				} else if (cache[pos]->validity != LineLayout::llInvalid) {
+					hits++;
 				}
 			}
 			if (!cache[pos]) {
@@ -473,6 +649,18 @@ void LineLayoutCache::Dispose(LineLayout *ll) noexcept {
 			delete ll;
 		} else {
 			useCount--;
+			if (Budgeted()) {
+				// Layouts grow as they are used so are measured when given back
+				const std::map<Sci::Line, Held>::iterator it = held.find(ll->lineNumber);
+				if ((it != held.end()) && (it->second.ll.get() == ll)) {
+					const size_t bytes = ll->MemoryUsed();
+					bytesHeld = bytesHeld - it->second.bytes + bytes;
+					it->second.bytes = bytes;
+				}
+				if (useCount == 0) {
+					Evict();
+				}
+			}
 		}
 	}
 }
@@ -494,6 +682,15 @@ SpecialRepresentations::SpecialRepresentations() noexcept {
 	std::fill(startByteHasReprs, std::end(startByteHasReprs), none);
 }
 
+std::string SpecialRepresentations::Key() const {
+	std::string key;
+	for (const std::pair<const unsigned int, Representation> &repr : mapReprs) {
+		key.append(reinterpret_cast<const char *>(&repr.first), sizeof(repr.first));
+		key.append(repr.second.stringRep.c_str(), repr.second.stringRep.length() + 1);
+	}
+	return key;
+}
+
 void SpecialRepresentations::SetRepresentation(const char *charBytes, const char *value) {
 	const unsigned int key = KeyFromString(charBytes, UTF8MaxBytes);
 	MapRepresentation::iterator it = mapReprs.find(key);
@@ -669,96 +866,147 @@ bool BreakFinder::More() const noexcept {
 	return (subBreak >= 0) || (nextBreak < lineRange.end);
 }
 
-PositionCacheEntry::PositionCacheEntry() noexcept :
-	styleNumber(0), len(0), clock(0), positions(nullptr) {
-}
-
-// Copy constructor not currently used, but needed for being element in std::vector.
-PositionCacheEntry::PositionCacheEntry(const PositionCacheEntry &other) :
-	styleNumber(other.styleNumber), len(other.styleNumber), clock(other.styleNumber), positions(nullptr) {
-	if (other.positions) {
-		const size_t lenData = len + (len / sizeof(XYPOSITION)) + 1;
-		positions = std::make_unique<XYPOSITION[]>(lenData);
-		memcpy(positions.get(), other.positions.get(), lenData * sizeof(XYPOSITION));
-	}
-}
-
-void PositionCacheEntry::Set(unsigned int styleNumber_, const char *s_,
-	unsigned int len_, const XYPOSITION *positions_, unsigned int clock_) {
-	Clear();
-	styleNumber = styleNumber_;
-	len = len_;
-	clock = clock_;
-	if (s_ && positions_) {
-		positions = std::make_unique<XYPOSITION[]>(len + (len / sizeof(XYPOSITION)) + 1);
-		for (unsigned int i=0; i<len; i++) {
-			positions[i] = positions_[i];
-		}
-		memcpy(&positions[len], s_, len);
+unsigned int PositionCache::Hash(unsigned int measureKey, const char *s, unsigned int len) noexcept {
+	unsigned int ret = s[0] << 7;
+	for (unsigned int i=0; i<len; i++) {
+		ret *= 1000003;
+		ret ^= s[i];
 	}
+	ret *= 1000003;
+	ret ^= len;
+	ret *= 1000003;
+	ret ^= measureKey;
+	return ret;
 }
 
-PositionCacheEntry::~PositionCacheEntry() {
-	Clear();
-}
-
-void PositionCacheEntry::Clear() noexcept {
-	positions.reset();
-	styleNumber = 0;
-	len = 0;
-	clock = 0;
+// Slab i has slots of 8 << i positions and bytes.
+size_t PositionCache::SlabOf(unsigned int len) noexcept {
+	size_t slab = 0;
+	while ((len - 1) >> (slotShiftMin + slab))
+		slab++;
+	return slab;
 }
 
-bool PositionCacheEntry::Retrieve(unsigned int styleNumber_, const char *s_,
-	unsigned int len_, XYPOSITION *positions_) const {
-	if ((styleNumber == styleNumber_) && (len == len_) &&
-		(memcmp(&positions[len], s_, len)== 0)) {
-		for (unsigned int i=0; i<len; i++) {
-			positions_[i] = positions[i];
+void PositionCache::Release(Entry &entry) noexcept {
+	if (entry.len) {
+		try {
+			slabs[SlabOf(entry.len)].freeSlots.push_back(entry.slot);
+		} catch (...) {
+			// The slot is lost until the cache is cleared
 		}
-		return true;
+	}
+	entry = Entry();
+}
+
+void PositionCache::Store(Entry &entry, unsigned int hash, unsigned int measureKey, const char *s,
+	unsigned int len, const XYPOSITION *positions) {
+	Release(entry);
+	const size_t slabIndex = SlabOf(len);
+	Slab &slab = slabs[slabIndex];
+	const size_t lengthSlot = static_cast<size_t>(1) << (slotShiftMin + slabIndex);
+	unsigned int slot;
+	if (!slab.freeSlots.empty()) {
+		slot = slab.freeSlots.back();
+		slab.freeSlots.pop_back();
 	} else {
-		return false;
+		slot = static_cast<unsigned int>(slab.widths.size() / lengthSlot);
+		slab.widths.resize(slab.widths.size() + lengthSlot);
+		slab.text.resize(slab.text.size() + lengthSlot);
 	}
+	const size_t offset = slot * lengthSlot;
+	std::copy(positions, positions + len, slab.widths.begin() + offset);
+	memcpy(&slab.text[offset], s, len);
+	entry.hash = hash;
+	entry.measureKey = measureKey;
+	entry.len = len;
+	entry.slot = slot;
+	entry.lastUse = clock++;
+	allClear = false;
 }
 
-unsigned int PositionCacheEntry::Hash(unsigned int styleNumber_, const char *s, unsigned int len_) noexcept {
-	unsigned int ret = s[0] << 7;
-	for (unsigned int i=0; i<len_; i++) {
-		ret *= 1000003;
-		ret ^= s[i];
+// Entries move to their sets in the new size, keeping their slots. Those that do not fit are dropped.
+void PositionCache::Resize(size_t size) {
+	if ((size > 0) && (size % ways))
+		size += ways - size % ways;
+	std::vector<Entry> entriesOld(size);
+	entries.swap(entriesOld);
+	const size_t sets = entries.size() / ways;
+	for (Entry &entryOld : entriesOld) {
+		if (entryOld.len) {
+			Entry *set = sets ? &entries[(entryOld.hash % sets) * ways] : nullptr;
+			Entry *empty = set ? std::find_if(set, set + ways, [](const Entry &e) noexcept { return e.len == 0; }) : nullptr;
+			if (empty && (empty != set + ways)) {
+				*empty = entryOld;
+			} else {
+				Release(entryOld);
+			}
+		}
 	}
-	ret *= 1000003;
-	ret ^= len_;
-	ret *= 1000003;
-	ret ^= styleNumber_;
-	return ret;
 }
 
-bool PositionCacheEntry::NewerThan(const PositionCacheEntry &other) const noexcept {
-	return clock > other.clock;
+// After each window of lookups, grows when many entries were replaced as the runs seen do not fit.
+void PositionCache::Adapt() {
+	if (lookupsWindow >= window) {
+		if ((evictionsWindow > window / 8) && (entries.size() < sizeSet * growthMax))
+			Resize(entries.size() * 2);
+		lookupsWindow = 0;
+		evictionsWindow = 0;
+	}
 }
 
-void PositionCacheEntry::ResetClock() noexcept {
-	if (clock > 0) {
-		clock = 1;
+void PositionCache::MeasureRun(Surface *surface, Font &font, unsigned int measureKey,
+	const char *s, unsigned int len, XYPOSITION *positions) {
+	if (entries.empty() || (len == 0) || (len > BreakFinder::lengthStartSubdivision)) {
+		surface->MeasureWidths(font, std::string_view(s, len), positions);
+		return;
+	}
+	lookups++;
+	lookupsWindow++;
+	const unsigned int hashValue = Hash(measureKey, s, len);
+	Entry *set = &entries[(hashValue % (entries.size() / ways)) * ways];
+	Entry *oldest = set;
+	const size_t slabIndex = SlabOf(len);
+	const size_t offsetShift = slotShiftMin + slabIndex;
+	for (Entry *entry = set; entry < set + ways; entry++) {
+		if ((entry->hash == hashValue) && (entry->len == len) && (entry->measureKey == measureKey)) {
+			const Slab &slab = slabs[slabIndex];
+			const size_t offset = static_cast<size_t>(entry->slot) << offsetShift;
+			if (memcmp(&slab.text[offset], s, len) == 0) {
+				std::copy(slab.widths.begin() + offset, slab.widths.begin() + offset + len, positions);
+				entry->lastUse = clock++;
+				hits++;
+				return;
+			}
+		}
+		// Empty entries are used first, then the least recently used
+		if (oldest->len && (!entry->len || (clock - entry->lastUse > clock - oldest->lastUse)))
+			oldest = entry;
+	}
+	surface->MeasureWidths(font, std::string_view(s, len), positions);
+	if (oldest->len) {
+		evictions++;
+		evictionsWindow++;
 	}
+	Store(*oldest, hashValue, measureKey, s, len, positions);
+	Adapt();
 }
 
-PositionCache::PositionCache() {
-	clock = 1;
-	pces.resize(0x400);
-	allClear = true;
+PositionCache::PositionCache() :
+	slabs(slabCount), sizeSet(0x400), clock(1), allClear(true),
+	lookups(0), hits(0), evictions(0), lookupsWindow(0), evictionsWindow(0) {
+	Resize(sizeSet);
 }
 
 PositionCache::~PositionCache() {
-	Clear();
 }
 
 void PositionCache::Clear() noexcept {
 	if (!allClear) {
-		for (PositionCacheEntry &pce : pces) {
-			pce.Clear();
+		std::fill(entries.begin(), entries.end(), Entry());
+		for (Slab &slab : slabs) {
+			std::vector<XYPOSITION>().swap(slab.widths);
+			std::vector<char>().swap(slab.text);
+			std::vector<unsigned int>().swap(slab.freeSlots);
 		}
 	}
 	clock = 1;
@@ -767,41 +1015,36 @@ void PositionCache::Clear() noexcept {
 
 void PositionCache::SetSize(size_t size_) {
 	Clear();
-	pces.resize(size_);
+	sizeSet = size_;
+	Resize(sizeSet);
+}
+
+void PositionCache::GetStatistics(Sci_CacheStatistics *stats) const noexcept {
+	stats->size = static_cast<int>(entries.size());
+	stats->used = static_cast<int>(std::count_if(entries.begin(), entries.end(),
+		[](const Entry &e) noexcept { return e.len != 0; }));
+	long long bytes = entries.capacity() * sizeof(Entry);
+	for (const Slab &slab : slabs) {
+		bytes += slab.widths.capacity() * sizeof(XYPOSITION) + slab.text.capacity() +
+			slab.freeSlots.capacity() * sizeof(unsigned int);
+	}
+	stats->bytes = bytes;
+	stats->lookups = lookups;
+	stats->hits = hits;
+	stats->evictions = evictions;
 }
 
 void PositionCache::MeasureWidths(Surface *surface, const ViewStyle &vstyle, unsigned int styleNumber,
 	const char *s, unsigned int len, XYPOSITION *positions, const Document *pdoc) {
-
-	allClear = false;
-	size_t probe = pces.size();	// Out of bounds
-	if ((!pces.empty()) && (len < 30)) {
-		// Only store short strings in the cache so it doesn't churn with
-		// long comments with only a single comment.
-
-		// Two way associative: try two probe positions.
-		const unsigned int hashValue = PositionCacheEntry::Hash(styleNumber, s, len);
-		probe = hashValue % pces.size();
-		if (pces[probe].Retrieve(styleNumber, s, len, positions)) {
-			return;
-		}
-		const unsigned int probe2 = (hashValue * 37) % pces.size();
-		if (pces[probe2].Retrieve(styleNumber, s, len, positions)) {
-			return;
-		}
-		// Not found. Choose the oldest of the two slots to replace
-		if (pces[probe].NewerThan(pces[probe2])) {
-			probe = probe2;
-		}
-	}
+	FontAlias fontStyle = vstyle.styles[styleNumber].font;
+	const unsigned int measureKey = vstyle.styles[styleNumber].measureKey;
 	if (len > BreakFinder::lengthStartSubdivision) {
-		// Break up into segments
+		// Break up into segments, each cached
 		unsigned int startSegment = 0;
 		XYPOSITION xStartSegment = 0;
 		while (startSegment < len) {
 			const unsigned int lenSegment = pdoc->SafeSegment(s + startSegment, len - startSegment, BreakFinder::lengthEachSubdivision);
-			FontAlias fontStyle = vstyle.styles[styleNumber].font;
-			surface->MeasureWidths(fontStyle, std::string_view(s + startSegment, lenSegment), positions + startSegment);
+			MeasureRun(surface, fontStyle, measureKey, s + startSegment, lenSegment, positions + startSegment);
 			for (unsigned int inSeg = 0; inSeg < lenSegment; inSeg++) {
 				positions[startSegment + inSeg] += xStartSegment;
 			}
@@ -809,20 +1052,6 @@ void PositionCache::MeasureWidths(Surface *surface, const ViewStyle &vstyle, uns
 			startSegment += lenSegment;
 		}
 	} else {
-		FontAlias fontStyle = vstyle.styles[styleNumber].font;
-		surface->MeasureWidths(fontStyle, std::string_view(s, len), positions);
-	}
-	if (probe < pces.size()) {
-		// Store into cache
-		clock++;
-		if (clock > 60000) {
-			// Since there are only 16 bits for the clock, wrap it round and
-			// reset all cache entries so none get stuck with a high clock.
-			for (PositionCacheEntry &pce : pces) {
-				pce.ResetClock();
-			}
-			clock = 2;
-		}
-		pces[probe].Set(styleNumber, s, len, positions, clock);
+		MeasureRun(surface, fontStyle, measureKey, s, len, positions);
 	}
 }
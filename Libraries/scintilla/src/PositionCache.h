@@ -113,6 +113,7 @@ public:
 	int FindPositionFromX(XYPOSITION x, Range range, bool charPosition) const;
 	Point PointFromPosition(int posInLine, int lineHeight, PointEnd pe) const;
 	int EndLineStyle() const;
+	size_t MemoryUsed() const noexcept;
 };
 
 struct ScreenLine : public IScreenLine {
@@ -147,14 +148,37 @@ struct ScreenLine : public IScreenLine {
 
 /**
  */
+/**
+ * With a budget, the document level holds the layouts of the lines used most recently in
+ * about budget bytes instead of one for every line.
+ * Edits invalidate and renumber only the layouts of the lines they change.
+ */
 class LineLayoutCache {
+	struct Held {
+		std::unique_ptr<LineLayout> ll;
+		size_t bytes;
+		unsigned long long lastUse;
+	};
 	int level;
 	std::vector<std::unique_ptr<LineLayout>>cache;
 	bool allInvalidated;
 	int styleClock;
 	int useCount;
+	size_t budget;
+	std::map<Sci::Line, Held> held;
+	std::map<unsigned long long, LineLayout *> recent;	// By lastUse
+	unsigned long long useClock;
+	size_t bytesHeld;
+	Sci::Line linesInDoc;	// Lines in the document when the held layouts were last numbered
+	std::string key;
+	long long lookups;
+	long long hits;
+	long long evictions;
 	void Allocate(size_t length_);
-	void AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc);
+	void AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc_);
+	bool Budgeted() const noexcept;
+	LineLayout *RetrieveHeld(Sci::Line lineNumber, int maxChars);
+	void Evict() noexcept;
 public:
 	LineLayoutCache();
 	// Deleted so LineLayoutCache objects can not be copied.
@@ -171,35 +195,24 @@ public:
 		llcDocument=SC_CACHE_DOCUMENT
 	};
 	void Invalidate(LineLayout::validLevel validity_);
+	/// Invalidates the layouts of lines lineFirst to lineLast.
+	void Invalidate(LineLayout::validLevel validity_, Sci::Line lineFirst, Sci::Line lineLast);
+	/// Called after text is inserted or deleted in line, adding linesAdded lines after it to make linesInDoc_ lines.
+	/// Each view sharing the cache calls it for the same change, which is only applied once.
+	void LinesChanged(Sci::Line line, Sci::Line linesAdded, Sci::Line linesInDoc_);
 	void SetLevel(int level_) noexcept;
 	int GetLevel() const noexcept { return level; }
+	void SetBudget(size_t budget_) noexcept;
+	size_t GetBudget() const noexcept { return budget; }
+	void GetStatistics(Sci_CacheStatistics *stats) const noexcept;
+	/// Views of a document whose layout settings give equal keys share the cache with this key.
+	void SetKey(const std::string &key_);
+	const std::string &GetKey() const noexcept { return key; }
 	LineLayout *Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
-		Sci::Line linesOnScreen, Sci::Line linesInDoc);
+		Sci::Line linesOnScreen, Sci::Line linesInDoc_);
 	void Dispose(LineLayout *ll) noexcept;
 };
 
-class PositionCacheEntry {
-	unsigned int styleNumber:8;
-	unsigned int len:8;
-	unsigned int clock:16;
-	std::unique_ptr<XYPOSITION []> positions;
-public:
-	PositionCacheEntry() noexcept;
-	// Copy constructor not currently used, but needed for being element in std::vector.
-	PositionCacheEntry(const PositionCacheEntry &);
-	// Deleted so PositionCacheEntry objects can not be assigned.
-	PositionCacheEntry(PositionCacheEntry &&) = delete;
-	void operator=(const PositionCacheEntry &) = delete;
-	void operator=(PositionCacheEntry &&) = delete;
-	~PositionCacheEntry();
-	void Set(unsigned int styleNumber_, const char *s_, unsigned int len_, const XYPOSITION *positions_, unsigned int clock_);
-	void Clear() noexcept;
-	bool Retrieve(unsigned int styleNumber_, const char *s_, unsigned int len_, XYPOSITION *positions_) const;
-	static unsigned int Hash(unsigned int styleNumber_, const char *s, unsigned int len_) noexcept;
-	bool NewerThan(const PositionCacheEntry &other) const noexcept;
-	void ResetClock() noexcept;
-};
-
 class Representation {
 public:
 	std::string stringRep;
@@ -219,6 +232,8 @@ public:
 	const Representation *RepresentationFromCharacter(const char *charBytes, size_t len) const;
 	bool Contains(const char *charBytes, size_t len) const;
 	void Clear();
+	/// Returns a string which is equal for equal sets of representations.
+	std::string Key() const;
 };
 
 struct TextSegment {
@@ -265,10 +280,48 @@ public:
 	bool More() const noexcept;
 };
 
+/**
+ * Caches the widths of runs of text so that each is measured once.
+ * Runs are found by their text and the measure key of their font, so one cache can be shared by
+ * the views of a document, and styles with the same font share widths.
+ * Entries are in sets of ways with the least recently used replaced. Their widths and text are held
+ * in slabs of slots sized in powers of 2.
+ * When many entries are replaced the cache grows, up to growthMax times the size set.
+ * Runs longer than BreakFinder::lengthStartSubdivision are measured and cached in segments.
+ */
 class PositionCache {
-	std::vector<PositionCacheEntry> pces;
+	struct Entry {
+		unsigned int hash = 0;
+		unsigned int measureKey = 0;
+		unsigned int len = 0;	// 0 when empty
+		unsigned int slot = 0;
+		unsigned int lastUse = 0;
+	};
+	struct Slab {
+		std::vector<XYPOSITION> widths;
+		std::vector<char> text;
+		std::vector<unsigned int> freeSlots;
+	};
+	enum { ways = 4, slabCount = 7, slotShiftMin = 3, growthMax = 16, window = 0x1000 };
+	std::vector<Entry> entries;
+	std::vector<Slab> slabs;
+	size_t sizeSet;
 	unsigned int clock;
 	bool allClear;
+	unsigned long long lookups;
+	unsigned long long hits;
+	unsigned long long evictions;
+	unsigned int lookupsWindow;
+	unsigned int evictionsWindow;
+
+	static unsigned int Hash(unsigned int measureKey, const char *s, unsigned int len) noexcept;
+	static size_t SlabOf(unsigned int len) noexcept;
+	void Release(Entry &entry) noexcept;
+	void Store(Entry &entry, unsigned int hash, unsigned int measureKey, const char *s, unsigned int len, const XYPOSITION *positions);
+	void Resize(size_t size);
+	void Adapt();
+	void MeasureRun(Surface *surface, Font &font, unsigned int measureKey,
+		const char *s, unsigned int len, XYPOSITION *positions);
 public:
 	PositionCache();
 	// Deleted so PositionCache objects can not be copied.
@@ -279,7 +332,8 @@ public:
 	~PositionCache();
 	void Clear() noexcept;
 	void SetSize(size_t size_);
-	size_t GetSize() const noexcept { return pces.size(); }
+	size_t GetSize() const noexcept { return sizeSet; }
+	void GetStatistics(Sci_CacheStatistics *stats) const noexcept;
 	void MeasureWidths(Surface *surface, const ViewStyle &vstyle, unsigned int styleNumber,
 		const char *s, unsigned int len, XYPOSITION *positions, const Document *pdoc);
 };
@@ -59,6 +59,14 @@ void RunStyles<DISTANCE, STYLE>::RemoveRun(DISTANCE run) {
 	styles->DeleteRange(run, 1);
 }
 
+template <typename DISTANCE, typename STYLE>
+void RunStyles<DISTANCE, STYLE>::RemoveRuns(DISTANCE run, DISTANCE count) {
+	if (count > 0) {
+		starts->RemovePartitions(run, count);
+		styles->DeleteRange(run, count);
+	}
+}
+
 template <typename DISTANCE, typename STYLE>
 void RunStyles<DISTANCE, STYLE>::RemoveRunIfEmpty(DISTANCE run) {
 	if ((run < starts->Partitions()) && (starts->Partitions() > 1)) {
@@ -165,10 +173,8 @@ FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, ST
 	if (runStart < runEnd) {
 		const FillResult<DISTANCE> result{ true, position, fillLength };
 		styles->SetValueAt(runStart, value);
-		// Remove each old run over the range
-		for (DISTANCE run=runStart+1; run<runEnd; run++) {
-			RemoveRun(runStart+1);
-		}
+		// Remove the old runs over the range
+		RemoveRuns(runStart+1, runEnd-runStart-1);
 		runEnd = RunFromPosition(end);
 		RemoveRunIfSameAsPrevious(runEnd);
 		RemoveRunIfSameAsPrevious(runStart);
@@ -180,6 +186,76 @@ FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, ST
 	}
 }
 
+// Merges the ranges into the runs they cover in one pass then replaces those runs,
+// instead of splitting and merging runs for each range.
+template <typename DISTANCE, typename STYLE>
+FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRanges(const DISTANCE *ranges, size_t count, STYLE value) {
+	if (count == 0) {
+		return FillResult<DISTANCE>{false, 0, 0};
+	}
+	if (count == 1) {
+		return FillRange(ranges[0], value, ranges[1]);
+	}
+	const DISTANCE spanStart = ranges[0];
+	const DISTANCE spanEnd = ranges[2 * (count - 1)] + ranges[2 * (count - 1) + 1];
+	const FillResult<DISTANCE> resultNoChange{false, spanStart, spanEnd - spanStart};
+	if ((spanStart < 0) || (spanEnd > Length())) {
+		return resultNoChange;
+	}
+	if (spanEnd < Length()) {
+		SplitRun(spanEnd);
+	}
+	const DISTANCE runStart = SplitRun(spanStart);
+	const DISTANCE runEnd = (spanEnd < Length()) ? RunFromPosition(spanEnd) : starts->Partitions();
+	std::vector<DISTANCE> startsSpan;
+	std::vector<STYLE> stylesSpan;
+	DISTANCE changeStart = spanEnd;
+	DISTANCE changeEnd = spanStart;
+	size_t range = 0;
+	DISTANCE position = spanStart;
+	for (DISTANCE run = runStart; run < runEnd; run++) {
+		const DISTANCE endRun = starts->PositionFromPartition(run + 1);
+		const STYLE styleRun = styles->ValueAt(run);
+		while (position < endRun) {
+			DISTANCE end = endRun;
+			STYLE style = styleRun;
+			if ((range < count) && (position >= ranges[2 * range])) {
+				const DISTANCE endRange = ranges[2 * range] + ranges[2 * range + 1];
+				end = std::min(end, endRange);
+				style = value;
+				if (styleRun != value) {
+					changeStart = std::min(changeStart, position);
+					changeEnd = end;
+				}
+				if (end == endRange) {
+					range++;
+				}
+			} else if (range < count) {
+				end = std::min(end, ranges[2 * range]);
+			}
+			if (stylesSpan.empty() || (stylesSpan.back() != style)) {
+				startsSpan.push_back(position);
+				stylesSpan.push_back(style);
+			}
+			position = end;
+		}
+	}
+	if (changeStart >= changeEnd) {
+		// Runs split at the ends of the span are joined again
+		if (spanEnd < Length()) {
+			RemoveRunIfSameAsPrevious(runEnd);
+		}
+		RemoveRunIfSameAsPrevious(runStart);
+		return resultNoChange;
+	}
+	RemoveRuns(runStart, runEnd - runStart);
+	starts->InsertPartitions(runStart, startsSpan.data(), startsSpan.size());
+	styles->InsertFromArray(runStart, stylesSpan.data(), 0, stylesSpan.size());
+	RemoveRunIfSameAsPrevious(runStart + static_cast<DISTANCE>(stylesSpan.size()));
+	RemoveRunIfSameAsPrevious(runStart);
+	return FillResult<DISTANCE>{true, changeStart, changeEnd - changeStart};
+}
+
 template <typename DISTANCE, typename STYLE>
 void RunStyles<DISTANCE, STYLE>::SetValueAt(DISTANCE position, STYLE value) {
 	FillRange(position, value, 1);
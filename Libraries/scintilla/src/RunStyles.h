@@ -30,6 +30,7 @@ private:
 	DISTANCE RunFromPosition(DISTANCE position) const noexcept;
 	DISTANCE SplitRun(DISTANCE position);
 	void RemoveRun(DISTANCE run);
+	void RemoveRuns(DISTANCE run, DISTANCE count);
 	void RemoveRunIfEmpty(DISTANCE run);
 	void RemoveRunIfSameAsPrevious(DISTANCE run);
 public:
@@ -47,6 +48,8 @@ public:
 	DISTANCE EndRun(DISTANCE position) const noexcept;
 	// Returns changed=true if some values may have changed
 	FillResult<DISTANCE> FillRange(DISTANCE position, STYLE value, DISTANCE fillLength);
+	// ranges holds count pairs of position and length, sorted by position, not overlapping nor empty
+	FillResult<DISTANCE> FillRanges(const DISTANCE *ranges, size_t count, STYLE value);
 	void SetValueAt(DISTANCE position, STYLE value);
 	void InsertSpace(DISTANCE position, DISTANCE insertLength);
 	void DeleteAll();
@@ -612,6 +612,8 @@ LexState *ScintillaBase::DocumentLexState() {
 
 void LexState::SetLexerModule(const LexerModule *lex) {
 	if (lex != lexCurrent) {
+		// Lexers that are changed or released must not be styling on another thread
+		pdoc->StopBackgroundStyling();
 		if (instance) {
 			instance->Release();
 			instance = nullptr;
@@ -657,6 +659,7 @@ const char *LexState::DescribeWordListSets() {
 
 void LexState::SetWordList(int n, const char *wl) {
 	if (instance) {
+		pdoc->StopBackgroundStyling();
 		const Sci_Position firstModification = instance->WordListSet(n, wl);
 		if (firstModification >= 0) {
 			pdoc->ModifiedAt(firstModification);
@@ -670,6 +673,7 @@ const char *LexState::GetName() const {
 
 void *LexState::PrivateCall(int operation, void *pointer) {
 	if (pdoc && instance) {
+		pdoc->StopBackgroundStyling();
 		return instance->PrivateCall(operation, pointer);
 	} else {
 		return nullptr;
@@ -703,6 +707,7 @@ const char *LexState::DescribeProperty(const char *name) {
 void LexState::PropSet(const char *key, const char *val) {
 	props.Set(key, val, strlen(key), strlen(val));
 	if (instance) {
+		pdoc->StopBackgroundStyling();
 		const Sci_Position firstModification = instance->PropertySet(key, val);
 		if (firstModification >= 0) {
 			pdoc->ModifiedAt(firstModification);
@@ -731,6 +736,7 @@ int LexState::LineEndTypesSupported() {
 
 int LexState::AllocateSubStyles(int styleBase, int numberStyles) {
 	if (instance) {
+		pdoc->StopBackgroundStyling();
 		return instance->AllocateSubStyles(styleBase, numberStyles);
 	}
 	return -1;
@@ -766,12 +772,14 @@ int LexState::PrimaryStyleFromStyle(int style) {
 
 void LexState::FreeSubStyles() {
 	if (instance) {
+		pdoc->StopBackgroundStyling();
 		instance->FreeSubStyles();
 	}
 }
 
 void LexState::SetIdentifiers(int style, const char *identifiers) {
 	if (instance) {
+		pdoc->StopBackgroundStyling();
 		instance->SetIdentifiers(style, identifiers);
 		pdoc->ModifiedAt(0);
 	}
@@ -0,0 +1,158 @@
+// Scintilla source code edit control
+/** @file SearchFilter.cxx
+ ** Fast scanning of contiguous text for positions where a search string may start.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SEARCHFILTER_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#include "SearchFilter.h"
+
+using namespace Scintilla;
+
+namespace {
+
+#ifdef SEARCHFILTER_SSE2
+
+constexpr ptrdiff_t blockSize = 16;
+
+inline int LowestBit(unsigned int mask) noexcept {
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+inline int HighestBit(unsigned int mask) noexcept {
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanReverse(&index, mask);
+	return static_cast<int>(index);
+#else
+	return 31 - __builtin_clz(mask);
+#endif
+}
+
+// Vector form of SearchFilter::ByteSet.
+class ByteSetSSE2 {
+	__m128i a;
+	__m128i b;
+	bool leads;
+public:
+	explicit ByteSetSSE2(const SearchFilter::ByteSet &set) noexcept :
+		a(_mm_set1_epi8(static_cast<char>(set.a))),
+		b(_mm_set1_epi8(static_cast<char>(set.b))),
+		leads(set.leads) {
+	}
+	__m128i Specific(__m128i v) const noexcept {
+		return _mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b));
+	}
+	__m128i Contains(__m128i v) const noexcept {
+		const __m128i m = Specific(v);
+		return leads ? _mm_or_si128(m, Leads(v)) : m;
+	}
+	static __m128i Leads(__m128i v) noexcept {
+		const __m128i maskLead = _mm_set1_epi8(static_cast<char>(0xC0));
+		return _mm_cmpeq_epi8(_mm_and_si128(v, maskLead), maskLead);
+	}
+};
+
+#endif
+
+}
+
+SearchFilter::SearchFilter(ByteSet first_, ByteSet second_) noexcept : first(first_), second(second_) {
+}
+
+ptrdiff_t SearchFilter::Forward(const char *s, ptrdiff_t length, ptrdiff_t available) const noexcept {
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(s);
+	ptrdiff_t i = 0;
+#ifdef SEARCHFILTER_SSE2
+	// Each block reads 16 bytes at i and 16 at i+1, so stop 1 byte before the end of available text.
+	const ptrdiff_t endBlocks = (length < available) ? length : available - 1;
+	if (endBlocks >= blockSize) {
+		const ByteSetSSE2 vFirst(first);
+		const ByteSetSSE2 vSecond(second);
+		for (; i + blockSize <= endBlocks; i += blockSize) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(us + i));
+			__m128i m = vFirst.Specific(v);
+			if (!second.any) {
+				const __m128i vNext = _mm_loadu_si128(reinterpret_cast<const __m128i *>(us + i + 1));
+				m = _mm_and_si128(m, vSecond.Contains(vNext));
+			}
+			if (first.leads)
+				m = _mm_or_si128(m, ByteSetSSE2::Leads(v));
+			const unsigned int mask = _mm_movemask_epi8(m);
+			if (mask)
+				return i + LowestBit(mask);
+		}
+	}
+#else
+	if (first.a == first.b && !first.leads) {
+		// memchr is vectorized by most C libraries
+		while (i < length) {
+			const void *found = memchr(us + i, first.a, length - i);
+			if (!found)
+				return -1;
+			i = static_cast<const unsigned char *>(found) - us;
+			if (Candidate(us, i, available))
+				return i;
+			i++;
+		}
+		return -1;
+	}
+#endif
+	for (; i < length; i++) {
+		if (Candidate(us, i, available))
+			return i;
+	}
+	return -1;
+}
+
+ptrdiff_t SearchFilter::Backward(const char *s, ptrdiff_t length, ptrdiff_t available) const noexcept {
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(s);
+	ptrdiff_t i = length;
+#ifdef SEARCHFILTER_SSE2
+	// Positions from endBlocks can't be checked in blocks because the next byte may not be available.
+	const ptrdiff_t endBlocks = (length < available) ? length : available - 1;
+	for (; i > endBlocks; i--) {
+		if (Candidate(us, i - 1, available))
+			return i - 1;
+	}
+	if (i >= blockSize) {
+		const ByteSetSSE2 vFirst(first);
+		const ByteSetSSE2 vSecond(second);
+		for (; i >= blockSize; i -= blockSize) {
+			const ptrdiff_t block = i - blockSize;
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(us + block));
+			__m128i m = vFirst.Specific(v);
+			if (!second.any) {
+				const __m128i vNext = _mm_loadu_si128(reinterpret_cast<const __m128i *>(us + block + 1));
+				m = _mm_and_si128(m, vSecond.Contains(vNext));
+			}
+			if (first.leads)
+				m = _mm_or_si128(m, ByteSetSSE2::Leads(v));
+			const unsigned int mask = _mm_movemask_epi8(m);
+			if (mask)
+				return block + HighestBit(mask);
+		}
+	}
+#endif
+	for (; i > 0; i--) {
+		if (Candidate(us, i - 1, available))
+			return i - 1;
+	}
+	return -1;
+}
@@ -0,0 +1,65 @@
+// Scintilla source code edit control
+/** @file SearchFilter.h
+ ** Fast scanning of contiguous text for positions where a search string may start.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef SEARCHFILTER_H
+#define SEARCHFILTER_H
+
+namespace Scintilla {
+
+/**
+ * Skips text that can not match a search string, 16 bytes at a time where SSE2 is available.
+ * A position is a candidate when its byte is in the first set and the next byte is in the second set,
+ * or when its byte is a UTF-8 lead byte and the first set includes lead bytes.
+ * Candidates are not matches: the caller verifies each one, so the filter only has to be a superset.
+ */
+class SearchFilter {
+public:
+	/// Up to 2 specific bytes, optionally all bytes >= 0xC0 (UTF-8 lead bytes and invalid bytes),
+	/// or any byte.
+	struct ByteSet {
+		unsigned char a = 0;
+		unsigned char b = 0;
+		bool leads = false;
+		bool any = true;
+
+		ByteSet() noexcept = default;
+		explicit ByteSet(unsigned char ch) noexcept : a(ch), b(ch), any(false) {}
+		ByteSet(unsigned char a_, unsigned char b_, bool leads_) noexcept : a(a_), b(b_), leads(leads_), any(false) {}
+
+		bool Specific(unsigned char ch) const noexcept {
+			return ch == a || ch == b;
+		}
+		bool Contains(unsigned char ch) const noexcept {
+			return any || Specific(ch) || (leads && ch >= 0xC0);
+		}
+	};
+
+private:
+	ByteSet first;
+	ByteSet second;
+
+	bool Candidate(const unsigned char *s, ptrdiff_t i, ptrdiff_t available) const noexcept {
+		const unsigned char ch = s[i];
+		if (first.Specific(ch))
+			return (i + 1 >= available) || second.Contains(s[i + 1]);
+		return first.leads && ch >= 0xC0;
+	}
+
+public:
+	/// first must not be 'any'. second applies to the byte after a specific first byte.
+	SearchFilter(ByteSet first_, ByteSet second_) noexcept;
+
+	/// Returns the index of the first candidate in [0, length) of s or -1.
+	/// available is the count of bytes that can be read at s (>= length). A byte after that
+	/// is treated as unknown, so a specific first byte just before it is a candidate.
+	ptrdiff_t Forward(const char *s, ptrdiff_t length, ptrdiff_t available) const noexcept;
+	/// Returns the index of the last candidate in [0, length) of s or -1.
+	ptrdiff_t Backward(const char *s, ptrdiff_t length, ptrdiff_t available) const noexcept;
+};
+
+}
+
+#endif
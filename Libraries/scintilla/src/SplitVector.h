@@ -206,11 +206,12 @@ public:
 	/// Add some new empty elements.
 	/// InsertValue is good for value objects but not for unique_ptr objects
 	/// since they can only be moved from once.
-	void InsertEmpty(ptrdiff_t position, ptrdiff_t insertLength) {
+	/// Returns a pointer to the first element inserted or nullptr if none.
+	T *InsertEmpty(ptrdiff_t position, ptrdiff_t insertLength) {
 		PLATFORM_ASSERT((position >= 0) && (position <= lengthBody));
 		if (insertLength > 0) {
 			if ((position < 0) || (position > lengthBody)) {
-				return;
+				return nullptr;
 			}
 			RoomFor(insertLength);
 			GapTo(position);
@@ -221,7 +222,9 @@ public:
 			lengthBody += insertLength;
 			part1Length += insertLength;
 			gapLength -= insertLength;
+			return body.data() + part1Length - insertLength;
 		}
+		return nullptr;
 	}
 
 	/// Ensure at least length elements allocated,
@@ -325,6 +328,25 @@ public:
 	ptrdiff_t GapPosition() const noexcept {
 		return part1Length;
 	}
+
+	/// Return a pointer to the contiguous run of elements (before or after the gap) that
+	/// contains position, without rearranging the buffer.
+	/// start and length receive the range of the run. Returns nullptr when out of range.
+	const T *ContiguousRange(ptrdiff_t position, ptrdiff_t &start, ptrdiff_t &length) const noexcept {
+		if (position < 0 || position >= lengthBody) {
+			start = position;
+			length = 0;
+			return nullptr;
+		}
+		if (position < part1Length) {
+			start = 0;
+			length = part1Length;
+			return body.data();
+		}
+		start = part1Length;
+		length = lengthBody - part1Length;
+		return body.data() + part1Length + gapLength;
+	}
 };
 
 }
@@ -73,6 +73,7 @@ void FontMeasurements::ClearMeasurements() noexcept {
 	aveCharWidth = 1;
 	spaceWidth = 1;
 	sizeZoomed = 2;
+	measureKey = 0;
 }
 
 Style::Style() : FontSpecification() {
@@ -50,6 +50,7 @@ struct FontMeasurements {
 	XYPOSITION aveCharWidth;
 	XYPOSITION spaceWidth;
 	int sizeZoomed;
+	unsigned int measureKey;	// The same for fonts that measure text the same, 0 until realised
 	FontMeasurements() noexcept;
 	void ClearMeasurements() noexcept;
 };
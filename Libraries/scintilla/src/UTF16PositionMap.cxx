@@ -0,0 +1,339 @@
+// Scintilla source code edit control
+/** @file UTF16PositionMap.cxx
+ ** Maps byte positions of UTF-8 text to UTF-16 positions and back.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "Platform.h"
+
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "ChunkedVector.h"
+#include "CellBuffer.h"
+#include "UniConversion.h"
+#include "UTF16PositionMap.h"
+
+using namespace Scintilla;
+
+namespace {
+
+constexpr uint64_t highBits = 0x8080808080808080ULL;
+
+// Valid UTF-8 is counted with each byte weighted on its own: trail bytes 0, 4-byte leads 2, others 1.
+
+constexpr int UnitsOfByte(unsigned char ch) noexcept {
+	return UTF8IsTrailByte(ch) ? 0 : ((ch >= 0xF0) ? 2 : 1);
+}
+
+// Number of bytes of a word with their high bit set, when all other bits are clear.
+constexpr int CountHighBits(uint64_t bits) noexcept {
+	return static_cast<int>((((bits >> 7) * 0x0101010101010101ULL) >> 56) & 0xFF);
+}
+
+// Counts 8 bytes at once: a byte 10xxxxxx has bit 7 set and bit 6 clear, a byte 1111xxxx bits 7 to 4 set.
+// Shifting the word left moves bits 6, 5 and 4 of each byte into its bit 7.
+inline int UnitsOfWord(const char *s) noexcept {
+	uint64_t w;
+	memcpy(&w, s, sizeof(w));
+	if ((w & highBits) == 0)
+		return 8;
+	const uint64_t trails = w & ~(w << 1) & highBits;
+	const uint64_t fourByteLeads = w & (w << 1) & (w << 2) & (w << 3) & highBits;
+	return 8 - CountHighBits(trails) + CountHighBits(fourByteLeads);
+}
+
+// Advances pos up to end over valid UTF-8 while the UTF-16 position stays within target, stopping at a
+// character that would pass it, so trail bytes after target are passed over but not a lead byte.
+Sci::Position ScanValid(const CellBuffer &cb, Sci::Position pos, Sci::Position end, Sci::Position &units, Sci::Position target) noexcept {
+	while (pos < end) {
+		Sci::Position startRange = 0;
+		Sci::Position lengthRange = 0;
+		const char *range = cb.ContiguousRange(pos, startRange, lengthRange);
+		if (!range || (lengthRange <= 0)) {
+			const int unitsByte = UnitsOfByte(cb.UCharAt(pos));
+			if (units + unitsByte > target)
+				return pos;
+			units += unitsByte;
+			pos++;
+			continue;
+		}
+		const char *s = range + pos - startRange;
+		const Sci::Position length = std::min(end, startRange + lengthRange) - pos;
+		Sci::Position i = 0;
+		while (i + 8 <= length) {
+			const int unitsWord = UnitsOfWord(s + i);
+			if (units + unitsWord >= target)
+				break;
+			units += unitsWord;
+			i += 8;
+		}
+		for (; i < length; i++) {
+			const int unitsByte = UnitsOfByte(s[i]);
+			if (units + unitsByte > target)
+				return pos + i;
+			units += unitsByte;
+		}
+		pos += length;
+	}
+	return pos;
+}
+
+// Other text is counted a character at a time as for SC_LINECHARACTERINDEX_UTF16: 4 bytes as 2 units,
+// other characters and each byte of invalid UTF-8 as 1 unit.
+
+inline int UnitsOfCharacter(const unsigned char *us, size_t len, int &lenChar) noexcept {
+	lenChar = UTF8Classify(us, len) & UTF8MaskWidth;
+	return (lenChar == UTF8MaxBytes) ? 2 : 1;
+}
+
+int UnitsOfCharacterAt(const CellBuffer &cb, Sci::Position pos, int &lenChar) noexcept {
+	unsigned char bytes[UTF8MaxBytes] {};
+	const Sci::Position len = std::min<Sci::Position>(UTF8MaxBytes, cb.Length() - pos);
+	for (Sci::Position i = 0; i < len; i++) {
+		bytes[i] = cb.UCharAt(pos + i);
+	}
+	return UnitsOfCharacter(bytes, len, lenChar);
+}
+
+// The end of the character that pos is inside, or pos when a character or an invalid byte starts there.
+// A character is only a lead byte and trail bytes, so the nearest lead byte before pos is where one starts.
+Sci::Position CharacterEnd(const CellBuffer &cb, Sci::Position pos) noexcept {
+	if ((pos >= cb.Length()) || !UTF8IsTrailByte(cb.UCharAt(pos)))
+		return pos;
+	for (Sci::Position lead = pos - 1; (lead >= 0) && (lead > pos - UTF8MaxBytes); lead--) {
+		if (!UTF8IsTrailByte(cb.UCharAt(lead))) {
+			int lenChar = 1;
+			UnitsOfCharacterAt(cb, lead, lenChar);
+			return std::max(pos, lead + lenChar);
+		}
+	}
+	return pos;
+}
+
+// Advances pos over the characters starting before end while the UTF-16 position stays within target,
+// adding their units. Returns the position reached, which is past end when a character crosses it.
+// Clears valid on an invalid byte.
+Sci::Position ScanCharacters(const CellBuffer &cb, Sci::Position pos, Sci::Position end, Sci::Position &units, Sci::Position target, bool &valid) noexcept {
+	const Sci::Position length = cb.Length();
+	while (pos < end) {
+		Sci::Position startRange = 0;
+		Sci::Position lengthRange = 0;
+		const char *range = cb.ContiguousRange(pos, startRange, lengthRange);
+		const Sci::Position endRange = startRange + lengthRange;
+		// Characters are classified in place while the bytes they may take are in the range
+		const Sci::Position endInPlace = (endRange < length) ? endRange - (UTF8MaxBytes - 1) : endRange;
+		if (!range || (pos >= endInPlace)) {
+			int lenChar = 1;
+			const int unitsChar = UnitsOfCharacterAt(cb, pos, lenChar);
+			if (units + unitsChar > target)
+				return pos;
+			if ((lenChar == 1) && (cb.UCharAt(pos) >= 0x80))
+				valid = false;
+			units += unitsChar;
+			pos += lenChar;
+			continue;
+		}
+		const unsigned char *us = reinterpret_cast<const unsigned char *>(range);
+		const Sci::Position endScan = std::min(end, endInPlace);
+		while (pos < endScan) {
+			if ((pos + 8 <= endScan) && (units + 8 <= target)) {
+				// 8 ASCII bytes at once
+				uint64_t w;
+				memcpy(&w, us + pos - startRange, sizeof(w));
+				if ((w & highBits) == 0) {
+					units += 8;
+					pos += 8;
+					continue;
+				}
+			}
+			int lenChar = 1;
+			const int unitsChar = UnitsOfCharacter(us + pos - startRange, std::min<Sci::Position>(UTF8MaxBytes, endRange - pos), lenChar);
+			if (units + unitsChar > target)
+				return pos;
+			if ((lenChar == 1) && (us[pos - startRange] >= 0x80))
+				valid = false;
+			units += unitsChar;
+			pos += lenChar;
+		}
+	}
+	return pos;
+}
+
+// The units of the characters starting from start up to end, so counts of adjacent ranges add up:
+// a character crossing start was counted before it and one crossing end is counted here.
+// Clears valid when the range holds invalid UTF-8.
+Sci::Position UnitsInRange(const CellBuffer &cb, Sci::Position start, Sci::Position end, bool &valid) noexcept {
+	Sci::Position units = 0;
+	ScanCharacters(cb, CharacterEnd(cb, start), end, units, std::numeric_limits<Sci::Position>::max(), valid);
+	return units;
+}
+
+}
+
+UTF16PositionMap::UTF16PositionMap() : starts(8), startsUTF16(8) {
+}
+
+UTF16PositionMap::~UTF16PositionMap() {
+}
+
+Sci::Position UTF16PositionMap::BlockLength(Sci::Position block) const noexcept {
+	return starts.PositionFromPartition(block + 1) - starts.PositionFromPartition(block);
+}
+
+void UTF16PositionMap::Split(const CellBuffer &cb, Sci::Position block) {
+	const Sci::Position start = starts.PositionFromPartition(block);
+	const Sci::Position end = starts.PositionFromPartition(block + 1);
+	Sci::Position startUTF16 = startsUTF16.PositionFromPartition(block);
+	std::vector<Sci::Position> positions;
+	std::vector<Sci::Position> positionsUTF16;
+	std::vector<bool> validBlocks;
+	// The last block keeps the rest, from blockSize to less than 2 * blockSize bytes
+	for (Sci::Position pos = start + blockSize; end - pos >= blockSize; pos += blockSize) {
+		bool valid = true;
+		startUTF16 += UnitsInRange(cb, pos - blockSize, pos, valid);
+		positions.push_back(pos);
+		positionsUTF16.push_back(startUTF16);
+		validBlocks.push_back(valid);
+	}
+	if (!positions.empty()) {
+		starts.InsertPartitions(block + 1, positions.data(), positions.size());
+		startsUTF16.InsertPartitions(block + 1, positionsUTF16.data(), positionsUTF16.size());
+		// The rest is part of the block that was split so is valid when that was
+		validBlocks.push_back(validity[block]);
+		validity[block] = validBlocks.front();
+		validity.insert(validity.begin() + block + 1, validBlocks.begin() + 1, validBlocks.end());
+	}
+}
+
+void UTF16PositionMap::JoinShort(Sci::Position block) {
+	const Sci::Position length = BlockLength(block);
+	if ((starts.Partitions() <= 1) || (length >= blockSize / 2))
+		return;
+	// Joins with the previous or next block when the result is not long enough to split
+	if ((block > 0) && (BlockLength(block - 1) + length < 2 * blockSize)) {
+		starts.RemovePartition(block);
+		startsUTF16.RemovePartition(block);
+		validity[block - 1] = validity[block - 1] && validity[block];
+		validity.erase(validity.begin() + block);
+	} else if ((block + 1 < starts.Partitions()) && (length + BlockLength(block + 1) < 2 * blockSize)) {
+		starts.RemovePartition(block + 1);
+		startsUTF16.RemovePartition(block + 1);
+		validity[block] = validity[block] && validity[block + 1];
+		validity.erase(validity.begin() + block + 1);
+	}
+}
+
+void UTF16PositionMap::Recount(const CellBuffer &cb, Sci::Position start, Sci::Position end) {
+	// A change may join the bytes around it into a character or break one apart, so these are counted again
+	const Sci::Position blockFirst = starts.PartitionFromPosition(std::max<Sci::Position>(start - (UTF8MaxBytes - 1), 0));
+	const Sci::Position blockLast = starts.PartitionFromPosition(end + UTF8MaxBytes - 1);
+	for (Sci::Position block = blockFirst; block <= blockLast; block++) {
+		bool valid = true;
+		const Sci::Position units = UnitsInRange(cb, starts.PositionFromPartition(block), starts.PositionFromPartition(block + 1), valid);
+		const Sci::Position unitsBefore = startsUTF16.PositionFromPartition(block + 1) - startsUTF16.PositionFromPartition(block);
+		startsUTF16.InsertText(block, units - unitsBefore);
+		validity[block] = valid;
+	}
+}
+
+void UTF16PositionMap::Init(const CellBuffer &cb) {
+	starts.DeleteAll();
+	startsUTF16.DeleteAll();
+	validity.assign(1, false);
+	const Sci::Position length = cb.Length();
+	starts.InsertText(0, length);
+	Split(cb, 0);
+	// Split counted all but the last block, so the end is set after it
+	const Sci::Position blockLast = starts.Partitions() - 1;
+	bool valid = true;
+	const Sci::Position endUTF16 = startsUTF16.PositionFromPartition(blockLast) +
+		UnitsInRange(cb, starts.PositionFromPartition(blockLast), length, valid);
+	startsUTF16.InsertText(blockLast, endUTF16 - LengthUTF16());
+	validity[blockLast] = valid;
+}
+
+void UTF16PositionMap::InsertText(const CellBuffer &cb, Sci::Position position, Sci::Position insertLength) {
+	const Sci::Position block = starts.PartitionFromPosition(position);
+	starts.InsertText(block, insertLength);
+	Recount(cb, position, position + insertLength);
+	if (BlockLength(block) >= 2 * blockSize)
+		Split(cb, block);
+}
+
+void UTF16PositionMap::DeleteText(const CellBuffer &cb, Sci::Position position, Sci::Position deleteLength) {
+	const Sci::Position end = position + deleteLength;
+	// The blocks starting inside the deletion are joined with the block where it starts
+	const Sci::Position block = starts.PartitionFromPosition(position);
+	const Sci::Position blockEnd = starts.PartitionFromPosition(end);
+	if (blockEnd > block) {
+		starts.RemovePartitions(block + 1, blockEnd - block);
+		startsUTF16.RemovePartitions(block + 1, blockEnd - block);
+		validity.erase(validity.begin() + block + 1, validity.begin() + blockEnd + 1);
+	}
+	starts.InsertText(block, -deleteLength);
+	Recount(cb, position, position);
+	JoinShort(block);
+}
+
+Sci::Position UTF16PositionMap::LengthUTF16() const noexcept {
+	return startsUTF16.PositionFromPartition(startsUTF16.Partitions());
+}
+
+void UTF16PositionMap::FindBlock(Sci::Position block, Hint &hint) const noexcept {
+	hint.position = starts.PositionFromPartition(block);
+	hint.positionUTF16 = startsUTF16.PositionFromPartition(block);
+	hint.end = starts.PositionFromPartition(block + 1);
+	hint.endUTF16 = startsUTF16.PositionFromPartition(block + 1);
+	hint.valid = validity[block];
+}
+
+Sci::Position UTF16PositionMap::UTF16FromPosition(const CellBuffer &cb, Sci::Position pos, Hint &hint) const noexcept {
+	pos = std::clamp<Sci::Position>(pos, 0, cb.Length());
+	if ((pos < hint.position) || (pos >= hint.end)) {
+		FindBlock(starts.PartitionFromPosition(pos), hint);
+	}
+	Sci::Position units = hint.positionUTF16;
+	if (hint.valid) {
+		ScanValid(cb, hint.position, pos, units, std::numeric_limits<Sci::Position>::max());
+	} else {
+		bool valid = false;
+		units += UnitsInRange(cb, hint.position, pos, valid);
+	}
+	hint.position = pos;
+	hint.positionUTF16 = units;
+	return units;
+}
+
+Sci::Position UTF16PositionMap::PositionFromUTF16(const CellBuffer &cb, Sci::Position posUTF16, Hint &hint) const noexcept {
+	posUTF16 = std::clamp<Sci::Position>(posUTF16, 0, LengthUTF16());
+	if ((posUTF16 < hint.positionUTF16) || (posUTF16 >= hint.endUTF16)) {
+		FindBlock(startsUTF16.PartitionFromPosition(posUTF16), hint);
+	}
+	Sci::Position pos = hint.position;
+	Sci::Position units = hint.positionUTF16;
+	if (hint.valid) {
+		pos = ScanValid(cb, pos, hint.end, units, posUTF16);
+	}
+	if (!hint.valid || (pos >= hint.end)) {
+		// Scans on past the block for the trail bytes of a character crossing its end.
+		// A character crossing pos was counted before it.
+		bool valid = false;
+		pos = ScanCharacters(cb, CharacterEnd(cb, pos), cb.Length(), units, posUTF16, valid);
+	}
+	hint.position = pos;
+	hint.positionUTF16 = units;
+	return pos;
+}
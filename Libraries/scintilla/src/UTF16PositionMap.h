@@ -0,0 +1,83 @@
+// Scintilla source code edit control
+/** @file UTF16PositionMap.h
+ ** Maps byte positions of UTF-8 text to UTF-16 positions and back.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef UTF16POSITIONMAP_H
+#define UTF16POSITIONMAP_H
+
+namespace Scintilla {
+
+/**
+ * Divides the text of a CellBuffer into blocks of about blockSize bytes, holding the byte and UTF-16 start of each,
+ * so converting a position only counts the text from the start of its block.
+ * Text is counted as by SC_LINECHARACTERINDEX_UTF16, each byte of invalid UTF-8 being 1 code unit.
+ * Blocks may start inside a character, which is counted in the block holding its lead byte.
+ * Blocks of valid UTF-8 are counted a word at a time, others a character at a time.
+ * Inserting and deleting text counts again the blocks it touches, splitting those grown too long and joining those too short.
+ */
+class UTF16PositionMap {
+	Partitioning<Sci::Position> starts;
+	Partitioning<Sci::Position> startsUTF16;
+	std::vector<bool> validity;
+
+	/// Remembers the last position converted in a block, so converting sorted positions
+	/// only counts the text between them.
+	struct Hint {
+		Sci::Position position = 0;
+		Sci::Position positionUTF16 = 0;
+		Sci::Position end = -1;
+		Sci::Position endUTF16 = -1;
+		bool valid = false;
+	};
+
+	Sci::Position BlockLength(Sci::Position block) const noexcept;
+	void Split(const CellBuffer &cb, Sci::Position block);
+	void JoinShort(Sci::Position block);
+	void Recount(const CellBuffer &cb, Sci::Position start, Sci::Position end);
+	void FindBlock(Sci::Position block, Hint &hint) const noexcept;
+	Sci::Position UTF16FromPosition(const CellBuffer &cb, Sci::Position pos, Hint &hint) const noexcept;
+	Sci::Position PositionFromUTF16(const CellBuffer &cb, Sci::Position posUTF16, Hint &hint) const noexcept;
+
+public:
+	static constexpr Sci::Position blockSize = 0x1000;
+
+	UTF16PositionMap();
+	// Deleted so UTF16PositionMap objects can not be copied.
+	UTF16PositionMap(const UTF16PositionMap &) = delete;
+	UTF16PositionMap(UTF16PositionMap &&) = delete;
+	UTF16PositionMap &operator=(const UTF16PositionMap &) = delete;
+	UTF16PositionMap &operator=(UTF16PositionMap &&) = delete;
+	~UTF16PositionMap();
+
+	/// Divides all the text of cb.
+	void Init(const CellBuffer &cb);
+	/// Called after insertLength bytes were inserted into cb at position.
+	void InsertText(const CellBuffer &cb, Sci::Position position, Sci::Position insertLength);
+	/// Called after deleteLength bytes were deleted from cb at position.
+	void DeleteText(const CellBuffer &cb, Sci::Position position, Sci::Position deleteLength);
+	Sci::Position LengthUTF16() const noexcept;
+
+	/// Convert count positions in place, fastest when sorted.
+	/// Positions are clamped to the text. A UTF-16 position between the halves of a surrogate pair
+	/// converts to the start of the character; a byte position inside a character to the UTF-16 position after it.
+	template <typename POS>
+	void UTF16FromPositions(const CellBuffer &cb, POS *positions, size_t count) const noexcept {
+		Hint hint;
+		for (size_t i = 0; i < count; i++) {
+			positions[i] = static_cast<POS>(UTF16FromPosition(cb, positions[i], hint));
+		}
+	}
+	template <typename POS>
+	void PositionsFromUTF16(const CellBuffer &cb, POS *positions, size_t count) const noexcept {
+		Hint hint;
+		for (size_t i = 0; i < count; i++) {
+			positions[i] = static_cast<POS>(PositionFromUTF16(cb, positions[i], hint));
+		}
+	}
+};
+
+}
+
+#endif
@@ -5,16 +5,188 @@
 // Copyright 1998-2001 by Neil Hodgson <neilh@scintilla.org>
 // The License.txt file describes the conditions under which this software may be distributed.
 
+#include <cstddef>
 #include <cstdlib>
 
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define UNICONVERSION_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 
 #include "UniConversion.h"
 
 using namespace Scintilla;
 
+namespace {
+
+// Runs of ASCII are converted a block of 16 characters at a time, the rest one character at a time.
+// A run is only checked in blocks once its first block is all ASCII, as short runs between
+// other characters are common in many languages and are quicker to check one at a time.
+
+constexpr size_t blockSize = 16;
+
+constexpr bool IsASCIINotNul(unsigned int uch) noexcept {
+	return (uch != 0) && (uch < 0x80);
+}
+
+#ifdef UNICONVERSION_SSE2
+
+inline int LowestBit(unsigned int mask) noexcept {
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// A mask with a bit set for each of the 16 bytes at us that is not ASCII.
+inline unsigned int NotASCIIMask(const unsigned char *us) noexcept {
+	return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(us)));
+}
+
+// Packs the 16 characters at ws into bytes, returning a mask with a bit set for each character
+// that is not ASCII or is NUL. Only the bytes of the other characters hold their value.
+inline unsigned int PackWide(const wchar_t *ws, __m128i &bytes) noexcept {
+	const __m128i zero = _mm_setzero_si128();
+	if constexpr (sizeof(wchar_t) == 2) {
+		const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ws));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ws + 8));
+		const __m128i asciiA = _mm_andnot_si128(_mm_cmpeq_epi16(a, zero), _mm_cmpeq_epi16(_mm_and_si128(a, high), zero));
+		const __m128i asciiB = _mm_andnot_si128(_mm_cmpeq_epi16(b, zero), _mm_cmpeq_epi16(_mm_and_si128(b, high), zero));
+		bytes = _mm_packs_epi16(a, b);
+		return ~_mm_movemask_epi8(_mm_packs_epi16(asciiA, asciiB)) & 0xFFFF;
+	} else {
+		const __m128i high = _mm_set1_epi32(~0x7F);
+		__m128i v[4];
+		__m128i ascii[4];
+		for (int i = 0; i < 4; i++) {
+			v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ws + i * 4));
+			ascii[i] = _mm_andnot_si128(_mm_cmpeq_epi32(v[i], zero), _mm_cmpeq_epi32(_mm_and_si128(v[i], high), zero));
+		}
+		bytes = _mm_packs_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+		return ~_mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(ascii[0], ascii[1]),
+			_mm_packs_epi32(ascii[2], ascii[3]))) & 0xFFFF;
+	}
+}
+
+// Widens the 16 ASCII bytes of v into wchar_t at tbuf.
+inline void WidenASCII(__m128i v, wchar_t *tbuf) noexcept {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low = _mm_unpacklo_epi8(v, zero);
+	const __m128i high = _mm_unpackhi_epi8(v, zero);
+	if constexpr (sizeof(wchar_t) == 2) {
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf), low);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf + 8), high);
+	} else {
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf), _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf + 4), _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf + 8), _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf + 12), _mm_unpackhi_epi16(high, zero));
+	}
+}
+
+#endif
+
+// Length of the run of ASCII bytes starting at start.
+size_t ASCIIRun(std::string_view svu8, size_t start) noexcept {
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(svu8.data());
+	const size_t endFirst = std::min(svu8.length(), start + blockSize);
+	size_t i = start;
+	while ((i < endFirst) && (us[i] < 0x80))
+		i++;
+	if (i < endFirst)
+		return i - start;
+#ifdef UNICONVERSION_SSE2
+	for (; i + blockSize <= svu8.length(); i += blockSize) {
+		const unsigned int notASCII = NotASCIIMask(us + i);
+		if (notASCII)
+			return i + LowestBit(notASCII) - start;
+	}
+#endif
+	while ((i < svu8.length()) && (us[i] < 0x80))
+		i++;
+	return i - start;
+}
+
+// Length of the run of ASCII characters other than NUL starting at start.
+size_t ASCIIRun(std::wstring_view wsv, size_t start) noexcept {
+	const size_t endFirst = std::min(wsv.length(), start + blockSize);
+	size_t i = start;
+	while ((i < endFirst) && IsASCIINotNul(wsv[i]))
+		i++;
+	if (i < endFirst)
+		return i - start;
+#ifdef UNICONVERSION_SSE2
+	for (; i + blockSize <= wsv.length(); i += blockSize) {
+		__m128i bytes;
+		const unsigned int notASCII = PackWide(wsv.data() + i, bytes);
+		if (notASCII)
+			return i + LowestBit(notASCII) - start;
+	}
+#endif
+	while ((i < wsv.length()) && IsASCIINotNul(wsv[i]))
+		i++;
+	return i - start;
+}
+
+// Copies the run of ASCII bytes starting at start into tbuf, stopping when tlen characters are written.
+// Returns the number copied.
+size_t WidenASCIIRun(std::string_view svu8, size_t start, wchar_t *tbuf, size_t tlen) noexcept {
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(svu8.data());
+	const size_t endFirst = std::min({svu8.length(), start + blockSize, start + tlen});
+	size_t i = start;
+	size_t ui = 0;
+	for (; (i < endFirst) && (us[i] < 0x80); i++, ui++)
+		tbuf[ui] = us[i];
+	if (i < endFirst)
+		return ui;
+#ifdef UNICONVERSION_SSE2
+	for (; (i + blockSize <= svu8.length()) && (ui + blockSize <= tlen); i += blockSize, ui += blockSize) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(us + i));
+		if (_mm_movemask_epi8(v))
+			break;
+		WidenASCII(v, tbuf + ui);
+	}
+#endif
+	for (; (i < svu8.length()) && (us[i] < 0x80) && (ui < tlen); i++, ui++)
+		tbuf[ui] = us[i];
+	return ui;
+}
+
+// Copies the run of ASCII characters other than NUL starting at start into putf. Returns the number copied.
+size_t NarrowASCIIRun(std::wstring_view wsv, size_t start, char *putf) noexcept {
+	const size_t endFirst = std::min(wsv.length(), start + blockSize);
+	size_t i = start;
+	for (; (i < endFirst) && IsASCIINotNul(wsv[i]); i++)
+		putf[i - start] = static_cast<char>(wsv[i]);
+	if (i < endFirst)
+		return i - start;
+#ifdef UNICONVERSION_SSE2
+	for (; i + blockSize <= wsv.length(); i += blockSize) {
+		__m128i bytes;
+		if (PackWide(wsv.data() + i, bytes))
+			break;
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(putf + i - start), bytes);
+	}
+#endif
+	for (; (i < wsv.length()) && IsASCIINotNul(wsv[i]); i++)
+		putf[i - start] = static_cast<char>(wsv[i]);
+	return i - start;
+}
+
+}
+
 namespace Scintilla {
 
 size_t UTF8Length(std::wstring_view wsv) noexcept {
@@ -22,7 +194,10 @@ size_t UTF8Length(std::wstring_view wsv) noexcept {
 	for (size_t i = 0; i < wsv.length() && wsv[i];) {
 		const unsigned int uch = wsv[i];
 		if (uch < 0x80) {
-			len++;
+			const size_t lenASCII = ASCIIRun(wsv, i);
+			len += lenASCII;
+			i += lenASCII;
+			continue;
 		} else if (uch < 0x800) {
 			len += 2;
 		} else if ((uch >= SURROGATE_LEAD_FIRST) &&
@@ -54,7 +229,10 @@ void UTF8FromUTF16(std::wstring_view wsv, char *putf, size_t len) {
 	for (size_t i = 0; i < wsv.length() && wsv[i];) {
 		const unsigned int uch = wsv[i];
 		if (uch < 0x80) {
-			putf[k++] = static_cast<char>(uch);
+			const size_t lenASCII = NarrowASCIIRun(wsv, i, putf + k);
+			k += lenASCII;
+			i += lenASCII;
+			continue;
 		} else if (uch < 0x800) {
 			putf[k++] = static_cast<char>(0xC0 | (uch >> 6));
 			putf[k++] = static_cast<char>(0x80 | (uch & 0x3f));
@@ -102,6 +280,12 @@ size_t UTF16Length(std::string_view svu8) noexcept {
 	size_t ulen = 0;
 	for (size_t i = 0; i< svu8.length();) {
 		const unsigned char ch = svu8[i];
+		if (ch < 0x80) {
+			const size_t lenASCII = ASCIIRun(svu8, i);
+			ulen += lenASCII;
+			i += lenASCII;
+			continue;
+		}
 		const unsigned int byteCount = UTF8BytesOfLead[ch];
 		const unsigned int utf16Len = UTF16LengthFromUTF8ByteCount(byteCount);
 		i += byteCount;
@@ -120,6 +304,12 @@ size_t UTF16FromUTF8(std::string_view svu8, wchar_t *tbuf, size_t tlen) {
 	size_t ui = 0;
 	for (size_t i = 0; i < svu8.length();) {
 		unsigned char ch = svu8[i];
+		if ((ch < 0x80) && (ui < tlen)) {
+			const size_t lenASCII = WidenASCIIRun(svu8, i, tbuf + ui, tlen - ui);
+			ui += lenASCII;
+			i += lenASCII;
+			continue;
+		}
 		const unsigned int byteCount = UTF8BytesOfLead[ch];
 		unsigned int value;
 
@@ -365,20 +555,25 @@ int UTF8DrawBytes(const unsigned char *us, int len) noexcept {
 	return (utf8StatusNext & UTF8MaskInvalid) ? 1 : (utf8StatusNext & UTF8MaskWidth);
 }
 
-bool UTF8IsValid(std::string_view svu8) noexcept {
+// Length of the start of svu8 that is valid UTF-8.
+size_t UTF8ValidLength(std::string_view svu8) noexcept {
 	const unsigned char *us = reinterpret_cast<const unsigned char *>(svu8.data());
-	size_t remaining = svu8.length();
-	while (remaining > 0) {
-		const int utf8Status = UTF8Classify(us, remaining);
-		if (utf8Status & UTF8MaskInvalid) {
-			return false;
-		} else {
-			const int lenChar = utf8Status & UTF8MaskWidth;
-			us += lenChar;
-			remaining -= lenChar;
+	size_t i = 0;
+	while (i < svu8.length()) {
+		if (us[i] < 0x80) {
+			i += ASCIIRun(svu8, i);
+			continue;
 		}
+		const int utf8Status = UTF8Classify(us + i, svu8.length() - i);
+		if (utf8Status & UTF8MaskInvalid)
+			break;
+		i += utf8Status & UTF8MaskWidth;
 	}
-	return remaining == 0;
+	return i;
+}
+
+bool UTF8IsValid(std::string_view svu8) noexcept {
+	return UTF8ValidLength(svu8) == svu8.length();
 }
 
 // Replace invalid bytes in UTF-8 with the replacement character
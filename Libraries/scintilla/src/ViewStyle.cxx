@@ -10,11 +10,13 @@
 #include <cstring>
 
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <memory>
+#include <mutex>
 
 #include "Platform.h"
 
@@ -29,6 +31,25 @@
 
 using namespace Scintilla;
 
+namespace {
+
+// Fonts created with the same parameters measure text the same, in any view.
+// Views may be on different threads so the keys are shared under a lock.
+unsigned int MeasureKey(const FontParameters &fp) {
+	static std::mutex mutexKeys;
+	static std::map<std::string, unsigned int> keys;
+	std::string parameters(fp.faceName);
+	parameters.push_back('\0');
+	for (const int value : { static_cast<int>(fp.size * 1000), fp.weight, fp.italic ? 1 : 0,
+		fp.extraFontFlag, fp.technology, fp.characterSet }) {
+		parameters.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+	std::lock_guard<std::mutex> guard(mutexKeys);
+	return keys.emplace(parameters, static_cast<unsigned int>(keys.size() + 1)).first->second;
+}
+
+}
+
 MarginStyle::MarginStyle(int style_, int width_, int mask_) noexcept :
 	style(style_), width(width_), mask(mask_), sensitive(false), cursor(SC_CURSORREVERSEARROW) {
 }
@@ -48,6 +69,7 @@ void FontRealised::Realise(Surface &surface, int zoomLevel, int technology, cons
 	const float deviceHeight = static_cast<float>(surface.DeviceHeightFont(sizeZoomed));
 	const FontParameters fp(fs.fontName, deviceHeight / SC_FONT_SIZE_MULTIPLIER, fs.weight, fs.italic, fs.extraFontFlag, technology, fs.characterSet);
 	font.Create(fp);
+	measureKey = MeasureKey(fp);
 
 	ascent = static_cast<unsigned int>(surface.Ascent(font));
 	descent = static_cast<unsigned int>(surface.Descent(font));
@@ -260,6 +260,69 @@ public:
 
 }
 
+namespace {
+
+//Au: a read-only file mapped in memory, for Sci_OpenMappedFile.
+//If the file can't be mapped, eg is too big for the address space of a 32-bit process, the document reads it a step at a time.
+class MappedFile : public IMappedText {
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+	HANDLE hMapping = NULL;
+	const char* data = nullptr;
+	Sci::Position length = 0;
+public:
+	MappedFile() noexcept = default;
+	// Deleted so MappedFile objects can not be copied.
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile&&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile& operator=(MappedFile&&) = delete;
+	~MappedFile() override {
+		if(data) ::UnmapViewOfFile(data);
+		if(hMapping) ::CloseHandle(hMapping);
+		if(hFile != INVALID_HANDLE_VALUE) ::CloseHandle(hFile);
+	}
+
+	//Other processes can append to the file (eg logs), but the document shows the size at the time of opening.
+	//The mapping has that size, and Windows does not let other processes truncate a file while it is mapped.
+	bool Open(const wchar_t* file) noexcept {
+		hFile = ::CreateFileW(file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if(hFile == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size{};
+		if(!::GetFileSizeEx(hFile, &size) || size.QuadPart > PTRDIFF_MAX) return false;
+		length = static_cast<Sci::Position>(size.QuadPart);
+		if(length == 0) return true;
+		hMapping = ::CreateFileMappingW(hFile, NULL, PAGE_READONLY, size.HighPart, size.LowPart, NULL);
+		if(hMapping) data = static_cast<const char*>(::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(length)));
+		if(!data && hMapping) { ::CloseHandle(hMapping); hMapping = NULL; }
+		return true;
+	}
+
+	const char* Data() const noexcept override {
+		if(!data && length) return nullptr; //not mapped, Read is used
+		return data ? data : "";
+	}
+	Sci::Position Length() const noexcept override {
+		return length;
+	}
+	Sci::Position Read(Sci::Position position, char* buffer, Sci::Position readLength) noexcept override {
+		readLength = std::min(readLength, length - position);
+		Sci::Position got = 0;
+		while(got < readLength) {
+			OVERLAPPED o{};
+			const ULONGLONG offset = static_cast<ULONGLONG>(position + got);
+			o.Offset = static_cast<DWORD>(offset);
+			o.OffsetHigh = static_cast<DWORD>(offset >> 32);
+			const DWORD n = static_cast<DWORD>(std::min<Sci::Position>(readLength - got, 0x1000000));
+			DWORD nRead = 0;
+			if(!::ReadFile(hFile, buffer + got, n, &nRead, &o) || nRead == 0) break;
+			got += nRead;
+		}
+		return got;
+	}
+};
+
+}
+
 /**
  */
 class ScintillaWin :
@@ -472,6 +535,64 @@ public:
 			}
 		}
 	}
+
+	//Finds all matches of text in the target range, with the search flags, like repeated SCI_SEARCHINTARGET.
+	//matches - receives start and end of max capacity matches. Can be null.
+	//indicator - if >= 0, sets it with the current indicator value in all matches.
+	//maxMatches - if > 0, stops after finding this count of matches.
+	//Returns the count of matches, or -1 if the regular expression is invalid. Does not change the target.
+	int Sci_FindAll(const char* text, int length, int indicator, int maxMatches, int* matches, int capacity) {
+		struct Sink : FindAllSink {
+			int indicator, * matches, capacity, n;
+			std::vector<Sci_IndicatorRange> ranges; //filled with the indicator in one pass after the search
+			bool Match(Sci::Position position, Sci::Position length) override {
+				if(n < capacity) {
+					matches[n * 2] = (int)position;
+					matches[n * 2 + 1] = (int)(position + length);
+				}
+				n++;
+				if(indicator >= 0) ranges.push_back({ position, length });
+				return true;
+			}
+		} sink;
+		sink.indicator = indicator;
+		sink.matches = matches;
+		sink.capacity = matches ? capacity : 0;
+		sink.n = 0;
+
+		if(!pdoc->HasCaseFolder())
+			pdoc->SetCaseFolder(CaseFolderForEncoding());
+		const int indicatorPrev = pdoc->decorations->GetCurrentIndicator();
+		if(indicator >= 0) pdoc->DecorationSetCurrentIndicator(indicator);
+		int r;
+		try {
+			r = (int)pdoc->FindAll(targetStart, targetEnd, text, length, searchFlags, maxMatches, sink);
+		}
+		catch(RegexError&) {
+			errorStatus = SC_STATUS_WARN_REGEX;
+			r = -1;
+		}
+		if(indicator >= 0) {
+			pdoc->DecorationFillRanges(sink.ranges.data(), sink.ranges.size(), pdoc->decorations->GetCurrentValue());
+			pdoc->DecorationSetCurrentIndicator(indicatorPrev);
+		}
+		return r;
+	}
+
+	//Replaces the document with a read-only document that shows file mapped in memory, without loading it.
+	//The first part of the file is shown at once, and the rest is added in idle time.
+	//options - SC_DOCUMENTOPTION_x. Adds SC_DOCUMENTOPTION_TEXT_LARGE if the file is 2 GB or bigger.
+	//Returns false if fails to open the file.
+	bool Sci_OpenMappedFile(const wchar_t* file, int options) {
+		auto mf = std::make_unique<MappedFile>();
+		if(!mf->Open(file)) return false;
+		if(mf->Length() >= INT_MAX) options |= SC_DOCUMENTOPTION_TEXT_LARGE;
+		Document* doc = new Document(options);
+		doc->SetMappedText(std::move(mf));
+		doc->ExtendMapped();
+		SetDocPointer(doc);
+		return true;
+	}
 };
 
 HINSTANCE ScintillaWin::hInstance{};
@@ -3604,4 +3725,39 @@ EXPORT void __stdcall Sci_GetStylingInfo(ScintillaWin* sci, int flags, struct Sc
 	sci->Sci_GetStylingInfo(flags, r);
 }
 
+EXPORT int __stdcall Sci_FindAll(ScintillaWin* sci, const char* text, int length, int indicator, int maxMatches, int* matches, int capacity) {
+	return sci->Sci_FindAll(text, length, indicator, maxMatches, matches, capacity);
+}
+
+//Converts count UTF-8 positions in a to UTF-16 positions, in place. Fastest when sorted.
+//Each byte of invalid UTF-8 is 1 UTF-16 code unit, like with SC_LINECHARACTERINDEX_UTF16.
+EXPORT void __stdcall Sci_Pos16(ScintillaWin* sci, int* a, int count) {
+	sci->pdoc->UTF16FromPositions(a, count);
+}
+
+//Converts count UTF-16 positions in a to UTF-8 positions, in place. Fastest when sorted.
+EXPORT void __stdcall Sci_Pos8(ScintillaWin* sci, int* a, int count) {
+	sci->pdoc->PositionsFromUTF16(a, count);
+}
+
+//Gets text as UTF-16 without a UTF-8 or UTF-16 copy of all the text. Call repeatedly to get a big range a buffer at a time.
+//Converts text from *position up to end8 (if < 0, the end of the text), as many whole characters as fit in bufferLength.
+//Advances *position past the text converted. Returns the number of UTF-16 code units written to buffer.
+EXPORT Sci_Position __stdcall Sci_GetText16(ScintillaWin* sci, Sci_Position* position, Sci_Position end8, wchar_t* buffer, Sci_Position bufferLength) {
+	auto pdoc = sci->pdoc;
+	auto end = end8 < 0 ? pdoc->Length() : end8;
+	return pdoc->GetUTF16Range(*position, end, buffer, bufferLength);
+}
+
+//Inserts UTF-16 text at *position without a UTF-8 copy of all the text. Call repeatedly to insert big text a buffer at a time.
+//Advances *position past the inserted text. Returns the number of UTF-16 code units inserted.
+//It is less than length if the text ends with a lead surrogate (pass it again with the rest of the text) or if the document is read-only.
+EXPORT Sci_Position __stdcall Sci_InsertText16(ScintillaWin* sci, Sci_Position* position, const wchar_t* text, Sci_Position length) {
+	return sci->pdoc->InsertUTF16(*position, text, length);
+}
+
+EXPORT BOOL __stdcall Sci_OpenMappedFile(ScintillaWin* sci, const wchar_t* file, int options) {
+	return sci->Sci_OpenMappedFile(file, options);
+}
+
 }
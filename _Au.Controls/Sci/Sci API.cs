@@ -30,6 +30,24 @@ namespace Au.Controls
 		public const int SCI_SETANNOTATIONDRAWCALLBACK = 9504;
 		public const int SCI_ISXINMARGIN = 9506;
 		public const int SCI_DRAGDROP = 9507;
+		public const int SCFIND_PCRE2 = 0x01000000; //with SCFIND_REGEXP: use PCRE2 (Perl syntax)
+		public const int SC_DOCUMENTOPTION_CHUNKED = 0x400; //SCI_CREATEDOCUMENT: hold text in chunks, for large documents edited in many places
+		public const int SCI_SETUNDOMEMORYLIMIT = 9508; //wParam: max bytes of undo text, 0 unlimited (default); the oldest undo actions are deleted
+		public const int SCI_GETUNDOMEMORYLIMIT = 9509;
+		public const int SCI_SETBACKGROUNDSTYLING = 9510; //wParam: bool; idle styling (SCI_SETIDLESTYLING) runs the lexer on another thread, for the document
+		public const int SCI_GETBACKGROUNDSTYLING = 9511;
+		public const int SCI_GETPOSITIONCACHESTATISTICS = 9512; //lParam: Sci_CacheStatistics*; the position cache is shared by the views of the document and grows when too small
+		public const int SCI_SETLAYOUTCACHEBUDGET = 9513; //wParam: max bytes of line layouts with SC_CACHE_DOCUMENT, 0 unlimited (default); the least recently used are dropped
+		public const int SCI_GETLAYOUTCACHEBUDGET = 9514;
+		public const int SCI_GETLAYOUTCACHESTATISTICS = 9515; //lParam: Sci_CacheStatistics*; size and used are line layouts held and those with positions
+		public const int SCI_SETBACKGROUNDWRAPPING = 9516; //wParam: bool; idle wrapping lays out lines on another thread, for the view; lines near the caret and on screen are wrapped first
+		public const int SCI_GETBACKGROUNDWRAPPING = 9517;
+		public const int SCI_MARGINSTYLEPREVIOUS = 9518; //wParam: line, lParam: style; the last line up to wParam with the text margin style, or -1
+		public const int SCI_MARGINSTYLELINES = 9519; //wParam: style, lParam: int* receiving the lines with the text margin style, or null; returns their count
+		public const int SCI_SETBATCHMODIFIED = 9520; //wParam: bool; SCN_MODIFIED of a user action, undo group or undo/redo are sent as one SCN_MODIFIEDBATCH when it ends, except SC_MOD_INSERTCHECK
+		public const int SCI_GETBATCHMODIFIED = 9521;
+		public const int SCI_INDICATORFILLRANGES = 9522; //wParam: count, lParam: Sci_IndicatorRange*; fills the ranges with the current indicator and value in one pass, fastest when sorted by position; one SCN_MODIFIED
+		public const int SCI_INDICATORCLEARRANGES = 9523; //wParam: count, lParam: Sci_IndicatorRange*; clears the current indicator in the ranges
 
 		[DllImport("SciLexer", EntryPoint = "Scintilla_DirectFunction")]
 		public static extern LPARAM Sci_Call(LPARAM sci, int message, LPARAM wParam = default, LPARAM lParam = default);
@@ -51,6 +69,51 @@ namespace Au.Controls
 		[DllImport("SciLexer")]
 		public static extern void Sci_GetStylingInfo(LPARAM sci, int flags, out Sci_StylingInfo r);
 
+		/// <summary>
+		/// Finds all matches of text in the target range, using the search flags. Like repeated SCI_SEARCHINTARGET, but in one pass.
+		/// matches - receives start and end of max capacity matches. Can be null.
+		/// indicator - if >= 0, sets it with the current indicator value in all matches.
+		/// maxMatches - if > 0, stops after finding this count of matches.
+		/// Returns the count of matches, or -1 if the regular expression is invalid.
+		/// </summary>
+		[DllImport("SciLexer")]
+		public static extern int Sci_FindAll(LPARAM sci, byte* text, int length, int indicator, int maxMatches, int* matches, int capacity);
+
+		/// <summary>
+		/// Converts count UTF-8 positions in a to UTF-16 positions, in place. Fastest when sorted.
+		/// Uses a map of UTF-16 positions of the text, created when first used and then updated when the text changes.
+		/// Each byte of invalid UTF-8 is 1 UTF-16 code unit, like with SC_LINECHARACTERINDEX_UTF16.
+		/// </summary>
+		[DllImport("SciLexer")]
+		public static extern void Sci_Pos16(LPARAM sci, int* a, int count);
+
+		/// <summary>
+		/// Converts count UTF-16 positions in a to UTF-8 positions, in place. Fastest when sorted.
+		/// A position between the halves of a surrogate pair converts to the start of the character.
+		/// </summary>
+		[DllImport("SciLexer")]
+		public static extern void Sci_Pos8(LPARAM sci, int* a, int count);
+
+		/// <summary>
+		/// Gets text as UTF-16 without making a UTF-8 or UTF-16 copy of all the text.
+		/// Converts text from *position up to end8 (if &lt; 0, the end of the text), as many whole characters as fit in bufferLength.
+		/// Advances *position past the converted text. Returns the number of UTF-16 code units written to buffer.
+		/// Call repeatedly to get a big range a buffer at a time.
+		/// </summary>
+		[DllImport("SciLexer")]
+		public static extern LPARAM Sci_GetText16(LPARAM sci, LPARAM* position, LPARAM end8, char* buffer, LPARAM bufferLength);
+
+		/// <summary>
+		/// Inserts UTF-16 text at *position without making a UTF-8 copy of all the text. Advances *position past the inserted text.
+		/// Returns the number of UTF-16 code units inserted. It is less than length if the text ends with a lead surrogate (pass it again with the rest of the text) or if the document is read-only.
+		/// Call repeatedly to insert big text a buffer at a time.
+		/// </summary>
+		[DllImport("SciLexer")]
+		public static extern LPARAM Sci_InsertText16(LPARAM sci, LPARAM* position, char* text, LPARAM length);
+
+		[DllImport("SciLexer", CharSet = CharSet.Unicode)]
+		public static extern bool Sci_OpenMappedFile(LPARAM sci, string file, int options);
+
 #pragma warning disable 649
 		public unsafe struct Sci_AnnotationDrawCallbackData
 		{
@@ -60,6 +123,22 @@ namespace Au.Controls
 			public byte* text;
 			public int textLen, line, annotLine;
 		};
+		public struct Sci_ModificationRecord
+		{
+			public MOD modificationType;
+			LPARAM _position, _length, _linesAdded, _line;
+			public int position => (int)_position;
+			public int length => (int)_length;
+			public int linesAdded => (int)_linesAdded;
+			public int line => (int)_line;
+		}
+		public struct Sci_IndicatorRange
+		{
+			LPARAM _position, _length;
+			public Sci_IndicatorRange(int position, int length) { _position = position; _length = length; }
+			public int position => (int)_position;
+			public int length => (int)_length;
+		}
 		public struct Sci_DragDropData
 		{
 			public int x, y;
@@ -67,6 +146,12 @@ namespace Au.Controls
 			public int len;
 			public int copy; //bool
 		}
+		public struct Sci_CacheStatistics
+		{
+			public int size, used; //entries
+			public long bytes;
+			public long lookups, hits, evictions;
+		}
 #pragma warning restore 649
 		#endregion
 
@@ -1092,6 +1177,7 @@ namespace Au.Controls
 			SC_MOD_INSERTCHECK = 0x100000,
 			SC_MOD_CHANGETABSTOPS = 0x200000,
 			SC_MODEVENTMASKALL = 0x3FFFFF,
+			SC_MOD_CHANGEFOLDLINES = 0x1000000, //Au: with SC_MOD_CHANGEFOLD: Sci_SetFoldLevels changed the fold levels of lines from line; length is the number of lines
 		}
 		public const int SC_UPDATE_CONTENT = 0x1;
 		public const int SC_UPDATE_SELECTION = 0x2;
@@ -1165,6 +1251,7 @@ namespace Au.Controls
 			SCN_AUTOCCOMPLETED = 2030,
 			SCN_MARGINRIGHTCLICK = 2031,
 			SCN_AUTOCSELECTIONCHANGE = 2032,
+			SCN_MODIFIEDBATCH = 2900, //Au: lParam: Sci_ModificationRecord*, length: their count, in the order of the modifications; modificationType: their types combined
 		}
 		public const int SC_BIDIRECTIONAL_DISABLED = 0;
 		public const int SC_BIDIRECTIONAL_L2R = 1;
@@ -40,6 +40,7 @@ namespace Au
 			int _skip;
 			Cpp.AccCallbackT _also;
 			char _resultProp;
+			string _resultProps;
 
 			/// <summary>
 			/// The found accessible object.
@@ -67,16 +68,41 @@ namespace Au
 				{
 					if(_also != null) throw new ArgumentException("ResultGetProperty cannot be used with parameter 'also'.");
 					if(_navig != null) throw new ArgumentException("ResultGetProperty cannot be used with parameter 'navig'.");
+					if(_resultProps != null) throw new ArgumentException("ResultGetProperty cannot be used with ResultGetProperties.");
 					_resultProp = value;
 				}
 			}
 
+			/// <summary>
+			/// Set this when you need multiple properties of the found accessible object(s), like with <see cref="GetProperties"/>.
+			/// The value is a string, the same as with <see cref="GetProperties"/>, for example "nv" for Name and Value.
+			/// The properties are retrieved while searching, in the same remote procedure call. Then don't need to call <b>GetProperties</b> for each object, which is slow when there are many objects.
+			/// Results are in <see cref="ResultProperties"/>.
+			/// </summary>
+			/// <exception cref="ArgumentException">Used <see cref="ResultGetProperty"/> or parameter <i>navig</i>.</exception>
+			public string ResultGetProperties
+			{
+				set
+				{
+					if(_resultProp != default) throw new ArgumentException("ResultGetProperties cannot be used with ResultGetProperty.");
+					if(_navig != null) throw new ArgumentException("ResultGetProperties cannot be used with parameter 'navig'.");
+					_resultProps = value;
+				}
+			}
+
+			/// <summary>
+			/// Properties of found accessible objects, depending on <see cref="ResultGetProperties"/>.
+			/// If used parameter <i>also</i>, contains properties of each object passed to <i>also</i>, in the same order. Else contains 0 or 1 element (the found object).
+			/// null if <b>ResultGetProperties</b> not used.
+			/// </summary>
+			public AccProperties[] ResultProperties { get; private set; }
+
 			/// <summary>
 			/// true if used parameter <i>navig</i> and the intermediate object was found but the navigation did not find the final object.
 			/// </summary>
 			public bool NavigFailed { get; private set; }
 
-			void _ClearResult() { Result = null; ResultProperty = null; NavigFailed = false; }
+			void _ClearResult() { Result = null; ResultProperty = null; ResultProperties = null; NavigFailed = false; }
 
 			/// <summary>
 			/// Stores the specified accessible object properties in this object. Reference: <see cref="AAcc.Find"/>.
@@ -221,12 +247,17 @@ namespace Au
 					secondsTimeout = -1; //for WaitChromeDisabled
 				}
 
-				var ap = new Cpp.Cpp_AccParams(_role, _name, _prop, flags, _skip, _resultProp);
+				var ap = new Cpp.Cpp_AccParams(_role, _name, _prop, flags, _skip, _resultProp, _resultProps);
 
 				var to = new AWaitFor.Loop(secondsTimeout, new OptWaitFor(period: inProc ? 10 : 40));
 				for(bool doneUAC = false, doneThread = false; ;) {
 					var hr = Cpp.Cpp_AccFind(w, aParent, in ap, _also, out var ca, out var sResult);
 
+					if(_resultProps != null && (hr == 0 || hr == Cpp.EError.NotFound)) {
+						ResultProperties = PropertiesFromPack_(_resultProps, sResult);
+						sResult = null;
+					}
+
 					if(hr == 0) {
 						switch(_resultProp) {
 						case '\0':
@@ -542,6 +573,35 @@ namespace Au
 			return a.ToArray();
 		}
 
+		/// <summary>
+		/// Finds all matching accessible objects in window, and gets their properties.
+		/// More info: <see cref="Find"/>, <see cref="GetProperties"/>.
+		/// </summary>
+		/// <param name="props">Properties to get, like with <see cref="GetProperties"/>. For example "nv" for Name and Value.</param>
+		/// <param name="properties">Receives properties of each found object. The array length and order are the same as of the returned array.</param>
+		/// <returns>Array of 0 or more elements.</returns>
+		/// <exception cref="ArgumentException">Exceptions of other overload. Also if <i>props</i> contains an unknown property character.</exception>
+		/// <exception cref="AuWndException"/>
+		/// <exception cref="AuException"/>
+		/// <remarks>
+		/// Much faster than calling <see cref="GetProperties"/> for each found object, because the properties are retrieved while searching, in the same remote procedure call.
+		/// </remarks>
+		/// <example>
+		/// <code><![CDATA[
+		/// var w = +AWnd.Find(null, "Shell_TrayWnd");
+		/// var a = AAcc.FindAll(w, "BUTTON", null, null, 0, "nr", out var p);
+		/// for(int i = 0; i < a.Length; i++) AOutput.Write(p[i].Name, p[i].Rect);
+		/// ]]></code>
+		/// </example>
+		public static AAcc[] FindAll(AWnd w, string role, string name, string prop, AFFlags flags, string props, out AccProperties[] properties)
+		{
+			var a = new List<AAcc>();
+			var f = new Finder(role, name, prop, flags, o => { a.Add(o); return false; }) { ResultGetProperties = props };
+			f.Find(w);
+			properties = f.ResultProperties;
+			return a.ToArray();
+		}
+
 		/// <summary>
 		/// Finds all matching descendant accessible objects (AO) of this AO.
 		/// More info: <see cref="Find"/>.
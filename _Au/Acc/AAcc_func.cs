@@ -801,35 +801,56 @@ namespace Au
 				ALastError.Code = hr;
 				return false;
 			}
-			using(b) {
-				var offsets = (int*)b.Ptr;
-				for(int i = 0; i < props.Length; i++) {
-					int offs = offsets[i], len = ((i == props.Length - 1) ? b.Length : offsets[i + 1]) - offs;
-					var p = b.Ptr + offs;
+			using(b) _PropertiesFromRecord(props, b.Ptr, b.Length, out result);
+			return true;
+		}
+
+		//Decodes a props record returned by Cpp_AccGetProps or Cpp_AccFind (resultProps). Format: int offsets[props.Length], then values.
+		static void _PropertiesFromRecord(string props, char* r, int recordLength, out AccProperties result)
+		{
+			result = default;
+			var offsets = (int*)r;
+			for(int i = 0; i < props.Length; i++) {
+				int offs = offsets[i], len = ((i == props.Length - 1) ? recordLength : offsets[i + 1]) - offs;
+				var p = r + offs;
+				switch(props[i]) {
+				case 'r': result.Rect = len > 0 ? *(RECT*)p : default; break;
+				case 's': result.State = len > 0 ? *(AccSTATE*)p : default; break;
+				case 'w': result.WndContainer = len > 0 ? (AWnd)(*(int*)p) : default; break;
+				case '@': result.HtmlAttributes = _AttributesToDictionary(p, len); break;
+				default:
+					var s = (len == 0) ? "" : new string(p, 0, len);
 					switch(props[i]) {
-					case 'r': result.Rect = len > 0 ? *(RECT*)p : default; break;
-					case 's': result.State = len > 0 ? *(AccSTATE*)p : default; break;
-					case 'w': result.WndContainer = len > 0 ? (AWnd)(*(int*)p) : default; break;
-					case '@': result.HtmlAttributes = _AttributesToDictionary(p, len); break;
-					default:
-						var s = (len == 0) ? "" : new string(p, 0, len);
-						switch(props[i]) {
-						case 'R': result.Role = s; break;
-						case 'n': result.Name = s; break;
-						case 'v': result.Value = s; break;
-						case 'd': result.Description = s; break;
-						case 'h': result.Help = s; break;
-						case 'a': result.DefaultAction = s; break;
-						case 'k': result.KeyboardShortcut = s; break;
-						case 'u': result.UiaId = s; break;
-						case 'o': result.OuterHtml = s; break;
-						case 'i': result.InnerHtml = s; break;
-						}
-						break;
+					case 'R': result.Role = s; break;
+					case 'n': result.Name = s; break;
+					case 'v': result.Value = s; break;
+					case 'd': result.Description = s; break;
+					case 'h': result.Help = s; break;
+					case 'a': result.DefaultAction = s; break;
+					case 'k': result.KeyboardShortcut = s; break;
+					case 'u': result.UiaId = s; break;
+					case 'o': result.OuterHtml = s; break;
+					case 'i': result.InnerHtml = s; break;
 					}
+					break;
 				}
 			}
-			return true;
+		}
+
+		//Decodes a pack of props records returned by Cpp_AccFind (resultProps). Format: int count, then for each record: int length, record.
+		internal static AccProperties[] PropertiesFromPack_(string props, string pack)
+		{
+			if(pack == null || pack.Length < 2) return Array.Empty<AccProperties>();
+			fixed (char* p = pack) {
+				int n = *(int*)p, pos = 2;
+				var a = new AccProperties[n];
+				for(int i = 0; i < n; i++) {
+					int len = *(int*)(p + pos); pos += 2;
+					_PropertiesFromRecord(props, p + pos, len, out a[i]);
+					pos += len;
+				}
+				return a;
+			}
 		}
 
 		static Dictionary<string, string> _AttributesToDictionary(char* p, int len)
@@ -43,6 +43,7 @@ namespace Au.Types
 		internal const int E_NOINTERFACE = unchecked((int)0x80004002);
 		internal const int E_FAIL = unchecked((int)0x80004005);
 		internal const int E_INVALIDARG = unchecked((int)0x80070057);
+		internal const int E_HANDLE = unchecked((int)0x80070006);
 		internal const int E_ACCESSDENIED = unchecked((int)0x80070005);
 		internal const int E_OUTOFMEMORY = unchecked((int)0x8007000E);
 		internal const int DISP_E_MEMBERNOTFOUND = unchecked((int)0x80020003);
@@ -50,8 +50,10 @@ namespace Au.Types
 			public AFFlags flags;
 			public int skip;
 			char resultProp; //AAcc.Finder.RProp
+			string _resultProps; //AAcc.Finder.ResultGetProperties
+			int _resultPropsLength;
 
-			public Cpp_AccParams(string role, string name, string prop, AFFlags flags, int skip, char resultProp) : this()
+			public Cpp_AccParams(string role, string name, string prop, AFFlags flags, int skip, char resultProp, string resultProps = null) : this()
 			{
 				if(role != null) { _role = role; _roleLength = role.Length; }
 				if(name != null) { _name = name; _nameLength = name.Length; }
@@ -59,6 +61,7 @@ namespace Au.Types
 				this.flags = flags;
 				this.skip = skip;
 				this.resultProp = resultProp;
+				if(resultProps != null) { _resultProps = resultProps; _resultPropsLength = resultProps.Length; }
 			}
 		}
 
@@ -71,13 +74,38 @@ namespace Au.Types
 			InvalidParameter = 0x1002, //invalid parameter, for example wildcard expression (or regular expression in it)
 			WindowClosed = 0x1003, //the specified window handle is invalid or the window was destroyed while injecting
 			WaitChromeDisabled = 0x1004, //need to wait while enabling Chrome AOs finished
+			Cancelled = 0x1005, //Cpp_AccFindAsync search cancelled
+			Timeout = 0x1006, //Cpp_AccFindAsync search deadline expired
+			Pending = 0x1007, //Cpp_AccFindAsyncWait: still searching
 		}
 
 		internal static bool IsCppError(int hr)
 		{
-			return hr >= (int)EError.NotFound && hr <= (int)EError.WaitChromeDisabled;
+			return hr >= (int)EError.NotFound && hr <= (int)EError.Pending;
 		}
 
+		//Asynchronous Cpp_AccFind. Returns a handle immediately. Supports timeout, cancellation and progress (count of visited AOs).
+		//Don't use 'also'; finds single AO.
+
+		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		internal static extern int Cpp_AccFindAsync(AWnd w, Cpp_Acc* aParent, in Cpp_AccParams ap, int timeoutMs, out int handle);
+
+		//Returns an HRESULT: 0 if found; an EError value if IsCppError (NotFound, Cancelled, Timeout, Pending...); else a COM error code, eg Api.E_HANDLE if the handle is invalid.
+		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		internal static extern int Cpp_AccFindAsyncWait(int handle, int waitMs, out Cpp_Acc aResult, [MarshalAs(UnmanagedType.BStr)] out string sResult, out int nodesVisited);
+
+		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		[return: MarshalAs(UnmanagedType.U1)]
+		internal static extern bool Cpp_AccFindAsyncCancel(int handle);
+
+		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		[return: MarshalAs(UnmanagedType.U1)]
+		internal static extern bool Cpp_AccFindAsyncClose(int handle);
+
+		//Closes all handles and waits until the search threads end. Call before unloading AuCpp.dll; its static destructor only cancels them.
+		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		internal static extern void Cpp_AccFindAsyncCloseAll();
+
 		/// <summary>
 		/// flags: 1 not inproc, 2 get only name.
 		/// </summary>
@@ -127,6 +155,10 @@ namespace Au.Types
 		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
 		internal static extern int Cpp_AccGetProps(Cpp_Acc a, string props, out BSTR sResult);
 
+		//Gets learned child-fetch stats of AO providers, for diagnostics. If w not default, of the in-proc agent in w process.
+		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		internal static extern int Cpp_AccChildStats(AWnd w, out BSTR sResult);
+
 
 		[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
 		static extern void Cpp_Unload();
@@ -164,6 +196,15 @@ namespace Au.Types
 		//[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
 		//internal static extern void Cpp_TestWildex(string s, string w);
 
+		//[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		//internal static extern void Cpp_TestAccAsync();
+
+		//[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		//internal static extern void Cpp_TestAccProps();
+
+		//[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
+		//internal static extern void Cpp_TestAccChildren();
+
 		//[DllImport("AuCpp.dll", CallingConvention = CallingConvention.Cdecl)]
 		//internal static extern int Cpp_TestInt(int a, int b, int c);
 